@@ -0,0 +1,84 @@
+#!/usr/bin/python3
+# SPDX-License-Identifier: LGPL-2.1+
+
+import argparse
+import gzip
+import hashlib
+import sys
+from xml.sax.saxutils import escape
+
+# keep in sync with plugins/test/fu-plugin-test.c
+KINDS = [(0x00, 'Scale Dock'),
+         (0x10, 'Scale Dock Controller'),
+         (0x20, 'Scale Dock Hub')]
+
+
+def _scale_guid(kind, idx):
+    return '{:08x}-0000-4000-8000-{:012x}'.format(0x273f0000 + kind, idx)
+
+
+def _generate_component(idx, kind, name, releases):
+    appstream_id = 'com.acme.test.scale.device{:05}.kind{:02x}.firmware'.format(idx, kind)
+    lines = []
+    lines.append('  <component type="firmware">')
+    lines.append('    <id>{}</id>'.format(appstream_id))
+    lines.append('    <name>{}</name>'.format(escape(name)))
+    lines.append('    <summary>Firmware for a synthetic load testing device</summary>')
+    lines.append('    <developer_name>ACME Corp.</developer_name>')
+    lines.append('    <project_license>proprietary</project_license>')
+    lines.append('    <provides>')
+    lines.append('      <firmware type="flashed">{}</firmware>'.format(_scale_guid(kind, idx)))
+    lines.append('    </provides>')
+    lines.append('    <releases>')
+    for rel in reversed(range(releases)):
+        version = '1.3.{}'.format(rel)
+        csum = hashlib.sha1('{}:{}'.format(appstream_id, version).encode()).hexdigest()
+        lines.append('      <release version="{}" timestamp="{}" urgency="medium">'.format(version, 1577836800 + rel * 86400))
+        lines.append('        <location>https://fwupd.org/downloads/{}-{}.cab</location>'.format(csum, version))
+        lines.append('        <checksum type="sha1" filename="{}-{}.cab" target="container">{}</checksum>'.format(csum, version, csum))
+        lines.append('        <description><p>This release fixes bugs and improves stability.</p></description>')
+        lines.append('        <size type="installed">65536</size>')
+        lines.append('        <size type="download">32768</size>')
+        lines.append('      </release>')
+    lines.append('    </releases>')
+    lines.append('    <requires>')
+    lines.append('      <id compare="ge" version="1.3.0">org.freedesktop.fwupd</id>')
+    lines.append('    </requires>')
+    lines.append('    <custom>')
+    lines.append('      <value key="LVFS::VersionFormat">triplet</value>')
+    lines.append('      <value key="LVFS::UpdateProtocol">com.acme.test</value>')
+    lines.append('    </custom>')
+    lines.append('  </component>')
+    return lines
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Generate metadata matching the '
+                                     'synthetic devices of the test plugin')
+    parser.add_argument('--devices', type=int, default=1000,
+                        help='the value of FWUPD_PLUGIN_TEST_SCALE')
+    parser.add_argument('--releases', type=int, default=5,
+                        help='releases for each component')
+    parser.add_argument('output', type=str, help='the output file, e.g. scale.xml.gz')
+    args = parser.parse_args()
+    if args.devices < 1 or args.releases < 1:
+        print('--devices and --releases must be positive')
+        return 1
+
+    lines = ['<?xml version="1.0" encoding="UTF-8"?>',
+             '<components origin="lvfs" version="0.9">']
+    for idx in range(args.devices):
+        for kind, name in KINDS:
+            lines.extend(_generate_component(idx, kind, name, args.releases))
+    lines.append('</components>')
+    data = '\n'.join(lines).encode() + b'\n'
+    if args.output.endswith('.gz'):
+        data = gzip.compress(data)
+    with open(args.output, 'wb') as f:
+        f.write(data)
+    print('wrote {} components to {}'.format(args.devices * len(KINDS), args.output))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -47,6 +47,8 @@ typedef struct {
 	gchar				*host_machine_id;
 	GDBusConnection			*conn;
 	GDBusProxy			*proxy;
+	GPtrArray			*changes_devices;	/* of GVariant, from GetChanges */
+	guint64				 changes_sequence;
 } FwupdClientPrivate;
 
 enum {
@@ -240,6 +242,36 @@ fwupd_client_signal_cb (GDBusProxy *proxy,
 	g_debug ("Unknown signal name '%s' from %s", signal_name, sender_name);
 }
 
+static void
+fwupd_client_set_proxy (FwupdClient *client, GDBusProxy *proxy)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	g_autoptr(GVariant) val = NULL;
+	g_autoptr(GVariant) val2 = NULL;
+
+	priv->conn = g_object_ref (g_dbus_proxy_get_connection (proxy));
+	priv->proxy = g_object_ref (proxy);
+	g_signal_connect (priv->proxy, "g-properties-changed",
+			  G_CALLBACK (fwupd_client_properties_changed_cb), client);
+	g_signal_connect (priv->proxy, "g-signal",
+			  G_CALLBACK (fwupd_client_signal_cb), client);
+	val = g_dbus_proxy_get_cached_property (priv->proxy, "DaemonVersion");
+	if (val != NULL)
+		fwupd_client_set_daemon_version (client, g_variant_get_string (val, NULL));
+	val2 = g_dbus_proxy_get_cached_property (priv->proxy, "Tainted");
+	if (val2 != NULL)
+		priv->tainted = g_variant_get_boolean (val2);
+	val2 = g_dbus_proxy_get_cached_property (priv->proxy, "Interactive");
+	if (val2 != NULL)
+		priv->interactive = g_variant_get_boolean (val2);
+	val = g_dbus_proxy_get_cached_property (priv->proxy, "HostProduct");
+	if (val != NULL)
+		fwupd_client_set_host_product (client, g_variant_get_string (val, NULL));
+	val = g_dbus_proxy_get_cached_property (priv->proxy, "HostMachineId");
+	if (val != NULL)
+		fwupd_client_set_host_machine_id (client, g_variant_get_string (val, NULL));
+}
+
 /**
  * fwupd_client_connect:
  * @client: A #FwupdClient
@@ -258,8 +290,8 @@ gboolean
 fwupd_client_connect (FwupdClient *client, GCancellable *cancellable, GError **error)
 {
 	FwupdClientPrivate *priv = GET_PRIVATE (client);
-	g_autoptr(GVariant) val = NULL;
-	g_autoptr(GVariant) val2 = NULL;
+	g_autoptr(GDBusConnection) conn = NULL;
+	g_autoptr(GDBusProxy) proxy = NULL;
 
 	g_return_val_if_fail (FWUPD_IS_CLIENT (client), FALSE);
 	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), FALSE);
@@ -270,41 +302,22 @@ fwupd_client_connect (FwupdClient *client, GCancellable *cancellable, GError **e
 		return TRUE;
 
 	/* connect to the daemon */
-	priv->conn = g_bus_get_sync (G_BUS_TYPE_SYSTEM, NULL, error);
-	if (priv->conn == NULL) {
+	conn = g_bus_get_sync (G_BUS_TYPE_SYSTEM, NULL, error);
+	if (conn == NULL) {
 		g_prefix_error (error, "Failed to connect to system D-Bus: ");
 		return FALSE;
 	}
-	priv->proxy = g_dbus_proxy_new_sync (priv->conn,
-					     G_DBUS_PROXY_FLAGS_NONE,
-					     NULL,
-					     FWUPD_DBUS_SERVICE,
-					     FWUPD_DBUS_PATH,
-					     FWUPD_DBUS_INTERFACE,
-					     NULL,
-					     error);
-	if (priv->proxy == NULL)
+	proxy = g_dbus_proxy_new_sync (conn,
+				       G_DBUS_PROXY_FLAGS_NONE,
+				       NULL,
+				       FWUPD_DBUS_SERVICE,
+				       FWUPD_DBUS_PATH,
+				       FWUPD_DBUS_INTERFACE,
+				       NULL,
+				       error);
+	if (proxy == NULL)
 		return FALSE;
-	g_signal_connect (priv->proxy, "g-properties-changed",
-			  G_CALLBACK (fwupd_client_properties_changed_cb), client);
-	g_signal_connect (priv->proxy, "g-signal",
-			  G_CALLBACK (fwupd_client_signal_cb), client);
-	val = g_dbus_proxy_get_cached_property (priv->proxy, "DaemonVersion");
-	if (val != NULL)
-		fwupd_client_set_daemon_version (client, g_variant_get_string (val, NULL));
-	val2 = g_dbus_proxy_get_cached_property (priv->proxy, "Tainted");
-	if (val2 != NULL)
-		priv->tainted = g_variant_get_boolean (val2);
-	val2 = g_dbus_proxy_get_cached_property (priv->proxy, "Interactive");
-	if (val2 != NULL)
-		priv->interactive = g_variant_get_boolean (val2);
-	val = g_dbus_proxy_get_cached_property (priv->proxy, "HostProduct");
-	if (val != NULL)
-		fwupd_client_set_host_product (client, g_variant_get_string (val, NULL));
-	val = g_dbus_proxy_get_cached_property (priv->proxy, "HostMachineId");
-	if (val != NULL)
-		fwupd_client_set_host_machine_id (client, g_variant_get_string (val, NULL));
-
+	fwupd_client_set_proxy (client, proxy);
 	return TRUE;
 }
 
@@ -383,6 +396,190 @@ fwupd_client_get_devices (FwupdClient *client, GCancellable *cancellable, GError
 	return fwupd_device_array_from_variant (val);
 }
 
+static gint
+fwupd_client_changes_find_device (FwupdClient *client, const gchar *device_id)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	for (guint i = 0; i < priv->changes_devices->len; i++) {
+		GVariant *value = g_ptr_array_index (priv->changes_devices, i);
+		const gchar *device_id_tmp = NULL;
+		if (!g_variant_lookup (value, FWUPD_RESULT_KEY_DEVICE_ID, "&s", &device_id_tmp))
+			continue;
+		if (g_strcmp0 (device_id, device_id_tmp) == 0)
+			return (gint) i;
+	}
+	return -1;
+}
+
+/* the old properties, without the ones changed or removed, plus the changed */
+static GVariant *
+fwupd_client_changes_merge (GVariant *value_old, GVariant *changed, const gchar **removed)
+{
+	GVariantBuilder builder;
+	GVariantIter iter;
+	GVariant *value;
+	const gchar *key;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+	g_variant_iter_init (&iter, value_old);
+	while (g_variant_iter_next (&iter, "{&sv}", &key, &value)) {
+		g_autoptr(GVariant) value_tmp = NULL;
+		if (changed != NULL)
+			value_tmp = g_variant_lookup_value (changed, key, NULL);
+		if (value_tmp == NULL &&
+		    (removed == NULL || !g_strv_contains (removed, key)))
+			g_variant_builder_add (&builder, "{sv}", key, value);
+		g_variant_unref (value);
+	}
+	if (changed != NULL) {
+		g_variant_iter_init (&iter, changed);
+		while (g_variant_iter_next (&iter, "{&sv}", &key, &value)) {
+			g_variant_builder_add (&builder, "{sv}", key, value);
+			g_variant_unref (value);
+		}
+	}
+	return g_variant_ref_sink (g_variant_builder_end (&builder));
+}
+
+static void
+fwupd_client_changes_apply (FwupdClient *client, GVariant *change)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	const gchar *device_id = NULL;
+	const gchar *kind = NULL;
+	gint idx;
+	GVariant *value_old;
+	g_autofree const gchar **removed = NULL;
+	g_autoptr(GVariant) changed = NULL;
+
+	if (!g_variant_lookup (change, "Kind", "&s", &kind))
+		return;
+	if (!g_variant_lookup (change, FWUPD_RESULT_KEY_DEVICE_ID, "&s", &device_id))
+		return;
+	changed = g_variant_lookup_value (change, "Changed", G_VARIANT_TYPE_VARDICT);
+	g_variant_lookup (change, "Removed", "^a&s", &removed);
+
+	idx = fwupd_client_changes_find_device (client, device_id);
+	if (g_strcmp0 (kind, "removed") == 0) {
+		if (idx >= 0)
+			g_ptr_array_remove_index (priv->changes_devices, idx);
+		return;
+	}
+	if (changed == NULL)
+		changed = g_variant_ref_sink (g_variant_new_array (G_VARIANT_TYPE ("{sv}"), NULL, 0));
+	if (idx < 0) {
+		g_ptr_array_add (priv->changes_devices, g_variant_ref (changed));
+		return;
+	}
+	value_old = priv->changes_devices->pdata[idx];
+	priv->changes_devices->pdata[idx] = fwupd_client_changes_merge (value_old, changed, removed);
+	g_variant_unref (value_old);
+}
+
+static gboolean
+fwupd_client_changes_resync (FwupdClient *client, GCancellable *cancellable, GError **error)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	g_autoptr(GVariant) val = NULL;
+	g_autoptr(GVariant) untuple = NULL;
+
+	val = g_dbus_proxy_call_sync (priv->proxy,
+				      "GetDevices",
+				      NULL,
+				      G_DBUS_CALL_FLAGS_NONE,
+				      -1,
+				      cancellable,
+				      error);
+	if (val == NULL) {
+		if (error != NULL)
+			fwupd_client_fixup_dbus_error (*error);
+		return FALSE;
+	}
+	g_ptr_array_set_size (priv->changes_devices, 0);
+	untuple = g_variant_get_child_value (val, 0);
+	for (gsize i = 0; i < g_variant_n_children (untuple); i++)
+		g_ptr_array_add (priv->changes_devices, g_variant_get_child_value (untuple, i));
+	return TRUE;
+}
+
+/**
+ * fwupd_client_sync_devices:
+ * @client: A #FwupdClient
+ * @cancellable: the #GCancellable, or %NULL
+ * @error: the #GError, or %NULL
+ *
+ * Gets all the devices registered with the daemon, like
+ * fwupd_client_get_devices(). The client keeps a copy of the device list and
+ * only asks the daemon for the properties that changed since the last call,
+ * which is much cheaper when called in response to #FwupdClient::changed.
+ *
+ * Properties only shown to privileged users, such as the serial number, are
+ * not included in the changes and so may be out of date.
+ *
+ * Returns: (element-type FwupdDevice) (transfer container): results
+ *
+ * Since: 1.4.2
+ **/
+GPtrArray *
+fwupd_client_sync_devices (FwupdClient *client, GCancellable *cancellable, GError **error)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	GPtrArray *devices;
+	gboolean resync = FALSE;
+	guint64 sequence = 0;
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GVariant) changes = NULL;
+	g_autoptr(GVariant) val = NULL;
+
+	g_return_val_if_fail (FWUPD_IS_CLIENT (client), NULL);
+	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	/* connect */
+	if (!fwupd_client_connect (client, cancellable, error))
+		return NULL;
+
+	/* call into daemon */
+	val = g_dbus_proxy_call_sync (priv->proxy,
+				      "GetChanges",
+				      g_variant_new ("(t)", priv->changes_sequence),
+				      G_DBUS_CALL_FLAGS_NONE,
+				      -1,
+				      cancellable,
+				      &error_local);
+	if (val == NULL) {
+		/* older daemon */
+		if (g_error_matches (error_local, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD))
+			return fwupd_client_get_devices (client, cancellable, error);
+		fwupd_client_fixup_dbus_error (error_local);
+		g_propagate_error (error, g_steal_pointer (&error_local));
+		return NULL;
+	}
+	g_variant_get (val, "(tb@aa{sv})", &sequence, &resync, &changes);
+	if (resync) {
+		if (!fwupd_client_changes_resync (client, cancellable, error))
+			return NULL;
+	} else {
+		for (gsize i = 0; i < g_variant_n_children (changes); i++) {
+			g_autoptr(GVariant) change = g_variant_get_child_value (changes, i);
+			fwupd_client_changes_apply (client, change);
+		}
+	}
+	priv->changes_sequence = sequence;
+
+	/* create new objects so the caller can modify them */
+	devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	for (guint i = 0; i < priv->changes_devices->len; i++) {
+		GVariant *value = g_ptr_array_index (priv->changes_devices, i);
+		FwupdDevice *dev = fwupd_device_from_variant (value);
+		if (dev == NULL)
+			continue;
+		g_ptr_array_add (devices, dev);
+	}
+	fwupd_device_array_ensure_parents (devices);
+	return devices;
+}
+
 /**
  * fwupd_client_get_history:
  * @client: A #FwupdClient
@@ -425,6 +622,85 @@ fwupd_client_get_history (FwupdClient *client, GCancellable *cancellable, GError
 	return fwupd_device_array_from_variant (val);
 }
 
+/**
+ * fwupd_client_get_history_full:
+ * @client: A #FwupdClient
+ * @device_id: (nullable): the device ID, or %NULL for all devices
+ * @update_state: a #FwupdUpdateState, or %FWUPD_UPDATE_STATE_UNKNOWN for all states
+ * @since: only return devices modified at or after this UNIX time, or 0
+ * @offset: number of matching devices to skip
+ * @limit: maximum number of devices to return, or 0 for no limit
+ * @cancellable: the #GCancellable, or %NULL
+ * @error: the #GError, or %NULL
+ *
+ * Gets a filtered page of the history, oldest first. Only the matching
+ * devices are sent by the daemon.
+ *
+ * Returns: (element-type FwupdDevice) (transfer container): results
+ *
+ * Since: 1.4.2
+ **/
+GPtrArray *
+fwupd_client_get_history_full (FwupdClient *client,
+			       const gchar *device_id,
+			       FwupdUpdateState update_state,
+			       guint64 since,
+			       guint offset,
+			       guint limit,
+			       GCancellable *cancellable,
+			       GError **error)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	GVariantBuilder builder;
+	g_autoptr(GVariant) val = NULL;
+
+	g_return_val_if_fail (FWUPD_IS_CLIENT (client), NULL);
+	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	/* connect */
+	if (!fwupd_client_connect (client, cancellable, error))
+		return NULL;
+
+	/* only send the filters that are set */
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+	if (device_id != NULL) {
+		g_variant_builder_add (&builder, "{sv}",
+				       "device-id", g_variant_new_string (device_id));
+	}
+	if (update_state != FWUPD_UPDATE_STATE_UNKNOWN) {
+		g_variant_builder_add (&builder, "{sv}",
+				       "update-state", g_variant_new_uint32 (update_state));
+	}
+	if (since != 0) {
+		g_variant_builder_add (&builder, "{sv}",
+				       "since", g_variant_new_uint64 (since));
+	}
+	if (offset != 0) {
+		g_variant_builder_add (&builder, "{sv}",
+				       "offset", g_variant_new_uint32 (offset));
+	}
+	if (limit != 0) {
+		g_variant_builder_add (&builder, "{sv}",
+				       "limit", g_variant_new_uint32 (limit));
+	}
+
+	/* call into daemon */
+	val = g_dbus_proxy_call_sync (priv->proxy,
+				      "GetHistoryFiltered",
+				      g_variant_new ("(a{sv})", &builder),
+				      G_DBUS_CALL_FLAGS_NONE,
+				      -1,
+				      cancellable,
+				      error);
+	if (val == NULL) {
+		if (error != NULL)
+			fwupd_client_fixup_dbus_error (*error);
+		return NULL;
+	}
+	return fwupd_device_array_from_variant (val);
+}
+
 /**
  * fwupd_client_get_device_by_id:
  * @client: A #FwupdClient
@@ -1028,51 +1304,19 @@ fwupd_client_send_message_cb (GObject *source_object, GAsyncResult *res, gpointe
 		fwupd_client_fixup_dbus_error (helper->error);
 	g_main_loop_quit (helper->loop);
 }
-#endif
 
-/**
- * fwupd_client_install:
- * @client: A #FwupdClient
- * @device_id: the device ID
- * @filename: the filename to install
- * @install_flags: the #FwupdInstallFlags, e.g. %FWUPD_INSTALL_FLAG_ALLOW_REINSTALL
- * @cancellable: the #GCancellable, or %NULL
- * @error: the #GError, or %NULL
- *
- * Install a file onto a specific device.
- *
- * Returns: %TRUE for success
- *
- * Since: 0.7.0
- **/
-gboolean
-fwupd_client_install (FwupdClient *client,
-		      const gchar *device_id,
-		      const gchar *filename,
-		      FwupdInstallFlags install_flags,
-		      GCancellable *cancellable,
-		      GError **error)
+static GDBusMessage *
+fwupd_client_install_request_new (const gchar *device_id,
+				  const gchar *filename,
+				  FwupdInstallFlags install_flags,
+				  GError **error)
 {
-#ifdef HAVE_GIO_UNIX
-	FwupdClientPrivate *priv = GET_PRIVATE (client);
-	GVariant *body;
+	GDBusMessage *request;
 	GVariantBuilder builder;
 	gint retval;
 	gint fd;
-	g_autoptr(FwupdClientHelper) helper = NULL;
-	g_autoptr(GDBusMessage) request = NULL;
 	g_autoptr(GUnixFDList) fd_list = NULL;
 
-	g_return_val_if_fail (FWUPD_IS_CLIENT (client), FALSE);
-	g_return_val_if_fail (device_id != NULL, FALSE);
-	g_return_val_if_fail (filename != NULL, FALSE);
-	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), FALSE);
-	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
-
-	/* connect */
-	if (!fwupd_client_connect (client, cancellable, error))
-		return FALSE;
-
 	/* set options */
 	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
 	g_variant_builder_add (&builder, "{sv}",
@@ -1103,12 +1347,13 @@ fwupd_client_install (FwupdClient *client,
 	/* open file */
 	fd = open (filename, O_RDONLY);
 	if (fd < 0) {
+		g_variant_builder_clear (&builder);
 		g_set_error (error,
 			     FWUPD_ERROR,
 			     FWUPD_ERROR_INVALID_FILE,
 			     "failed to open %s",
 			     filename);
-		return FALSE;
+		return NULL;
 	}
 
 	/* set out of band file descriptor */
@@ -1124,38 +1369,135 @@ fwupd_client_install (FwupdClient *client,
 	/* g_unix_fd_list_append did a dup() already */
 	close (fd);
 
-	/* call into daemon */
-	helper = fwupd_client_helper_new ();
-	body = g_variant_new ("(sha{sv})", device_id, fd, &builder);
-	g_dbus_message_set_body (request, body);
-	g_dbus_connection_send_message_with_reply (priv->conn,
-						   request,
-						   G_DBUS_SEND_MESSAGE_FLAGS_NONE,
-						   G_MAXINT,
-						   NULL,
-						   cancellable,
-						   fwupd_client_send_message_cb,
-						   helper);
-	g_main_loop_run (helper->loop);
-	if (!helper->ret) {
-		g_propagate_error (error, helper->error);
-		helper->error = NULL;
-		return FALSE;
-	}
-	return TRUE;
-#else
-	g_set_error_literal (error,
-			     FWUPD_ERROR,
-			     FWUPD_ERROR_NOT_SUPPORTED,
-			     "Not supported as <glib-unix.h> is unavailable");
-	return FALSE;
-#endif
+	g_dbus_message_set_body (request,
+				 g_variant_new ("(sha{sv})", device_id, fd, &builder));
+	return request;
 }
 
-/**
- * fwupd_client_get_details:
- * @client: A #FwupdClient
- * @filename: the firmware filename, e.g. `firmware.cab`
+static GDBusMessage *
+fwupd_client_update_metadata_request_new (const gchar *remote_id,
+					  const gchar *metadata_fn,
+					  const gchar *signature_fn,
+					  GError **error)
+{
+	GDBusMessage *request;
+	gint fd;
+	gint fd_sig;
+	g_autoptr(GUnixFDList) fd_list = NULL;
+
+	/* open file */
+	fd = open (metadata_fn, O_RDONLY);
+	if (fd < 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "failed to open %s",
+			     metadata_fn);
+		return NULL;
+	}
+	fd_sig = open (signature_fn, O_RDONLY);
+	if (fd_sig < 0) {
+		close (fd);
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "failed to open %s",
+			     signature_fn);
+		return NULL;
+	}
+
+	/* set out of band file descriptor */
+	fd_list = g_unix_fd_list_new ();
+	g_unix_fd_list_append (fd_list, fd, NULL);
+	g_unix_fd_list_append (fd_list, fd_sig, NULL);
+	request = g_dbus_message_new_method_call (FWUPD_DBUS_SERVICE,
+						  FWUPD_DBUS_PATH,
+						  FWUPD_DBUS_INTERFACE,
+						  "UpdateMetadata");
+	g_dbus_message_set_unix_fd_list (request, fd_list);
+
+	/* g_unix_fd_list_append did a dup() already */
+	close (fd);
+	close (fd_sig);
+
+	g_dbus_message_set_body (request,
+				 g_variant_new ("(shh)", remote_id, fd, fd_sig));
+	return request;
+}
+#endif
+
+/**
+ * fwupd_client_install:
+ * @client: A #FwupdClient
+ * @device_id: the device ID
+ * @filename: the filename to install
+ * @install_flags: the #FwupdInstallFlags, e.g. %FWUPD_INSTALL_FLAG_ALLOW_REINSTALL
+ * @cancellable: the #GCancellable, or %NULL
+ * @error: the #GError, or %NULL
+ *
+ * Install a file onto a specific device.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 0.7.0
+ **/
+gboolean
+fwupd_client_install (FwupdClient *client,
+		      const gchar *device_id,
+		      const gchar *filename,
+		      FwupdInstallFlags install_flags,
+		      GCancellable *cancellable,
+		      GError **error)
+{
+#ifdef HAVE_GIO_UNIX
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	g_autoptr(FwupdClientHelper) helper = NULL;
+	g_autoptr(GDBusMessage) request = NULL;
+
+	g_return_val_if_fail (FWUPD_IS_CLIENT (client), FALSE);
+	g_return_val_if_fail (device_id != NULL, FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	/* connect */
+	if (!fwupd_client_connect (client, cancellable, error))
+		return FALSE;
+	request = fwupd_client_install_request_new (device_id, filename,
+						    install_flags, error);
+	if (request == NULL)
+		return FALSE;
+
+	/* call into daemon */
+	helper = fwupd_client_helper_new ();
+	g_dbus_connection_send_message_with_reply (priv->conn,
+						   request,
+						   G_DBUS_SEND_MESSAGE_FLAGS_NONE,
+						   G_MAXINT,
+						   NULL,
+						   cancellable,
+						   fwupd_client_send_message_cb,
+						   helper);
+	g_main_loop_run (helper->loop);
+	if (!helper->ret) {
+		g_propagate_error (error, helper->error);
+		helper->error = NULL;
+		return FALSE;
+	}
+	return TRUE;
+#else
+	g_set_error_literal (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_SUPPORTED,
+			     "Not supported as <glib-unix.h> is unavailable");
+	return FALSE;
+#endif
+}
+
+/**
+ * fwupd_client_get_details:
+ * @client: A #FwupdClient
+ * @filename: the firmware filename, e.g. `firmware.cab`
  * @cancellable: the #GCancellable, or %NULL
  * @error: the #GError, or %NULL
  *
@@ -1399,12 +1741,8 @@ fwupd_client_update_metadata (FwupdClient *client,
 {
 #ifdef HAVE_GIO_UNIX
 	FwupdClientPrivate *priv = GET_PRIVATE (client);
-	GVariant *body;
-	gint fd;
-	gint fd_sig;
 	g_autoptr(FwupdClientHelper) helper = NULL;
 	g_autoptr(GDBusMessage) request = NULL;
-	g_autoptr(GUnixFDList) fd_list = NULL;
 
 	g_return_val_if_fail (FWUPD_IS_CLIENT (client), FALSE);
 	g_return_val_if_fail (remote_id != NULL, FALSE);
@@ -1416,45 +1754,14 @@ fwupd_client_update_metadata (FwupdClient *client,
 	/* connect */
 	if (!fwupd_client_connect (client, cancellable, error))
 		return FALSE;
-
-	/* open file */
-	fd = open (metadata_fn, O_RDONLY);
-	if (fd < 0) {
-		g_set_error (error,
-			     FWUPD_ERROR,
-			     FWUPD_ERROR_INVALID_FILE,
-			     "failed to open %s",
-			     metadata_fn);
+	request = fwupd_client_update_metadata_request_new (remote_id,
+							    metadata_fn,
+							    signature_fn,
+							    error);
+	if (request == NULL)
 		return FALSE;
-	}
-	fd_sig = open (signature_fn, O_RDONLY);
-	if (fd_sig < 0) {
-		close (fd);
-		g_set_error (error,
-			     FWUPD_ERROR,
-			     FWUPD_ERROR_INVALID_FILE,
-			     "failed to open %s",
-			     signature_fn);
-		return FALSE;
-	}
-
-	/* set out of band file descriptor */
-	fd_list = g_unix_fd_list_new ();
-	g_unix_fd_list_append (fd_list, fd, NULL);
-	g_unix_fd_list_append (fd_list, fd_sig, NULL);
-	request = g_dbus_message_new_method_call (FWUPD_DBUS_SERVICE,
-						  FWUPD_DBUS_PATH,
-						  FWUPD_DBUS_INTERFACE,
-						  "UpdateMetadata");
-	g_dbus_message_set_unix_fd_list (request, fd_list);
-
-	/* g_unix_fd_list_append did a dup() already */
-	close (fd);
-	close (fd_sig);
 
 	/* call into daemon */
-	body = g_variant_new ("(shh)", remote_id, fd, fd_sig);
-	g_dbus_message_set_body (request, body);
 	helper = fwupd_client_helper_new ();
 	g_dbus_connection_send_message_with_reply (priv->conn,
 						   request,
@@ -1843,6 +2150,842 @@ fwupd_client_get_remote_by_id (FwupdClient *client,
 	return g_object_ref (remote);
 }
 
+typedef GPtrArray *(*FwupdClientArrayFunc)	(GVariant	*value);
+
+typedef struct {
+	gchar			*method;
+	GVariant		*params;	/* nullable */
+	GDBusMessage		*request;	/* nullable, for passing fds */
+	gint			 timeout_msec;
+	FwupdClientArrayFunc	 array_func;	/* nullable */
+} FwupdClientCallHelper;
+
+static void
+fwupd_client_call_helper_free (FwupdClientCallHelper *helper)
+{
+	if (helper->params != NULL)
+		g_variant_unref (helper->params);
+	if (helper->request != NULL)
+		g_object_unref (helper->request);
+	g_free (helper->method);
+	g_free (helper);
+}
+
+static void
+fwupd_client_connect_proxy_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	g_autoptr(GTask) task = G_TASK (user_data);
+	FwupdClient *client = g_task_get_source_object (task);
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	GError *error = NULL;
+	g_autoptr(GDBusProxy) proxy = NULL;
+
+	proxy = g_dbus_proxy_new_finish (res, &error);
+	if (proxy == NULL) {
+		g_task_return_error (task, error);
+		return;
+	}
+
+	/* another call might have connected first */
+	if (priv->proxy == NULL)
+		fwupd_client_set_proxy (client, proxy);
+	g_task_return_boolean (task, TRUE);
+}
+
+static void
+fwupd_client_connect_bus_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	g_autoptr(GTask) task = G_TASK (user_data);
+	GError *error = NULL;
+	g_autoptr(GDBusConnection) conn = NULL;
+
+	conn = g_bus_get_finish (res, &error);
+	if (conn == NULL) {
+		g_prefix_error (&error, "Failed to connect to system D-Bus: ");
+		g_task_return_error (task, error);
+		return;
+	}
+	g_dbus_proxy_new (conn,
+			  G_DBUS_PROXY_FLAGS_NONE,
+			  NULL,
+			  FWUPD_DBUS_SERVICE,
+			  FWUPD_DBUS_PATH,
+			  FWUPD_DBUS_INTERFACE,
+			  g_task_get_cancellable (task),
+			  fwupd_client_connect_proxy_cb,
+			  g_steal_pointer (&task));
+}
+
+/**
+ * fwupd_client_connect_async:
+ * @client: A #FwupdClient
+ * @cancellable: the #GCancellable, or %NULL
+ * @callback: the function to run on completion
+ * @user_data: the data to pass to @callback
+ *
+ * Sets up the client ready for use without blocking. The other
+ * asynchronous methods call this for you.
+ *
+ * Since: 1.4.2
+ **/
+void
+fwupd_client_connect_async (FwupdClient *client,
+			    GCancellable *cancellable,
+			    GAsyncReadyCallback callback,
+			    gpointer user_data)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	g_autoptr(GTask) task = NULL;
+
+	g_return_if_fail (FWUPD_IS_CLIENT (client));
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+	task = g_task_new (client, cancellable, callback, user_data);
+	g_task_set_source_tag (task, fwupd_client_connect_async);
+
+	/* nothing to do */
+	if (priv->proxy != NULL) {
+		g_task_return_boolean (task, TRUE);
+		return;
+	}
+	g_bus_get (G_BUS_TYPE_SYSTEM,
+		   cancellable,
+		   fwupd_client_connect_bus_cb,
+		   g_steal_pointer (&task));
+}
+
+/**
+ * fwupd_client_connect_finish:
+ * @client: A #FwupdClient
+ * @res: the #GAsyncResult
+ * @error: the #GError, or %NULL
+ *
+ * Gets the result of fwupd_client_connect_async().
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.4.2
+ **/
+gboolean
+fwupd_client_connect_finish (FwupdClient *client, GAsyncResult *res, GError **error)
+{
+	g_return_val_if_fail (FWUPD_IS_CLIENT (client), FALSE);
+	g_return_val_if_fail (g_task_is_valid (res, client), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+	return g_task_propagate_boolean (G_TASK (res), error);
+}
+
+static void
+fwupd_client_call_return (GTask *task, GVariant *val)
+{
+	FwupdClientCallHelper *helper = g_task_get_task_data (task);
+	if (helper->array_func == NULL) {
+		g_task_return_boolean (task, TRUE);
+		return;
+	}
+	g_task_return_pointer (task,
+			       helper->array_func (val),
+			       (GDestroyNotify) g_ptr_array_unref);
+}
+
+static void
+fwupd_client_call_proxy_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	g_autoptr(GTask) task = G_TASK (user_data);
+	GError *error = NULL;
+	g_autoptr(GVariant) val = NULL;
+
+	val = g_dbus_proxy_call_finish (G_DBUS_PROXY (source), res, &error);
+	if (val == NULL) {
+		fwupd_client_fixup_dbus_error (error);
+		g_task_return_error (task, error);
+		return;
+	}
+	fwupd_client_call_return (task, val);
+}
+
+#ifdef HAVE_GIO_UNIX
+static void
+fwupd_client_call_message_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	g_autoptr(GTask) task = G_TASK (user_data);
+	GError *error = NULL;
+	g_autoptr(GDBusMessage) reply = NULL;
+
+	reply = g_dbus_connection_send_message_with_reply_finish (G_DBUS_CONNECTION (source),
+								  res, &error);
+	if (reply == NULL || g_dbus_message_to_gerror (reply, &error)) {
+		fwupd_client_fixup_dbus_error (error);
+		g_task_return_error (task, error);
+		return;
+	}
+	fwupd_client_call_return (task, g_dbus_message_get_body (reply));
+}
+#endif
+
+static void
+fwupd_client_call_dispatch (GTask *task)
+{
+	FwupdClient *client = g_task_get_source_object (task);
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	FwupdClientCallHelper *helper = g_task_get_task_data (task);
+
+#ifdef HAVE_GIO_UNIX
+	if (helper->request != NULL) {
+		g_dbus_connection_send_message_with_reply (priv->conn,
+							   helper->request,
+							   G_DBUS_SEND_MESSAGE_FLAGS_NONE,
+							   helper->timeout_msec,
+							   NULL,
+							   g_task_get_cancellable (task),
+							   fwupd_client_call_message_cb,
+							   task);
+		return;
+	}
+#endif
+	g_dbus_proxy_call (priv->proxy,
+			   helper->method,
+			   helper->params,
+			   G_DBUS_CALL_FLAGS_NONE,
+			   helper->timeout_msec,
+			   g_task_get_cancellable (task),
+			   fwupd_client_call_proxy_cb,
+			   task);
+}
+
+static void
+fwupd_client_call_connect_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	GTask *task = G_TASK (user_data);
+	GError *error = NULL;
+
+	if (!fwupd_client_connect_finish (FWUPD_CLIENT (source), res, &error)) {
+		g_task_return_error (task, error);
+		g_object_unref (task);
+		return;
+	}
+	fwupd_client_call_dispatch (task);
+}
+
+/* takes ownership of @helper; the D-Bus calls are sent as soon as the client
+ * is connected, so several can be in flight on the same connection */
+static void
+fwupd_client_call_async (FwupdClient *client,
+			 FwupdClientCallHelper *helper,
+			 gpointer source_tag,
+			 GCancellable *cancellable,
+			 GAsyncReadyCallback callback,
+			 gpointer user_data)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	GTask *task = g_task_new (client, cancellable, callback, user_data);
+
+	g_task_set_source_tag (task, source_tag);
+	g_task_set_task_data (task, helper, (GDestroyNotify) fwupd_client_call_helper_free);
+	if (helper->params != NULL)
+		g_variant_ref_sink (helper->params);
+	if (priv->proxy == NULL) {
+		fwupd_client_connect_async (client, cancellable,
+					    fwupd_client_call_connect_cb, task);
+		return;
+	}
+	fwupd_client_call_dispatch (task);
+}
+
+static FwupdClientCallHelper *
+fwupd_client_call_helper_new (const gchar *method,
+			      GVariant *params,
+			      FwupdClientArrayFunc array_func)
+{
+	FwupdClientCallHelper *helper = g_new0 (FwupdClientCallHelper, 1);
+	helper->method = g_strdup (method);
+	helper->params = params;
+	helper->array_func = array_func;
+	helper->timeout_msec = -1;
+	return helper;
+}
+
+static GPtrArray *
+fwupd_client_call_array_finish (FwupdClient *client,
+				GAsyncResult *res,
+				gpointer source_tag,
+				GError **error)
+{
+	g_return_val_if_fail (FWUPD_IS_CLIENT (client), NULL);
+	g_return_val_if_fail (g_task_is_valid (res, client), NULL);
+	g_return_val_if_fail (g_task_get_source_tag (G_TASK (res)) == source_tag, NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+	return g_task_propagate_pointer (G_TASK (res), error);
+}
+
+static gboolean
+fwupd_client_call_boolean_finish (FwupdClient *client,
+				  GAsyncResult *res,
+				  gpointer source_tag,
+				  GError **error)
+{
+	g_return_val_if_fail (FWUPD_IS_CLIENT (client), FALSE);
+	g_return_val_if_fail (g_task_is_valid (res, client), FALSE);
+	g_return_val_if_fail (g_task_get_source_tag (G_TASK (res)) == source_tag, FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+	return g_task_propagate_boolean (G_TASK (res), error);
+}
+
+/**
+ * fwupd_client_get_devices_async:
+ * @client: A #FwupdClient
+ * @cancellable: the #GCancellable, or %NULL
+ * @callback: the function to run on completion
+ * @user_data: the data to pass to @callback
+ *
+ * Gets all the devices registered with the daemon without blocking.
+ *
+ * Since: 1.4.2
+ **/
+void
+fwupd_client_get_devices_async (FwupdClient *client,
+				GCancellable *cancellable,
+				GAsyncReadyCallback callback,
+				gpointer user_data)
+{
+	g_return_if_fail (FWUPD_IS_CLIENT (client));
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+	fwupd_client_call_async (client,
+				 fwupd_client_call_helper_new ("GetDevices", NULL,
+							       fwupd_device_array_from_variant),
+				 fwupd_client_get_devices_async,
+				 cancellable, callback, user_data);
+}
+
+/**
+ * fwupd_client_get_devices_finish:
+ * @client: A #FwupdClient
+ * @res: the #GAsyncResult
+ * @error: the #GError, or %NULL
+ *
+ * Gets the result of fwupd_client_get_devices_async().
+ *
+ * Returns: (element-type FwupdDevice) (transfer container): results
+ *
+ * Since: 1.4.2
+ **/
+GPtrArray *
+fwupd_client_get_devices_finish (FwupdClient *client, GAsyncResult *res, GError **error)
+{
+	return fwupd_client_call_array_finish (client, res,
+					       fwupd_client_get_devices_async,
+					       error);
+}
+
+/**
+ * fwupd_client_get_history_async:
+ * @client: A #FwupdClient
+ * @cancellable: the #GCancellable, or %NULL
+ * @callback: the function to run on completion
+ * @user_data: the data to pass to @callback
+ *
+ * Gets all the history without blocking.
+ *
+ * Since: 1.4.2
+ **/
+void
+fwupd_client_get_history_async (FwupdClient *client,
+				GCancellable *cancellable,
+				GAsyncReadyCallback callback,
+				gpointer user_data)
+{
+	g_return_if_fail (FWUPD_IS_CLIENT (client));
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+	fwupd_client_call_async (client,
+				 fwupd_client_call_helper_new ("GetHistory", NULL,
+							       fwupd_device_array_from_variant),
+				 fwupd_client_get_history_async,
+				 cancellable, callback, user_data);
+}
+
+/**
+ * fwupd_client_get_history_finish:
+ * @client: A #FwupdClient
+ * @res: the #GAsyncResult
+ * @error: the #GError, or %NULL
+ *
+ * Gets the result of fwupd_client_get_history_async().
+ *
+ * Returns: (element-type FwupdDevice) (transfer container): results
+ *
+ * Since: 1.4.2
+ **/
+GPtrArray *
+fwupd_client_get_history_finish (FwupdClient *client, GAsyncResult *res, GError **error)
+{
+	return fwupd_client_call_array_finish (client, res,
+					       fwupd_client_get_history_async,
+					       error);
+}
+
+/**
+ * fwupd_client_get_releases_async:
+ * @client: A #FwupdClient
+ * @device_id: the device ID
+ * @cancellable: the #GCancellable, or %NULL
+ * @callback: the function to run on completion
+ * @user_data: the data to pass to @callback
+ *
+ * Gets all the releases for a specific device without blocking.
+ *
+ * Since: 1.4.2
+ **/
+void
+fwupd_client_get_releases_async (FwupdClient *client,
+				 const gchar *device_id,
+				 GCancellable *cancellable,
+				 GAsyncReadyCallback callback,
+				 gpointer user_data)
+{
+	g_return_if_fail (FWUPD_IS_CLIENT (client));
+	g_return_if_fail (device_id != NULL);
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+	fwupd_client_call_async (client,
+				 fwupd_client_call_helper_new ("GetReleases",
+							       g_variant_new ("(s)", device_id),
+							       fwupd_release_array_from_variant),
+				 fwupd_client_get_releases_async,
+				 cancellable, callback, user_data);
+}
+
+/**
+ * fwupd_client_get_releases_finish:
+ * @client: A #FwupdClient
+ * @res: the #GAsyncResult
+ * @error: the #GError, or %NULL
+ *
+ * Gets the result of fwupd_client_get_releases_async().
+ *
+ * Returns: (element-type FwupdRelease) (transfer container): results
+ *
+ * Since: 1.4.2
+ **/
+GPtrArray *
+fwupd_client_get_releases_finish (FwupdClient *client, GAsyncResult *res, GError **error)
+{
+	return fwupd_client_call_array_finish (client, res,
+					       fwupd_client_get_releases_async,
+					       error);
+}
+
+/**
+ * fwupd_client_get_downgrades_async:
+ * @client: A #FwupdClient
+ * @device_id: the device ID
+ * @cancellable: the #GCancellable, or %NULL
+ * @callback: the function to run on completion
+ * @user_data: the data to pass to @callback
+ *
+ * Gets all the downgrades for a specific device without blocking.
+ *
+ * Since: 1.4.2
+ **/
+void
+fwupd_client_get_downgrades_async (FwupdClient *client,
+				   const gchar *device_id,
+				   GCancellable *cancellable,
+				   GAsyncReadyCallback callback,
+				   gpointer user_data)
+{
+	g_return_if_fail (FWUPD_IS_CLIENT (client));
+	g_return_if_fail (device_id != NULL);
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+	fwupd_client_call_async (client,
+				 fwupd_client_call_helper_new ("GetDowngrades",
+							       g_variant_new ("(s)", device_id),
+							       fwupd_release_array_from_variant),
+				 fwupd_client_get_downgrades_async,
+				 cancellable, callback, user_data);
+}
+
+/**
+ * fwupd_client_get_downgrades_finish:
+ * @client: A #FwupdClient
+ * @res: the #GAsyncResult
+ * @error: the #GError, or %NULL
+ *
+ * Gets the result of fwupd_client_get_downgrades_async().
+ *
+ * Returns: (element-type FwupdRelease) (transfer container): results
+ *
+ * Since: 1.4.2
+ **/
+GPtrArray *
+fwupd_client_get_downgrades_finish (FwupdClient *client, GAsyncResult *res, GError **error)
+{
+	return fwupd_client_call_array_finish (client, res,
+					       fwupd_client_get_downgrades_async,
+					       error);
+}
+
+/**
+ * fwupd_client_get_upgrades_async:
+ * @client: A #FwupdClient
+ * @device_id: the device ID
+ * @cancellable: the #GCancellable, or %NULL
+ * @callback: the function to run on completion
+ * @user_data: the data to pass to @callback
+ *
+ * Gets all the upgrades for a specific device without blocking.
+ *
+ * Since: 1.4.2
+ **/
+void
+fwupd_client_get_upgrades_async (FwupdClient *client,
+				 const gchar *device_id,
+				 GCancellable *cancellable,
+				 GAsyncReadyCallback callback,
+				 gpointer user_data)
+{
+	g_return_if_fail (FWUPD_IS_CLIENT (client));
+	g_return_if_fail (device_id != NULL);
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+	fwupd_client_call_async (client,
+				 fwupd_client_call_helper_new ("GetUpgrades",
+							       g_variant_new ("(s)", device_id),
+							       fwupd_release_array_from_variant),
+				 fwupd_client_get_upgrades_async,
+				 cancellable, callback, user_data);
+}
+
+/**
+ * fwupd_client_get_upgrades_finish:
+ * @client: A #FwupdClient
+ * @res: the #GAsyncResult
+ * @error: the #GError, or %NULL
+ *
+ * Gets the result of fwupd_client_get_upgrades_async().
+ *
+ * Returns: (element-type FwupdRelease) (transfer container): results
+ *
+ * Since: 1.4.2
+ **/
+GPtrArray *
+fwupd_client_get_upgrades_finish (FwupdClient *client, GAsyncResult *res, GError **error)
+{
+	return fwupd_client_call_array_finish (client, res,
+					       fwupd_client_get_upgrades_async,
+					       error);
+}
+
+/**
+ * fwupd_client_get_remotes_async:
+ * @client: A #FwupdClient
+ * @cancellable: the #GCancellable, or %NULL
+ * @callback: the function to run on completion
+ * @user_data: the data to pass to @callback
+ *
+ * Gets the list of remotes without blocking.
+ *
+ * Since: 1.4.2
+ **/
+void
+fwupd_client_get_remotes_async (FwupdClient *client,
+				GCancellable *cancellable,
+				GAsyncReadyCallback callback,
+				gpointer user_data)
+{
+	g_return_if_fail (FWUPD_IS_CLIENT (client));
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+	fwupd_client_call_async (client,
+				 fwupd_client_call_helper_new ("GetRemotes", NULL,
+							       fwupd_remote_array_from_variant),
+				 fwupd_client_get_remotes_async,
+				 cancellable, callback, user_data);
+}
+
+/**
+ * fwupd_client_get_remotes_finish:
+ * @client: A #FwupdClient
+ * @res: the #GAsyncResult
+ * @error: the #GError, or %NULL
+ *
+ * Gets the result of fwupd_client_get_remotes_async().
+ *
+ * Returns: (element-type FwupdRemote) (transfer container): results
+ *
+ * Since: 1.4.2
+ **/
+GPtrArray *
+fwupd_client_get_remotes_finish (FwupdClient *client, GAsyncResult *res, GError **error)
+{
+	return fwupd_client_call_array_finish (client, res,
+					       fwupd_client_get_remotes_async,
+					       error);
+}
+
+/**
+ * fwupd_client_install_async:
+ * @client: A #FwupdClient
+ * @device_id: the device ID
+ * @filename: the filename to install
+ * @install_flags: the #FwupdInstallFlags, e.g. %FWUPD_INSTALL_FLAG_ALLOW_REINSTALL
+ * @cancellable: the #GCancellable, or %NULL
+ * @callback: the function to run on completion
+ * @user_data: the data to pass to @callback
+ *
+ * Install a file onto a specific device without blocking.
+ *
+ * Since: 1.4.2
+ **/
+void
+fwupd_client_install_async (FwupdClient *client,
+			    const gchar *device_id,
+			    const gchar *filename,
+			    FwupdInstallFlags install_flags,
+			    GCancellable *cancellable,
+			    GAsyncReadyCallback callback,
+			    gpointer user_data)
+{
+#ifdef HAVE_GIO_UNIX
+	FwupdClientCallHelper *helper;
+	GError *error = NULL;
+	g_autoptr(GDBusMessage) request = NULL;
+#endif
+
+	g_return_if_fail (FWUPD_IS_CLIENT (client));
+	g_return_if_fail (device_id != NULL);
+	g_return_if_fail (filename != NULL);
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+#ifdef HAVE_GIO_UNIX
+	request = fwupd_client_install_request_new (device_id, filename,
+						    install_flags, &error);
+	if (request == NULL) {
+		g_task_report_error (client, callback, user_data,
+				     fwupd_client_install_async, error);
+		return;
+	}
+	helper = fwupd_client_call_helper_new ("Install", NULL, NULL);
+	helper->request = g_steal_pointer (&request);
+	helper->timeout_msec = G_MAXINT;
+	fwupd_client_call_async (client, helper,
+				 fwupd_client_install_async,
+				 cancellable, callback, user_data);
+#else
+	g_task_report_new_error (client, callback, user_data,
+				 fwupd_client_install_async,
+				 FWUPD_ERROR,
+				 FWUPD_ERROR_NOT_SUPPORTED,
+				 "Not supported as <glib-unix.h> is unavailable");
+#endif
+}
+
+/**
+ * fwupd_client_install_finish:
+ * @client: A #FwupdClient
+ * @res: the #GAsyncResult
+ * @error: the #GError, or %NULL
+ *
+ * Gets the result of fwupd_client_install_async().
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.4.2
+ **/
+gboolean
+fwupd_client_install_finish (FwupdClient *client, GAsyncResult *res, GError **error)
+{
+	return fwupd_client_call_boolean_finish (client, res,
+						 fwupd_client_install_async,
+						 error);
+}
+
+/**
+ * fwupd_client_update_metadata_async:
+ * @client: A #FwupdClient
+ * @remote_id: the remote ID, e.g. `lvfs-testing`
+ * @metadata_fn: the XML metadata filename
+ * @signature_fn: the GPG signature file
+ * @cancellable: the #GCancellable, or %NULL
+ * @callback: the function to run on completion
+ * @user_data: the data to pass to @callback
+ *
+ * Updates the metadata without blocking.
+ *
+ * Since: 1.4.2
+ **/
+void
+fwupd_client_update_metadata_async (FwupdClient *client,
+				    const gchar *remote_id,
+				    const gchar *metadata_fn,
+				    const gchar *signature_fn,
+				    GCancellable *cancellable,
+				    GAsyncReadyCallback callback,
+				    gpointer user_data)
+{
+#ifdef HAVE_GIO_UNIX
+	FwupdClientCallHelper *helper;
+	GError *error = NULL;
+	g_autoptr(GDBusMessage) request = NULL;
+#endif
+
+	g_return_if_fail (FWUPD_IS_CLIENT (client));
+	g_return_if_fail (remote_id != NULL);
+	g_return_if_fail (metadata_fn != NULL);
+	g_return_if_fail (signature_fn != NULL);
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+#ifdef HAVE_GIO_UNIX
+	request = fwupd_client_update_metadata_request_new (remote_id,
+							    metadata_fn,
+							    signature_fn,
+							    &error);
+	if (request == NULL) {
+		g_task_report_error (client, callback, user_data,
+				     fwupd_client_update_metadata_async, error);
+		return;
+	}
+	helper = fwupd_client_call_helper_new ("UpdateMetadata", NULL, NULL);
+	helper->request = g_steal_pointer (&request);
+	fwupd_client_call_async (client, helper,
+				 fwupd_client_update_metadata_async,
+				 cancellable, callback, user_data);
+#else
+	g_task_report_new_error (client, callback, user_data,
+				 fwupd_client_update_metadata_async,
+				 FWUPD_ERROR,
+				 FWUPD_ERROR_NOT_SUPPORTED,
+				 "Not supported as <glib-unix.h> is unavailable");
+#endif
+}
+
+/**
+ * fwupd_client_update_metadata_finish:
+ * @client: A #FwupdClient
+ * @res: the #GAsyncResult
+ * @error: the #GError, or %NULL
+ *
+ * Gets the result of fwupd_client_update_metadata_async().
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.4.2
+ **/
+gboolean
+fwupd_client_update_metadata_finish (FwupdClient *client, GAsyncResult *res, GError **error)
+{
+	return fwupd_client_call_boolean_finish (client, res,
+						 fwupd_client_update_metadata_async,
+						 error);
+}
+
+typedef struct {
+	GMainLoop		*loop;
+	GHashTable		*results;	/* device-id:GPtrArray */
+	GError			*error;
+	guint			 pending;
+} FwupdClientBatchHelper;
+
+typedef struct {
+	FwupdClientBatchHelper	*batch;
+	gchar			*device_id;
+} FwupdClientBatchItem;
+
+static void
+fwupd_client_get_upgrades_batch_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	FwupdClientBatchItem *item = (FwupdClientBatchItem *) user_data;
+	FwupdClientBatchHelper *batch = item->batch;
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GPtrArray) releases = NULL;
+
+	releases = fwupd_client_get_upgrades_finish (FWUPD_CLIENT (source), res, &error_local);
+	if (releases == NULL &&
+	    (g_error_matches (error_local, FWUPD_ERROR, FWUPD_ERROR_NOTHING_TO_DO) ||
+	     g_error_matches (error_local, FWUPD_ERROR, FWUPD_ERROR_NOT_SUPPORTED))) {
+		releases = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	}
+	if (releases != NULL) {
+		g_hash_table_insert (batch->results,
+				     g_steal_pointer (&item->device_id),
+				     g_steal_pointer (&releases));
+	} else if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+		if (batch->error == NULL)
+			batch->error = g_steal_pointer (&error_local);
+	} else {
+		/* only skip this device, like calling it for each device would */
+		g_debug ("failed to get upgrades for %s: %s",
+			 item->device_id, error_local->message);
+	}
+	g_free (item->device_id);
+	g_free (item);
+
+	/* wait for all the calls, even after a failure */
+	if (--batch->pending == 0)
+		g_main_loop_quit (batch->loop);
+}
+
+/**
+ * fwupd_client_get_upgrades_batch:
+ * @client: A #FwupdClient
+ * @device_ids: the device IDs
+ * @cancellable: the #GCancellable, or %NULL
+ * @error: the #GError, or %NULL
+ *
+ * Gets all the upgrades for several devices. All the requests are sent to the
+ * daemon before waiting for the first reply, which is much faster than
+ * calling fwupd_client_get_upgrades() for each device in turn.
+ *
+ * Devices with no upgrades, or that cannot be updated, have an empty array.
+ * Devices where getting the upgrades failed for any other reason are not
+ * included, so one failing device does not hide the upgrades of the others.
+ *
+ * Returns: (transfer container) (element-type utf8 GPtrArray): device IDs to
+ * arrays of #FwupdRelease, or %NULL if the daemon could not be contacted or
+ * @cancellable was cancelled
+ *
+ * Since: 1.4.2
+ **/
+GHashTable *
+fwupd_client_get_upgrades_batch (FwupdClient *client,
+				 gchar **device_ids,
+				 GCancellable *cancellable,
+				 GError **error)
+{
+	FwupdClientBatchHelper batch = { NULL };
+	g_autoptr(GHashTable) results = NULL;
+
+	g_return_val_if_fail (FWUPD_IS_CLIENT (client), NULL);
+	g_return_val_if_fail (device_ids != NULL, NULL);
+	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	/* connect */
+	if (!fwupd_client_connect (client, cancellable, error))
+		return NULL;
+
+	results = g_hash_table_new_full (g_str_hash, g_str_equal,
+					 g_free, (GDestroyNotify) g_ptr_array_unref);
+	if (device_ids[0] == NULL)
+		return g_steal_pointer (&results);
+
+	/* pipeline all the requests on the one connection */
+	batch.results = results;
+	batch.loop = g_main_loop_new (NULL, FALSE);
+	for (guint i = 0; device_ids[i] != NULL; i++) {
+		FwupdClientBatchItem *item = g_new0 (FwupdClientBatchItem, 1);
+		item->batch = &batch;
+		item->device_id = g_strdup (device_ids[i]);
+		batch.pending++;
+		fwupd_client_get_upgrades_async (client, device_ids[i], cancellable,
+						 fwupd_client_get_upgrades_batch_cb,
+						 item);
+	}
+	g_main_loop_run (batch.loop);
+	g_main_loop_unref (batch.loop);
+	if (batch.error != NULL) {
+		g_propagate_error (error, batch.error);
+		return NULL;
+	}
+	return g_steal_pointer (&results);
+}
+
 static void
 fwupd_client_get_property (GObject *object, guint prop_id,
 			   GValue *value, GParamSpec *pspec)
@@ -2074,6 +3217,8 @@ fwupd_client_class_init (FwupdClientClass *klass)
 static void
 fwupd_client_init (FwupdClient *client)
 {
+	FwupdClientPrivate *priv = GET_PRIVATE (client);
+	priv->changes_devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_variant_unref);
 }
 
 static void
@@ -2089,6 +3234,7 @@ fwupd_client_finalize (GObject *object)
 		g_object_unref (priv->conn);
 	if (priv->proxy != NULL)
 		g_object_unref (priv->proxy);
+	g_ptr_array_unref (priv->changes_devices);
 
 	G_OBJECT_CLASS (fwupd_client_parent_class)->finalize (object);
 }
@@ -47,9 +47,20 @@ gboolean	 fwupd_client_connect			(FwupdClient	*client,
 GPtrArray	*fwupd_client_get_devices		(FwupdClient	*client,
 							 GCancellable	*cancellable,
 							 GError		**error);
+GPtrArray	*fwupd_client_sync_devices		(FwupdClient	*client,
+							 GCancellable	*cancellable,
+							 GError		**error);
 GPtrArray	*fwupd_client_get_history		(FwupdClient	*client,
 							 GCancellable	*cancellable,
 							 GError		**error);
+GPtrArray	*fwupd_client_get_history_full		(FwupdClient	*client,
+							 const gchar	*device_id,
+							 FwupdUpdateState update_state,
+							 guint64	 since,
+							 guint		 offset,
+							 guint		 limit,
+							 GCancellable	*cancellable,
+							 GError		**error);
 GPtrArray	*fwupd_client_get_releases		(FwupdClient	*client,
 							 const gchar	*device_id,
 							 GCancellable	*cancellable,
@@ -156,4 +167,81 @@ gchar		*fwupd_client_self_sign			(FwupdClient	*client,
 							 GCancellable	*cancellable,
 							 GError		**error);
 
+void		 fwupd_client_connect_async		(FwupdClient	*client,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 user_data);
+gboolean	 fwupd_client_connect_finish		(FwupdClient	*client,
+							 GAsyncResult	*res,
+							 GError		**error);
+void		 fwupd_client_get_devices_async		(FwupdClient	*client,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 user_data);
+GPtrArray	*fwupd_client_get_devices_finish	(FwupdClient	*client,
+							 GAsyncResult	*res,
+							 GError		**error);
+void		 fwupd_client_get_history_async		(FwupdClient	*client,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 user_data);
+GPtrArray	*fwupd_client_get_history_finish	(FwupdClient	*client,
+							 GAsyncResult	*res,
+							 GError		**error);
+void		 fwupd_client_get_releases_async	(FwupdClient	*client,
+							 const gchar	*device_id,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 user_data);
+GPtrArray	*fwupd_client_get_releases_finish	(FwupdClient	*client,
+							 GAsyncResult	*res,
+							 GError		**error);
+void		 fwupd_client_get_downgrades_async	(FwupdClient	*client,
+							 const gchar	*device_id,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 user_data);
+GPtrArray	*fwupd_client_get_downgrades_finish	(FwupdClient	*client,
+							 GAsyncResult	*res,
+							 GError		**error);
+void		 fwupd_client_get_upgrades_async	(FwupdClient	*client,
+							 const gchar	*device_id,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 user_data);
+GPtrArray	*fwupd_client_get_upgrades_finish	(FwupdClient	*client,
+							 GAsyncResult	*res,
+							 GError		**error);
+GHashTable	*fwupd_client_get_upgrades_batch	(FwupdClient	*client,
+							 gchar		**device_ids,
+							 GCancellable	*cancellable,
+							 GError		**error);
+void		 fwupd_client_get_remotes_async		(FwupdClient	*client,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 user_data);
+GPtrArray	*fwupd_client_get_remotes_finish	(FwupdClient	*client,
+							 GAsyncResult	*res,
+							 GError		**error);
+void		 fwupd_client_install_async		(FwupdClient	*client,
+							 const gchar	*device_id,
+							 const gchar	*filename,
+							 FwupdInstallFlags install_flags,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 user_data);
+gboolean	 fwupd_client_install_finish		(FwupdClient	*client,
+							 GAsyncResult	*res,
+							 GError		**error);
+void		 fwupd_client_update_metadata_async	(FwupdClient	*client,
+							 const gchar	*remote_id,
+							 const gchar	*metadata_fn,
+							 const gchar	*signature_fn,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 user_data);
+gboolean	 fwupd_client_update_metadata_finish	(FwupdClient	*client,
+							 GAsyncResult	*res,
+							 GError		**error);
+
 G_END_DECLS
@@ -16,8 +16,11 @@ G_BEGIN_DECLS
 GVariant	*fwupd_device_to_variant		(FwupdDevice	*device);
 GVariant	*fwupd_device_to_variant_full		(FwupdDevice	*device,
 							 FwupdDeviceFlags flags);
+GVariant	*fwupd_device_to_variant_cached		(FwupdDevice	*device,
+							 FwupdDeviceFlags flags);
 void		 fwupd_device_incorporate		(FwupdDevice	*self,
 							 FwupdDevice	*donor);
+void		 fwupd_device_rebuild_guid_index	(FwupdDevice	*device);
 void		 fwupd_device_to_json			(FwupdDevice *device,
 							 JsonBuilder *builder);
 
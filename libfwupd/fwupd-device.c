@@ -27,6 +27,12 @@
 
 static void fwupd_device_finalize	 (GObject *object);
 
+/* a slot in the open-addressed GUID set */
+typedef struct {
+	fwupd_guid_t			 key;
+	gboolean			 used;
+} FwupdDeviceGuidSlot;
+
 typedef struct {
 	gchar				*id;
 	gchar				*parent_id;
@@ -34,17 +40,20 @@ typedef struct {
 	guint64				 modified;
 	guint64				 flags;
 	GPtrArray			*guids;
+	FwupdDeviceGuidSlot		*guid_slots;	/* nullable */
+	guint				 guid_slots_size;	/* power of two */
+	guint				 guid_slots_used;
 	GPtrArray			*instance_ids;
 	GPtrArray			*icons;
 	gchar				*name;
 	gchar				*serial;
 	gchar				*summary;
 	gchar				*description;
-	gchar				*vendor;
+	const gchar			*vendor;		/* interned */
 	gchar				*vendor_id;
 	gchar				*homepage;
-	gchar				*plugin;
-	gchar				*protocol;
+	const gchar			*plugin;		/* interned */
+	const gchar			*protocol;		/* interned */
 	gchar				*version;
 	gchar				*version_lowest;
 	gchar				*version_bootloader;
@@ -62,6 +71,7 @@ typedef struct {
 	FwupdStatus			 status;
 	GPtrArray			*releases;
 	FwupdDevice			*parent;
+	GVariant			*variant_cache[2];	/* untrusted, trusted */
 } FwupdDevicePrivate;
 
 enum {
@@ -76,6 +86,16 @@ enum {
 G_DEFINE_TYPE_WITH_PRIVATE (FwupdDevice, fwupd_device, G_TYPE_OBJECT)
 #define GET_PRIVATE(o) (fwupd_device_get_instance_private (o))
 
+/* called by every setter that changes something fwupd_device_to_variant_full()
+ * would serialize, so the next fwupd_device_to_variant_cached() rebuilds it */
+static void
+fwupd_device_invalidate_variant (FwupdDevice *device)
+{
+	FwupdDevicePrivate *priv = GET_PRIVATE (device);
+	for (guint i = 0; i < G_N_ELEMENTS (priv->variant_cache); i++)
+		g_clear_pointer (&priv->variant_cache[i], g_variant_unref);
+}
+
 /**
  * fwupd_device_get_checksums:
  * @device: A #FwupdDevice
@@ -115,6 +135,7 @@ fwupd_device_add_checksum (FwupdDevice *device, const gchar *checksum)
 			return;
 	}
 	g_ptr_array_add (priv->checksums, g_strdup (checksum));
+	fwupd_device_invalidate_variant (device);
 }
 
 /**
@@ -169,6 +190,7 @@ fwupd_device_set_summary (FwupdDevice *device, const gchar *summary)
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	g_free (priv->summary);
 	priv->summary = g_strdup (summary);
+	fwupd_device_invalidate_variant (device);
 }
 
 /**
@@ -205,6 +227,7 @@ fwupd_device_set_serial (FwupdDevice *device, const gchar *serial)
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	g_free (priv->serial);
 	priv->serial = g_strdup (serial);
+	fwupd_device_invalidate_variant (device);
 }
 
 /**
@@ -241,6 +264,7 @@ fwupd_device_set_id (FwupdDevice *device, const gchar *id)
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	g_free (priv->id);
 	priv->id = g_strdup (id);
+	fwupd_device_invalidate_variant (device);
 }
 
 /**
@@ -277,6 +301,7 @@ fwupd_device_set_parent_id (FwupdDevice *device, const gchar *parent_id)
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	g_free (priv->parent_id);
 	priv->parent_id = g_strdup (parent_id);
+	fwupd_device_invalidate_variant (device);
 }
 
 /**
@@ -316,12 +341,136 @@ fwupd_device_set_parent (FwupdDevice *device, FwupdDevice *parent)
 	g_ptr_array_add (priv_parent->children, g_object_ref (device));
 }
 
+/* only the canonical lowercase form is indexed, so that has_guid() matches
+ * exactly the same strings as a g_strcmp0() would */
+static gboolean
+fwupd_device_guid_parse (const gchar *guid, fwupd_guid_t *key)
+{
+	guint j = 0;
+	gboolean hi = TRUE;
+
+	if (guid == NULL)
+		return FALSE;
+	for (guint i = 0; i < 36; i++) {
+		gchar c = guid[i];
+		guint8 v;
+		if (i == 8 || i == 13 || i == 18 || i == 23) {
+			if (c != '-')
+				return FALSE;
+			continue;
+		}
+		if (c >= '0' && c <= '9')
+			v = c - '0';
+		else if (c >= 'a' && c <= 'f')
+			v = c - 'a' + 10;
+		else
+			return FALSE;
+		if (hi)
+			(*key)[j] = v << 4;
+		else
+			(*key)[j++] |= v;
+		hi = !hi;
+	}
+	return guid[36] == '\0';
+}
+
+static guint
+fwupd_device_guid_hash (const fwupd_guid_t *key)
+{
+	guint32 tmp1;
+	guint32 tmp2;
+	memcpy (&tmp1, *key, sizeof(tmp1));
+	memcpy (&tmp2, *key + 12, sizeof(tmp2));
+	return tmp1 ^ tmp2;
+}
+
+/* returns FALSE if the key was already present */
+static gboolean
+fwupd_device_guid_slots_insert (FwupdDevicePrivate *priv, const fwupd_guid_t *key)
+{
+	guint idx;
+
+	/* keep the load factor below one half */
+	if ((priv->guid_slots_used + 1) * 2 > priv->guid_slots_size) {
+		FwupdDeviceGuidSlot *slots_old = priv->guid_slots;
+		guint size_old = priv->guid_slots_size;
+		priv->guid_slots_size = MAX (size_old * 2, 16);
+		priv->guid_slots = g_new0 (FwupdDeviceGuidSlot, priv->guid_slots_size);
+		priv->guid_slots_used = 0;
+		for (guint i = 0; i < size_old; i++) {
+			if (slots_old[i].used)
+				fwupd_device_guid_slots_insert (priv, &slots_old[i].key);
+		}
+		g_free (slots_old);
+	}
+
+	/* linear probe */
+	idx = fwupd_device_guid_hash (key) & (priv->guid_slots_size - 1);
+	while (priv->guid_slots[idx].used) {
+		if (memcmp (priv->guid_slots[idx].key, *key, sizeof(fwupd_guid_t)) == 0)
+			return FALSE;
+		idx = (idx + 1) & (priv->guid_slots_size - 1);
+	}
+	memcpy (priv->guid_slots[idx].key, *key, sizeof(fwupd_guid_t));
+	priv->guid_slots[idx].used = TRUE;
+	priv->guid_slots_used++;
+	return TRUE;
+}
+
+static gboolean
+fwupd_device_guid_slots_contains (FwupdDevicePrivate *priv, const fwupd_guid_t *key)
+{
+	guint idx;
+	if (priv->guid_slots == NULL)
+		return FALSE;
+	idx = fwupd_device_guid_hash (key) & (priv->guid_slots_size - 1);
+	while (priv->guid_slots[idx].used) {
+		if (memcmp (priv->guid_slots[idx].key, *key, sizeof(fwupd_guid_t)) == 0)
+			return TRUE;
+		idx = (idx + 1) & (priv->guid_slots_size - 1);
+	}
+	return FALSE;
+}
+
+/**
+ * fwupd_device_rebuild_guid_index:
+ * @device: A #FwupdDevice
+ *
+ * Rebuilds the GUID lookup index from the array returned by
+ * fwupd_device_get_guids(), which must be called after the array has been
+ * modified directly, e.g. truncated when the device is rescanned.
+ *
+ * Since: 1.4.2
+ **/
+void
+fwupd_device_rebuild_guid_index (FwupdDevice *device)
+{
+	FwupdDevicePrivate *priv = GET_PRIVATE (device);
+
+	g_return_if_fail (FWUPD_IS_DEVICE (device));
+
+	g_clear_pointer (&priv->guid_slots, g_free);
+	priv->guid_slots_size = 0;
+	priv->guid_slots_used = 0;
+	for (guint i = 0; i < priv->guids->len; i++) {
+		const gchar *guid = g_ptr_array_index (priv->guids, i);
+		fwupd_guid_t key;
+		if (fwupd_device_guid_parse (guid, &key))
+			fwupd_device_guid_slots_insert (priv, &key);
+	}
+	fwupd_device_invalidate_variant (device);
+}
+
 /**
  * fwupd_device_get_guids:
  * @device: A #FwupdDevice
  *
  * Gets the GUIDs.
  *
+ * The array should not be modified; use fwupd_device_add_guid() instead.
+ * Since 1.4.2 fwupd_device_has_guid() uses an index that is not updated if the
+ * array is modified directly.
+ *
  * Returns: (element-type utf8) (transfer none): the GUIDs
  *
  * Since: 0.9.3
@@ -341,6 +490,9 @@ fwupd_device_get_guids (FwupdDevice *device)
  *
  * Finds out if the device has this specific GUID.
  *
+ * This function is not thread safe, and must not be called while another
+ * thread is adding GUIDs to the same device.
+ *
  * Returns: %TRUE if the GUID is found
  *
  * Since: 0.9.3
@@ -349,9 +501,15 @@ gboolean
 fwupd_device_has_guid (FwupdDevice *device, const gchar *guid)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
+	fwupd_guid_t key;
 
 	g_return_val_if_fail (FWUPD_IS_DEVICE (device), FALSE);
 
+	/* hashed lookup of the binary form */
+	if (fwupd_device_guid_parse (guid, &key))
+		return fwupd_device_guid_slots_contains (priv, &key);
+
+	/* not a canonical GUID, so was never indexed */
 	for (guint i = 0; i < priv->guids->len; i++) {
 		const gchar *guid_tmp = g_ptr_array_index (priv->guids, i);
 		if (g_strcmp0 (guid, guid_tmp) == 0)
@@ -373,10 +531,19 @@ void
 fwupd_device_add_guid (FwupdDevice *device, const gchar *guid)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
+	fwupd_guid_t key;
+
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
-	if (fwupd_device_has_guid (device, guid))
+
+	/* check and insert in one probe */
+	if (fwupd_device_guid_parse (guid, &key)) {
+		if (!fwupd_device_guid_slots_insert (priv, &key))
+			return;
+	} else if (fwupd_device_has_guid (device, guid)) {
 		return;
+	}
 	g_ptr_array_add (priv->guids, g_strdup (guid));
+	fwupd_device_invalidate_variant (device);
 }
 
 /**
@@ -460,6 +627,7 @@ fwupd_device_add_instance_id (FwupdDevice *device, const gchar *instance_id)
 	if (fwupd_device_has_instance_id (device, instance_id))
 		return;
 	g_ptr_array_add (priv->instance_ids, g_strdup (instance_id));
+	fwupd_device_invalidate_variant (device);
 }
 
 /**
@@ -512,6 +680,7 @@ fwupd_device_add_icon (FwupdDevice *device, const gchar *icon)
 	if (fwupd_device_has_icon (device, icon))
 		return;
 	g_ptr_array_add (priv->icons, g_strdup (icon));
+	fwupd_device_invalidate_variant (device);
 }
 
 /**
@@ -548,6 +717,7 @@ fwupd_device_set_name (FwupdDevice *device, const gchar *name)
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	g_free (priv->name);
 	priv->name = g_strdup (name);
+	fwupd_device_invalidate_variant (device);
 }
 
 /**
@@ -582,8 +752,8 @@ fwupd_device_set_vendor (FwupdDevice *device, const gchar *vendor)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
-	g_free (priv->vendor);
-	priv->vendor = g_strdup (vendor);
+	priv->vendor = g_intern_string (vendor);
+	fwupd_device_invalidate_variant (device);
 }
 
 /**
@@ -620,6 +790,7 @@ fwupd_device_set_vendor_id (FwupdDevice *device, const gchar *vendor_id)
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	g_free (priv->vendor_id);
 	priv->vendor_id = g_strdup (vendor_id);
+	fwupd_device_invalidate_variant (device);
 }
 
 /**
@@ -656,6 +827,7 @@ fwupd_device_set_description (FwupdDevice *device, const gchar *description)
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	g_free (priv->description);
 	priv->description = g_strdup (description);
+	fwupd_device_invalidate_variant (device);
 }
 
 /**
@@ -692,6 +864,7 @@ fwupd_device_set_version (FwupdDevice *device, const gchar *version)
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	g_free (priv->version);
 	priv->version = g_strdup (version);
+	fwupd_device_invalidate_variant (device);
 }
 
 /**
@@ -728,6 +901,7 @@ fwupd_device_set_version_lowest (FwupdDevice *device, const gchar *version_lowes
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	g_free (priv->version_lowest);
 	priv->version_lowest = g_strdup (version_lowest);
+	fwupd_device_invalidate_variant (device);
 }
 
 /**
@@ -763,6 +937,7 @@ fwupd_device_set_version_lowest_raw (FwupdDevice *device, guint64 version_lowest
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	priv->version_lowest_raw = version_lowest_raw;
+	fwupd_device_invalidate_variant (device);
 }
 
 /**
@@ -799,6 +974,7 @@ fwupd_device_set_version_bootloader (FwupdDevice *device, const gchar *version_b
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	g_free (priv->version_bootloader);
 	priv->version_bootloader = g_strdup (version_bootloader);
+	fwupd_device_invalidate_variant (device);
 }
 
 /**
@@ -834,6 +1010,7 @@ fwupd_device_set_version_bootloader_raw (FwupdDevice *device, guint64 version_bo
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	priv->version_bootloader_raw = version_bootloader_raw;
+	fwupd_device_invalidate_variant (device);
 }
 
 /**
@@ -869,6 +1046,7 @@ fwupd_device_set_flashes_left (FwupdDevice *device, guint32 flashes_left)
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	priv->flashes_left = flashes_left;
+	fwupd_device_invalidate_variant (device);
 }
 
 /**
@@ -904,6 +1082,7 @@ fwupd_device_set_install_duration (FwupdDevice *device, guint32 duration)
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	priv->install_duration = duration;
+	fwupd_device_invalidate_variant (device);
 }
 
 /**
@@ -938,8 +1117,8 @@ fwupd_device_set_plugin (FwupdDevice *device, const gchar *plugin)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
-	g_free (priv->plugin);
-	priv->plugin = g_strdup (plugin);
+	priv->plugin = g_intern_string (plugin);
+	fwupd_device_invalidate_variant (device);
 }
 
 /**
@@ -974,8 +1153,8 @@ fwupd_device_set_protocol (FwupdDevice *device, const gchar *protocol)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
-	g_free (priv->protocol);
-	priv->protocol = g_strdup (protocol);
+	priv->protocol = g_intern_string (protocol);
+	fwupd_device_invalidate_variant (device);
 }
 
 /**
@@ -1013,6 +1192,7 @@ fwupd_device_set_flags (FwupdDevice *device, guint64 flags)
 	if (priv->flags == flags)
 		return;
 	priv->flags = flags;
+	fwupd_device_invalidate_variant (device);
 	g_object_notify (G_OBJECT (device), "flags");
 }
 
@@ -1035,6 +1215,7 @@ fwupd_device_add_flag (FwupdDevice *device, FwupdDeviceFlags flag)
 	if ((priv->flags & flag) > 0)
 		return;
 	priv->flags |= flag;
+	fwupd_device_invalidate_variant (device);
 	g_object_notify (G_OBJECT (device), "flags");
 }
 
@@ -1057,6 +1238,7 @@ fwupd_device_remove_flag (FwupdDevice *device, FwupdDeviceFlags flag)
 	if ((priv->flags & flag) == 0)
 		return;
 	priv->flags &= ~flag;
+	fwupd_device_invalidate_variant (device);
 	g_object_notify (G_OBJECT (device), "flags");
 }
 
@@ -1113,6 +1295,7 @@ fwupd_device_set_created (FwupdDevice *device, guint64 created)
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	priv->created = created;
+	fwupd_device_invalidate_variant (device);
 }
 
 /**
@@ -1148,6 +1331,7 @@ fwupd_device_set_modified (FwupdDevice *device, guint64 modified)
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	priv->modified = modified;
+	fwupd_device_invalidate_variant (device);
 }
 
 /**
@@ -1440,6 +1624,38 @@ fwupd_device_to_variant_full (FwupdDevice *device, FwupdDeviceFlags flags)
 	return g_variant_new ("a{sv}", &builder);
 }
 
+/**
+ * fwupd_device_to_variant_cached:
+ * @device: A #FwupdDevice
+ * @flags: #FwupdDeviceFlags for the call
+ *
+ * Creates a GVariant from the device data, reusing the result of the last
+ * call if nothing has changed on the device since then.
+ *
+ * Devices with releases are never cached, as the #FwupdRelease objects can
+ * be modified without the device being notified.
+ *
+ * Returns: (transfer full): the GVariant, which is not floating
+ *
+ * Since: 1.4.2
+ **/
+GVariant *
+fwupd_device_to_variant_cached (FwupdDevice *device, FwupdDeviceFlags flags)
+{
+	FwupdDevicePrivate *priv = GET_PRIVATE (device);
+	guint idx = (flags & FWUPD_DEVICE_FLAG_TRUSTED) > 0 ? 1 : 0;
+
+	g_return_val_if_fail (FWUPD_IS_DEVICE (device), NULL);
+
+	if (priv->releases->len > 0)
+		return g_variant_ref_sink (fwupd_device_to_variant_full (device, flags));
+	if (priv->variant_cache[idx] == NULL) {
+		GVariant *tmp = fwupd_device_to_variant_full (device, flags);
+		priv->variant_cache[idx] = g_variant_ref_sink (tmp);
+	}
+	return g_variant_ref (priv->variant_cache[idx]);
+}
+
 /**
  * fwupd_device_to_variant:
  * @device: A #FwupdDevice
@@ -1694,6 +1910,7 @@ fwupd_device_set_update_state (FwupdDevice *device, FwupdUpdateState update_stat
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	priv->update_state = update_state;
+	fwupd_device_invalidate_variant (device);
 }
 
 /**
@@ -1729,6 +1946,7 @@ fwupd_device_set_version_format (FwupdDevice *device, FwupdVersionFormat version
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	priv->version_format = version_format;
+	fwupd_device_invalidate_variant (device);
 }
 
 /**
@@ -1764,6 +1982,7 @@ fwupd_device_set_version_raw (FwupdDevice *device, guint64 version_raw)
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	priv->version_raw = version_raw;
+	fwupd_device_invalidate_variant (device);
 }
 
 /**
@@ -1800,6 +2019,7 @@ fwupd_device_set_update_message (FwupdDevice *device, const gchar *update_messag
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	g_free (priv->update_message);
 	priv->update_message = g_strdup (update_message);
+	fwupd_device_invalidate_variant (device);
 }
 
 /**
@@ -1836,6 +2056,7 @@ fwupd_device_set_update_error (FwupdDevice *device, const gchar *update_error)
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	g_free (priv->update_error);
 	priv->update_error = g_strdup (update_error);
+	fwupd_device_invalidate_variant (device);
 }
 
 /**
@@ -1891,6 +2112,7 @@ fwupd_device_add_release (FwupdDevice *device, FwupdRelease *release)
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	g_return_if_fail (FWUPD_IS_DEVICE (device));
 	g_ptr_array_add (priv->releases, g_object_ref (release));
+	fwupd_device_invalidate_variant (device);
 }
 /**
  * fwupd_device_get_status:
@@ -1927,6 +2149,7 @@ fwupd_device_set_status (FwupdDevice *self, FwupdStatus status)
 	if (priv->status == status)
 		return;
 	priv->status = status;
+	fwupd_device_invalidate_variant (self);
 	g_object_notify (G_OBJECT (self), "status");
 }
 
@@ -2294,21 +2517,20 @@ fwupd_device_finalize (GObject *object)
 	g_free (priv->name);
 	g_free (priv->serial);
 	g_free (priv->summary);
-	g_free (priv->vendor);
 	g_free (priv->vendor_id);
-	g_free (priv->plugin);
-	g_free (priv->protocol);
 	g_free (priv->update_error);
 	g_free (priv->update_message);
 	g_free (priv->version);
 	g_free (priv->version_lowest);
 	g_free (priv->version_bootloader);
 	g_ptr_array_unref (priv->guids);
+	g_free (priv->guid_slots);
 	g_ptr_array_unref (priv->instance_ids);
 	g_ptr_array_unref (priv->icons);
 	g_ptr_array_unref (priv->checksums);
 	g_ptr_array_unref (priv->children);
 	g_ptr_array_unref (priv->releases);
+	fwupd_device_invalidate_variant (device);
 
 	G_OBJECT_CLASS (fwupd_device_parent_class)->finalize (object);
 }
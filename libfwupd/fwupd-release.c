@@ -35,7 +35,7 @@ typedef struct {
 	GHashTable			*metadata;
 	gchar				*description;
 	gchar				*filename;
-	gchar				*protocol;
+	const gchar			*protocol;		/* interned */
 	gchar				*homepage;
 	gchar				*details_url;
 	gchar				*source_url;
@@ -47,7 +47,7 @@ typedef struct {
 	gchar				*name_variant_suffix;
 	gchar				*summary;
 	gchar				*uri;
-	gchar				*vendor;
+	const gchar			*vendor;		/* interned */
 	gchar				*version;
 	gchar				*remote_id;
 	guint64				 size;
@@ -241,8 +241,7 @@ fwupd_release_set_protocol (FwupdRelease *release, const gchar *protocol)
 {
 	FwupdReleasePrivate *priv = GET_PRIVATE (release);
 	g_return_if_fail (FWUPD_IS_RELEASE (release));
-	g_free (priv->protocol);
-	priv->protocol = g_strdup (protocol);
+	priv->protocol = g_intern_string (protocol);
 }
 
 /**
@@ -929,8 +928,7 @@ fwupd_release_set_vendor (FwupdRelease *release, const gchar *vendor)
 {
 	FwupdReleasePrivate *priv = GET_PRIVATE (release);
 	g_return_if_fail (FWUPD_IS_RELEASE (release));
-	g_free (priv->vendor);
-	priv->vendor = g_strdup (vendor);
+	priv->vendor = g_intern_string (vendor);
 }
 
 /**
@@ -1804,7 +1802,6 @@ fwupd_release_finalize (GObject *object)
 
 	g_free (priv->description);
 	g_free (priv->filename);
-	g_free (priv->protocol);
 	g_free (priv->appstream_id);
 	g_free (priv->detach_caption);
 	g_free (priv->detach_image);
@@ -1816,7 +1813,6 @@ fwupd_release_finalize (GObject *object)
 	g_free (priv->homepage);
 	g_free (priv->details_url);
 	g_free (priv->source_url);
-	g_free (priv->vendor);
 	g_free (priv->version);
 	g_free (priv->remote_id);
 	g_free (priv->update_message);
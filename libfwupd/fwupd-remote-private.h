@@ -6,11 +6,15 @@
 
 #pragma once
 
+#include <json-glib/json-glib.h>
+
 #include "fwupd-remote.h"
 
 G_BEGIN_DECLS
 
 GVariant	*fwupd_remote_to_variant		(FwupdRemote	*self);
+void		 fwupd_remote_to_json			(FwupdRemote	*self,
+							 JsonBuilder	*builder);
 gboolean	 fwupd_remote_load_from_filename	(FwupdRemote	*self,
 							 const gchar	*filename,
 							 GCancellable	*cancellable,
@@ -1220,6 +1220,71 @@ fwupd_remote_to_variant (FwupdRemote *self)
 	return g_variant_new ("a{sv}", &builder);
 }
 
+static void
+fwupd_remote_json_add_string (JsonBuilder *builder, const gchar *key, const gchar *str)
+{
+	if (str == NULL)
+		return;
+	json_builder_set_member_name (builder, key);
+	json_builder_add_string_value (builder, str);
+}
+
+static void
+fwupd_remote_json_add_int (JsonBuilder *builder, const gchar *key, gint64 num)
+{
+	if (num == 0)
+		return;
+	json_builder_set_member_name (builder, key);
+	json_builder_add_int_value (builder, num);
+}
+
+static void
+fwupd_remote_json_add_boolean (JsonBuilder *builder, const gchar *key, gboolean value)
+{
+	json_builder_set_member_name (builder, key);
+	json_builder_add_boolean_value (builder, value);
+}
+
+/**
+ * fwupd_remote_to_json:
+ * @self: A #FwupdRemote
+ * @builder: A #JsonBuilder
+ *
+ * Adds a fwupd remote to a JSON builder. The username and password are
+ * never included.
+ *
+ * Since: 1.4.2
+ **/
+void
+fwupd_remote_to_json (FwupdRemote *self, JsonBuilder *builder)
+{
+	FwupdRemotePrivate *priv = GET_PRIVATE (self);
+
+	g_return_if_fail (FWUPD_IS_REMOTE (self));
+	g_return_if_fail (builder != NULL);
+
+	fwupd_remote_json_add_string (builder, FWUPD_RESULT_KEY_REMOTE_ID, priv->id);
+	fwupd_remote_json_add_string (builder, "Title", priv->title);
+	if (priv->kind != FWUPD_REMOTE_KIND_UNKNOWN) {
+		fwupd_remote_json_add_string (builder, "Type",
+					      fwupd_remote_kind_to_string (priv->kind));
+	}
+	if (priv->keyring_kind != FWUPD_KEYRING_KIND_UNKNOWN) {
+		fwupd_remote_json_add_string (builder, "Keyring",
+					      fwupd_keyring_kind_to_string (priv->keyring_kind));
+	}
+	fwupd_remote_json_add_boolean (builder, "Enabled", priv->enabled);
+	fwupd_remote_json_add_boolean (builder, "ApprovalRequired", priv->approval_required);
+	fwupd_remote_json_add_boolean (builder, "AutomaticReports", priv->automatic_reports);
+	fwupd_remote_json_add_int (builder, "Priority", priv->priority);
+	fwupd_remote_json_add_int (builder, "ModificationTime", priv->mtime);
+	fwupd_remote_json_add_string (builder, FWUPD_RESULT_KEY_CHECKSUM, priv->checksum);
+	fwupd_remote_json_add_string (builder, FWUPD_RESULT_KEY_URI, priv->metadata_uri);
+	fwupd_remote_json_add_string (builder, "ReportUri", priv->report_uri);
+	fwupd_remote_json_add_string (builder, "FirmwareBaseUri", priv->firmware_base_uri);
+	fwupd_remote_json_add_string (builder, "FilenameCache", priv->filename_cache);
+}
+
 static void
 fwupd_remote_get_property (GObject *obj, guint prop_id,
 			   GValue *value, GParamSpec *pspec)
@@ -157,8 +157,12 @@ fwupd_remote_download_func (void)
 	g_autofree gchar *directory = NULL;
 	g_autofree gchar *expected_metadata = NULL;
 	g_autofree gchar *expected_signature = NULL;
+	g_autofree gchar *data = NULL;
 	g_autoptr(FwupdRemote) remote = NULL;
 	g_autoptr(GError) error = NULL;
+	g_autoptr(JsonBuilder) builder = NULL;
+	g_autoptr(JsonGenerator) json_generator = NULL;
+	g_autoptr(JsonNode) json_root = NULL;
 
 	remote = fwupd_remote_new ();
 	directory = g_build_filename (FWUPD_LOCALSTATEDIR,
@@ -189,6 +193,21 @@ fwupd_remote_download_func (void)
 	g_assert_cmpstr (fwupd_remote_get_report_uri (remote), ==, "https://fwupd.org/lvfs/firmware/report");
 	g_assert_cmpstr (fwupd_remote_get_filename_cache (remote), ==, expected_metadata);
 	g_assert_cmpstr (fwupd_remote_get_filename_cache_sig (remote), ==, expected_signature);
+
+	/* export to json */
+	builder = json_builder_new ();
+	json_builder_begin_object (builder);
+	fwupd_remote_to_json (remote, builder);
+	json_builder_end_object (builder);
+	json_root = json_builder_get_root (builder);
+	json_generator = json_generator_new ();
+	json_generator_set_root (json_generator, json_root);
+	data = json_generator_to_data (json_generator, NULL);
+	g_assert_nonnull (data);
+	g_assert_nonnull (g_strstr_len (data, -1, "\"RemoteId\":\"lvfs\""));
+	g_assert_nonnull (g_strstr_len (data, -1, "\"Type\":\"download\""));
+	g_assert_nonnull (g_strstr_len (data, -1, "\"Keyring\":\"jcat\""));
+	g_assert_null (g_strstr_len (data, -1, "Password"));
 }
 
 /* verify we used the FirmwareBaseURI just for firmware */
@@ -304,6 +323,107 @@ fwupd_release_func (void)
 	g_assert_cmpstr (fwupd_release_get_metadata_item (release2, "baz"), ==, "bam");
 }
 
+static void
+fwupd_device_guids_func (void)
+{
+	GPtrArray *guids;
+	g_autoptr(FwupdDevice) dev = fwupd_device_new ();
+
+	/* enough to grow the set a few times */
+	for (guint i = 0; i < 100; i++) {
+		g_autofree gchar *guid = g_strdup_printf ("2082b5e0-7a64-478a-b1b2-%012x", i);
+		fwupd_device_add_guid (dev, guid);
+		fwupd_device_add_guid (dev, guid);
+	}
+	guids = fwupd_device_get_guids (dev);
+	g_assert_cmpint (guids->len, ==, 100);
+	g_assert (fwupd_device_has_guid (dev, "2082b5e0-7a64-478a-b1b2-000000000000"));
+	g_assert (fwupd_device_has_guid (dev, "2082b5e0-7a64-478a-b1b2-000000000063"));
+	g_assert (!fwupd_device_has_guid (dev, "2082b5e0-7a64-478a-b1b2-000000000064"));
+
+	/* not canonical, so matched exactly */
+	g_assert (!fwupd_device_has_guid (dev, "2082B5E0-7A64-478A-B1B2-000000000000"));
+	fwupd_device_add_guid (dev, "2082B5E0-7A64-478A-B1B2-000000000000");
+	fwupd_device_add_guid (dev, "WacomAES");
+	fwupd_device_add_guid (dev, "WacomAES");
+	g_assert_cmpint (guids->len, ==, 102);
+	g_assert (fwupd_device_has_guid (dev, "2082B5E0-7A64-478A-B1B2-000000000000"));
+	g_assert (fwupd_device_has_guid (dev, "WacomAES"));
+
+	/* array modified by the caller, as fu_device_rescan() does */
+	g_ptr_array_set_size (guids, 0);
+	fwupd_device_rebuild_guid_index (dev);
+	g_assert (!fwupd_device_has_guid (dev, "2082b5e0-7a64-478a-b1b2-000000000000"));
+	fwupd_device_add_guid (dev, "2082b5e0-7a64-478a-b1b2-000000000000");
+	g_assert_cmpint (guids->len, ==, 1);
+	g_assert (fwupd_device_has_guid (dev, "2082b5e0-7a64-478a-b1b2-000000000000"));
+
+	/* same length after the edit */
+	g_ptr_array_set_size (guids, 0);
+	g_ptr_array_add (guids, g_strdup ("2082b5e0-7a64-478a-b1b2-000000000001"));
+	fwupd_device_rebuild_guid_index (dev);
+	g_assert (!fwupd_device_has_guid (dev, "2082b5e0-7a64-478a-b1b2-000000000000"));
+	g_assert (fwupd_device_has_guid (dev, "2082b5e0-7a64-478a-b1b2-000000000001"));
+	fwupd_device_add_guid (dev, "2082b5e0-7a64-478a-b1b2-000000000001");
+	g_assert_cmpint (guids->len, ==, 1);
+}
+
+static void
+fwupd_device_interned_func (void)
+{
+	g_autofree gchar *protocol = g_strdup ("com.acme.test");
+	g_autoptr(FwupdDevice) dev1 = fwupd_device_new ();
+	g_autoptr(FwupdDevice) dev2 = fwupd_device_new ();
+
+	/* both devices share the same string */
+	fwupd_device_set_protocol (dev1, "com.acme.test");
+	fwupd_device_set_protocol (dev2, protocol);
+	g_assert_cmpstr (fwupd_device_get_protocol (dev2), ==, "com.acme.test");
+	g_assert (fwupd_device_get_protocol (dev1) == fwupd_device_get_protocol (dev2));
+	fwupd_device_set_vendor (dev1, "ACME");
+	fwupd_device_set_vendor (dev2, "ACME");
+	g_assert (fwupd_device_get_vendor (dev1) == fwupd_device_get_vendor (dev2));
+
+	/* cleared */
+	fwupd_device_set_protocol (dev1, NULL);
+	g_assert_null (fwupd_device_get_protocol (dev1));
+}
+
+static void
+fwupd_device_variant_cached_func (void)
+{
+	const gchar *tmp = NULL;
+	g_autoptr(FwupdDevice) dev = fwupd_device_new ();
+	g_autoptr(GVariant) val1 = NULL;
+	g_autoptr(GVariant) val2 = NULL;
+	g_autoptr(GVariant) val3 = NULL;
+	g_autoptr(GVariant) val4 = NULL;
+
+	fwupd_device_set_id (dev, "USB:foo");
+	fwupd_device_set_serial (dev, "12345");
+	fwupd_device_set_version (dev, "1.2.3");
+
+	/* reused until something changes */
+	val1 = fwupd_device_to_variant_cached (dev, FWUPD_DEVICE_FLAG_NONE);
+	val2 = fwupd_device_to_variant_cached (dev, FWUPD_DEVICE_FLAG_NONE);
+	g_assert_true (val1 == val2);
+	g_assert_false (g_variant_is_floating (val1));
+	g_assert_false (g_variant_lookup (val1, FWUPD_RESULT_KEY_SERIAL, "&s", &tmp));
+
+	/* trusted callers get a different cache entry */
+	val3 = fwupd_device_to_variant_cached (dev, FWUPD_DEVICE_FLAG_TRUSTED);
+	g_assert_true (val1 != val3);
+	g_assert_true (g_variant_lookup (val3, FWUPD_RESULT_KEY_SERIAL, "&s", &tmp));
+	g_assert_cmpstr (tmp, ==, "12345");
+
+	/* invalidated by a setter */
+	fwupd_device_set_version (dev, "1.2.4");
+	val4 = fwupd_device_to_variant_cached (dev, FWUPD_DEVICE_FLAG_NONE);
+	g_assert_true (val1 != val4);
+	g_assert_true (g_variant_lookup (val4, FWUPD_RESULT_KEY_VERSION, "&s", &tmp));
+	g_assert_cmpstr (tmp, ==, "1.2.4");
+}
+
 static void
 fwupd_device_func (void)
 {
@@ -429,6 +549,64 @@ fwupd_device_func (void)
 	g_assert (ret);
 }
 
+static void
+fwupd_client_async_ready_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	GAsyncResult **res_out = (GAsyncResult **) user_data;
+	*res_out = g_object_ref (res);
+}
+
+static GAsyncResult *
+fwupd_client_async_wait (GAsyncResult **res)
+{
+	while (*res == NULL)
+		g_main_context_iteration (NULL, TRUE);
+	return *res;
+}
+
+static void
+fwupd_client_devices_async_func (void)
+{
+	gboolean ret;
+	g_autoptr(FwupdClient) client = fwupd_client_new ();
+	g_autoptr(GAsyncResult) res1 = NULL;
+	g_autoptr(GAsyncResult) res2 = NULL;
+	g_autoptr(GAsyncResult) res3 = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) devices1 = NULL;
+	g_autoptr(GPtrArray) devices2 = NULL;
+
+	fwupd_client_connect_async (client, NULL, fwupd_client_async_ready_cb, &res1);
+	ret = fwupd_client_connect_finish (client, fwupd_client_async_wait (&res1), &error);
+	if (!ret && g_error_matches (error, G_DBUS_ERROR, G_DBUS_ERROR_TIMED_OUT)) {
+		g_test_skip ("timeout connecting to daemon");
+		return;
+	}
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	if (fwupd_client_get_daemon_version (client) == NULL) {
+		g_test_skip ("no enabled fwupd daemon");
+		return;
+	}
+
+	/* both calls are in flight at the same time */
+	fwupd_client_get_devices_async (client, NULL, fwupd_client_async_ready_cb, &res2);
+	fwupd_client_get_devices_async (client, NULL, fwupd_client_async_ready_cb, &res3);
+	devices1 = fwupd_client_get_devices_finish (client, fwupd_client_async_wait (&res2), &error);
+	if (devices1 == NULL &&
+	    (g_error_matches (error, FWUPD_ERROR, FWUPD_ERROR_NOTHING_TO_DO) ||
+	     g_error_matches (error, FWUPD_ERROR, FWUPD_ERROR_NOT_SUPPORTED))) {
+		g_test_skip ("no available fwupd devices");
+		return;
+	}
+	g_assert_no_error (error);
+	g_assert_nonnull (devices1);
+	devices2 = fwupd_client_get_devices_finish (client, fwupd_client_async_wait (&res3), &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (devices2);
+	g_assert_cmpint (devices1->len, ==, devices2->len);
+}
+
 static void
 fwupd_client_devices_func (void)
 {
@@ -665,6 +843,9 @@ main (int argc, char **argv)
 	g_test_add_func ("/fwupd/common{guid}", fwupd_common_guid_func);
 	g_test_add_func ("/fwupd/release", fwupd_release_func);
 	g_test_add_func ("/fwupd/device", fwupd_device_func);
+	g_test_add_func ("/fwupd/device{guids}", fwupd_device_guids_func);
+	g_test_add_func ("/fwupd/device{interned}", fwupd_device_interned_func);
+	g_test_add_func ("/fwupd/device{variant-cached}", fwupd_device_variant_cached_func);
 	g_test_add_func ("/fwupd/remote{download}", fwupd_remote_download_func);
 	g_test_add_func ("/fwupd/remote{base-uri}", fwupd_remote_baseuri_func);
 	g_test_add_func ("/fwupd/remote{no-path}", fwupd_remote_nopath_func);
@@ -672,6 +853,7 @@ main (int argc, char **argv)
 	if (fwupd_has_system_bus ()) {
 		g_test_add_func ("/fwupd/client{remotes}", fwupd_client_remotes_func);
 		g_test_add_func ("/fwupd/client{devices}", fwupd_client_devices_func);
+		g_test_add_func ("/fwupd/client{devices-async}", fwupd_client_devices_async_func);
 	}
 	return g_test_run ();
 }
@@ -464,6 +464,57 @@ fu_common_version_verify_format (const gchar *version,
 	return TRUE;
 }
 
+/**
+ * fu_common_version_to_key:
+ * @version: (nullable): a version number, e.g. `1.2.3`
+ * @fmt: a #FwupdVersionFormat, e.g. %FWUPD_VERSION_FORMAT_TRIPLET
+ *
+ * Converts a version number to a packed integer key that can be compared
+ * with other keys using simple integer comparisons. Each dotted section is
+ * stored in 16 bits so that sorting by the key gives the same order as
+ * fu_common_vercmp_full().
+ *
+ * Versions that cannot be represented, for instance with more than four
+ * sections, non-numeric content, or the plain version format return zero,
+ * and must be compared using fu_common_vercmp_full() instead.
+ *
+ * Returns: a version key, or 0 if the version cannot be converted
+ *
+ * Since: 1.4.2
+ */
+guint64
+fu_common_version_to_key (const gchar *version, FwupdVersionFormat fmt)
+{
+	const gchar *tmp = version;
+	guint64 key = 0;
+
+	/* compared as strings */
+	if (version == NULL || fmt == FWUPD_VERSION_FORMAT_PLAIN)
+		return 0;
+
+	/* section 0 is stored in the high bits, and missing sections are
+	 * stored as zero so that 1.2 sorts lower than 1.2.0 */
+	for (guint i = 0; i < 4; i++) {
+		guint64 val = 0;
+		if (!g_ascii_isdigit (tmp[0]))
+			return 0;
+		for (; g_ascii_isdigit (tmp[0]); tmp++) {
+			val = (val * 10) + (tmp[0] - '0');
+			if (val >= G_MAXUINT16)
+				return 0;
+		}
+		key |= (val + 1) << (48 - (16 * i));
+		if (tmp[0] == '\0')
+			return key;
+		if (tmp[0] != '.')
+			return 0;
+		tmp++;
+	}
+
+	/* too many sections */
+	return 0;
+}
+
 /**
  * fu_common_vercmp_full:
  * @version_a: the semver release version, e.g. 1.2.3
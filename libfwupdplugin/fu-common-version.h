@@ -15,6 +15,8 @@ G_DEPRECATED_FOR(fu_common_vercmp_full);
 gint		 fu_common_vercmp_full		(const gchar	*version_a,
 						 const gchar	*version_b,
 						 FwupdVersionFormat fmt);
+guint64		 fu_common_version_to_key	(const gchar	*version,
+						 FwupdVersionFormat fmt);
 gchar		*fu_common_version_from_uint64	(guint64	 val,
 						 FwupdVersionFormat kind);
 gchar		*fu_common_version_from_uint32	(guint32	 val,
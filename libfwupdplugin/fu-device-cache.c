@@ -0,0 +1,384 @@
+/*
+ * Copyright (C) 2020 The fwupd authors
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#define G_LOG_DOMAIN				"FuDeviceCache"
+
+#include "config.h"
+
+#include <gio/gio.h>
+
+#include "fu-common.h"
+#include "fu-device-cache.h"
+
+#include "fwupd-device-private.h"
+
+/* daemon version, then physical ID:(token, device) */
+#define FU_DEVICE_CACHE_VARIANT_TYPE		"(sa{s(sa{sv})})"
+
+/* set by the daemon during a session rather than by probing the hardware */
+#define FU_DEVICE_CACHE_FLAGS_SESSION		(FWUPD_DEVICE_FLAG_SUPPORTED | \
+						 FWUPD_DEVICE_FLAG_REGISTERED | \
+						 FWUPD_DEVICE_FLAG_NEEDS_REBOOT | \
+						 FWUPD_DEVICE_FLAG_NEEDS_SHUTDOWN | \
+						 FWUPD_DEVICE_FLAG_NEEDS_ACTIVATION | \
+						 FWUPD_DEVICE_FLAG_REPORTED | \
+						 FWUPD_DEVICE_FLAG_NOTIFIED | \
+						 FWUPD_DEVICE_FLAG_HISTORICAL | \
+						 FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG | \
+						 FWUPD_DEVICE_FLAG_ANOTHER_WRITE_REQUIRED | \
+						 FWUPD_DEVICE_FLAG_WILL_DISAPPEAR | \
+						 FWUPD_DEVICE_FLAG_TRUSTED)
+
+typedef struct {
+	gchar			*token;
+	GVariant		*value;
+	gboolean		 used;		/* restored or added this session */
+} FuDeviceCacheItem;
+
+struct _FuDeviceCache {
+	GObject			 parent_instance;
+	gchar			*filename;
+	GHashTable		*items;		/* key:FuDeviceCacheItem */
+	gboolean		 dirty;
+};
+
+G_DEFINE_TYPE (FuDeviceCache, fu_device_cache, G_TYPE_OBJECT)
+
+static void
+fu_device_cache_item_free (FuDeviceCacheItem *item)
+{
+	g_free (item->token);
+	g_variant_unref (item->value);
+	g_free (item);
+}
+
+static FuDeviceCacheItem *
+fu_device_cache_item_new (const gchar *token, GVariant *value)
+{
+	FuDeviceCacheItem *item = g_new0 (FuDeviceCacheItem, 1);
+	item->token = g_strdup (token);
+	item->value = g_variant_ref_sink (value);
+	return item;
+}
+
+static gchar *
+fu_device_cache_get_key (FuDevice *device)
+{
+	const gchar *physical_id = fu_device_get_physical_id (device);
+	const gchar *logical_id = fu_device_get_logical_id (device);
+	if (physical_id == NULL)
+		return NULL;
+	if (logical_id == NULL)
+		return g_strdup (physical_id);
+	return g_strdup_printf ("%s:%s", physical_id, logical_id);
+}
+
+/**
+ * fu_device_cache_load:
+ * @self: A #FuDeviceCache
+ * @filename: A filename, which does not have to exist
+ * @error: A #GError, or %NULL
+ *
+ * Loads the devices saved by a previous daemon instance. A cache written by a
+ * different daemon version is ignored.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.4.2
+ **/
+gboolean
+fu_device_cache_load (FuDeviceCache *self, const gchar *filename, GError **error)
+{
+	const gchar *version = NULL;
+	GVariantIter iter;
+	GVariant *value = NULL;
+	const gchar *key = NULL;
+	const gchar *token = NULL;
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GVariant) items = NULL;
+	g_autoptr(GVariant) data = NULL;
+
+	g_return_val_if_fail (FU_IS_DEVICE_CACHE (self), FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	/* save for later */
+	g_free (self->filename);
+	self->filename = g_strdup (filename);
+	g_hash_table_remove_all (self->items);
+	self->dirty = FALSE;
+
+	/* nothing saved yet */
+	if (!g_file_test (filename, G_FILE_TEST_EXISTS))
+		return TRUE;
+	blob = fu_common_get_contents_bytes (filename, error);
+	if (blob == NULL)
+		return FALSE;
+	data = g_variant_new_from_bytes (G_VARIANT_TYPE (FU_DEVICE_CACHE_VARIANT_TYPE),
+					 blob, FALSE);
+	g_variant_get (data, "(&s@a{s(sa{sv})})", &version, &items);
+	if (g_strcmp0 (version, PACKAGE_VERSION) != 0) {
+		g_debug ("ignoring device cache from %s", version);
+		self->dirty = TRUE;
+		return TRUE;
+	}
+	g_variant_iter_init (&iter, items);
+	while (g_variant_iter_next (&iter, "{&s(&s@a{sv})}", &key, &token, &value)) {
+		g_hash_table_insert (self->items,
+				     g_strdup (key),
+				     fu_device_cache_item_new (token, value));
+		g_variant_unref (value);
+	}
+	g_debug ("loaded %u cached devices", g_hash_table_size (self->items));
+	return TRUE;
+}
+
+/**
+ * fu_device_cache_save:
+ * @self: A #FuDeviceCache
+ * @error: A #GError, or %NULL
+ *
+ * Saves all the devices added or restored since the cache was loaded, dropping
+ * any devices that were not seen. Nothing is written if nothing changed.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.4.2
+ **/
+gboolean
+fu_device_cache_save (FuDeviceCache *self, GError **error)
+{
+	GHashTableIter iter;
+	gpointer key;
+	gpointer value;
+	GVariantBuilder builder;
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GVariant) data = NULL;
+
+	g_return_val_if_fail (FU_IS_DEVICE_CACHE (self), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	/* not loaded */
+	if (self->filename == NULL) {
+		g_set_error_literal (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_NOT_INITIALIZED,
+				     "no filename set");
+		return FALSE;
+	}
+
+	/* remove any devices that have gone away */
+	g_hash_table_iter_init (&iter, self->items);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		FuDeviceCacheItem *item = (FuDeviceCacheItem *) value;
+		if (!item->used) {
+			g_hash_table_iter_remove (&iter);
+			self->dirty = TRUE;
+		}
+	}
+	if (!self->dirty)
+		return TRUE;
+
+	/* save */
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{s(sa{sv})}"));
+	g_hash_table_iter_init (&iter, self->items);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		FuDeviceCacheItem *item = (FuDeviceCacheItem *) value;
+		g_variant_builder_add (&builder, "{s(s@a{sv})}",
+				       (const gchar *) key,
+				       item->token,
+				       item->value);
+	}
+	data = g_variant_ref_sink (g_variant_new ("(sa{s(sa{sv})})",
+						  PACKAGE_VERSION,
+						  &builder));
+	blob = g_variant_get_data_as_bytes (data);
+	if (!fu_common_set_contents_bytes (self->filename, blob, error))
+		return FALSE;
+	self->dirty = FALSE;
+	return TRUE;
+}
+
+/**
+ * fu_device_cache_add:
+ * @self: A #FuDeviceCache
+ * @device: A #FuDevice that has been set up
+ *
+ * Saves the probed identity of the device, e.g. the GUIDs, version and flags.
+ * Devices without a physical ID or cache token are ignored.
+ *
+ * Since: 1.4.2
+ **/
+void
+fu_device_cache_add (FuDeviceCache *self, FuDevice *device)
+{
+	const gchar *token;
+	FuDeviceCacheItem *item;
+	g_autofree gchar *key = NULL;
+
+	g_return_if_fail (FU_IS_DEVICE_CACHE (self));
+	g_return_if_fail (FU_IS_DEVICE (device));
+
+	token = fu_device_get_cache_token (device);
+	if (token == NULL)
+		return;
+	key = fu_device_cache_get_key (device);
+	if (key == NULL)
+		return;
+	item = fu_device_cache_item_new (token,
+					 fwupd_device_to_variant_full (FWUPD_DEVICE (device),
+								       FWUPD_DEVICE_FLAG_TRUSTED));
+	item->used = TRUE;
+	g_hash_table_insert (self->items, g_steal_pointer (&key), item);
+	self->dirty = TRUE;
+}
+
+/* only the identity found when the device was set up, and never the result
+ * of a previous update */
+static void
+fu_device_cache_incorporate (FuDevice *self, FwupdDevice *donor)
+{
+	GPtrArray *guids = fwupd_device_get_guids (donor);
+
+	if (fu_device_get_name (self) == NULL)
+		fwupd_device_set_name (FWUPD_DEVICE (self), fwupd_device_get_name (donor));
+	if (fu_device_get_summary (self) == NULL)
+		fu_device_set_summary (self, fwupd_device_get_summary (donor));
+	if (fu_device_get_vendor (self) == NULL)
+		fu_device_set_vendor (self, fwupd_device_get_vendor (donor));
+	if (fu_device_get_vendor_id (self) == NULL)
+		fu_device_set_vendor_id (self, fwupd_device_get_vendor_id (donor));
+	if (fu_device_get_serial (self) == NULL)
+		fu_device_set_serial (self, fwupd_device_get_serial (donor));
+	if (fu_device_get_version_format (self) == FWUPD_VERSION_FORMAT_UNKNOWN)
+		fwupd_device_set_version_format (FWUPD_DEVICE (self), fwupd_device_get_version_format (donor));
+	if (fu_device_get_version (self) == NULL)
+		fwupd_device_set_version (FWUPD_DEVICE (self), fwupd_device_get_version (donor));
+	if (fu_device_get_version_lowest (self) == NULL)
+		fwupd_device_set_version_lowest (FWUPD_DEVICE (self), fwupd_device_get_version_lowest (donor));
+	if (fu_device_get_version_bootloader (self) == NULL)
+		fwupd_device_set_version_bootloader (FWUPD_DEVICE (self), fwupd_device_get_version_bootloader (donor));
+	if (fu_device_get_version_raw (self) == 0)
+		fu_device_set_version_raw (self, fwupd_device_get_version_raw (donor));
+	for (guint i = 0; i < guids->len; i++) {
+		const gchar *guid = g_ptr_array_index (guids, i);
+		fu_device_add_guid (self, guid);
+	}
+	fu_device_add_flag (self, fwupd_device_get_flags (donor) & ~FU_DEVICE_CACHE_FLAGS_SESSION);
+}
+
+/**
+ * fu_device_cache_restore:
+ * @self: A #FuDeviceCache
+ * @device: A #FuDevice that has been probed
+ *
+ * Restores the identity of the device from the cache, but only if the cache
+ * token has not changed since the device was added. The update state, update
+ * error and any flags set during the previous session are not restored.
+ *
+ * Returns: %TRUE if the device was restored
+ *
+ * Since: 1.4.2
+ **/
+gboolean
+fu_device_cache_restore (FuDeviceCache *self, FuDevice *device)
+{
+	const gchar *token;
+	FuDeviceCacheItem *item;
+	g_autofree gchar *key = NULL;
+	g_autoptr(FwupdDevice) donor = NULL;
+
+	g_return_val_if_fail (FU_IS_DEVICE_CACHE (self), FALSE);
+	g_return_val_if_fail (FU_IS_DEVICE (device), FALSE);
+
+	token = fu_device_get_cache_token (device);
+	if (token == NULL)
+		return FALSE;
+	key = fu_device_cache_get_key (device);
+	if (key == NULL)
+		return FALSE;
+	item = g_hash_table_lookup (self->items, key);
+	if (item == NULL)
+		return FALSE;
+
+	/* the device has changed, e.g. been updated */
+	if (g_strcmp0 (item->token, token) != 0) {
+		g_debug ("cache token for %s changed from %s to %s",
+			 key, item->token, token);
+		g_hash_table_remove (self->items, key);
+		self->dirty = TRUE;
+		return FALSE;
+	}
+	donor = fwupd_device_from_variant (item->value);
+	if (donor == NULL) {
+		g_hash_table_remove (self->items, key);
+		self->dirty = TRUE;
+		return FALSE;
+	}
+	fu_device_cache_incorporate (device, donor);
+	item->used = TRUE;
+	return TRUE;
+}
+
+/**
+ * fu_device_cache_get_size:
+ * @self: A #FuDeviceCache
+ *
+ * Gets the number of cached devices.
+ *
+ * Returns: integer
+ *
+ * Since: 1.4.2
+ **/
+guint
+fu_device_cache_get_size (FuDeviceCache *self)
+{
+	g_return_val_if_fail (FU_IS_DEVICE_CACHE (self), 0);
+	return g_hash_table_size (self->items);
+}
+
+static void
+fu_device_cache_finalize (GObject *object)
+{
+	FuDeviceCache *self = FU_DEVICE_CACHE (object);
+
+	g_free (self->filename);
+	g_hash_table_unref (self->items);
+
+	G_OBJECT_CLASS (fu_device_cache_parent_class)->finalize (object);
+}
+
+static void
+fu_device_cache_class_init (FuDeviceCacheClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = fu_device_cache_finalize;
+}
+
+static void
+fu_device_cache_init (FuDeviceCache *self)
+{
+	self->items = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+					     (GDestroyNotify) fu_device_cache_item_free);
+}
+
+/**
+ * fu_device_cache_new:
+ *
+ * Creates a new cache of the probed identity of devices, which can be used to
+ * avoid setting up devices when the daemon is restarted.
+ *
+ * Returns: a #FuDeviceCache
+ *
+ * Since: 1.4.2
+ **/
+FuDeviceCache *
+fu_device_cache_new (void)
+{
+	FuDeviceCache *self;
+	self = g_object_new (FU_TYPE_DEVICE_CACHE, NULL);
+	return FU_DEVICE_CACHE (self);
+}
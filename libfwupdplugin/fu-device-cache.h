@@ -0,0 +1,26 @@
+/*
+ * Copyright (C) 2020 The fwupd authors
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#pragma once
+
+#include <glib-object.h>
+
+#include "fu-device.h"
+
+#define FU_TYPE_DEVICE_CACHE (fu_device_cache_get_type ())
+G_DECLARE_FINAL_TYPE (FuDeviceCache, fu_device_cache, FU, DEVICE_CACHE, GObject)
+
+FuDeviceCache	*fu_device_cache_new		(void);
+gboolean	 fu_device_cache_load		(FuDeviceCache	*self,
+						 const gchar	*filename,
+						 GError		**error);
+gboolean	 fu_device_cache_save		(FuDeviceCache	*self,
+						 GError		**error);
+void		 fu_device_cache_add		(FuDeviceCache	*self,
+						 FuDevice	*device);
+gboolean	 fu_device_cache_restore	(FuDeviceCache	*self,
+						 FuDevice	*device);
+guint		 fu_device_cache_get_size	(FuDeviceCache	*self);
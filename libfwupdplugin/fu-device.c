@@ -37,6 +37,7 @@ typedef struct {
 	gchar				*physical_id;
 	gchar				*logical_id;
 	gchar				*proxy_guid;
+	gchar				*cache_token;
 	FuDevice			*alternate;
 	FuDevice			*parent;	/* noref */
 	FuDevice			*proxy;		/* noref */
@@ -61,6 +62,11 @@ typedef struct {
 	GPtrArray			*possible_plugins;
 	GPtrArray			*retry_recs;	/* of FuDeviceRetryRecovery */
 	guint				 retry_delay;
+	guint64				 version_key;
+	gchar				*version_key_str;
+	FwupdVersionFormat		 version_key_fmt;
+	guint				 batch_depth;
+	gboolean			 batch_changed;
 } FuDevicePrivate;
 
 typedef struct {
@@ -80,6 +86,13 @@ enum {
 	PROP_LAST
 };
 
+enum {
+	SIGNAL_BATCH_CHANGED,
+	SIGNAL_LAST
+};
+
+static guint signals[SIGNAL_LAST] = { 0 };
+
 G_DEFINE_TYPE_WITH_PRIVATE (FuDevice, fu_device, FWUPD_TYPE_DEVICE)
 #define GET_PRIVATE(o) (fu_device_get_instance_private (o))
 
@@ -1495,7 +1508,10 @@ fu_device_set_metadata (FuDevice *self, const gchar *key, const gchar *value)
 	g_return_if_fail (key != NULL);
 	g_return_if_fail (value != NULL);
 	g_return_if_fail (locker != NULL);
-	g_hash_table_insert (priv->metadata, g_strdup (key), g_strdup (value));
+	/* keys come from a small fixed vocabulary shared by every device */
+	g_hash_table_insert (priv->metadata,
+			     (gpointer) g_intern_string (key),
+			     g_strdup (value));
 }
 
 /**
@@ -1620,6 +1636,44 @@ fu_device_set_id (FuDevice *self, const gchar *id)
 	}
 }
 
+static void
+fu_device_ensure_version_key (FuDevice *self)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	const gchar *version = fu_device_get_version (self);
+	FwupdVersionFormat fmt = fu_device_get_version_format (self);
+
+	/* already valid */
+	if (priv->version_key_fmt == fmt &&
+	    g_strcmp0 (priv->version_key_str, version) == 0)
+		return;
+	g_free (priv->version_key_str);
+	priv->version_key_str = g_strdup (version);
+	priv->version_key_fmt = fmt;
+	priv->version_key = fu_common_version_to_key (version, fmt);
+}
+
+/**
+ * fu_device_get_version_key:
+ * @self: A #FuDevice
+ *
+ * Gets the device version as a packed integer key, which is computed when
+ * the version or version format is set. Keys from fu_common_version_to_key()
+ * can be compared with simple integer comparisons.
+ *
+ * Returns: the version key, or 0 if the version cannot be represented
+ *
+ * Since: 1.4.2
+ **/
+guint64
+fu_device_get_version_key (FuDevice *self)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	g_return_val_if_fail (FU_IS_DEVICE (self), 0);
+	fu_device_ensure_version_key (self);
+	return priv->version_key;
+}
+
 /**
  * fu_device_set_version_format:
  * @self: A #FwupdDevice
@@ -1642,6 +1696,7 @@ fu_device_set_version_format (FuDevice *self, FwupdVersionFormat fmt)
 			 fwupd_version_format_to_string (fmt));
 	}
 	fwupd_device_set_version_format (FWUPD_DEVICE (self), fmt);
+	fu_device_ensure_version_key (self);
 }
 
 /**
@@ -1684,6 +1739,7 @@ fu_device_set_version (FuDevice *self, const gchar *version)
 		}
 		fwupd_device_set_version (FWUPD_DEVICE (self), version_safe);
 	}
+	fu_device_ensure_version_key (self);
 }
 
 /**
@@ -1833,6 +1889,46 @@ fu_device_get_logical_id (FuDevice *self)
 	return priv->logical_id;
 }
 
+/**
+ * fu_device_get_cache_token:
+ * @self: A #FuDevice
+ *
+ * Gets the token used to decide if the device can be restored from the
+ * enumeration cache.
+ *
+ * Returns: a string value, or %NULL if never set.
+ *
+ * Since: 1.4.2
+ **/
+const gchar *
+fu_device_get_cache_token (FuDevice *self)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	g_return_val_if_fail (FU_IS_DEVICE (self), NULL);
+	return priv->cache_token;
+}
+
+/**
+ * fu_device_set_cache_token:
+ * @self: A #FuDevice
+ * @cache_token: a string, e.g. `1.2.3`, or %NULL
+ *
+ * Sets a token that is cheap to read in ->probe() and that changes whenever
+ * the identity found in ->setup() would change, for instance the firmware
+ * version exported in sysfs. Devices with a token can be restored from the
+ * enumeration cache rather than being opened when the daemon is started.
+ *
+ * Since: 1.4.2
+ **/
+void
+fu_device_set_cache_token (FuDevice *self, const gchar *cache_token)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	g_return_if_fail (FU_IS_DEVICE (self));
+	g_free (priv->cache_token);
+	priv->cache_token = g_strdup (cache_token);
+}
+
 /**
  * fu_device_set_logical_id:
  * @self: A #FuDevice
@@ -2261,6 +2357,8 @@ fu_device_add_string (FuDevice *self, guint idt, GString *str)
 		fu_common_string_append_kv (str, idt + 1, "ProxyId", fu_device_get_id (priv->proxy));
 	if (priv->proxy_guid != NULL)
 		fu_common_string_append_kv (str, idt + 1, "ProxyGuid", priv->proxy_guid);
+	if (priv->cache_token != NULL)
+		fu_common_string_append_kv (str, idt + 1, "CacheToken", priv->cache_token);
 	if (priv->size_min > 0) {
 		g_autofree gchar *sz = g_strdup_printf ("%" G_GUINT64_FORMAT, priv->size_min);
 		fu_common_string_append_kv (str, idt + 1, "FirmwareSizeMin", sz);
@@ -2829,6 +2927,7 @@ fu_device_rescan (FuDevice *self, GError **error)
 	/* remove all GUIDs */
 	g_ptr_array_set_size (fu_device_get_instance_ids (self), 0);
 	g_ptr_array_set_size (fu_device_get_guids (self), 0);
+	fwupd_device_rebuild_guid_index (FWUPD_DEVICE (self));
 
 	/* subclassed */
 	if (klass->rescan != NULL) {
@@ -2968,6 +3067,93 @@ fu_device_probe_invalidate (FuDevice *self)
 	priv->done_setup = FALSE;
 }
 
+/**
+ * fu_device_batch_begin:
+ * @self: A #FuDevice
+ *
+ * Starts a batch of property changes. Any GObject notifications are held
+ * back until fu_device_batch_commit() is called, and each property is only
+ * notified once however many times it was changed.
+ *
+ * Batches can be nested, and only the outermost commit emits anything.
+ *
+ * Since: 1.4.2
+ **/
+void
+fu_device_batch_begin (FuDevice *self)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	g_return_if_fail (FU_IS_DEVICE (self));
+	if (priv->batch_depth++ == 0)
+		priv->batch_changed = FALSE;
+	g_object_freeze_notify (G_OBJECT (self));
+}
+
+/**
+ * fu_device_batch_defer_changed:
+ * @self: A #FuDevice
+ *
+ * Records that the device has changed if a batch is in progress, so that the
+ * caller can emit one change notification when the batch is committed.
+ *
+ * Returns: %TRUE if the notification was deferred
+ *
+ * Since: 1.4.2
+ **/
+gboolean
+fu_device_batch_defer_changed (FuDevice *self)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	g_return_val_if_fail (FU_IS_DEVICE (self), FALSE);
+	if (priv->batch_depth == 0)
+		return FALSE;
+	priv->batch_changed = TRUE;
+	return TRUE;
+}
+
+/**
+ * fu_device_batch_commit:
+ * @self: A #FuDevice
+ *
+ * Ends a batch of property changes started with fu_device_batch_begin(),
+ * emitting any held back GObject notifications. If this was the outermost
+ * batch and anything changed then the ::batch-changed signal is emitted.
+ *
+ * Returns: %TRUE if this was the outermost batch and anything changed
+ *
+ * Since: 1.4.2
+ **/
+gboolean
+fu_device_batch_commit (FuDevice *self)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	g_return_val_if_fail (FU_IS_DEVICE (self), FALSE);
+	g_return_val_if_fail (priv->batch_depth > 0, FALSE);
+
+	/* this sets batch_changed if any notifications were queued */
+	g_object_thaw_notify (G_OBJECT (self));
+	if (--priv->batch_depth > 0)
+		return FALSE;
+	if (!priv->batch_changed)
+		return FALSE;
+	g_signal_emit (self, signals[SIGNAL_BATCH_CHANGED], 0);
+	return TRUE;
+}
+
+static void
+fu_device_dispatch_properties_changed (GObject *object,
+				       guint n_pspecs,
+				       GParamSpec **pspecs)
+{
+	FuDevice *self = FU_DEVICE (object);
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	if (priv->batch_depth > 0 && n_pspecs > 0)
+		priv->batch_changed = TRUE;
+	G_OBJECT_CLASS (fu_device_parent_class)->dispatch_properties_changed (object,
+									      n_pspecs,
+									      pspecs);
+}
+
 /**
  * fu_device_incorporate:
  * @self: A #FuDevice
@@ -2990,6 +3176,9 @@ fu_device_incorporate (FuDevice *self, FuDevice *donor)
 	g_return_if_fail (FU_IS_DEVICE (self));
 	g_return_if_fail (FU_IS_DEVICE (donor));
 
+	/* notify each changed property once */
+	fu_device_batch_begin (self);
+
 	/* copy from donor FuDevice if has not already been set */
 	if (priv->alternate_id == NULL)
 		fu_device_set_alternate_id (self, fu_device_get_alternate_id (donor));
@@ -3003,6 +3192,8 @@ fu_device_incorporate (FuDevice *self, FuDevice *donor)
 		fu_device_set_proxy (self, priv_donor->proxy);
 	if (priv->proxy_guid == NULL && priv_donor->proxy_guid != NULL)
 		fu_device_set_proxy_guid (self, priv_donor->proxy_guid);
+	if (priv->cache_token == NULL && priv_donor->cache_token != NULL)
+		fu_device_set_cache_token (self, priv_donor->cache_token);
 	if (priv->quirks == NULL)
 		fu_device_set_quirks (self, fu_device_get_quirks (donor));
 	g_rw_lock_reader_lock (&priv_donor->parent_guids_mutex);
@@ -3037,6 +3228,7 @@ fu_device_incorporate (FuDevice *self, FuDevice *donor)
 		g_autofree gchar *guid = fwupd_guid_hash_string (instance_id);
 		fu_device_add_guid_quirks (self, guid);
 	}
+	fu_device_batch_commit (self);
 }
 
 /**
@@ -3089,6 +3281,13 @@ fu_device_class_init (FuDeviceClass *klass)
 	object_class->finalize = fu_device_finalize;
 	object_class->get_property = fu_device_get_property;
 	object_class->set_property = fu_device_set_property;
+	object_class->dispatch_properties_changed = fu_device_dispatch_properties_changed;
+
+	signals[SIGNAL_BATCH_CHANGED] =
+		g_signal_new ("batch-changed",
+			      G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
+			      0, NULL, NULL, g_cclosure_marshal_VOID__VOID,
+			      G_TYPE_NONE, 0);
 
 	pspec = g_param_spec_string ("physical-id", NULL, NULL, NULL,
 				     G_PARAM_READWRITE |
@@ -3137,7 +3336,7 @@ fu_device_init (FuDevice *self)
 	priv->retry_recs = g_ptr_array_new_with_free_func (g_free);
 	g_rw_lock_init (&priv->parent_guids_mutex);
 	priv->metadata = g_hash_table_new_full (g_str_hash, g_str_equal,
-						g_free, g_free);
+						NULL, g_free);
 	g_rw_lock_init (&priv->metadata_mutex);
 }
 
@@ -3169,6 +3368,8 @@ fu_device_finalize (GObject *object)
 	g_free (priv->physical_id);
 	g_free (priv->logical_id);
 	g_free (priv->proxy_guid);
+	g_free (priv->cache_token);
+	g_free (priv->version_key_str);
 
 	G_OBJECT_CLASS (fu_device_parent_class)->finalize (object);
 }
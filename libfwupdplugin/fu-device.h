@@ -210,6 +210,7 @@ void		 fu_device_set_version_format		(FuDevice	*self,
 							 FwupdVersionFormat fmt);
 void		 fu_device_set_version			(FuDevice	*self,
 							 const gchar	*version);
+guint64		 fu_device_get_version_key		(FuDevice	*self);
 void		 fu_device_set_version_lowest		(FuDevice	*self,
 							 const gchar	*version);
 void		 fu_device_set_version_bootloader	(FuDevice	*self,
@@ -220,6 +221,9 @@ void		 fu_device_set_physical_id		(FuDevice	*self,
 const gchar	*fu_device_get_logical_id		(FuDevice	*self);
 void		 fu_device_set_logical_id		(FuDevice	*self,
 							 const gchar	*logical_id);
+const gchar	*fu_device_get_cache_token		(FuDevice	*self);
+void		 fu_device_set_cache_token		(FuDevice	*self,
+							 const gchar	*cache_token);
 const gchar	*fu_device_get_proxy_guid		(FuDevice	*self);
 void		 fu_device_set_proxy_guid		(FuDevice	*self,
 							 const gchar	*proxy_guid);
@@ -284,6 +288,9 @@ gboolean	 fu_device_prepare			(FuDevice	*self,
 gboolean	 fu_device_cleanup			(FuDevice	*self,
 							 FwupdInstallFlags flags,
 							 GError		**error);
+void		 fu_device_batch_begin			(FuDevice	*self);
+gboolean	 fu_device_batch_defer_changed		(FuDevice	*self);
+gboolean	 fu_device_batch_commit			(FuDevice	*self);
 void		 fu_device_incorporate			(FuDevice	*self,
 							 FuDevice	*donor);
 void		 fu_device_incorporate_flag		(FuDevice	*self,
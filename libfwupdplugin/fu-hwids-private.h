@@ -0,0 +1,14 @@
+/*
+ * Copyright (C) 2020 The fwupd authors
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#pragma once
+
+#include "fu-hwids.h"
+
+gboolean	 fu_hwids_setup_with_cache	(FuHwids	*self,
+						 FuSmbios	*smbios,
+						 const gchar	*filename,
+						 GError		**error);
@@ -13,7 +13,8 @@
 #include <string.h>
 
 #include "fu-common.h"
-#include "fu-hwids.h"
+#include "fu-hwids-private.h"
+#include "fu-smbios-private.h"
 #include "fwupd-common.h"
 #include "fwupd-error.h"
 
@@ -27,6 +28,9 @@ struct _FuHwids {
 
 G_DEFINE_TYPE (FuHwids, fu_hwids, G_TYPE_OBJECT)
 
+/* daemon version, DMI table checksum, then raw values, display values and GUIDs */
+#define FU_HWIDS_CACHE_VARIANT_TYPE		"(ssa{ss}a{ss}as)"
+
 /**
  * fu_hwids_get_value:
  * @self: A #FuHwids
@@ -423,6 +427,141 @@ fu_hwids_setup (FuHwids *self, FuSmbios *smbios, GError **error)
 	return TRUE;
 }
 
+static gboolean
+fu_hwids_load_cache (FuHwids *self, const gchar *filename, const gchar *checksum)
+{
+	GVariantIter iter;
+	const gchar *version = NULL;
+	const gchar *checksum_tmp = NULL;
+	const gchar *key = NULL;
+	const gchar *value = NULL;
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GMappedFile) mapped_file = NULL;
+	g_autoptr(GVariant) data = NULL;
+	g_autoptr(GVariant) dmi_hw = NULL;
+	g_autoptr(GVariant) dmi_display = NULL;
+	g_autoptr(GVariant) guids = NULL;
+	g_autoptr(GError) error_local = NULL;
+
+	/* the snapshot is shared by every process, so avoid copying it */
+	mapped_file = g_mapped_file_new (filename, FALSE, &error_local);
+	if (mapped_file == NULL) {
+		g_debug ("no hwids cache: %s", error_local->message);
+		return FALSE;
+	}
+	blob = g_mapped_file_get_bytes (mapped_file);
+	data = g_variant_new_from_bytes (G_VARIANT_TYPE (FU_HWIDS_CACHE_VARIANT_TYPE),
+					 blob, FALSE);
+	g_variant_get (data, "(&s&s@a{ss}@a{ss}@as)",
+		       &version, &checksum_tmp, &dmi_hw, &dmi_display, &guids);
+
+	/* the GUIDs might be derived differently by another version */
+	if (g_strcmp0 (version, PACKAGE_VERSION) != 0) {
+		g_debug ("ignoring hwids cache from %s", version);
+		return FALSE;
+	}
+	if (g_strcmp0 (checksum_tmp, checksum) != 0) {
+		g_debug ("hwids cache is for DMI %s, not %s", checksum_tmp, checksum);
+		return FALSE;
+	}
+
+	/* success */
+	g_variant_iter_init (&iter, dmi_hw);
+	while (g_variant_iter_next (&iter, "{&s&s}", &key, &value))
+		g_hash_table_insert (self->hash_dmi_hw, g_strdup (key), g_strdup (value));
+	g_variant_iter_init (&iter, dmi_display);
+	while (g_variant_iter_next (&iter, "{&s&s}", &key, &value))
+		g_hash_table_insert (self->hash_dmi_display, g_strdup (key), g_strdup (value));
+	g_variant_iter_init (&iter, guids);
+	while (g_variant_iter_next (&iter, "&s", &value)) {
+		g_hash_table_insert (self->hash_guid, g_strdup (value), GUINT_TO_POINTER (1));
+		g_ptr_array_add (self->array_guids, g_strdup (value));
+	}
+	return TRUE;
+}
+
+static gboolean
+fu_hwids_save_cache (FuHwids *self,
+		     const gchar *filename,
+		     const gchar *checksum,
+		     GError **error)
+{
+	GHashTableIter iter;
+	gpointer key;
+	gpointer value;
+	GVariantBuilder builder_hw;
+	GVariantBuilder builder_display;
+	GVariantBuilder builder_guids;
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GVariant) data = NULL;
+
+	g_variant_builder_init (&builder_hw, G_VARIANT_TYPE ("a{ss}"));
+	g_hash_table_iter_init (&iter, self->hash_dmi_hw);
+	while (g_hash_table_iter_next (&iter, &key, &value))
+		g_variant_builder_add (&builder_hw, "{ss}", key, value);
+	g_variant_builder_init (&builder_display, G_VARIANT_TYPE ("a{ss}"));
+	g_hash_table_iter_init (&iter, self->hash_dmi_display);
+	while (g_hash_table_iter_next (&iter, &key, &value))
+		g_variant_builder_add (&builder_display, "{ss}", key, value);
+	g_variant_builder_init (&builder_guids, G_VARIANT_TYPE ("as"));
+	for (guint i = 0; i < self->array_guids->len; i++) {
+		const gchar *guid = g_ptr_array_index (self->array_guids, i);
+		g_variant_builder_add (&builder_guids, "s", guid);
+	}
+	data = g_variant_ref_sink (g_variant_new (FU_HWIDS_CACHE_VARIANT_TYPE,
+						  PACKAGE_VERSION,
+						  checksum,
+						  &builder_hw,
+						  &builder_display,
+						  &builder_guids));
+	blob = g_variant_get_data_as_bytes (data);
+	return fu_common_set_contents_bytes (filename, blob, error);
+}
+
+/**
+ * fu_hwids_setup_with_cache:
+ * @self: A #FuHwids
+ * @smbios: A #FuSmbios
+ * @filename: A cache filename, which does not have to exist
+ * @error: A #GError or %NULL
+ *
+ * Reads all the SMBIOS values from the hardware, using a snapshot saved by a
+ * previous process if neither the DMI table nor the daemon version has changed
+ * since it was written.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.4.2
+ **/
+gboolean
+fu_hwids_setup_with_cache (FuHwids *self,
+			   FuSmbios *smbios,
+			   const gchar *filename,
+			   GError **error)
+{
+	const gchar *checksum;
+	g_autoptr(GError) error_local = NULL;
+
+	g_return_val_if_fail (FU_IS_HWIDS (self), FALSE);
+	g_return_val_if_fail (FU_IS_SMBIOS (smbios), FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+
+	/* no DMI table, so nothing to key the cache on */
+	checksum = fu_smbios_get_checksum (smbios);
+	if (checksum == NULL)
+		return fu_hwids_setup (self, smbios, error);
+	if (fu_hwids_load_cache (self, filename, checksum))
+		return TRUE;
+
+	if (!fu_hwids_setup (self, smbios, error))
+		return FALSE;
+
+	/* not fatal, e.g. fwupdtool running as a user */
+	if (!fu_hwids_save_cache (self, filename, checksum, &error_local))
+		g_debug ("failed to save hwids cache: %s", error_local->message);
+	return TRUE;
+}
+
 static void
 fu_hwids_finalize (GObject *object)
 {
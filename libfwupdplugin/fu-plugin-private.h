@@ -6,12 +6,15 @@
 
 #pragma once
 
+#include "fu-device-cache.h"
 #include "fu-quirks.h"
 #include "fu-plugin.h"
 #include "fu-smbios.h"
 
 FuPlugin	*fu_plugin_new				(void);
 gboolean	 fu_plugin_is_open			(FuPlugin	*self);
+gboolean	 fu_plugin_has_vfunc			(FuPlugin	*self,
+							 const gchar	*vfunc);
 void		 fu_plugin_set_usb_context		(FuPlugin	*self,
 							 GUsbContext	*usb_ctx);
 void		 fu_plugin_set_hwids			(FuPlugin	*self,
@@ -20,6 +23,8 @@ void		 fu_plugin_set_udev_subsystems		(FuPlugin	*self,
 							 GPtrArray	*udev_subsystems);
 void		 fu_plugin_set_quirks			(FuPlugin	*self,
 							 FuQuirks	*quirks);
+void		 fu_plugin_set_device_cache		(FuPlugin	*self,
+							 FuDeviceCache	*device_cache);
 void		 fu_plugin_set_runtime_versions		(FuPlugin	*self,
 							 GHashTable	*runtime_versions);
 void		 fu_plugin_set_compile_versions		(FuPlugin	*self,
@@ -41,6 +46,11 @@ gboolean	 fu_plugin_has_rule			(FuPlugin	*self,
 							 FuPluginRule	 rule,
 							 const gchar	*name);
 GHashTable	*fu_plugin_get_report_metadata		(FuPlugin	*self);
+GPtrArray	*fu_plugin_get_stats_names		(FuPlugin	*self);
+guint64		 fu_plugin_get_stats_count		(FuPlugin	*self,
+							 const gchar	*vfunc);
+gchar		*fu_plugin_stats_to_string		(FuPlugin	*self);
+GVariant	*fu_plugin_stats_to_variant		(FuPlugin	*self);
 gboolean	 fu_plugin_open				(FuPlugin	*self,
 							 const gchar	*filename,
 							 GError		**error);
@@ -31,6 +31,7 @@
  */
 
 #define	FU_PLUGIN_COLDPLUG_DELAY_MAXIMUM	3000u	/* ms */
+#define	FU_PLUGIN_STATS_BUCKETS			24	/* log2(us), last is overflow */
 
 static void fu_plugin_finalize			 (GObject *object);
 
@@ -45,6 +46,7 @@ typedef struct {
 	gchar			*build_hash;
 	FuHwids			*hwids;
 	FuQuirks		*quirks;
+	FuDeviceCache		*device_cache;
 	GHashTable		*runtime_versions;
 	GHashTable		*compile_versions;
 	GPtrArray		*udev_subsystems;
@@ -54,8 +56,18 @@ typedef struct {
 	GRWLock			 devices_mutex;
 	GHashTable		*report_metadata;	/* key:value */
 	FuPluginData		*data;
+	GHashTable		*stats;		/* vfunc:FuPluginStats */
+	GMutex			 stats_mutex;
 } FuPluginPrivate;
 
+typedef struct {
+	guint64			 count;
+	guint64			 failures;
+	guint64			 total;		/* us */
+	guint64			 max;		/* us */
+	guint64			 buckets[FU_PLUGIN_STATS_BUCKETS];
+} FuPluginStats;
+
 enum {
 	SIGNAL_DEVICE_ADDED,
 	SIGNAL_DEVICE_REMOVED,
@@ -122,6 +134,33 @@ fu_plugin_is_open (FuPlugin *self)
 	return priv->module != NULL;
 }
 
+/**
+ * fu_plugin_has_vfunc:
+ * @self: A #FuPlugin
+ * @vfunc: the vfunc name, e.g. `udev_device_changed`
+ *
+ * Determines if the plugin module implements a specific vfunc.
+ *
+ * Returns: TRUE if the symbol exists
+ *
+ * Since: 1.4.2
+ **/
+gboolean
+fu_plugin_has_vfunc (FuPlugin *self, const gchar *vfunc)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (self);
+	gpointer func = NULL;
+	g_autofree gchar *symbol_name = NULL;
+
+	g_return_val_if_fail (FU_IS_PLUGIN (self), FALSE);
+	g_return_val_if_fail (vfunc != NULL, FALSE);
+
+	if (priv->module == NULL)
+		return FALSE;
+	symbol_name = g_strdup_printf ("fu_plugin_%s", vfunc);
+	return g_module_symbol (priv->module, symbol_name, &func) && func != NULL;
+}
+
 /**
  * fu_plugin_get_name:
  * @self: A #FuPlugin
@@ -794,6 +833,22 @@ fu_plugin_set_quirks (FuPlugin *self, FuQuirks *quirks)
 	g_set_object (&priv->quirks, quirks);
 }
 
+/**
+ * fu_plugin_set_device_cache:
+ * @self: A #FuPlugin
+ * @device_cache: A #FuDeviceCache, or %NULL
+ *
+ * Sets the enumeration cache used when adding devices with a cache token.
+ *
+ * Since: 1.4.2
+ **/
+void
+fu_plugin_set_device_cache (FuPlugin *self, FuDeviceCache *device_cache)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (self);
+	g_set_object (&priv->device_cache, device_cache);
+}
+
 /**
  * fu_plugin_get_quirks:
  * @self: A #FuPlugin
@@ -1066,6 +1121,184 @@ fu_plugin_device_read_firmware (FuPlugin *self, FuDevice *device, GError **error
 	return fu_device_attach (device, error);
 }
 
+static guint
+fu_plugin_stats_bucket_for_duration (guint64 duration)
+{
+	guint idx = 0;
+	while (duration > 1 && idx < FU_PLUGIN_STATS_BUCKETS - 1) {
+		duration >>= 1;
+		idx++;
+	}
+	return idx;
+}
+
+static void
+fu_plugin_stats_add (FuPlugin *self, const gchar *vfunc, gint64 begin, gboolean success)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (self);
+	FuPluginStats *stats;
+	guint64 duration = (guint64) MAX (g_get_monotonic_time () - begin, 0);
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&priv->stats_mutex);
+
+	stats = g_hash_table_lookup (priv->stats, vfunc);
+	if (stats == NULL) {
+		stats = g_new0 (FuPluginStats, 1);
+		g_hash_table_insert (priv->stats, g_strdup (vfunc), stats);
+	}
+	stats->count++;
+	if (!success)
+		stats->failures++;
+	stats->total += duration;
+	stats->max = MAX (stats->max, duration);
+	stats->buckets[fu_plugin_stats_bucket_for_duration (duration)]++;
+}
+
+/* returns the upper bound of the bucket containing the percentile */
+static guint64
+fu_plugin_stats_get_percentile (FuPluginStats *stats, guint percentile)
+{
+	guint64 cnt = 0;
+	guint64 threshold = (stats->count * percentile + 99) / 100;
+	for (guint i = 0; i < FU_PLUGIN_STATS_BUCKETS - 1; i++) {
+		cnt += stats->buckets[i];
+		if (cnt >= threshold)
+			return MIN ((guint64) 1 << (i + 1), stats->max);
+	}
+	return stats->max;
+}
+
+/**
+ * fu_plugin_get_stats_names:
+ * @self: A #FuPlugin
+ *
+ * Gets the names of the plugin vfuncs that have been called.
+ *
+ * Returns: (transfer container) (element-type utf8): sorted vfunc names
+ *
+ * Since: 1.4.2
+ **/
+GPtrArray *
+fu_plugin_get_stats_names (FuPlugin *self)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (self);
+	GPtrArray *names = g_ptr_array_new_with_free_func (g_free);
+	g_autoptr(GList) keys = NULL;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&priv->stats_mutex);
+
+	keys = g_hash_table_get_keys (priv->stats);
+	keys = g_list_sort (keys, (GCompareFunc) g_strcmp0);
+	for (GList *l = keys; l != NULL; l = l->next)
+		g_ptr_array_add (names, g_strdup (l->data));
+	return names;
+}
+
+/**
+ * fu_plugin_get_stats_count:
+ * @self: A #FuPlugin
+ * @vfunc: A vfunc name, e.g. `coldplug`
+ *
+ * Gets the number of times a plugin vfunc has been called.
+ *
+ * Returns: integer, or 0 if never called
+ *
+ * Since: 1.4.2
+ **/
+guint64
+fu_plugin_get_stats_count (FuPlugin *self, const gchar *vfunc)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (self);
+	FuPluginStats *stats;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&priv->stats_mutex);
+
+	stats = g_hash_table_lookup (priv->stats, vfunc);
+	return stats != NULL ? stats->count : 0;
+}
+
+/**
+ * fu_plugin_stats_to_string:
+ * @self: A #FuPlugin
+ *
+ * Gets a human readable summary of the vfunc call counts and latencies. The
+ * percentiles are the upper bound of the power-of-two histogram bucket.
+ *
+ * Returns: (transfer full): a string, or %NULL if no vfuncs have been called
+ *
+ * Since: 1.4.2
+ **/
+gchar *
+fu_plugin_stats_to_string (FuPlugin *self)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (self);
+	GString *str = g_string_new (NULL);
+	g_autoptr(GPtrArray) names = fu_plugin_get_stats_names (self);
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&priv->stats_mutex);
+
+	for (guint i = 0; i < names->len; i++) {
+		const gchar *name = g_ptr_array_index (names, i);
+		FuPluginStats *stats = g_hash_table_lookup (priv->stats, name);
+		g_string_append_printf (str,
+					"  %-20s count:%" G_GUINT64_FORMAT
+					" failed:%" G_GUINT64_FORMAT
+					" mean:%.3fms p50:%.3fms p99:%.3fms max:%.3fms\n",
+					name,
+					stats->count,
+					stats->failures,
+					(gdouble) stats->total / (stats->count * 1000.f),
+					(gdouble) fu_plugin_stats_get_percentile (stats, 50) / 1000.f,
+					(gdouble) fu_plugin_stats_get_percentile (stats, 99) / 1000.f,
+					(gdouble) stats->max / 1000.f);
+	}
+	if (str->len == 0) {
+		g_string_free (str, TRUE);
+		return NULL;
+	}
+	return g_string_free (str, FALSE);
+}
+
+/**
+ * fu_plugin_stats_to_variant:
+ * @self: A #FuPlugin
+ *
+ * Serializes the vfunc call counts and latency histograms, keyed by the vfunc
+ * name. The `Buckets` array is indexed by log2 of the duration in microseconds.
+ *
+ * Returns: (transfer floating): a #GVariant of type `a{sv}`
+ *
+ * Since: 1.4.2
+ **/
+GVariant *
+fu_plugin_stats_to_variant (FuPlugin *self)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (self);
+	GVariantBuilder builder;
+	g_autoptr(GPtrArray) names = fu_plugin_get_stats_names (self);
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&priv->stats_mutex);
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+	for (guint i = 0; i < names->len; i++) {
+		const gchar *name = g_ptr_array_index (names, i);
+		FuPluginStats *stats = g_hash_table_lookup (priv->stats, name);
+		GVariantBuilder builder_stats;
+		g_variant_builder_init (&builder_stats, G_VARIANT_TYPE_VARDICT);
+		g_variant_builder_add (&builder_stats, "{sv}", "Count",
+				       g_variant_new_uint64 (stats->count));
+		g_variant_builder_add (&builder_stats, "{sv}", "Failures",
+				       g_variant_new_uint64 (stats->failures));
+		g_variant_builder_add (&builder_stats, "{sv}", "Total",
+				       g_variant_new_uint64 (stats->total));
+		g_variant_builder_add (&builder_stats, "{sv}", "Max",
+				       g_variant_new_uint64 (stats->max));
+		g_variant_builder_add (&builder_stats, "{sv}", "Buckets",
+				       g_variant_new_fixed_array (G_VARIANT_TYPE_UINT64,
+								  stats->buckets,
+								  FU_PLUGIN_STATS_BUCKETS,
+								  sizeof(guint64)));
+		g_variant_builder_add (&builder, "{sv}", name,
+				       g_variant_builder_end (&builder_stats));
+	}
+	return g_variant_builder_end (&builder);
+}
+
 /**
  * fu_plugin_runner_startup:
  * @self: a #FuPlugin
@@ -1081,6 +1314,8 @@ gboolean
 fu_plugin_runner_startup (FuPlugin *self, GError **error)
 {
 	FuPluginPrivate *priv = GET_PRIVATE (self);
+	gboolean ret;
+	gint64 begin;
 	FuPluginStartupFunc func = NULL;
 	g_autoptr(GError) error_local = NULL;
 
@@ -1097,7 +1332,10 @@ fu_plugin_runner_startup (FuPlugin *self, GError **error)
 	if (func == NULL)
 		return TRUE;
 	g_debug ("performing startup() on %s", priv->name);
-	if (!func (self, &error_local)) {
+	begin = g_get_monotonic_time ();
+	ret = func (self, &error_local);
+	fu_plugin_stats_add (self, "startup", begin, ret);
+	if (!ret) {
 		if (error_local == NULL) {
 			g_critical ("unset error in plugin %s for startup()",
 				    priv->name);
@@ -1121,6 +1359,8 @@ fu_plugin_runner_device_generic (FuPlugin *self, FuDevice *device,
 				 GError **error)
 {
 	FuPluginPrivate *priv = GET_PRIVATE (self);
+	gboolean ret;
+	gint64 begin;
 	FuPluginDeviceFunc func = NULL;
 	g_autoptr(GError) error_local = NULL;
 
@@ -1143,7 +1383,10 @@ fu_plugin_runner_device_generic (FuPlugin *self, FuDevice *device,
 		return TRUE;
 	}
 	g_debug ("performing %s() on %s", symbol_name + 10, priv->name);
-	if (!func (self, device, &error_local)) {
+	begin = g_get_monotonic_time ();
+	ret = func (self, device, &error_local);
+	fu_plugin_stats_add (self, symbol_name + 10, begin, ret);
+	if (!ret) {
 		if (error_local == NULL) {
 			g_critical ("unset error in plugin %s for %s()",
 				    priv->name, symbol_name + 10);
@@ -1166,6 +1409,8 @@ fu_plugin_runner_flagged_device_generic (FuPlugin *self, FwupdInstallFlags flags
 					 const gchar *symbol_name, GError **error)
 {
 	FuPluginPrivate *priv = GET_PRIVATE (self);
+	gboolean ret;
+	gint64 begin;
 	FuPluginFlaggedDeviceFunc func = NULL;
 	g_autoptr(GError) error_local = NULL;
 
@@ -1182,7 +1427,10 @@ fu_plugin_runner_flagged_device_generic (FuPlugin *self, FwupdInstallFlags flags
 	if (func == NULL)
 		return TRUE;
 	g_debug ("performing %s() on %s", symbol_name + 10, priv->name);
-	if (!func (self, flags, device, &error_local)) {
+	begin = g_get_monotonic_time ();
+	ret = func (self, flags, device, &error_local);
+	fu_plugin_stats_add (self, symbol_name + 10, begin, ret);
+	if (!ret) {
 		if (error_local == NULL) {
 			g_critical ("unset error in plugin %s for %s()",
 				    priv->name, symbol_name + 10);
@@ -1205,6 +1453,8 @@ fu_plugin_runner_device_array_generic (FuPlugin *self, GPtrArray *devices,
 				       const gchar *symbol_name, GError **error)
 {
 	FuPluginPrivate *priv = GET_PRIVATE (self);
+	gboolean ret;
+	gint64 begin;
 	FuPluginDeviceArrayFunc func = NULL;
 	g_autoptr(GError) error_local = NULL;
 
@@ -1221,7 +1471,10 @@ fu_plugin_runner_device_array_generic (FuPlugin *self, GPtrArray *devices,
 	if (func == NULL)
 		return TRUE;
 	g_debug ("performing %s() on %s", symbol_name + 10, priv->name);
-	if (!func (self, devices, &error_local)) {
+	begin = g_get_monotonic_time ();
+	ret = func (self, devices, &error_local);
+	fu_plugin_stats_add (self, symbol_name + 10, begin, ret);
+	if (!ret) {
 		if (error_local == NULL) {
 			g_critical ("unset error in plugin %s for %s()",
 				    priv->name, symbol_name + 10);
@@ -1253,6 +1506,8 @@ gboolean
 fu_plugin_runner_coldplug (FuPlugin *self, GError **error)
 {
 	FuPluginPrivate *priv = GET_PRIVATE (self);
+	gboolean ret;
+	gint64 begin;
 	FuPluginStartupFunc func = NULL;
 	g_autoptr(GError) error_local = NULL;
 
@@ -1269,7 +1524,10 @@ fu_plugin_runner_coldplug (FuPlugin *self, GError **error)
 	if (func == NULL)
 		return TRUE;
 	g_debug ("performing coldplug() on %s", priv->name);
-	if (!func (self, &error_local)) {
+	begin = g_get_monotonic_time ();
+	ret = func (self, &error_local);
+	fu_plugin_stats_add (self, "coldplug", begin, ret);
+	if (!ret) {
 		if (error_local == NULL) {
 			g_critical ("unset error in plugin %s for coldplug()",
 				    priv->name);
@@ -1300,6 +1558,8 @@ gboolean
 fu_plugin_runner_recoldplug (FuPlugin *self, GError **error)
 {
 	FuPluginPrivate *priv = GET_PRIVATE (self);
+	gboolean ret;
+	gint64 begin;
 	FuPluginStartupFunc func = NULL;
 	g_autoptr(GError) error_local = NULL;
 
@@ -1316,7 +1576,10 @@ fu_plugin_runner_recoldplug (FuPlugin *self, GError **error)
 	if (func == NULL)
 		return TRUE;
 	g_debug ("performing recoldplug() on %s", priv->name);
-	if (!func (self, &error_local)) {
+	begin = g_get_monotonic_time ();
+	ret = func (self, &error_local);
+	fu_plugin_stats_add (self, "recoldplug", begin, ret);
+	if (!ret) {
 		if (error_local == NULL) {
 			g_critical ("unset error in plugin %s for recoldplug()",
 				    priv->name);
@@ -1348,6 +1611,8 @@ gboolean
 fu_plugin_runner_coldplug_prepare (FuPlugin *self, GError **error)
 {
 	FuPluginPrivate *priv = GET_PRIVATE (self);
+	gboolean ret;
+	gint64 begin;
 	FuPluginStartupFunc func = NULL;
 	g_autoptr(GError) error_local = NULL;
 
@@ -1364,7 +1629,10 @@ fu_plugin_runner_coldplug_prepare (FuPlugin *self, GError **error)
 	if (func == NULL)
 		return TRUE;
 	g_debug ("performing coldplug_prepare() on %s", priv->name);
-	if (!func (self, &error_local)) {
+	begin = g_get_monotonic_time ();
+	ret = func (self, &error_local);
+	fu_plugin_stats_add (self, "coldplug_prepare", begin, ret);
+	if (!ret) {
 		if (error_local == NULL) {
 			g_critical ("unset error in plugin %s for coldplug_prepare()",
 				    priv->name);
@@ -1396,6 +1664,8 @@ gboolean
 fu_plugin_runner_coldplug_cleanup (FuPlugin *self, GError **error)
 {
 	FuPluginPrivate *priv = GET_PRIVATE (self);
+	gboolean ret;
+	gint64 begin;
 	FuPluginStartupFunc func = NULL;
 	g_autoptr(GError) error_local = NULL;
 
@@ -1412,7 +1682,10 @@ fu_plugin_runner_coldplug_cleanup (FuPlugin *self, GError **error)
 	if (func == NULL)
 		return TRUE;
 	g_debug ("performing coldplug_cleanup() on %s", priv->name);
-	if (!func (self, &error_local)) {
+	begin = g_get_monotonic_time ();
+	ret = func (self, &error_local);
+	fu_plugin_stats_add (self, "coldplug_cleanup", begin, ret);
+	if (!ret) {
 		if (error_local == NULL) {
 			g_critical ("unset error in plugin %s for coldplug_cleanup()",
 				    priv->name);
@@ -1655,11 +1928,34 @@ fu_plugin_check_supported_device (FuPlugin *self, FuDevice *device)
 	return FALSE;
 }
 
+/* devices are only restored if they set a cache token in ->probe() */
+static gboolean
+fu_plugin_device_cache_restore (FuPlugin *self,
+				FuDevice *device,
+				gboolean *restored,
+				GError **error)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (self);
+
+	*restored = FALSE;
+	if (priv->device_cache == NULL)
+		return TRUE;
+	if (!fu_device_probe (device, error))
+		return FALSE;
+	if (!fu_device_cache_restore (priv->device_cache, device))
+		return TRUE;
+	g_debug ("restored %s from the enumeration cache",
+		 fu_device_get_physical_id (device));
+	*restored = TRUE;
+	return TRUE;
+}
+
 static gboolean
 fu_plugin_usb_device_added (FuPlugin *self, FuUsbDevice *device, GError **error)
 {
 	FuPluginPrivate *priv = GET_PRIVATE (self);
 	GType device_gtype = fu_device_get_specialized_gtype (FU_DEVICE (device));
+	gboolean restored = FALSE;
 	g_autoptr(FuDevice) dev = NULL;
 	g_autoptr(FuDeviceLocker) locker = NULL;
 
@@ -1686,10 +1982,20 @@ fu_plugin_usb_device_added (FuPlugin *self, FuUsbDevice *device, GError **error)
 		}
 	}
 
+	/* restore without opening the device, which is set up when required */
+	if (!fu_plugin_device_cache_restore (self, dev, &restored, error))
+		return FALSE;
+	if (restored) {
+		fu_plugin_device_add (self, dev);
+		return TRUE;
+	}
+
 	/* open and add */
 	locker = fu_device_locker_new (dev, error);
 	if (locker == NULL)
 		return FALSE;
+	if (priv->device_cache != NULL)
+		fu_device_cache_add (priv->device_cache, dev);
 	fu_plugin_device_add (self, dev);
 	return TRUE;
 }
@@ -1711,6 +2017,7 @@ fu_plugin_udev_device_added (FuPlugin *self, FuUdevDevice *device, GError **erro
 {
 	FuPluginPrivate *priv = GET_PRIVATE (self);
 	GType device_gtype = fu_device_get_specialized_gtype (FU_DEVICE (device));
+	gboolean restored = FALSE;
 	g_autoptr(FuDevice) dev = NULL;
 	g_autoptr(FuDeviceLocker) locker = NULL;
 
@@ -1737,11 +2044,21 @@ fu_plugin_udev_device_added (FuPlugin *self, FuUdevDevice *device, GError **erro
 		}
 	}
 
+	/* restore without opening the device, which is set up when required */
+	if (!fu_plugin_device_cache_restore (self, dev, &restored, error))
+		return FALSE;
+	if (restored) {
+		fu_plugin_device_add (self, dev);
+		return TRUE;
+	}
+
 	/* open and add */
 	locker = fu_device_locker_new (dev, error);
 	if (locker == NULL)
 		return FALSE;
-	fu_plugin_device_add (self, FU_DEVICE (dev));
+	if (priv->device_cache != NULL)
+		fu_device_cache_add (priv->device_cache, dev);
+	fu_plugin_device_add (self, dev);
 	return TRUE;
 }
 
@@ -1761,6 +2078,8 @@ gboolean
 fu_plugin_runner_usb_device_added (FuPlugin *self, FuUsbDevice *device, GError **error)
 {
 	FuPluginPrivate *priv = GET_PRIVATE (self);
+	gboolean ret;
+	gint64 begin;
 	FuPluginUsbDeviceAddedFunc func = NULL;
 	g_autoptr(GError) error_local = NULL;
 
@@ -1783,7 +2102,10 @@ fu_plugin_runner_usb_device_added (FuPlugin *self, FuUsbDevice *device, GError *
 		return TRUE;
 	}
 	g_debug ("performing usb_device_added() on %s", priv->name);
-	if (!func (self, device, &error_local)) {
+	begin = g_get_monotonic_time ();
+	ret = func (self, device, &error_local);
+	fu_plugin_stats_add (self, "usb_device_added", begin, ret);
+	if (!ret) {
 		if (error_local == NULL) {
 			g_critical ("unset error in plugin %s for usb_device_added()",
 				    priv->name);
@@ -1816,6 +2138,8 @@ gboolean
 fu_plugin_runner_udev_device_added (FuPlugin *self, FuUdevDevice *device, GError **error)
 {
 	FuPluginPrivate *priv = GET_PRIVATE (self);
+	gboolean ret;
+	gint64 begin;
 	FuPluginUdevDeviceAddedFunc func = NULL;
 	g_autoptr(GError) error_local = NULL;
 
@@ -1838,7 +2162,10 @@ fu_plugin_runner_udev_device_added (FuPlugin *self, FuUdevDevice *device, GError
 		return TRUE;
 	}
 	g_debug ("performing udev_device_added() on %s", priv->name);
-	if (!func (self, device, &error_local)) {
+	begin = g_get_monotonic_time ();
+	ret = func (self, device, &error_local);
+	fu_plugin_stats_add (self, "udev_device_added", begin, ret);
+	if (!ret) {
 		if (error_local == NULL) {
 			g_critical ("unset error in plugin %s for udev_device_added()",
 				    priv->name);
@@ -1871,6 +2198,8 @@ gboolean
 fu_plugin_runner_udev_device_changed (FuPlugin *self, FuUdevDevice *device, GError **error)
 {
 	FuPluginPrivate *priv = GET_PRIVATE (self);
+	gboolean ret;
+	gint64 begin;
 	FuPluginUdevDeviceAddedFunc func = NULL;
 	g_autoptr(GError) error_local = NULL;
 
@@ -1893,7 +2222,10 @@ fu_plugin_runner_udev_device_changed (FuPlugin *self, FuUdevDevice *device, GErr
 		return TRUE;
 	}
 	g_debug ("performing udev_device_changed() on %s", priv->name);
-	if (!func (self, device, &error_local)) {
+	begin = g_get_monotonic_time ();
+	ret = func (self, device, &error_local);
+	fu_plugin_stats_add (self, "udev_device_changed", begin, ret);
+	if (!ret) {
 		if (error_local == NULL) {
 			g_critical ("unset error in plugin %s for udev_device_changed()",
 				    priv->name);
@@ -1959,8 +2291,10 @@ fu_plugin_runner_device_register (FuPlugin *self, FuDevice *device)
 	/* optional */
 	g_module_symbol (priv->module, "fu_plugin_device_registered", (gpointer *) &func);
 	if (func != NULL) {
+		gint64 begin = g_get_monotonic_time ();
 		g_debug ("performing fu_plugin_device_registered() on %s", priv->name);
 		func (self, device);
+		fu_plugin_stats_add (self, "device_registered", begin, TRUE);
 	}
 }
 
@@ -1980,6 +2314,8 @@ gboolean
 fu_plugin_runner_device_created (FuPlugin *self, FuDevice *device, GError **error)
 {
 	FuPluginPrivate *priv = GET_PRIVATE (self);
+	gboolean ret;
+	gint64 begin;
 	FuPluginDeviceFunc func = NULL;
 
 	/* not enabled */
@@ -1993,7 +2329,10 @@ fu_plugin_runner_device_created (FuPlugin *self, FuDevice *device, GError **erro
 	if (func == NULL)
 		return TRUE;
 	g_debug ("performing fu_plugin_device_created() on %s", priv->name);
-	return func (self, device, error);
+	begin = g_get_monotonic_time ();
+	ret = func (self, device, error);
+	fu_plugin_stats_add (self, "device_created", begin, ret);
+	return ret;
 }
 
 /**
@@ -2016,6 +2355,8 @@ fu_plugin_runner_verify (FuPlugin *self,
 			 GError **error)
 {
 	FuPluginPrivate *priv = GET_PRIVATE (self);
+	gboolean ret;
+	gint64 begin;
 	FuPluginVerifyFunc func = NULL;
 	GPtrArray *checksums;
 	g_autoptr(GError) error_local = NULL;
@@ -2047,7 +2388,10 @@ fu_plugin_runner_verify (FuPlugin *self,
 
 	/* run vfunc */
 	g_debug ("performing verify() on %s", priv->name);
-	if (!func (self, device, flags, &error_local)) {
+	begin = g_get_monotonic_time ();
+	ret = func (self, device, flags, &error_local);
+	fu_plugin_stats_add (self, "verify", begin, ret);
+	if (!ret) {
 		g_autoptr(GError) error_attach = NULL;
 		if (error_local == NULL) {
 			g_critical ("unset error in plugin %s for verify()",
@@ -2187,6 +2531,8 @@ fu_plugin_runner_update (FuPlugin *self,
 			 GError **error)
 {
 	FuPluginPrivate *priv = GET_PRIVATE (self);
+	gboolean ret;
+	gint64 begin;
 	FuPluginUpdateFunc update_func;
 	g_autoptr(GError) error_local = NULL;
 
@@ -2210,7 +2556,10 @@ fu_plugin_runner_update (FuPlugin *self,
 	}
 
 	/* online */
-	if (!update_func (self, device, blob_fw, flags, &error_local)) {
+	begin = g_get_monotonic_time ();
+	ret = update_func (self, device, blob_fw, flags, &error_local);
+	fu_plugin_stats_add (self, "update", begin, ret);
+	if (!ret) {
 		if (error_local == NULL) {
 			g_critical ("unset error in plugin %s for update()",
 				    priv->name);
@@ -2252,6 +2601,8 @@ gboolean
 fu_plugin_runner_clear_results (FuPlugin *self, FuDevice *device, GError **error)
 {
 	FuPluginPrivate *priv = GET_PRIVATE (self);
+	gboolean ret;
+	gint64 begin;
 	FuPluginDeviceFunc func = NULL;
 	g_autoptr(GError) error_local = NULL;
 
@@ -2268,7 +2619,10 @@ fu_plugin_runner_clear_results (FuPlugin *self, FuDevice *device, GError **error
 	if (func == NULL)
 		return TRUE;
 	g_debug ("performing clear_result() on %s", priv->name);
-	if (!func (self, device, &error_local)) {
+	begin = g_get_monotonic_time ();
+	ret = func (self, device, &error_local);
+	fu_plugin_stats_add (self, "clear_results", begin, ret);
+	if (!ret) {
 		if (error_local == NULL) {
 			g_critical ("unset error in plugin %s for clear_result()",
 				    priv->name);
@@ -2301,6 +2655,8 @@ gboolean
 fu_plugin_runner_get_results (FuPlugin *self, FuDevice *device, GError **error)
 {
 	FuPluginPrivate *priv = GET_PRIVATE (self);
+	gboolean ret;
+	gint64 begin;
 	FuPluginDeviceFunc func = NULL;
 	g_autoptr(GError) error_local = NULL;
 
@@ -2317,7 +2673,10 @@ fu_plugin_runner_get_results (FuPlugin *self, FuDevice *device, GError **error)
 	if (func == NULL)
 		return TRUE;
 	g_debug ("performing get_results() on %s", priv->name);
-	if (!func (self, device, &error_local)) {
+	begin = g_get_monotonic_time ();
+	ret = func (self, device, &error_local);
+	fu_plugin_stats_add (self, "get_results", begin, ret);
+	if (!ret) {
 		if (error_local == NULL) {
 			g_critical ("unset error in plugin %s for get_results()",
 				    priv->name);
@@ -2421,6 +2780,13 @@ void
 fu_plugin_add_rule (FuPlugin *self, FuPluginRule rule, const gchar *name)
 {
 	FuPluginPrivate *priv = fu_plugin_get_instance_private (self);
+
+	/* already added, e.g. from the manifest before the module was opened */
+	for (guint i = 0; i < priv->rules[rule]->len; i++) {
+		const gchar *tmp = g_ptr_array_index (priv->rules[rule], i);
+		if (g_strcmp0 (tmp, name) == 0)
+			return;
+	}
 	g_ptr_array_add (priv->rules[rule], g_strdup (name));
 	g_signal_emit (self, signals[SIGNAL_RULES_CHANGED], 0);
 }
@@ -2664,6 +3030,8 @@ fu_plugin_init (FuPlugin *self)
 					       g_free, (GDestroyNotify) g_object_unref);
 	g_rw_lock_init (&priv->devices_mutex);
 	priv->report_metadata = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	priv->stats = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	g_mutex_init (&priv->stats_mutex);
 	for (guint i = 0; i < FU_PLUGIN_RULE_LAST; i++)
 		priv->rules[i] = g_ptr_array_new_with_free_func (g_free);
 }
@@ -2693,6 +3061,8 @@ fu_plugin_finalize (GObject *object)
 		g_object_unref (priv->hwids);
 	if (priv->quirks != NULL)
 		g_object_unref (priv->quirks);
+	if (priv->device_cache != NULL)
+		g_object_unref (priv->device_cache);
 	if (priv->udev_subsystems != NULL)
 		g_ptr_array_unref (priv->udev_subsystems);
 	if (priv->smbios != NULL)
@@ -2704,6 +3074,8 @@ fu_plugin_finalize (GObject *object)
 	g_hash_table_unref (priv->devices);
 	g_hash_table_unref (priv->report_metadata);
 	g_rw_lock_clear (&priv->devices_mutex);
+	g_hash_table_unref (priv->stats);
+	g_mutex_clear (&priv->stats_mutex);
 	g_free (priv->build_hash);
 	g_free (priv->name);
 	g_free (priv->data);
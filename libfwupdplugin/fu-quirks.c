@@ -48,6 +48,13 @@
 
 static void fu_quirks_finalize	 (GObject *obj);
 
+enum {
+	SIGNAL_CHANGED,
+	SIGNAL_LAST
+};
+
+static guint signals[SIGNAL_LAST] = { 0 };
+
 struct _FuQuirks
 {
 	GObject			 parent_instance;
@@ -209,9 +216,10 @@ fu_quirks_check_silo (FuQuirks *self, GError **error)
 	g_autofree gchar *xmlbfn = NULL;
 	g_autoptr(GFile) file = NULL;
 	g_autoptr(XbBuilder) builder = NULL;
+	g_autoptr(XbSilo) silo_old = NULL;
 
 	/* everything is okay */
-	if (self->silo != NULL && xb_silo_is_valid (self->silo))
+	if (fu_quirks_is_valid (self))
 		return TRUE;
 
 	/* system datadir */
@@ -236,8 +244,33 @@ fu_quirks_check_silo (FuQuirks *self, GError **error)
 	}
 	if (self->load_flags & FU_QUIRKS_LOAD_FLAG_READONLY_FS)
 		compile_flags |= XB_BUILDER_COMPILE_FLAG_IGNORE_GUID;
+	silo_old = g_steal_pointer (&self->silo);
 	self->silo = xb_builder_ensure (builder, file, compile_flags, NULL, error);
-	return self->silo != NULL;
+	if (self->silo == NULL)
+		return FALSE;
+
+	/* a quirk file was changed since the last load */
+	if (silo_old != NULL)
+		g_signal_emit (self, signals[SIGNAL_CHANGED], 0);
+	return TRUE;
+}
+
+/**
+ * fu_quirks_is_valid:
+ * @self: A #FuQuirks
+ *
+ * Gets if the loaded quirks are still current. If a quirk file has changed
+ * then the quirks are loaded again when next used, and ::changed is emitted.
+ *
+ * Returns: %TRUE if no quirk file has changed since the quirks were loaded
+ *
+ * Since: 1.4.2
+ **/
+gboolean
+fu_quirks_is_valid (FuQuirks *self)
+{
+	g_return_val_if_fail (FU_IS_QUIRKS (self), FALSE);
+	return self->silo != NULL && xb_silo_is_valid (self->silo);
 }
 
 /**
@@ -373,6 +406,75 @@ fu_quirks_lookup_by_id_iter (FuQuirks *self, const gchar *group,
 	return TRUE;
 }
 
+/**
+ * fu_quirks_lookup_by_key_iter:
+ * @self: A #FuQuirks
+ * @key: string of the key to lookup, e.g. `Plugin`
+ * @iter_cb: (scope async): A #FuQuirksIter
+ * @user_data: user data passed to @iter_cb
+ *
+ * Looks up all the groups in the hardware database that set a specific key.
+ * The group GUID is passed to @iter_cb rather than the key name.
+ *
+ * Returns: %TRUE if the key was found, and @iter was called
+ *
+ * Since: 1.4.2
+ **/
+gboolean
+fu_quirks_lookup_by_key_iter (FuQuirks *self, const gchar *key,
+			      FuQuirksIter iter_cb, gpointer user_data)
+{
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) results = NULL;
+	g_autoptr(XbQuery) query = NULL;
+
+	g_return_val_if_fail (FU_IS_QUIRKS (self), FALSE);
+	g_return_val_if_fail (key != NULL, FALSE);
+	g_return_val_if_fail (iter_cb != NULL, FALSE);
+
+	/* ensure up to date */
+	if (!fu_quirks_check_silo (self, &error)) {
+		g_warning ("failed to build silo: %s", error->message);
+		return FALSE;
+	}
+
+	/* query */
+	query = xb_query_new_full (self->silo,
+				   "quirk/device/value[@key=?]",
+				   XB_QUERY_FLAG_NONE,
+				   &error);
+	if (query == NULL) {
+		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
+			return FALSE;
+		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT))
+			return FALSE;
+		g_warning ("failed to build query: %s", error->message);
+		return FALSE;
+	}
+	if (!xb_query_bind_str (query, 0, key, &error)) {
+		g_warning ("failed to bind 0: %s", error->message);
+		return FALSE;
+	}
+	results = xb_silo_query_full (self->silo, query, &error);
+	if (results == NULL) {
+		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
+			return FALSE;
+		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT))
+			return FALSE;
+		g_warning ("failed to query: %s", error->message);
+		return FALSE;
+	}
+	for (guint i = 0; i < results->len; i++) {
+		XbNode *n = g_ptr_array_index (results, i);
+		g_autoptr(XbNode) parent = xb_node_get_parent (n);
+		iter_cb (self,
+			 xb_node_get_attr (parent, "id"),
+			 xb_node_get_text (n),
+			 user_data);
+	}
+	return TRUE;
+}
+
 /**
  * fu_quirks_load: (skip)
  * @self: A #FuQuirks
@@ -398,6 +500,11 @@ fu_quirks_class_init (FuQuirksClass *klass)
 {
 	GObjectClass *object_class = G_OBJECT_CLASS (klass);
 	object_class->finalize = fu_quirks_finalize;
+	signals[SIGNAL_CHANGED] =
+		g_signal_new ("changed",
+			      G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
+			      0, NULL, NULL, g_cclosure_marshal_VOID__VOID,
+			      G_TYPE_NONE, 0);
 }
 
 static void
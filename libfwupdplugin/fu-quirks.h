@@ -42,6 +42,11 @@ gboolean	 fu_quirks_lookup_by_id_iter		(FuQuirks	*self,
 							 const gchar	*group,
 							 FuQuirksIter	 iter_cb,
 							 gpointer	 user_data);
+gboolean	 fu_quirks_lookup_by_key_iter		(FuQuirks	*self,
+							 const gchar	*key,
+							 FuQuirksIter	 iter_cb,
+							 gpointer	 user_data);
+gboolean	 fu_quirks_is_valid			(FuQuirks	*self);
 
 #define	FU_QUIRKS_PLUGIN			"Plugin"
 #define	FU_QUIRKS_FLAGS				"Flags"
@@ -12,7 +12,9 @@
 #include <libgcab.h>
 #include <glib/gstdio.h>
 
+#include "fu-device-cache.h"
 #include "fu-device-private.h"
+#include "fu-hwids-private.h"
 #include "fu-plugin-private.h"
 #include "fu-smbios-private.h"
 
@@ -331,6 +333,62 @@ fu_hwids_func (void)
 		g_assert (fu_hwids_has_guid (hwids, guids[i].value));
 }
 
+static void
+fu_hwids_cache_func (void)
+{
+	gboolean ret;
+	GPtrArray *guids;
+	g_autofree gchar *filename = NULL;
+	g_autoptr(FuHwids) hwids1 = fu_hwids_new ();
+	g_autoptr(FuHwids) hwids2 = fu_hwids_new ();
+	g_autoptr(FuHwids) hwids3 = fu_hwids_new ();
+	g_autoptr(FuSmbios) smbios = fu_smbios_new ();
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GVariant) data = NULL;
+
+	ret = fu_smbios_setup (smbios, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_nonnull (fu_smbios_get_checksum (smbios));
+
+	/* computed, then written */
+	filename = g_build_filename (g_get_tmp_dir (), "fwupd-self-test-hwids.cache", NULL);
+	g_unlink (filename);
+	ret = fu_hwids_setup_with_cache (hwids1, smbios, filename, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert (g_file_test (filename, G_FILE_TEST_EXISTS));
+
+	/* read back from the snapshot */
+	ret = fu_hwids_setup_with_cache (hwids2, smbios, filename, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpstr (fu_hwids_get_value (hwids2, FU_HWIDS_KEY_PRODUCT_SKU), ==,
+			 "LENOVO_MT_20AR_BU_Think_FM_ThinkPad T440s");
+	g_assert_cmpstr (fu_hwids_get_value (hwids2, FU_HWIDS_KEY_BIOS_MAJOR_RELEASE), ==, "02");
+	guids = fu_hwids_get_guids (hwids1);
+	g_assert_cmpint (fu_hwids_get_guids (hwids2)->len, ==, guids->len);
+	for (guint i = 0; i < guids->len; i++)
+		g_assert (fu_hwids_has_guid (hwids2, g_ptr_array_index (guids, i)));
+	g_assert (fu_hwids_has_guid (hwids2, "147efce9-f201-5fc8-ab0c-c859751c3440"));
+
+	/* written by a different daemon version, so ignored */
+	data = g_variant_ref_sink (g_variant_new ("(ssa{ss}a{ss}as)",
+						  "0.0.1",
+						  fu_smbios_get_checksum (smbios),
+						  NULL, NULL, NULL));
+	blob = g_variant_get_data_as_bytes (data);
+	ret = fu_common_set_contents_bytes (filename, blob, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	ret = fu_hwids_setup_with_cache (hwids3, smbios, filename, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpint (fu_hwids_get_guids (hwids3)->len, ==, guids->len);
+	g_unlink (filename);
+}
+
 static void
 _plugin_device_added_cb (FuPlugin *plugin, FuDevice *device, gpointer user_data)
 {
@@ -369,18 +427,34 @@ fu_plugin_delay_func (void)
 	g_clear_object (&device_tmp);
 }
 
+static void
+fu_plugin_quirks_by_key_cb (FuQuirks *quirks,
+			    const gchar *guid,
+			    const gchar *value,
+			    gpointer user_data)
+{
+	GPtrArray *values = (GPtrArray *) user_data;
+	g_ptr_array_add (values, g_strdup_printf ("%s=%s", guid, value));
+}
+
 static void
 fu_plugin_quirks_func (void)
 {
 	const gchar *tmp;
+	gboolean found = FALSE;
 	gboolean ret;
+	g_autofree gchar *guid = NULL;
+	g_autofree gchar *route = NULL;
 	g_autoptr(FuQuirks) quirks = fu_quirks_new ();
 	g_autoptr(FuPlugin) plugin = fu_plugin_new ();
 	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) routes = g_ptr_array_new_with_free_func (g_free);
 
+	g_assert_false (fu_quirks_is_valid (quirks));
 	ret = fu_quirks_load (quirks, FU_QUIRKS_LOAD_FLAG_NONE, &error);
 	g_assert_no_error (error);
 	g_assert (ret);
+	g_assert_true (fu_quirks_is_valid (quirks));
 	fu_plugin_set_quirks (plugin, quirks);
 
 	/* exact */
@@ -398,6 +472,22 @@ fu_plugin_quirks_func (void)
 	g_assert_cmpstr (tmp, ==, NULL);
 	tmp = fu_plugin_lookup_quirk_by_id (plugin, "bb9ec3e2-77b3-53bc-a1f1-b05916715627", "Flags");
 	g_assert_cmpstr (tmp, ==, "clever");
+
+	/* by key */
+	ret = fu_quirks_lookup_by_key_iter (quirks, FU_QUIRKS_PLUGIN,
+					    fu_plugin_quirks_by_key_cb, routes);
+	g_assert (ret);
+	g_assert_cmpint (routes->len, ==, 2);
+	guid = fwupd_guid_hash_string ("USB\\VID_FFFF&PID_FFFF");
+	route = g_strdup_printf ("%s=test", guid);
+	for (guint i = 0; i < routes->len; i++) {
+		if (g_strcmp0 (g_ptr_array_index (routes, i), route) == 0)
+			found = TRUE;
+	}
+	g_assert_true (found);
+	ret = fu_quirks_lookup_by_key_iter (quirks, "Unfound",
+					    fu_plugin_quirks_by_key_cb, routes);
+	g_assert (!ret);
 }
 
 static void
@@ -1001,6 +1091,26 @@ fu_device_flags_func (void)
 	g_assert_cmpint (fu_device_get_flags (device), ==, FWUPD_DEVICE_FLAG_UPDATABLE);
 }
 
+static void
+fu_device_rescan_func (void)
+{
+	gboolean ret;
+	g_autoptr(FuDevice) device = fu_device_new ();
+	g_autoptr(GError) error = NULL;
+
+	/* the GUID index is rebuilt when the GUIDs are cleared */
+	fu_device_add_guid (device, "2082b5e0-7a64-478a-b1b2-e3404fab6dad");
+	g_assert_true (fu_device_has_guid (device, "2082b5e0-7a64-478a-b1b2-e3404fab6dad"));
+	ret = fu_device_rescan (device, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_cmpint (fu_device_get_guids (device)->len, ==, 0);
+	g_assert_false (fu_device_has_guid (device, "2082b5e0-7a64-478a-b1b2-e3404fab6dad"));
+	fu_device_add_guid (device, "2082b5e0-7a64-478a-b1b2-e3404fab6dad");
+	fu_device_add_guid (device, "2082b5e0-7a64-478a-b1b2-e3404fab6dad");
+	g_assert_cmpint (fu_device_get_guids (device)->len, ==, 1);
+}
+
 static void
 fu_device_parent_func (void)
 {
@@ -1064,6 +1174,54 @@ fu_device_incorporate_func (void)
 	g_assert_cmpint (fu_device_get_icons(device)->len, ==, 1);
 }
 
+#ifdef HAVE_PWRITE
+static void
+fu_udev_device_port_func (void)
+{
+	gboolean ret;
+	gint fd;
+	guint8 buf[3] = { 0x0 };
+	guint8 tmp = 0x0;
+	g_autofree gchar *fn = NULL;
+	g_autoptr(FuUdevDevice) udev_device = fu_udev_device_new (NULL);
+	g_autoptr(GError) error = NULL;
+	FuUdevDevicePortOp ops[] = {
+		{ FU_UDEV_DEVICE_PORT_OP_WRITE,		0x2,	0x05,	NULL },
+		{ FU_UDEV_DEVICE_PORT_OP_WAIT_SET,	0x2,	0x04,	NULL },
+		{ FU_UDEV_DEVICE_PORT_OP_WAIT_CLEAR,	0x2,	0x02,	NULL },
+		{ FU_UDEV_DEVICE_PORT_OP_READ,		0x2,	0x00,	&tmp },
+	};
+
+	/* a regular file behaves like a port that always returns the last write */
+	fd = g_file_open_tmp ("fwupd-port-XXXXXX", &fn, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (fd, >, 0);
+	fu_udev_device_set_fd (udev_device, fd);
+	ret = fu_udev_device_pwrite (udev_device, 0x4, 0x00, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	/* run a command sequence */
+	ret = fu_udev_device_port_sequence (udev_device, ops, G_N_ELEMENTS (ops), 10, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpint (tmp, ==, 0x05);
+
+	/* drain the same port several times */
+	ret = fu_udev_device_pread_full (udev_device, 0x2, buf, sizeof(buf), &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpint (buf[0], ==, 0x05);
+	g_assert_cmpint (buf[2], ==, 0x05);
+
+	/* bit never gets set */
+	ret = fu_udev_device_pwait (udev_device, 0x2, 0x02, TRUE, 1, &error);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT);
+	g_assert (!ret);
+	g_unlink (fn);
+}
+#endif
+
 static void
 fu_chunk_func (void)
 {
@@ -1282,6 +1440,190 @@ fu_common_vercmp_func (void)
 	g_assert_cmpint (fu_common_vercmp (NULL, NULL), ==, G_MAXINT);
 }
 
+/* a selection of version strings used by firmware on the LVFS */
+static const gchar *version_corpus[] = {
+	"1.2.3", "1.2.4", "1.2.3.4", "1.2", "1.2.0", "0.1.27", "20190104",
+	"1.0.0.1", "3.0.2", "3.0.10", "1.1.3a", "2.5.0.1029", "4.33", "5.07",
+	"0.0.1", "65.0.0.1", "10.0.18362.1", "1.12.6", "2.0.16", "8.4.5",
+	"001.002.003", "0.3.0", "1.41.44.25", "10.4", "11.5.1", "1.2.3~rc1",
+	"alpha", "1.2b.3", "1.65535", "1.2.3.4.5", NULL };
+
+static void
+fu_common_version_key_func (void)
+{
+	/* check the key sorts the same as the string comparison */
+	for (guint i = 0; version_corpus[i] != NULL; i++) {
+		for (guint j = 0; version_corpus[j] != NULL; j++) {
+			guint64 key_a = fu_common_version_to_key (version_corpus[i],
+								  FWUPD_VERSION_FORMAT_UNKNOWN);
+			guint64 key_b = fu_common_version_to_key (version_corpus[j],
+								  FWUPD_VERSION_FORMAT_UNKNOWN);
+			gint rc = fu_common_vercmp (version_corpus[i], version_corpus[j]);
+			if (key_a == 0 || key_b == 0)
+				continue;
+			if (rc < 0)
+				g_assert_cmpint (key_a, <, key_b);
+			else if (rc > 0)
+				g_assert_cmpint (key_a, >, key_b);
+			else
+				g_assert_cmpint (key_a, ==, key_b);
+		}
+	}
+
+	/* not possible to represent */
+	g_assert_cmpint (fu_common_version_to_key (NULL, FWUPD_VERSION_FORMAT_TRIPLET), ==, 0);
+	g_assert_cmpint (fu_common_version_to_key ("1.2.3", FWUPD_VERSION_FORMAT_PLAIN), ==, 0);
+	g_assert_cmpint (fu_common_version_to_key ("1.2.3a", FWUPD_VERSION_FORMAT_TRIPLET), ==, 0);
+	g_assert_cmpint (fu_common_version_to_key ("1.2.3.4.5", FWUPD_VERSION_FORMAT_UNKNOWN), ==, 0);
+	g_assert_cmpint (fu_common_version_to_key ("1.65535", FWUPD_VERSION_FORMAT_PAIR), ==, 0);
+	g_assert_cmpint (fu_common_version_to_key ("1..2", FWUPD_VERSION_FORMAT_UNKNOWN), ==, 0);
+	g_assert_cmpint (fu_common_version_to_key ("1.2.", FWUPD_VERSION_FORMAT_UNKNOWN), ==, 0);
+	g_assert_cmpint (fu_common_version_to_key ("", FWUPD_VERSION_FORMAT_UNKNOWN), ==, 0);
+
+	/* missing sections sort lower */
+	g_assert_cmpint (fu_common_version_to_key ("1.2", FWUPD_VERSION_FORMAT_PAIR), <,
+			 fu_common_version_to_key ("1.2.0", FWUPD_VERSION_FORMAT_TRIPLET));
+}
+
+static void
+_device_notify_flags_cb (FuDevice *device, GParamSpec *pspec, gpointer user_data)
+{
+	guint *cnt = (guint *) user_data;
+	(*cnt)++;
+}
+
+static void
+_device_batch_changed_cb (FuDevice *device, gpointer user_data)
+{
+	guint *cnt = (guint *) user_data;
+	(*cnt)++;
+}
+
+static void
+fu_device_batch_func (void)
+{
+	guint cnt = 0;
+	guint changed_cnt = 0;
+	g_autoptr(FuDevice) device = fu_device_new ();
+
+	g_signal_connect (device, "notify::flags",
+			  G_CALLBACK (_device_notify_flags_cb), &cnt);
+	g_signal_connect (device, "batch-changed",
+			  G_CALLBACK (_device_batch_changed_cb), &changed_cnt);
+
+	/* several flags, one notification */
+	fu_device_batch_begin (device);
+	fu_device_add_flag (device, FWUPD_DEVICE_FLAG_UPDATABLE);
+	fu_device_add_flag (device, FWUPD_DEVICE_FLAG_REQUIRE_AC);
+	fu_device_add_flag (device, FWUPD_DEVICE_FLAG_SUPPORTED);
+	g_assert_cmpint (cnt, ==, 0);
+	g_assert_true (fu_device_batch_commit (device));
+	g_assert_cmpint (cnt, ==, 1);
+	g_assert_cmpint (changed_cnt, ==, 1);
+
+	/* nothing changed */
+	fu_device_batch_begin (device);
+	g_assert_false (fu_device_batch_commit (device));
+	g_assert_cmpint (changed_cnt, ==, 1);
+
+	/* only the outermost commit reports the change */
+	g_assert_false (fu_device_batch_defer_changed (device));
+	fu_device_batch_begin (device);
+	fu_device_batch_begin (device);
+	g_assert_true (fu_device_batch_defer_changed (device));
+	g_assert_false (fu_device_batch_commit (device));
+	g_assert_cmpint (changed_cnt, ==, 1);
+	g_assert_true (fu_device_batch_commit (device));
+	g_assert_cmpint (cnt, ==, 1);
+	g_assert_cmpint (changed_cnt, ==, 2);
+}
+
+static void
+fu_device_cache_func (void)
+{
+	gboolean ret;
+	const gchar *guid = "2082b5e0-7a64-478a-b1b2-e3404fab6dad";
+	const gchar *physical_id = "PCI_SLOT_NAME=0000:3b:00.0";
+	g_autofree gchar *fn = NULL;
+	g_autoptr(FuDevice) device1 = fu_device_new ();
+	g_autoptr(FuDevice) device2 = fu_device_new ();
+	g_autoptr(FuDevice) device3 = fu_device_new ();
+	g_autoptr(FuDeviceCache) cache1 = fu_device_cache_new ();
+	g_autoptr(FuDeviceCache) cache2 = fu_device_cache_new ();
+	g_autoptr(FuDeviceCache) cache3 = fu_device_cache_new ();
+	g_autoptr(GError) error = NULL;
+
+	/* nothing saved yet */
+	fn = g_build_filename (g_get_tmp_dir (), "fwupd-self-test-devices.cache", NULL);
+	g_unlink (fn);
+	ret = fu_device_cache_load (cache1, fn, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpint (fu_device_cache_get_size (cache1), ==, 0);
+
+	/* save a device that has been set up */
+	fu_device_set_physical_id (device1, physical_id);
+	fu_device_set_cache_token (device1, "1.2.3");
+	fu_device_set_version_format (device1, FWUPD_VERSION_FORMAT_TRIPLET);
+	fu_device_set_version (device1, "1.2.3");
+	fu_device_add_guid (device1, guid);
+	fu_device_add_flag (device1, FWUPD_DEVICE_FLAG_UPDATABLE);
+	fu_device_add_flag (device1, FWUPD_DEVICE_FLAG_NEEDS_REBOOT);
+	fu_device_set_update_state (device1, FWUPD_UPDATE_STATE_FAILED);
+	fu_device_set_update_error (device1, "write failed");
+	fu_device_cache_add (cache1, device1);
+	ret = fu_device_cache_save (cache1, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	/* restore into a device that has only been probed */
+	ret = fu_device_cache_load (cache2, fn, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpint (fu_device_cache_get_size (cache2), ==, 1);
+	fu_device_set_physical_id (device2, physical_id);
+	fu_device_set_cache_token (device2, "1.2.3");
+	g_assert (fu_device_cache_restore (cache2, device2));
+	g_assert_cmpstr (fu_device_get_version (device2), ==, "1.2.3");
+	g_assert_cmpint (fu_device_get_version_key (device2), ==,
+			 fu_device_get_version_key (device1));
+	g_assert (fu_device_has_guid (device2, guid));
+	g_assert (fu_device_has_flag (device2, FWUPD_DEVICE_FLAG_UPDATABLE));
+
+	/* the result of a previous update is not restored */
+	g_assert (!fu_device_has_flag (device2, FWUPD_DEVICE_FLAG_NEEDS_REBOOT));
+	g_assert_cmpint (fu_device_get_update_state (device2), ==, FWUPD_UPDATE_STATE_UNKNOWN);
+	g_assert_cmpstr (fu_device_get_update_error (device2), ==, NULL);
+
+	/* the firmware was updated, so the device has to be set up again */
+	ret = fu_device_cache_load (cache3, fn, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	fu_device_set_physical_id (device3, physical_id);
+	fu_device_set_cache_token (device3, "1.2.4");
+	g_assert (!fu_device_cache_restore (cache3, device3));
+	g_assert_cmpstr (fu_device_get_version (device3), ==, NULL);
+	g_assert_cmpint (fu_device_cache_get_size (cache3), ==, 0);
+	g_unlink (fn);
+}
+
+static void
+fu_device_version_key_func (void)
+{
+	g_autoptr(FuDevice) device = fu_device_new ();
+
+	/* computed when the version is set */
+	g_assert_cmpint (fu_device_get_version_key (device), ==, 0);
+	fu_device_set_version_format (device, FWUPD_VERSION_FORMAT_TRIPLET);
+	fu_device_set_version (device, "1.2.3");
+	g_assert_cmpint (fu_device_get_version_key (device), ==,
+			 fu_common_version_to_key ("1.2.3", FWUPD_VERSION_FORMAT_TRIPLET));
+
+	/* and invalidated when the version format is changed */
+	fu_device_set_version_format (device, FWUPD_VERSION_FORMAT_PLAIN);
+	g_assert_cmpint (fu_device_get_version_key (device), ==, 0);
+}
+
 static void
 fu_firmware_ihex_func (void)
 {
@@ -1762,10 +2104,17 @@ main (int argc, char **argv)
 	g_test_add_func ("/fwupd/plugin{quirks-performance}", fu_plugin_quirks_performance_func);
 	g_test_add_func ("/fwupd/plugin{quirks-device}", fu_plugin_quirks_device_func);
 	g_test_add_func ("/fwupd/chunk", fu_chunk_func);
+#ifdef HAVE_PWRITE
+	g_test_add_func ("/fwupd/udev-device{port}", fu_udev_device_port_func);
+#endif
 	g_test_add_func ("/fwupd/common{string-append-kv}", fu_common_string_append_kv_func);
 	g_test_add_func ("/fwupd/common{version-guess-format}", fu_common_version_guess_format_func);
 	g_test_add_func ("/fwupd/common{version}", fu_common_version_func);
 	g_test_add_func ("/fwupd/common{vercmp}", fu_common_vercmp_func);
+	g_test_add_func ("/fwupd/common{version-key}", fu_common_version_key_func);
+	g_test_add_func ("/fwupd/device{version-key}", fu_device_version_key_func);
+	g_test_add_func ("/fwupd/device{batch}", fu_device_batch_func);
+	g_test_add_func ("/fwupd/device{cache}", fu_device_cache_func);
 	g_test_add_func ("/fwupd/common{strstrip}", fu_common_strstrip_func);
 	g_test_add_func ("/fwupd/common{endian}", fu_common_endian_func);
 	g_test_add_func ("/fwupd/common{cab-success}", fu_common_store_cab_func);
@@ -1782,6 +2131,7 @@ main (int argc, char **argv)
 	g_test_add_func ("/fwupd/common{kernel-lockdown}", fu_common_kernel_lockdown_func);
 	g_test_add_func ("/fwupd/efivar", fu_efivar_func);
 	g_test_add_func ("/fwupd/hwids", fu_hwids_func);
+	g_test_add_func ("/fwupd/hwids{cache}", fu_hwids_cache_func);
 	g_test_add_func ("/fwupd/smbios", fu_smbios_func);
 	g_test_add_func ("/fwupd/smbios3", fu_smbios3_func);
 	g_test_add_func ("/fwupd/firmware", fu_firmware_func);
@@ -1794,6 +2144,7 @@ main (int argc, char **argv)
 	g_test_add_func ("/fwupd/archive{invalid}", fu_archive_invalid_func);
 	g_test_add_func ("/fwupd/archive{cab}", fu_archive_cab_func);
 	g_test_add_func ("/fwupd/device{flags}", fu_device_flags_func);
+	g_test_add_func ("/fwupd/device{rescan}", fu_device_rescan_func);
 	g_test_add_func ("/fwupd/device{parent}", fu_device_parent_func);
 	g_test_add_func ("/fwupd/device{incorporate}", fu_device_incorporate_func);
 	if (g_test_slow ())
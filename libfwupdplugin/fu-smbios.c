@@ -18,8 +18,11 @@
 struct _FuSmbios {
 	GObject			 parent_instance;
 	gchar			*smbios_ver;
+	gchar			*checksum;
 	guint32			 structure_table_len;
-	GPtrArray		*items;
+	GBytes			*blob;		/* NUL terminated */
+	GArray			*items;		/* of FuSmbiosItem */
+	GPtrArray		*strings;	/* (element-type utf8) (transfer none) */
 };
 
 /* little endian */
@@ -61,22 +64,37 @@ typedef struct __attribute__((packed)) {
 	guint16			 handle;
 } FuSmbiosStructure;
 
+/* everything points into the blob, so no allocation is needed per structure */
 typedef struct {
 	guint8			 type;
 	guint16			 handle;
-	GBytes			*data;
-	GPtrArray		*strings;
+	gsize			 offset;
+	gsize			 len;
+	guint			 strings_idx;
+	guint			 strings_len;
 } FuSmbiosItem;
 
 G_DEFINE_TYPE (FuSmbios, fu_smbios, G_TYPE_OBJECT)
 
+/* @blob must be followed by a NUL byte, as returned by g_file_get_contents() */
 static gboolean
-fu_smbios_setup_from_data (FuSmbios *self, const guint8 *buf, gsize sz, GError **error)
+fu_smbios_setup_from_data (FuSmbios *self, GBytes *blob, GError **error)
 {
+	gsize sz = 0;
+	const guint8 *buf = g_bytes_get_data (blob, &sz);
+
+	/* the items and strings all point into the blob */
+	g_array_set_size (self->items, 0);
+	g_ptr_array_set_size (self->strings, 0);
+	g_clear_pointer (&self->checksum, g_free);
+	if (self->blob != NULL)
+		g_bytes_unref (self->blob);
+	self->blob = g_bytes_ref (blob);
+
 	/* go through each structure */
 	for (gsize i = 0; i < sz; i++) {
 		FuSmbiosStructure *str = (FuSmbiosStructure *) &buf[i];
-		FuSmbiosItem *item;
+		FuSmbiosItem item = { 0x0 };
 
 		/* invalid */
 		if (str->len == 0x00)
@@ -90,16 +108,16 @@ fu_smbios_setup_from_data (FuSmbios *self, const guint8 *buf, gsize sz, GError *
 		}
 
 		/* create a new result */
-		item = g_new0 (FuSmbiosItem, 1);
-		item->type = str->type;
-		item->handle = GUINT16_FROM_LE (str->handle);
-		item->data = g_bytes_new (buf + i, str->len);
-		item->strings = g_ptr_array_new_with_free_func (g_free);
-		g_ptr_array_add (self->items, item);
+		item.type = str->type;
+		item.handle = GUINT16_FROM_LE (str->handle);
+		item.offset = i;
+		item.len = str->len;
+		item.strings_idx = self->strings->len;
 
 		/* jump to the end of the struct */
 		i += str->len;
 		if (buf[i] == '\0' && buf[i+1] == '\0') {
+			g_array_append_val (self->items, item);
 			i++;
 			continue;
 		}
@@ -109,11 +127,12 @@ fu_smbios_setup_from_data (FuSmbios *self, const guint8 *buf, gsize sz, GError *
 			if (buf[i] == '\0') {
 				if (start_offset == i)
 					break;
-				g_ptr_array_add (item->strings,
-						 g_strdup ((const gchar *) &buf[start_offset]));
+				g_ptr_array_add (self->strings, (gpointer) &buf[start_offset]);
 				start_offset = i + 1;
 			}
 		}
+		item.strings_len = self->strings->len - item.strings_idx;
+		g_array_append_val (self->items, item);
 	}
 	return TRUE;
 }
@@ -134,10 +153,12 @@ gboolean
 fu_smbios_setup_from_file (FuSmbios *self, const gchar *filename, GError **error)
 {
 	gsize sz = 0;
-	g_autofree gchar *buf = NULL;
+	gchar *buf = NULL;
+	g_autoptr(GBytes) blob = NULL;
 	if (!g_file_get_contents (filename, &buf, &sz, error))
 		return FALSE;
-	return fu_smbios_setup_from_data (self, (guint8 *) buf, sz, error);
+	blob = g_bytes_new_take (buf, sz);
+	return fu_smbios_setup_from_data (self, blob, error);
 }
 
 static gboolean
@@ -245,9 +266,10 @@ gboolean
 fu_smbios_setup_from_path (FuSmbios *self, const gchar *path, GError **error)
 {
 	gsize sz = 0;
+	gchar *dmi_raw = NULL;
 	g_autofree gchar *dmi_fn = NULL;
-	g_autofree gchar *dmi_raw = NULL;
 	g_autofree gchar *ep_fn = NULL;
+	g_autoptr(GBytes) blob = NULL;
 	g_autofree gchar *ep_raw = NULL;
 
 	g_return_val_if_fail (FU_IS_SMBIOS (self), FALSE);
@@ -290,6 +312,7 @@ fu_smbios_setup_from_path (FuSmbios *self, const gchar *path, GError **error)
 	dmi_fn = g_build_filename (path, "DMI", NULL);
 	if (!g_file_get_contents (dmi_fn, &dmi_raw, &sz, error))
 		return FALSE;
+	blob = g_bytes_new_take (dmi_raw, sz);
 	if (sz != self->structure_table_len) {
 		g_set_error (error,
 			     FWUPD_ERROR,
@@ -301,7 +324,7 @@ fu_smbios_setup_from_path (FuSmbios *self, const gchar *path, GError **error)
 	}
 
 	/* parse blob */
-	return fu_smbios_setup_from_data (self, (guint8 *) dmi_raw, sz, error);
+	return fu_smbios_setup_from_data (self, blob, error);
 }
 
 /**
@@ -346,13 +369,12 @@ fu_smbios_to_string (FuSmbios *self)
 	str = g_string_new (NULL);
 	g_string_append_printf (str, "SmbiosVersion: %s\n", self->smbios_ver);
 	for (guint i = 0; i < self->items->len; i++) {
-		FuSmbiosItem *item = g_ptr_array_index (self->items, i);
+		FuSmbiosItem *item = &g_array_index (self->items, FuSmbiosItem, i);
 		g_string_append_printf (str, "Type: %02x\n", item->type);
-		g_string_append_printf (str, " Length: %" G_GSIZE_FORMAT "\n",
-					g_bytes_get_size (item->data));
+		g_string_append_printf (str, " Length: %" G_GSIZE_FORMAT "\n", item->len);
 		g_string_append_printf (str, " Handle: 0x%04x\n", item->handle);
-		for (guint j = 0; j < item->strings->len; j++) {
-			const gchar *tmp = g_ptr_array_index (item->strings, j);
+		for (guint j = 0; j < item->strings_len; j++) {
+			const gchar *tmp = g_ptr_array_index (self->strings, item->strings_idx + j);
 			g_string_append_printf (str, "  String[%02u]: %s\n", j, tmp);
 		}
 	}
@@ -363,13 +385,38 @@ static FuSmbiosItem *
 fu_smbios_get_item_for_type (FuSmbios *self, guint8 type)
 {
 	for (guint i = 0; i < self->items->len; i++) {
-		FuSmbiosItem *item = g_ptr_array_index (self->items, i);
+		FuSmbiosItem *item = &g_array_index (self->items, FuSmbiosItem, i);
 		if (item->type == type)
 			return item;
 	}
 	return NULL;
 }
 
+/**
+ * fu_smbios_get_checksum:
+ * @self: A #FuSmbios
+ *
+ * Gets a checksum of the raw DMI table, which can be used to check if any
+ * values derived from the SMBIOS data are still valid.
+ *
+ * Returns: a SHA1 hash, or %NULL if not set up
+ *
+ * Since: 1.4.2
+ **/
+const gchar *
+fu_smbios_get_checksum (FuSmbios *self)
+{
+	g_return_val_if_fail (FU_IS_SMBIOS (self), NULL);
+	if (self->blob == NULL)
+		return NULL;
+	if (self->checksum == NULL) {
+		gsize sz = 0;
+		const guint8 *buf = g_bytes_get_data (self->blob, &sz);
+		self->checksum = g_compute_checksum_for_data (G_CHECKSUM_SHA1, buf, sz);
+	}
+	return self->checksum;
+}
+
 /**
  * fu_smbios_get_data:
  * @self: A #FuSmbios
@@ -395,7 +442,7 @@ fu_smbios_get_data (FuSmbios *self, guint8 type, GError **error)
 			     "no structure with type %02x", type);
 		return NULL;
 	}
-	return g_bytes_ref (item->data);
+	return g_bytes_new_from_bytes (self->blob, item->offset, item->len);
 }
 
 /**
@@ -434,7 +481,8 @@ fu_smbios_get_string (FuSmbios *self, guint8 type, guint8 offset, GError **error
 	}
 
 	/* check offset valid */
-	data = g_bytes_get_data (item->data, &sz);
+	data = (const guint8 *) g_bytes_get_data (self->blob, NULL) + item->offset;
+	sz = item->len;
 	if (offset >= sz) {
 		g_set_error (error,
 			     FWUPD_ERROR,
@@ -451,7 +499,7 @@ fu_smbios_get_string (FuSmbios *self, guint8 type, guint8 offset, GError **error
 	}
 
 	/* check string index valid */
-	if (data[offset] > item->strings->len) {
+	if (data[offset] > item->strings_len) {
 		g_set_error (error,
 			     FWUPD_ERROR,
 			     FWUPD_ERROR_INVALID_FILE,
@@ -459,15 +507,7 @@ fu_smbios_get_string (FuSmbios *self, guint8 type, guint8 offset, GError **error
 			     data[offset]);
 		return NULL;
 	}
-	return g_ptr_array_index (item->strings, data[offset] - 1);
-}
-
-static void
-fu_smbios_item_free (FuSmbiosItem *item)
-{
-	g_bytes_unref (item->data);
-	g_ptr_array_unref (item->strings);
-	g_free (item);
+	return g_ptr_array_index (self->strings, item->strings_idx + data[offset] - 1);
 }
 
 static void
@@ -475,7 +515,11 @@ fu_smbios_finalize (GObject *object)
 {
 	FuSmbios *self = FU_SMBIOS (object);
 	g_free (self->smbios_ver);
-	g_ptr_array_unref (self->items);
+	g_free (self->checksum);
+	if (self->blob != NULL)
+		g_bytes_unref (self->blob);
+	g_array_unref (self->items);
+	g_ptr_array_unref (self->strings);
 	G_OBJECT_CLASS (fu_smbios_parent_class)->finalize (object);
 }
 
@@ -489,7 +533,8 @@ fu_smbios_class_init (FuSmbiosClass *klass)
 static void
 fu_smbios_init (FuSmbios *self)
 {
-	self->items = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_smbios_item_free);
+	self->items = g_array_new (FALSE, FALSE, sizeof (FuSmbiosItem));
+	self->strings = g_ptr_array_new ();
 }
 
 /**
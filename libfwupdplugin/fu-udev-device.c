@@ -1063,6 +1063,210 @@ fu_udev_device_pread (FuUdevDevice *self, goffset port, guint8 *data, GError **e
 #endif
 }
 
+#ifdef HAVE_PWRITE
+static gboolean
+fu_udev_device_port_write (gint fd, guint16 port, guint8 data, GError **error)
+{
+	if (pwrite (fd, &data, 1, port) != 1) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_FAILED,
+			     "failed to write to port %04x: %s",
+			     (guint) port,
+			     strerror (errno));
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static gboolean
+fu_udev_device_port_read (gint fd, guint16 port, guint8 *data, GError **error)
+{
+	if (pread (fd, data, 1, port) != 1) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_FAILED,
+			     "failed to read from port %04x: %s",
+			     (guint) port,
+			     strerror (errno));
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static gboolean
+fu_udev_device_port_wait (gint fd, guint16 port, guint8 mask, gboolean set,
+			  guint timeout_ms, GError **error)
+{
+	gint64 deadline = g_get_monotonic_time () + ((gint64) timeout_ms * 1000);
+
+	/* the status is checked at least once, even with no timeout */
+	do {
+		guint8 status = 0x0;
+		if (!fu_udev_device_port_read (fd, port, &status, error))
+			return FALSE;
+		if (set && (status & mask) != 0)
+			return TRUE;
+		if (!set && (status & mask) == 0)
+			return TRUE;
+	} while (g_get_monotonic_time () < deadline);
+	g_set_error (error,
+		     G_IO_ERROR,
+		     G_IO_ERROR_TIMED_OUT,
+		     "timed out whilst waiting for port %04x 0x%02x:%i",
+		     (guint) port, mask, set);
+	return FALSE;
+}
+#endif
+
+/**
+ * fu_udev_device_pread_full:
+ * @self: A #FuUdevDevice
+ * @port: offset address
+ * @buf: (out): buffer
+ * @bufsz: number of bytes to read
+ * @error: A #GError, or %NULL
+ *
+ * Reads several bytes from the same offset, for instance to drain a data
+ * register. This is faster than calling fu_udev_device_pread() in a loop.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.4.2
+ **/
+gboolean
+fu_udev_device_pread_full (FuUdevDevice *self, goffset port,
+			   guint8 *buf, gsize bufsz, GError **error)
+{
+	FuUdevDevicePrivate *priv = GET_PRIVATE (self);
+
+	g_return_val_if_fail (FU_IS_UDEV_DEVICE (self), FALSE);
+	g_return_val_if_fail (port != 0x0, FALSE);
+	g_return_val_if_fail (buf != NULL, FALSE);
+	g_return_val_if_fail (priv->fd > 0, FALSE);
+
+#ifdef HAVE_PWRITE
+	for (gsize i = 0; i < bufsz; i++) {
+		if (!fu_udev_device_port_read (priv->fd, port, &buf[i], error))
+			return FALSE;
+	}
+	return TRUE;
+#else
+	g_set_error_literal (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_SUPPORTED,
+			     "Not supported as pread() is unavailable");
+	return FALSE;
+#endif
+}
+
+/**
+ * fu_udev_device_pwait:
+ * @self: A #FuUdevDevice
+ * @port: offset address
+ * @mask: bits to check
+ * @set: %TRUE to wait for any bit in @mask to be set, %FALSE to wait for
+ *	 all the bits to be clear
+ * @timeout_ms: timeout in ms
+ * @error: A #GError, or %NULL
+ *
+ * Polls a status register at a given offset until the bits match.
+ *
+ * Returns: %TRUE for success, or %FALSE with %G_IO_ERROR_TIMED_OUT
+ *
+ * Since: 1.4.2
+ **/
+gboolean
+fu_udev_device_pwait (FuUdevDevice *self, goffset port, guint8 mask,
+		      gboolean set, guint timeout_ms, GError **error)
+{
+	FuUdevDevicePrivate *priv = GET_PRIVATE (self);
+
+	g_return_val_if_fail (FU_IS_UDEV_DEVICE (self), FALSE);
+	g_return_val_if_fail (port != 0x0, FALSE);
+	g_return_val_if_fail (priv->fd > 0, FALSE);
+
+#ifdef HAVE_PWRITE
+	return fu_udev_device_port_wait (priv->fd, port, mask, set, timeout_ms, error);
+#else
+	g_set_error_literal (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_SUPPORTED,
+			     "Not supported as pread() is unavailable");
+	return FALSE;
+#endif
+}
+
+/**
+ * fu_udev_device_port_sequence:
+ * @self: A #FuUdevDevice
+ * @ops: (array length=n_ops): a #FuUdevDevicePortOp array
+ * @n_ops: number of operations
+ * @timeout_ms: timeout in ms for each wait operation
+ * @error: A #GError, or %NULL
+ *
+ * Runs a sequence of port writes, reads and status waits in order, stopping
+ * at the first failure. The arguments are only checked once, which makes
+ * this much faster than calling fu_udev_device_pwrite() and
+ * fu_udev_device_pread() for each byte of a long command.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.4.2
+ **/
+gboolean
+fu_udev_device_port_sequence (FuUdevDevice *self,
+			      const FuUdevDevicePortOp *ops,
+			      gsize n_ops,
+			      guint timeout_ms,
+			      GError **error)
+{
+	FuUdevDevicePrivate *priv = GET_PRIVATE (self);
+
+	g_return_val_if_fail (FU_IS_UDEV_DEVICE (self), FALSE);
+	g_return_val_if_fail (ops != NULL || n_ops == 0, FALSE);
+	g_return_val_if_fail (priv->fd > 0, FALSE);
+
+#ifdef HAVE_PWRITE
+	for (gsize i = 0; i < n_ops; i++) {
+		const FuUdevDevicePortOp *op = &ops[i];
+		gboolean ret = FALSE;
+		switch (op->kind) {
+		case FU_UDEV_DEVICE_PORT_OP_WRITE:
+			ret = fu_udev_device_port_write (priv->fd, op->port, op->value, error);
+			break;
+		case FU_UDEV_DEVICE_PORT_OP_READ:
+			ret = fu_udev_device_port_read (priv->fd, op->port, op->data, error);
+			break;
+		case FU_UDEV_DEVICE_PORT_OP_WAIT_SET:
+			ret = fu_udev_device_port_wait (priv->fd, op->port, op->value,
+							TRUE, timeout_ms, error);
+			break;
+		case FU_UDEV_DEVICE_PORT_OP_WAIT_CLEAR:
+			ret = fu_udev_device_port_wait (priv->fd, op->port, op->value,
+							FALSE, timeout_ms, error);
+			break;
+		default:
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INTERNAL,
+				     "port operation %u not known",
+				     (guint) op->kind);
+			break;
+		}
+		if (!ret)
+			return FALSE;
+	}
+	return TRUE;
+#else
+	g_set_error_literal (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_SUPPORTED,
+			     "Not supported as pwrite() is unavailable");
+	return FALSE;
+#endif
+}
+
 static void
 fu_udev_device_get_property (GObject *object, guint prop_id,
 			    GValue *value, GParamSpec *pspec)
@@ -50,6 +50,40 @@ typedef enum {
 	FU_UDEV_DEVICE_FLAG_LAST
 } FuUdevDeviceFlags;
 
+/**
+ * FuUdevDevicePortOpKind:
+ * @FU_UDEV_DEVICE_PORT_OP_WRITE:		Write the value to the port
+ * @FU_UDEV_DEVICE_PORT_OP_READ:		Read one byte from the port
+ * @FU_UDEV_DEVICE_PORT_OP_WAIT_SET:		Wait for any bit in the mask to be set
+ * @FU_UDEV_DEVICE_PORT_OP_WAIT_CLEAR:		Wait for all bits in the mask to be clear
+ *
+ * The kind of operation used in fu_udev_device_port_sequence().
+ **/
+typedef enum {
+	FU_UDEV_DEVICE_PORT_OP_WRITE,
+	FU_UDEV_DEVICE_PORT_OP_READ,
+	FU_UDEV_DEVICE_PORT_OP_WAIT_SET,
+	FU_UDEV_DEVICE_PORT_OP_WAIT_CLEAR,
+	/*< private >*/
+	FU_UDEV_DEVICE_PORT_OP_LAST
+} FuUdevDevicePortOpKind;
+
+/**
+ * FuUdevDevicePortOp:
+ * @kind: A #FuUdevDevicePortOpKind
+ * @port: offset address
+ * @value: value to write, or the mask to wait for
+ * @data: destination for a read, otherwise %NULL
+ *
+ * A single operation used in fu_udev_device_port_sequence().
+ **/
+typedef struct {
+	FuUdevDevicePortOpKind	 kind;
+	guint16			 port;
+	guint8			 value;
+	guint8			*data;
+} FuUdevDevicePortOp;
+
 FuUdevDevice	*fu_udev_device_new			(GUdevDevice	*udev_device);
 GUdevDevice	*fu_udev_device_get_dev			(FuUdevDevice	*self);
 const gchar	*fu_udev_device_get_device_file		(FuUdevDevice	*self);
@@ -85,6 +119,22 @@ gboolean	 fu_udev_device_pread			(FuUdevDevice	*self,
 							 goffset	 port,
 							 guint8		*data,
 							 GError		**error);
+gboolean	 fu_udev_device_pread_full		(FuUdevDevice	*self,
+							 goffset	 port,
+							 guint8		*buf,
+							 gsize		 bufsz,
+							 GError		**error);
+gboolean	 fu_udev_device_pwait			(FuUdevDevice	*self,
+							 goffset	 port,
+							 guint8		 mask,
+							 gboolean	 set,
+							 guint		 timeout_ms,
+							 GError		**error);
+gboolean	 fu_udev_device_port_sequence		(FuUdevDevice	*self,
+							 const FuUdevDevicePortOp *ops,
+							 gsize		 n_ops,
+							 guint		 timeout_ms,
+							 GError		**error);
 const gchar	*fu_udev_device_get_sysfs_attr		 (FuUdevDevice	*self,
 							  const gchar	*attr,
 							  GError	**error);
@@ -264,11 +264,24 @@ static gboolean
 fu_nvme_device_probe (FuUdevDevice *device, GError **error)
 {
 	FuNvmeDevice *self = FU_NVME_DEVICE (device);
+	const gchar *firmware_rev;
+	const gchar *model;
+	const gchar *serial;
 
 	/* set the physical ID */
 	if (!fu_udev_device_set_physical_id (device, "pci", error))
 		return FALSE;
 
+	/* the CNS only changes if the drive or the firmware is replaced */
+	model = fu_udev_device_get_sysfs_attr (device, "model", NULL);
+	serial = fu_udev_device_get_sysfs_attr (device, "serial", NULL);
+	firmware_rev = fu_udev_device_get_sysfs_attr (device, "firmware_rev", NULL);
+	if (model != NULL && serial != NULL && firmware_rev != NULL) {
+		g_autofree gchar *token = NULL;
+		token = g_strdup_printf ("%s|%s|%s", model, serial, firmware_rev);
+		fu_device_set_cache_token (FU_DEVICE (self), token);
+	}
+
 	/* look at the PCI depth to work out if in an external enclosure */
 	self->pci_depth = fu_udev_device_get_slot_depth (device, "pci");
 	if (self->pci_depth <= 2) {
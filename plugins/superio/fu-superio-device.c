@@ -9,7 +9,7 @@
 #include "fu-superio-common.h"
 #include "fu-superio-device.h"
 
-#define FU_PLUGIN_SUPERIO_TIMEOUT	0.25 /* s */
+#define FU_PLUGIN_SUPERIO_TIMEOUT	250 /* ms */
 
 typedef struct
 {
@@ -37,11 +37,12 @@ fu_superio_device_regval (FuSuperioDevice *self, guint8 addr,
 			  guint8 *data, GError **error)
 {
 	FuSuperioDevicePrivate *priv = GET_PRIVATE (self);
-	if (!fu_udev_device_pwrite (FU_UDEV_DEVICE (self), priv->port, addr, error))
-		return FALSE;
-	if (!fu_udev_device_pread (FU_UDEV_DEVICE (self), priv->port + 1, data, error))
-		return FALSE;
-	return TRUE;
+	FuUdevDevicePortOp ops[] = {
+		{ FU_UDEV_DEVICE_PORT_OP_WRITE,	priv->port,	addr,	NULL },
+		{ FU_UDEV_DEVICE_PORT_OP_READ,	priv->port + 1,	0x0,	data },
+	};
+	return fu_udev_device_port_sequence (FU_UDEV_DEVICE (self), ops, G_N_ELEMENTS (ops),
+					     FU_PLUGIN_SUPERIO_TIMEOUT, error);
 }
 
 gboolean
@@ -63,11 +64,12 @@ fu_superio_device_regwrite (FuSuperioDevice *self, guint8 addr,
 			    guint8 data, GError **error)
 {
 	FuSuperioDevicePrivate *priv = GET_PRIVATE (self);
-	if (!fu_udev_device_pwrite (FU_UDEV_DEVICE (self), priv->port, addr, error))
-		return FALSE;
-	if (!fu_udev_device_pwrite (FU_UDEV_DEVICE (self), priv->port + 1, data, error))
-		return FALSE;
-	return TRUE;
+	FuUdevDevicePortOp ops[] = {
+		{ FU_UDEV_DEVICE_PORT_OP_WRITE,	priv->port,	addr,	NULL },
+		{ FU_UDEV_DEVICE_PORT_OP_WRITE,	priv->port + 1,	data,	NULL },
+	};
+	return fu_udev_device_port_sequence (FU_UDEV_DEVICE (self), ops, G_N_ELEMENTS (ops),
+					     FU_PLUGIN_SUPERIO_TIMEOUT, error);
 }
 
 static gboolean
@@ -83,15 +85,16 @@ fu_superio_device_regdump (FuSuperioDevice *self, guint8 ldn, GError **error)
 	guint8 buf[0xff] = { 0x00 };
 	guint16 iobad0 = 0x0;
 	guint16 iobad1 = 0x0;
+	g_autoptr(GArray) ops = g_array_new (FALSE, FALSE, sizeof(FuUdevDevicePortOp));
 	g_autoptr(GString) str = g_string_new (NULL);
 
 	/* set LDN */
 	if (!fu_superio_device_set_ldn (self, ldn, error))
 		return FALSE;
-	for (guint i = 0x00; i < 0xff; i++) {
-		if (!fu_superio_device_regval (self, i, &buf[i], error))
-			return FALSE;
-	}
+	for (guint i = 0x00; i < 0xff; i++)
+		fu_superio_device_ops_regval (self, ops, i, &buf[i]);
+	if (!fu_superio_device_ops_run (self, ops, error))
+		return FALSE;
 
 	/* get the i/o base addresses */
 	if (!fu_superio_device_regval16 (self, SIO_LDNxx_IDX_IOBAD0, &iobad0, error))
@@ -143,63 +146,114 @@ fu_superio_device_check_id (FuSuperioDevice *self, GError **error)
 	return TRUE;
 }
 
-static gboolean
-fu_superio_device_wait_for (FuSuperioDevice *self, guint8 mask, gboolean set, GError **error)
+/* waits for the EC to read the last byte, and then writes the next one */
+static void
+fu_superio_device_ops_write (FuSuperioDevice *self, GArray *ops, guint16 port, guint8 data)
 {
 	FuSuperioDevicePrivate *priv = GET_PRIVATE (self);
-	g_autoptr(GTimer) timer = g_timer_new ();
-	do {
-		guint8 status = 0x00;
-		if (!fu_udev_device_pread (FU_UDEV_DEVICE (self), priv->pm1_iobad1, &status, error))
-			return FALSE;
-		if (g_timer_elapsed (timer, NULL) > FU_PLUGIN_SUPERIO_TIMEOUT)
-			break;
-		if (set && (status & mask) != 0)
-			return TRUE;
-		if (!set && (status & mask) == 0)
-			return TRUE;
-	} while (TRUE);
-	g_set_error (error,
-		     G_IO_ERROR,
-		     G_IO_ERROR_TIMED_OUT,
-		     "timed out whilst waiting for 0x%02x:%i", mask, set);
-	return FALSE;
+	FuUdevDevicePortOp op_wait = { FU_UDEV_DEVICE_PORT_OP_WAIT_CLEAR,
+				       priv->pm1_iobad1, SIO_STATUS_EC_IBF, NULL };
+	FuUdevDevicePortOp op_write = { FU_UDEV_DEVICE_PORT_OP_WRITE,
+					port, data, NULL };
+	g_array_append_val (ops, op_wait);
+	g_array_append_val (ops, op_write);
+}
+
+void
+fu_superio_device_ops_ec_read (FuSuperioDevice *self, GArray *ops, guint8 *data)
+{
+	FuSuperioDevicePrivate *priv = GET_PRIVATE (self);
+	FuUdevDevicePortOp op_wait = { FU_UDEV_DEVICE_PORT_OP_WAIT_SET,
+				       priv->pm1_iobad1, SIO_STATUS_EC_OBF, NULL };
+	FuUdevDevicePortOp op_read = { FU_UDEV_DEVICE_PORT_OP_READ,
+				       priv->pm1_iobad0, 0x0, data };
+	g_array_append_val (ops, op_wait);
+	g_array_append_val (ops, op_read);
+}
+
+void
+fu_superio_device_ops_ec_write0 (FuSuperioDevice *self, GArray *ops, guint8 data)
+{
+	FuSuperioDevicePrivate *priv = GET_PRIVATE (self);
+	fu_superio_device_ops_write (self, ops, priv->pm1_iobad0, data);
+}
+
+void
+fu_superio_device_ops_ec_write1 (FuSuperioDevice *self, GArray *ops, guint8 data)
+{
+	FuSuperioDevicePrivate *priv = GET_PRIVATE (self);
+	fu_superio_device_ops_write (self, ops, priv->pm1_iobad1, data);
+}
+
+void
+fu_superio_device_ops_regval (FuSuperioDevice *self, GArray *ops, guint8 addr, guint8 *data)
+{
+	FuSuperioDevicePrivate *priv = GET_PRIVATE (self);
+	FuUdevDevicePortOp op_write = { FU_UDEV_DEVICE_PORT_OP_WRITE,
+					priv->port, addr, NULL };
+	FuUdevDevicePortOp op_read = { FU_UDEV_DEVICE_PORT_OP_READ,
+				       priv->port + 1, 0x0, data };
+	g_array_append_val (ops, op_write);
+	g_array_append_val (ops, op_read);
+}
+
+/* runs all the queued operations and then clears the array for reuse */
+gboolean
+fu_superio_device_ops_run (FuSuperioDevice *self, GArray *ops, GError **error)
+{
+	gboolean ret;
+	ret = fu_udev_device_port_sequence (FU_UDEV_DEVICE (self),
+					    (const FuUdevDevicePortOp *) ops->data,
+					    ops->len,
+					    FU_PLUGIN_SUPERIO_TIMEOUT,
+					    error);
+	g_array_set_size (ops, 0);
+	return ret;
 }
 
 gboolean
 fu_superio_device_ec_read (FuSuperioDevice *self, guint8 *data, GError **error)
 {
 	FuSuperioDevicePrivate *priv = GET_PRIVATE (self);
-	if (!fu_superio_device_wait_for (self, SIO_STATUS_EC_OBF, TRUE, error))
-		return FALSE;
-	return fu_udev_device_pread (FU_UDEV_DEVICE (self), priv->pm1_iobad0, data, error);
+	FuUdevDevicePortOp ops[] = {
+		{ FU_UDEV_DEVICE_PORT_OP_WAIT_SET, priv->pm1_iobad1, SIO_STATUS_EC_OBF, NULL },
+		{ FU_UDEV_DEVICE_PORT_OP_READ, priv->pm1_iobad0, 0x0, data },
+	};
+	return fu_udev_device_port_sequence (FU_UDEV_DEVICE (self), ops, G_N_ELEMENTS (ops),
+					     FU_PLUGIN_SUPERIO_TIMEOUT, error);
 }
 
 gboolean
 fu_superio_device_ec_write0 (FuSuperioDevice *self, guint8 data, GError **error)
 {
 	FuSuperioDevicePrivate *priv = GET_PRIVATE (self);
-	if (!fu_superio_device_wait_for (self, SIO_STATUS_EC_IBF, FALSE, error))
-		return FALSE;
-	return fu_udev_device_pwrite (FU_UDEV_DEVICE (self), priv->pm1_iobad0, data, error);
+	FuUdevDevicePortOp ops[] = {
+		{ FU_UDEV_DEVICE_PORT_OP_WAIT_CLEAR, priv->pm1_iobad1, SIO_STATUS_EC_IBF, NULL },
+		{ FU_UDEV_DEVICE_PORT_OP_WRITE, priv->pm1_iobad0, data, NULL },
+	};
+	return fu_udev_device_port_sequence (FU_UDEV_DEVICE (self), ops, G_N_ELEMENTS (ops),
+					     FU_PLUGIN_SUPERIO_TIMEOUT, error);
 }
 
 gboolean
 fu_superio_device_ec_write1 (FuSuperioDevice *self, guint8 data, GError **error)
 {
 	FuSuperioDevicePrivate *priv = GET_PRIVATE (self);
-	if (!fu_superio_device_wait_for (self, SIO_STATUS_EC_IBF, FALSE, error))
-		return FALSE;
-	return fu_udev_device_pwrite (FU_UDEV_DEVICE (self), priv->pm1_iobad1, data, error);
+	FuUdevDevicePortOp ops[] = {
+		{ FU_UDEV_DEVICE_PORT_OP_WAIT_CLEAR, priv->pm1_iobad1, SIO_STATUS_EC_IBF, NULL },
+		{ FU_UDEV_DEVICE_PORT_OP_WRITE, priv->pm1_iobad1, data, NULL },
+	};
+	return fu_udev_device_port_sequence (FU_UDEV_DEVICE (self), ops, G_N_ELEMENTS (ops),
+					     FU_PLUGIN_SUPERIO_TIMEOUT, error);
 }
 
 static gboolean
 fu_superio_device_ec_flush (FuSuperioDevice *self, GError **error)
 {
 	FuSuperioDevicePrivate *priv = GET_PRIVATE (self);
-	guint8 status = 0x00;
-	g_autoptr(GTimer) timer = g_timer_new ();
+	gint64 deadline = g_get_monotonic_time () + FU_PLUGIN_SUPERIO_TIMEOUT * 1000;
 	do {
+		guint8 status = 0x00;
 		guint8 unused = 0;
 		if (!fu_udev_device_pread (FU_UDEV_DEVICE (self), priv->pm1_iobad1, &status, error))
 			return FALSE;
@@ -207,7 +261,7 @@ fu_superio_device_ec_flush (FuSuperioDevice *self, GError **error)
 			break;
 		if (!fu_udev_device_pread (FU_UDEV_DEVICE (self), priv->pm1_iobad0, &unused, error))
 			return FALSE;
-		if (g_timer_elapsed (timer, NULL) > FU_PLUGIN_SUPERIO_TIMEOUT) {
+		if (g_get_monotonic_time () > deadline) {
 			g_set_error_literal (error,
 					     G_IO_ERROR,
 					     G_IO_ERROR_TIMED_OUT,
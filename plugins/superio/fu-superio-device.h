@@ -43,3 +43,21 @@ gboolean	 fu_superio_device_regwrite	(FuSuperioDevice	*self,
 						 guint8			 addr,
 						 guint8			 data,
 						 GError			**error);
+
+/* queue port operations to run in one go */
+void		 fu_superio_device_ops_ec_read	(FuSuperioDevice	*self,
+						 GArray			*ops,
+						 guint8			*data);
+void		 fu_superio_device_ops_ec_write0 (FuSuperioDevice	*self,
+						 GArray			*ops,
+						 guint8			 data);
+void		 fu_superio_device_ops_ec_write1 (FuSuperioDevice	*self,
+						 GArray			*ops,
+						 guint8			 data);
+void		 fu_superio_device_ops_regval	(FuSuperioDevice	*self,
+						 GArray			*ops,
+						 guint8			 addr,
+						 guint8			*data);
+gboolean	 fu_superio_device_ops_run	(FuSuperioDevice	*self,
+						 GArray			*ops,
+						 GError			**error);
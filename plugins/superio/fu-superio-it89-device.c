@@ -16,6 +16,9 @@ struct _FuSuperioIt89Device {
 
 G_DEFINE_TYPE (FuSuperioIt89Device, fu_superio_it89_device, FU_TYPE_SUPERIO_DEVICE)
 
+/* number of bytes read from the EC in one port sequence */
+#define FU_SUPERIO_IT89_BLOCK_SIZE	0x100
+
 static gboolean
 fu_superio_it89_device_read_ec_register (FuSuperioDevice *self,
 					 guint16 addr,
@@ -121,24 +124,44 @@ fu_superio_it89_device_setup (FuSuperioDevice *self, GError **error)
 	return TRUE;
 }
 
+static void
+fu_superio_it89_device_ops_pm1do_sci (FuSuperioDevice *self, GArray *ops, guint8 val)
+{
+	fu_superio_device_ops_ec_write1 (self, ops, SIO_EC_PMC_PM1DOSCI);
+	fu_superio_device_ops_ec_write1 (self, ops, val);
+}
+
+static void
+fu_superio_it89_device_ops_pm1do_smi (FuSuperioDevice *self, GArray *ops, guint8 val)
+{
+	fu_superio_device_ops_ec_write1 (self, ops, SIO_EC_PMC_PM1DOCMI);
+	fu_superio_device_ops_ec_write1 (self, ops, val);
+}
+
 static gboolean
 fu_superio_it89_device_ec_pm1do_sci (FuSuperioDevice *self, guint8 val, GError **error)
 {
-	if (!fu_superio_device_ec_write1 (self, SIO_EC_PMC_PM1DOSCI, error))
-		return FALSE;
-	if (!fu_superio_device_ec_write1 (self, val, error))
-		return FALSE;
-	return TRUE;
+	g_autoptr(GArray) ops = g_array_new (FALSE, FALSE, sizeof(FuUdevDevicePortOp));
+	fu_superio_it89_device_ops_pm1do_sci (self, ops, val);
+	return fu_superio_device_ops_run (self, ops, error);
 }
 
 static gboolean
 fu_superio_it89_device_ec_pm1do_smi (FuSuperioDevice *self, guint8 val, GError **error)
 {
-	if (!fu_superio_device_ec_write1 (self, SIO_EC_PMC_PM1DOCMI, error))
-		return FALSE;
-	if (!fu_superio_device_ec_write1 (self, val, error))
-		return FALSE;
-	return TRUE;
+	g_autoptr(GArray) ops = g_array_new (FALSE, FALSE, sizeof(FuUdevDevicePortOp));
+	fu_superio_it89_device_ops_pm1do_smi (self, ops, val);
+	return fu_superio_device_ops_run (self, ops, error);
+}
+
+/* ask for the next byte and read it back */
+static gboolean
+fu_superio_it89_device_ec_pm1di (FuSuperioDevice *self, guint8 *data, GError **error)
+{
+	g_autoptr(GArray) ops = g_array_new (FALSE, FALSE, sizeof(FuUdevDevicePortOp));
+	fu_superio_device_ops_ec_write1 (self, ops, SIO_EC_PMC_PM1DI);
+	fu_superio_device_ops_ec_read (self, ops, data);
+	return fu_superio_device_ops_run (self, ops, error);
 }
 
 static gboolean
@@ -154,9 +177,7 @@ fu_superio_device_ec_read_status (FuSuperioDevice *self, GError **error)
 
 	/* wait for write */
 	do {
-		if (!fu_superio_device_ec_write1 (self, SIO_EC_PMC_PM1DI, error))
-			return FALSE;
-		if (!fu_superio_device_ec_read (self, &tmp, error))
+		if (!fu_superio_it89_device_ec_pm1di (self, &tmp, error))
 			return FALSE;
 	} while ((tmp & SIO_STATUS_EC_OBF) != 0);
 
@@ -187,9 +208,7 @@ fu_superio_device_ec_write_disable (FuSuperioDevice *self, GError **error)
 
 	/* wait for read */
 	do {
-		if (!fu_superio_device_ec_write1 (self, SIO_EC_PMC_PM1DI, error))
-			return FALSE;
-		if (!fu_superio_device_ec_read (self, &tmp, error))
+		if (!fu_superio_it89_device_ec_pm1di (self, &tmp, error))
 			return FALSE;
 	} while ((tmp & SIO_STATUS_EC_IBF) != 0);
 
@@ -220,9 +239,7 @@ fu_superio_device_ec_write_enable (FuSuperioDevice *self, GError **error)
 
 	/* wait for !BUSY */
 	do {
-		if (!fu_superio_device_ec_write1 (self, SIO_EC_PMC_PM1DI, error))
-			return FALSE;
-		if (!fu_superio_device_ec_read (self, &tmp, error))
+		if (!fu_superio_it89_device_ec_pm1di (self, &tmp, error))
 			return FALSE;
 	} while ((tmp & 3) != SIO_STATUS_EC_IBF);
 
@@ -238,6 +255,7 @@ fu_superio_it89_device_read_addr (FuSuperioDevice *self,
 				  GError **error)
 {
 	g_autofree guint8 *buf = NULL;
+	g_autoptr(GArray) ops = g_array_new (FALSE, FALSE, sizeof(FuUdevDevicePortOp));
 
 	/* check... */
 	if (!fu_superio_device_ec_write_disable (self, error))
@@ -263,12 +281,14 @@ fu_superio_it89_device_read_addr (FuSuperioDevice *self,
 	if (!fu_superio_it89_device_ec_pm1do_smi (self, 0x0, error))
 		return NULL;
 
-	/* read out data */
+	/* read out data, a block at a time */
 	buf = g_malloc0 (size);
 	for (guint i = 0; i < size; i++) {
-		if (!fu_superio_device_ec_write1 (self, SIO_EC_PMC_PM1DI, error))
-			return NULL;
-		if (!fu_superio_device_ec_read (self, &buf[i], error))
+		fu_superio_device_ops_ec_write1 (self, ops, SIO_EC_PMC_PM1DI);
+		fu_superio_device_ops_ec_read (self, ops, &buf[i]);
+		if ((i + 1) % FU_SUPERIO_IT89_BLOCK_SIZE != 0 && i + 1 != size)
+			continue;
+		if (!fu_superio_device_ops_run (self, ops, error))
 			return NULL;
 
 		/* update progress */
@@ -296,6 +316,7 @@ fu_superio_it89_device_write_addr (FuSuperioDevice *self, guint addr, GBytes *fw
 {
 	gsize size = 0;
 	const guint8 *buf = g_bytes_get_data (fw, &size);
+	g_autoptr(GArray) ops = g_array_new (FALSE, FALSE, sizeof(FuUdevDevicePortOp));
 
 	/* sanity check */
 	if ((addr & 0xff) != 0x00) {
@@ -336,16 +357,13 @@ fu_superio_it89_device_write_addr (FuSuperioDevice *self, guint addr, GBytes *fw
 		if (i > 0) {
 			if (!fu_superio_device_ec_read_status (self, error))
 				return FALSE;
-			if (!fu_superio_device_ec_write1 (self, SIO_EC_PMC_PM1DO, error))
-				return FALSE;
-			if (!fu_superio_it89_device_ec_pm1do_sci (self,
-								  SIO_SPI_CMD_WRITE_WORD,
-								  error))
-				return FALSE;
+			fu_superio_device_ops_ec_write1 (self, ops, SIO_EC_PMC_PM1DO);
+			fu_superio_it89_device_ops_pm1do_sci (self, ops,
+							      SIO_SPI_CMD_WRITE_WORD);
 		}
-		if (!fu_superio_it89_device_ec_pm1do_smi (self, buf[i+0], error))
-			return FALSE;
-		if (!fu_superio_it89_device_ec_pm1do_smi (self, buf[i+1], error))
+		fu_superio_it89_device_ops_pm1do_smi (self, ops, buf[i+0]);
+		fu_superio_it89_device_ops_pm1do_smi (self, ops, buf[i+1]);
+		if (!fu_superio_device_ops_run (self, ops, error))
 			return FALSE;
 	}
 
@@ -18,6 +18,7 @@ fu_plugin_init (FuPlugin *plugin)
 {
 	fu_plugin_set_build_hash (plugin, FU_BUILD_HASH);
 	fu_plugin_alloc_data (plugin, sizeof (FuPluginData));
+	fu_plugin_add_firmware_gtype (plugin, "test", FU_TYPE_FIRMWARE);
 	g_debug ("init");
 }
 
@@ -28,10 +29,91 @@ fu_plugin_destroy (FuPlugin *plugin)
 	g_debug ("destroy");
 }
 
+/* keep in sync with contrib/generate-scale-metadata.py */
+static gchar *
+fu_plugin_test_scale_guid (guint kind, guint idx)
+{
+	return g_strdup_printf ("%08x-0000-4000-8000-%012x", 0x273f0000u + kind, idx);
+}
+
+static guint
+fu_plugin_test_get_scale (FuPlugin *plugin)
+{
+	const gchar *tmp = g_getenv ("FWUPD_PLUGIN_TEST_SCALE");
+	g_autofree gchar *value = NULL;
+	if (tmp != NULL)
+		return fu_common_strtoull (tmp);
+	value = fu_plugin_get_config_value (plugin, "ScaleDevices");
+	if (value != NULL)
+		return fu_common_strtoull (value);
+	return 0;
+}
+
+static FuDevice *
+fu_plugin_test_scale_device_new (guint idx, guint kind, const gchar *name)
+{
+	FuDevice *device = fu_device_new ();
+	g_autofree gchar *id = g_strdup_printf ("Scale%05u-%02x", idx, kind);
+	g_autofree gchar *version = g_strdup_printf ("1.2.%u", idx % 10);
+
+	fu_device_set_id (device, id);
+	fu_device_set_physical_id (device, id);
+	fu_device_set_name (device, name);
+	fu_device_set_summary (device, "A synthetic device for load testing");
+	fu_device_set_vendor (device, "ACME Corp.");
+	fu_device_set_vendor_id (device, "USB:0x273F");
+	fu_device_set_protocol (device, "com.acme.test");
+	fu_device_add_icon (device, "computer");
+	fu_device_add_flag (device, FWUPD_DEVICE_FLAG_UPDATABLE);
+	fu_device_add_flag (device, FWUPD_DEVICE_FLAG_CAN_VERIFY);
+	fu_device_set_version_format (device, FWUPD_VERSION_FORMAT_TRIPLET);
+	fu_device_set_version (device, version);
+	fu_device_set_version_lowest (device, "1.0.0");
+
+	/* like real hardware, one GUID for each instance ID */
+	for (guint j = 0; j < 4; j++) {
+		g_autofree gchar *guid = fu_plugin_test_scale_guid (kind + j, idx);
+		fu_device_add_guid (device, guid);
+	}
+	return device;
+}
+
+/* each parent has one child, and one child that uses the parent as a proxy */
+static void
+fu_plugin_test_coldplug_scale (FuPlugin *plugin, guint cnt)
+{
+	for (guint i = 0; i < cnt; i++) {
+		g_autoptr(FuDevice) parent = NULL;
+		g_autoptr(FuDevice) child = NULL;
+		g_autoptr(FuDevice) proxied = NULL;
+
+		parent = fu_plugin_test_scale_device_new (i, 0x00, "Scale Dock");
+		fu_plugin_device_add (plugin, parent);
+
+		child = fu_plugin_test_scale_device_new (i, 0x10, "Scale Dock Controller");
+		fu_device_add_child (parent, child);
+		fu_plugin_device_add (plugin, child);
+
+		proxied = fu_plugin_test_scale_device_new (i, 0x20, "Scale Dock Hub");
+		fu_device_add_child (parent, proxied);
+		fu_device_set_proxy (proxied, parent);
+		fu_plugin_device_add (plugin, proxied);
+	}
+}
+
 gboolean
 fu_plugin_coldplug (FuPlugin *plugin, GError **error)
 {
+	guint scale = fu_plugin_test_get_scale (plugin);
 	g_autoptr(FuDevice) device = NULL;
+
+	/* synthetic devices for load testing */
+	if (scale > 0) {
+		g_debug ("adding %u synthetic devices", scale * 3);
+		fu_plugin_test_coldplug_scale (plugin, scale);
+		return TRUE;
+	}
+
 	device = fu_device_new ();
 	fu_device_set_id (device, "FakeDevice");
 	fu_device_add_guid (device, "b585990a-003e-5270-89d5-3705a17f9a43");
@@ -21,6 +21,10 @@
 #include "fu-util-common.h"
 #include "fwupd-device-private.h"
 #include "fwupd-enums-private.h"
+#include "fwupd-remote-private.h"
+
+/* number of history entries requested from the daemon at once */
+#define FU_AGENT_HISTORY_PAGE_SIZE		64
 
 struct FuUtilPrivate {
 	GCancellable		*cancellable;
@@ -198,6 +202,353 @@ fu_util_get_updates (FuUtilPrivate *priv, gchar **values, GError **error)
 	return TRUE;
 }
 
+typedef struct {
+	GMainLoop		*loop;
+	GPtrArray		*devices;
+	GPtrArray		*remotes;
+	GError			*error;
+	guint			 pending;
+} FuUtilStatusHelper;
+
+static void
+fu_util_status_helper_done (FuUtilStatusHelper *helper, GError *error)
+{
+	if (error != NULL && helper->error == NULL)
+		helper->error = g_error_copy (error);
+	if (--helper->pending == 0)
+		g_main_loop_quit (helper->loop);
+}
+
+static void
+fu_util_get_status_devices_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	FuUtilStatusHelper *helper = (FuUtilStatusHelper *) user_data;
+	g_autoptr(GError) error_local = NULL;
+
+	helper->devices = fwupd_client_get_devices_finish (FWUPD_CLIENT (source),
+							   res, &error_local);
+	if (helper->devices == NULL &&
+	    g_error_matches (error_local, FWUPD_ERROR, FWUPD_ERROR_NOTHING_TO_DO)) {
+		helper->devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+		g_clear_error (&error_local);
+	}
+	fu_util_status_helper_done (helper, error_local);
+}
+
+static void
+fu_util_get_status_remotes_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	FuUtilStatusHelper *helper = (FuUtilStatusHelper *) user_data;
+	g_autoptr(GError) error_local = NULL;
+
+	helper->remotes = fwupd_client_get_remotes_finish (FWUPD_CLIENT (source),
+							   res, &error_local);
+	if (helper->remotes == NULL &&
+	    g_error_matches (error_local, FWUPD_ERROR, FWUPD_ERROR_NOTHING_TO_DO)) {
+		helper->remotes = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+		g_clear_error (&error_local);
+	}
+	fu_util_status_helper_done (helper, error_local);
+}
+
+/* json-glib can only serialize a complete tree, so each member and array
+ * element is converted on its own and written as soon as it is ready */
+static gboolean
+fu_util_print_json_node (JsonNode *json_root, GError **error)
+{
+	g_autofree gchar *data = NULL;
+	g_autoptr(JsonGenerator) json_generator = json_generator_new ();
+
+	json_generator_set_root (json_generator, json_root);
+	data = json_generator_to_data (json_generator, NULL);
+	if (data == NULL) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INTERNAL,
+				     "Failed to convert to JSON string");
+		return FALSE;
+	}
+	g_print ("%s", data);
+	return TRUE;
+}
+
+static gboolean
+fu_util_print_json_member (gboolean *first, const gchar *name,
+			   JsonNode *json_node, GError **error)
+{
+	g_print ("%s\n  \"%s\" : ", *first ? "" : ",", name);
+	*first = FALSE;
+	return fu_util_print_json_node (json_node, error);
+}
+
+static void
+fu_util_print_json_array_begin (gboolean *first, const gchar *name)
+{
+	g_print ("%s\n  \"%s\" : [", *first ? "" : ",", name);
+	*first = FALSE;
+}
+
+static gboolean
+fu_util_print_json_element (gboolean *first, JsonBuilder *builder, GError **error)
+{
+	g_autoptr(JsonNode) json_root = json_builder_get_root (builder);
+	g_print ("%s\n    ", *first ? "" : ",");
+	*first = FALSE;
+	return fu_util_print_json_node (json_root, error);
+}
+
+static void
+fu_util_print_json_array_end (void)
+{
+	g_print ("\n  ]");
+}
+
+static gboolean
+fu_util_print_status_metadata (FuUtilPrivate *priv, gboolean *first, GError **error)
+{
+	g_auto(GStrv) checksums = NULL;
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(JsonNode) json_tainted = json_node_new (JSON_NODE_VALUE);
+	struct {
+		const gchar *name;
+		const gchar *value;
+	} items[] = {
+		{ "DaemonVersion",	fwupd_client_get_daemon_version (priv->client) },
+		{ "HostProduct",	fwupd_client_get_host_product (priv->client) },
+		{ "HostMachineId",	fwupd_client_get_host_machine_id (priv->client) },
+		{ NULL,			NULL }
+	};
+
+	for (guint i = 0; items[i].name != NULL; i++) {
+		g_autoptr(JsonNode) json_node = NULL;
+		if (items[i].value == NULL)
+			continue;
+		json_node = json_node_new (JSON_NODE_VALUE);
+		json_node_set_string (json_node, items[i].value);
+		if (!fu_util_print_json_member (first, items[i].name, json_node, error))
+			return FALSE;
+	}
+	json_node_set_boolean (json_tainted, fwupd_client_get_tainted (priv->client));
+	if (!fu_util_print_json_member (first, "Tainted", json_tainted, error))
+		return FALSE;
+
+	/* this needs a trusted client, so is not fatal */
+	checksums = fwupd_client_get_approved_firmware (priv->client,
+							priv->cancellable,
+							&error_local);
+	if (checksums == NULL) {
+		g_debug ("no approved firmware: %s", error_local->message);
+	} else {
+		g_autoptr(JsonBuilder) builder = json_builder_new ();
+		g_autoptr(JsonNode) json_root = NULL;
+		json_builder_begin_array (builder);
+		for (guint i = 0; checksums[i] != NULL; i++)
+			json_builder_add_string_value (builder, checksums[i]);
+		json_builder_end_array (builder);
+		json_root = json_builder_get_root (builder);
+		if (!fu_util_print_json_member (first, "ApprovedFirmware", json_root, error))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/* the upgrades for all supported devices in one go; a device that fails is
+ * printed without any releases */
+static GHashTable *
+fu_util_get_status_upgrades (FuUtilPrivate *priv, GPtrArray *devices, GError **error)
+{
+	g_autoptr(GPtrArray) device_ids = g_ptr_array_new ();
+
+	for (guint i = 0; i < devices->len; i++) {
+		FwupdDevice *dev = g_ptr_array_index (devices, i);
+		if (!fwupd_device_has_flag (dev, FWUPD_DEVICE_FLAG_SUPPORTED))
+			continue;
+		g_ptr_array_add (device_ids, (gpointer) fwupd_device_get_id (dev));
+	}
+	g_ptr_array_add (device_ids, NULL);
+	return fwupd_client_get_upgrades_batch (priv->client,
+						(gchar **) device_ids->pdata,
+						priv->cancellable,
+						error);
+}
+
+static gboolean
+fu_util_print_status_devices (FuUtilPrivate *priv, GPtrArray *devices,
+			      GHashTable *upgrades, gboolean *first, GError **error)
+{
+	gboolean first_element = TRUE;
+
+	fu_util_print_json_array_begin (first, "Devices");
+	for (guint i = 0; i < devices->len; i++) {
+		FwupdDevice *dev = g_ptr_array_index (devices, i);
+		GPtrArray *rels = g_hash_table_lookup (upgrades, fwupd_device_get_id (dev));
+		g_autoptr(JsonBuilder) builder = json_builder_new ();
+
+		for (guint j = 0; rels != NULL && j < rels->len; j++) {
+			FwupdRelease *rel = g_ptr_array_index (rels, j);
+			fwupd_device_add_release (dev, rel);
+		}
+		json_builder_begin_object (builder);
+		fwupd_device_to_json (dev, builder);
+		json_builder_end_object (builder);
+		if (!fu_util_print_json_element (&first_element, builder, error))
+			return FALSE;
+	}
+	fu_util_print_json_array_end ();
+	return TRUE;
+}
+
+/* gets the first page of history, or all of it from a daemon older than
+ * GetHistoryFiltered, so that nothing is printed if neither works */
+static GPtrArray *
+fu_util_get_status_history_first (FuUtilPrivate *priv, gboolean *paged, GError **error)
+{
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GError) error_fallback = NULL;
+	g_autoptr(GPtrArray) devices = NULL;
+
+	*paged = TRUE;
+	devices = fwupd_client_get_history_full (priv->client, NULL,
+						 FWUPD_UPDATE_STATE_UNKNOWN,
+						 0, 0, FU_AGENT_HISTORY_PAGE_SIZE,
+						 priv->cancellable,
+						 &error_local);
+	if (devices != NULL)
+		return g_steal_pointer (&devices);
+	if (g_error_matches (error_local, FWUPD_ERROR, FWUPD_ERROR_NOTHING_TO_DO))
+		return g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	if (g_cancellable_is_cancelled (priv->cancellable)) {
+		g_propagate_error (error, g_steal_pointer (&error_local));
+		return NULL;
+	}
+
+	/* older daemon */
+	g_debug ("failed to get history page, trying all: %s", error_local->message);
+	*paged = FALSE;
+	devices = fwupd_client_get_history (priv->client, priv->cancellable, &error_fallback);
+	if (devices != NULL)
+		return g_steal_pointer (&devices);
+	if (g_error_matches (error_fallback, FWUPD_ERROR, FWUPD_ERROR_NOTHING_TO_DO))
+		return g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	g_propagate_error (error, g_steal_pointer (&error_fallback));
+	return NULL;
+}
+
+static gboolean
+fu_util_print_status_history (FuUtilPrivate *priv, GPtrArray *devices_first,
+			      gboolean paged, gboolean *first, GError **error)
+{
+	gboolean first_element = TRUE;
+	g_autoptr(GPtrArray) devices = g_ptr_array_ref (devices_first);
+
+	/* fetch one page at a time so large histories are never held in
+	 * memory, writing each entry as soon as it arrives */
+	fu_util_print_json_array_begin (first, "History");
+	for (guint offset = 0;; offset += FU_AGENT_HISTORY_PAGE_SIZE) {
+		g_autoptr(GError) error_local = NULL;
+
+		if (offset > 0) {
+			g_ptr_array_unref (devices);
+			devices = fwupd_client_get_history_full (priv->client, NULL,
+								 FWUPD_UPDATE_STATE_UNKNOWN,
+								 0, offset,
+								 FU_AGENT_HISTORY_PAGE_SIZE,
+								 priv->cancellable,
+								 &error_local);
+			if (devices == NULL) {
+				if (g_error_matches (error_local, FWUPD_ERROR, FWUPD_ERROR_NOTHING_TO_DO))
+					break;
+				g_propagate_error (error, g_steal_pointer (&error_local));
+				return FALSE;
+			}
+		}
+		for (guint i = 0; i < devices->len; i++) {
+			FwupdDevice *dev = g_ptr_array_index (devices, i);
+			g_autoptr(JsonBuilder) builder = json_builder_new ();
+			json_builder_begin_object (builder);
+			fwupd_device_to_json (dev, builder);
+			json_builder_end_object (builder);
+			if (!fu_util_print_json_element (&first_element, builder, error))
+				return FALSE;
+		}
+		if (!paged || devices->len < FU_AGENT_HISTORY_PAGE_SIZE)
+			break;
+	}
+	fu_util_print_json_array_end ();
+	return TRUE;
+}
+
+static gboolean
+fu_util_get_status (FuUtilPrivate *priv, gchar **values, GError **error)
+{
+	gboolean first = TRUE;
+	gboolean first_element = TRUE;
+	gboolean paged = TRUE;
+	FuUtilStatusHelper helper = { NULL };
+	g_autoptr(GHashTable) upgrades = NULL;
+	g_autoptr(GPtrArray) devices = NULL;
+	g_autoptr(GPtrArray) history = NULL;
+	g_autoptr(GPtrArray) remotes = NULL;
+
+	/* check args */
+	if (g_strv_length (values) != 0) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_ARGS,
+				     "Invalid arguments");
+		return FALSE;
+	}
+
+	/* the daemon properties are needed for the metadata */
+	if (!fwupd_client_connect (priv->client, priv->cancellable, error))
+		return FALSE;
+
+	/* get the devices and remotes at the same time */
+	helper.loop = priv->loop;
+	helper.pending = 2;
+	fwupd_client_get_devices_async (priv->client, priv->cancellable,
+					fu_util_get_status_devices_cb, &helper);
+	fwupd_client_get_remotes_async (priv->client, priv->cancellable,
+					fu_util_get_status_remotes_cb, &helper);
+	g_main_loop_run (priv->loop);
+	devices = helper.devices;
+	remotes = helper.remotes;
+	if (helper.error != NULL) {
+		g_propagate_error (error, helper.error);
+		return FALSE;
+	}
+
+	/* anything that can fail is done before the document is started */
+	upgrades = fu_util_get_status_upgrades (priv, devices, error);
+	if (upgrades == NULL)
+		return FALSE;
+	history = fu_util_get_status_history_first (priv, &paged, error);
+	if (history == NULL)
+		return FALSE;
+
+	/* write the document as it is built */
+	g_print ("{");
+	if (!fu_util_print_status_metadata (priv, &first, error))
+		return FALSE;
+	fu_util_print_json_array_begin (&first, "Remotes");
+	for (guint i = 0; i < remotes->len; i++) {
+		FwupdRemote *remote = g_ptr_array_index (remotes, i);
+		g_autoptr(JsonBuilder) builder = json_builder_new ();
+		json_builder_begin_object (builder);
+		fwupd_remote_to_json (remote, builder);
+		json_builder_end_object (builder);
+		if (!fu_util_print_json_element (&first_element, builder, error))
+			return FALSE;
+	}
+	fu_util_print_json_array_end ();
+	if (!fu_util_print_status_devices (priv, devices, upgrades, &first, error))
+		return FALSE;
+	if (!fu_util_print_status_history (priv, history, paged, &first, error))
+		return FALSE;
+	g_print ("\n}\n");
+	return TRUE;
+}
+
 static void
 fu_util_ignore_cb (const gchar *log_domain, GLogLevelFlags log_level,
 		   const gchar *message, gpointer user_data)
@@ -271,6 +622,11 @@ main (int argc, char *argv[])
 			       /* TRANSLATORS: command description */
 			       _("Gets the list of updates for connected hardware"),
 			       fu_util_get_updates);
+	fu_util_cmd_array_add (cmd_array,
+			       "get-status", NULL,
+			       /* TRANSLATORS: command description */
+			       _("Gets the devices, updates, history and remotes in one document"),
+			       fu_util_get_status);
 
 	/* sort by command name */
 	fu_util_cmd_array_sort (cmd_array);
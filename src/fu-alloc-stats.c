@@ -0,0 +1,394 @@
+/*
+ * Copyright (C) 2020 The fwupd authors
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#define G_LOG_DOMAIN				"FuAllocStats"
+
+#include "config.h"
+
+#include <fwupd.h>
+#include <json-glib/json-glib.h>
+#ifdef HAVE_MALLOC_H
+#include <malloc.h>
+#endif
+
+#include "fu-alloc-stats.h"
+
+/**
+ * SECTION:fu-alloc-stats
+ * @short_description: memory accounting for daemon methods and engine phases
+ *
+ * This object records how much the heap and the resident set size grew during
+ * nested spans, for instance a D-Bus method call or an engine phase, and adds
+ * the results for each category and name. This can show which call path is
+ * responsible when the daemon memory usage grows over time.
+ *
+ * The heap size is the number of bytes allocated using malloc() and not yet
+ * freed, and is only available when using glibc. A span includes the memory
+ * used by any spans nested inside it.
+ *
+ * As the heap size is shared by the whole process, allocations made by other
+ * threads while a span is open are also counted. There is no locking, so only
+ * begin and end spans from the thread running the main loop.
+ *
+ * See also: #FuTrace
+ */
+
+struct _FuAllocStats
+{
+	GObject			 parent_instance;
+	gboolean		 enabled;
+	GHashTable		*items;		/* "category:name":FuAllocStatsItem */
+	GPtrArray		*stack;		/* of FuAllocStatsFrame */
+};
+
+typedef struct {
+	gint64			 heap;		/* bytes */
+	gint64			 rss;		/* bytes */
+	gint64			 rss_peak;	/* bytes */
+} FuAllocStatsSample;
+
+typedef struct {
+	gchar			*category;
+	gchar			*name;
+	FuAllocStatsSample	 begin;
+} FuAllocStatsFrame;
+
+typedef struct {
+	gchar			*category;
+	gchar			*name;
+	guint64			 calls;
+	gint64			 heap;		/* net growth of all calls */
+	gint64			 heap_max;	/* largest growth of one call */
+	gint64			 rss;		/* net growth of all calls */
+	gint64			 rss_peak;	/* growth of the peak */
+} FuAllocStatsItem;
+
+G_DEFINE_TYPE (FuAllocStats, fu_alloc_stats, G_TYPE_OBJECT)
+
+static void
+fu_alloc_stats_frame_free (FuAllocStatsFrame *frame)
+{
+	g_free (frame->category);
+	g_free (frame->name);
+	g_free (frame);
+}
+
+static void
+fu_alloc_stats_item_free (FuAllocStatsItem *item)
+{
+	g_free (item->category);
+	g_free (item->name);
+	g_free (item);
+}
+
+static gint64
+fu_alloc_stats_get_heap (void)
+{
+#if defined(HAVE_MALLINFO2)
+	struct mallinfo2 mi = mallinfo2 ();
+	return (gint64) (mi.uordblks + mi.hblkhd);
+#elif defined(HAVE_MALLINFO)
+	struct mallinfo mi = mallinfo ();
+	return (gint64) ((guint) mi.uordblks + (guint) mi.hblkhd);
+#else
+	return 0;
+#endif
+}
+
+/* values from /proc/self/status are in kB */
+static void
+fu_alloc_stats_get_rss (gint64 *rss, gint64 *rss_peak)
+{
+	g_autofree gchar *buf = NULL;
+	g_auto(GStrv) lines = NULL;
+
+	if (!g_file_get_contents ("/proc/self/status", &buf, NULL, NULL))
+		return;
+	lines = g_strsplit (buf, "\n", -1);
+	for (guint i = 0; lines[i] != NULL; i++) {
+		if (g_str_has_prefix (lines[i], "VmRSS:"))
+			*rss = g_ascii_strtoll (lines[i] + 6, NULL, 10) * 1024;
+		else if (g_str_has_prefix (lines[i], "VmHWM:"))
+			*rss_peak = g_ascii_strtoll (lines[i] + 6, NULL, 10) * 1024;
+	}
+}
+
+/**
+ * fu_alloc_stats_set_enabled:
+ * @self: A #FuAllocStats
+ * @enabled: %TRUE to record spans
+ *
+ * Enables or disables recording. Any results already recorded are kept.
+ **/
+void
+fu_alloc_stats_set_enabled (FuAllocStats *self, gboolean enabled)
+{
+	g_return_if_fail (FU_IS_ALLOC_STATS (self));
+	self->enabled = enabled;
+}
+
+/**
+ * fu_alloc_stats_get_enabled:
+ * @self: A #FuAllocStats
+ *
+ * Gets if spans are being recorded.
+ *
+ * Returns: %TRUE if enabled
+ **/
+gboolean
+fu_alloc_stats_get_enabled (FuAllocStats *self)
+{
+	g_return_val_if_fail (FU_IS_ALLOC_STATS (self), FALSE);
+	return self->enabled;
+}
+
+/**
+ * fu_alloc_stats_begin:
+ * @self: A #FuAllocStats
+ * @category: A category, e.g. `dbus` or `phase`
+ * @name: A name, e.g. `GetDevices`
+ *
+ * Begins a span, which is nested in any span that has not yet ended.
+ **/
+void
+fu_alloc_stats_begin (FuAllocStats *self, const gchar *category, const gchar *name)
+{
+	FuAllocStatsFrame *frame;
+
+	/* fast path */
+	if (!self->enabled)
+		return;
+
+	frame = g_new0 (FuAllocStatsFrame, 1);
+	frame->category = g_strdup (category);
+	frame->name = g_strdup (name);
+	g_ptr_array_add (self->stack, frame);
+
+	/* the heap is sampled last so the bookkeeping above is not counted */
+	fu_alloc_stats_get_rss (&frame->begin.rss, &frame->begin.rss_peak);
+	frame->begin.heap = fu_alloc_stats_get_heap ();
+}
+
+/**
+ * fu_alloc_stats_end:
+ * @self: A #FuAllocStats
+ *
+ * Ends the most recently begun span, and adds the growth to the results.
+ **/
+void
+fu_alloc_stats_end (FuAllocStats *self)
+{
+	FuAllocStatsFrame *frame;
+	FuAllocStatsItem *item;
+	FuAllocStatsSample end = { 0 };
+	g_autofree gchar *key = NULL;
+
+	/* fast path */
+	if (!self->enabled)
+		return;
+	if (self->stack->len == 0) {
+		g_warning ("no allocation span to end");
+		return;
+	}
+
+	/* the heap is sampled first so the bookkeeping below is not counted */
+	end.heap = fu_alloc_stats_get_heap ();
+	fu_alloc_stats_get_rss (&end.rss, &end.rss_peak);
+
+	frame = g_ptr_array_index (self->stack, self->stack->len - 1);
+	key = g_strdup_printf ("%s:%s", frame->category, frame->name);
+	item = g_hash_table_lookup (self->items, key);
+	if (item == NULL) {
+		item = g_new0 (FuAllocStatsItem, 1);
+		item->category = g_strdup (frame->category);
+		item->name = g_strdup (frame->name);
+		g_hash_table_insert (self->items, g_steal_pointer (&key), item);
+	}
+	item->calls++;
+	item->heap += end.heap - frame->begin.heap;
+	item->heap_max = MAX (item->heap_max, end.heap - frame->begin.heap);
+	item->rss += end.rss - frame->begin.rss;
+	item->rss_peak += end.rss_peak - frame->begin.rss_peak;
+	g_ptr_array_remove_index (self->stack, self->stack->len - 1);
+}
+
+/**
+ * fu_alloc_stats_get_size:
+ * @self: A #FuAllocStats
+ *
+ * Gets the number of different spans recorded.
+ *
+ * Returns: integer
+ **/
+guint
+fu_alloc_stats_get_size (FuAllocStats *self)
+{
+	g_return_val_if_fail (FU_IS_ALLOC_STATS (self), 0);
+	return g_hash_table_size (self->items);
+}
+
+static gint
+fu_alloc_stats_item_sort_cb (gconstpointer a, gconstpointer b)
+{
+	FuAllocStatsItem *item1 = *((FuAllocStatsItem **) a);
+	FuAllocStatsItem *item2 = *((FuAllocStatsItem **) b);
+	if (item1->heap > item2->heap)
+		return -1;
+	if (item1->heap < item2->heap)
+		return 1;
+	return g_strcmp0 (item1->name, item2->name);
+}
+
+/* largest net heap growth first */
+static GPtrArray *
+fu_alloc_stats_get_items (FuAllocStats *self)
+{
+	GPtrArray *items = g_ptr_array_new ();
+	GHashTableIter iter;
+	gpointer value;
+
+	g_hash_table_iter_init (&iter, self->items);
+	while (g_hash_table_iter_next (&iter, NULL, &value))
+		g_ptr_array_add (items, value);
+	g_ptr_array_sort (items, fu_alloc_stats_item_sort_cb);
+	return items;
+}
+
+/**
+ * fu_alloc_stats_to_string:
+ * @self: A #FuAllocStats
+ *
+ * Exports the results as a table, with the largest net heap growth first.
+ *
+ * Returns: (transfer full): a string
+ **/
+gchar *
+fu_alloc_stats_to_string (FuAllocStats *self)
+{
+	GString *str = g_string_new (NULL);
+	g_autoptr(GPtrArray) items = NULL;
+
+	g_return_val_if_fail (FU_IS_ALLOC_STATS (self), NULL);
+
+	items = fu_alloc_stats_get_items (self);
+	for (guint i = 0; i < items->len; i++) {
+		FuAllocStatsItem *item = g_ptr_array_index (items, i);
+		g_string_append_printf (str,
+					"%-8s %-28s calls:%-6" G_GUINT64_FORMAT
+					" heap:%+10.1fKiB max:%+10.1fKiB"
+					" rss:%+10.1fKiB peak:%+10.1fKiB\n",
+					item->category, item->name, item->calls,
+					(gdouble) item->heap / 1024.f,
+					(gdouble) item->heap_max / 1024.f,
+					(gdouble) item->rss / 1024.f,
+					(gdouble) item->rss_peak / 1024.f);
+	}
+	return g_string_free (str, FALSE);
+}
+
+/**
+ * fu_alloc_stats_to_json:
+ * @self: A #FuAllocStats
+ * @error: A #GError, or %NULL
+ *
+ * Exports the results as a JSON array, with all sizes in bytes.
+ *
+ * Returns: (transfer full): a JSON string, or %NULL for error
+ **/
+gchar *
+fu_alloc_stats_to_json (FuAllocStats *self, GError **error)
+{
+	g_autofree gchar *data = NULL;
+	g_autoptr(GPtrArray) items = NULL;
+	g_autoptr(JsonBuilder) builder = json_builder_new ();
+	g_autoptr(JsonGenerator) json_generator = NULL;
+	g_autoptr(JsonNode) json_root = NULL;
+
+	g_return_val_if_fail (FU_IS_ALLOC_STATS (self), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	items = fu_alloc_stats_get_items (self);
+	json_builder_begin_object (builder);
+	json_builder_set_member_name (builder, "AllocStats");
+	json_builder_begin_array (builder);
+	for (guint i = 0; i < items->len; i++) {
+		FuAllocStatsItem *item = g_ptr_array_index (items, i);
+		json_builder_begin_object (builder);
+		json_builder_set_member_name (builder, "Category");
+		json_builder_add_string_value (builder, item->category);
+		json_builder_set_member_name (builder, "Name");
+		json_builder_add_string_value (builder, item->name);
+		json_builder_set_member_name (builder, "Calls");
+		json_builder_add_int_value (builder, item->calls);
+		json_builder_set_member_name (builder, "Heap");
+		json_builder_add_int_value (builder, item->heap);
+		json_builder_set_member_name (builder, "HeapMax");
+		json_builder_add_int_value (builder, item->heap_max);
+		json_builder_set_member_name (builder, "Rss");
+		json_builder_add_int_value (builder, item->rss);
+		json_builder_set_member_name (builder, "RssPeak");
+		json_builder_add_int_value (builder, item->rss_peak);
+		json_builder_end_object (builder);
+	}
+	json_builder_end_array (builder);
+	json_builder_end_object (builder);
+
+	/* export as a string */
+	json_root = json_builder_get_root (builder);
+	json_generator = json_generator_new ();
+	json_generator_set_pretty (json_generator, TRUE);
+	json_generator_set_root (json_generator, json_root);
+	data = json_generator_to_data (json_generator, NULL);
+	if (data == NULL) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INTERNAL,
+				     "Failed to convert allocation stats to JSON");
+		return NULL;
+	}
+	return g_steal_pointer (&data);
+}
+
+static void
+fu_alloc_stats_init (FuAllocStats *self)
+{
+	self->items = g_hash_table_new_full (g_str_hash, g_str_equal,
+					     g_free, (GDestroyNotify) fu_alloc_stats_item_free);
+	self->stack = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_alloc_stats_frame_free);
+}
+
+static void
+fu_alloc_stats_finalize (GObject *object)
+{
+	FuAllocStats *self = FU_ALLOC_STATS (object);
+
+	g_hash_table_unref (self->items);
+	g_ptr_array_unref (self->stack);
+
+	G_OBJECT_CLASS (fu_alloc_stats_parent_class)->finalize (object);
+}
+
+static void
+fu_alloc_stats_class_init (FuAllocStatsClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = fu_alloc_stats_finalize;
+}
+
+/**
+ * fu_alloc_stats_new:
+ *
+ * Creates a new memory accounting object, which is disabled by default.
+ *
+ * Returns: (transfer full): the #FuAllocStats
+ **/
+FuAllocStats *
+fu_alloc_stats_new (void)
+{
+	FuAllocStats *self;
+	self = g_object_new (FU_TYPE_ALLOC_STATS, NULL);
+	return FU_ALLOC_STATS (self);
+}
@@ -0,0 +1,25 @@
+/*
+ * Copyright (C) 2020 The fwupd authors
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#pragma once
+
+#include <glib-object.h>
+
+#define FU_TYPE_ALLOC_STATS (fu_alloc_stats_get_type ())
+G_DECLARE_FINAL_TYPE (FuAllocStats, fu_alloc_stats, FU, ALLOC_STATS, GObject)
+
+FuAllocStats	*fu_alloc_stats_new		(void);
+void		 fu_alloc_stats_set_enabled	(FuAllocStats	*self,
+						 gboolean	 enabled);
+gboolean	 fu_alloc_stats_get_enabled	(FuAllocStats	*self);
+void		 fu_alloc_stats_begin		(FuAllocStats	*self,
+						 const gchar	*category,
+						 const gchar	*name);
+void		 fu_alloc_stats_end		(FuAllocStats	*self);
+guint		 fu_alloc_stats_get_size	(FuAllocStats	*self);
+gchar		*fu_alloc_stats_to_string	(FuAllocStats	*self);
+gchar		*fu_alloc_stats_to_json		(FuAllocStats	*self,
+						 GError		**error);
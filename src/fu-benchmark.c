@@ -0,0 +1,755 @@
+/*
+ * Copyright (C) 2020 The fwupd authors
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#define G_LOG_DOMAIN				"FuBenchmark"
+
+#include "config.h"
+
+#include <fwupd.h>
+#include <json-glib/json-glib.h>
+#include <libgcab.h>
+#include <stdlib.h>
+#include <string.h>
+#include <xmlb.h>
+
+#include "fwupd-device-private.h"
+
+#include "fu-cabinet.h"
+#include "fu-chunk.h"
+#include "fu-common.h"
+#include "fu-common-version.h"
+#include "fu-device-list.h"
+#include "fu-dfu-firmware.h"
+#include "fu-ihex-firmware.h"
+#include "fu-quirks.h"
+#include "fu-srec-firmware.h"
+
+/*
+ * Benchmarks for the code that runs on every daemon startup, metadata refresh
+ * or firmware install. Each benchmark prints the throughput and the number of
+ * heap allocations per iteration, and all the results can be saved as JSON so
+ * that two builds can be compared.
+ *
+ * The allocations are counted by wrapping malloc(), calloc() and realloc()
+ * which is only possible when using glibc.
+ */
+
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__)
+#define FU_BENCHMARK_COUNT_ALLOCS
+
+extern void *__libc_malloc (size_t size);
+extern void *__libc_calloc (size_t nmemb, size_t size);
+extern void *__libc_realloc (void *ptr, size_t size);
+
+static guint64 fu_benchmark_allocs = 0;
+static guint64 fu_benchmark_alloc_bytes = 0;
+
+static inline void
+fu_benchmark_alloc_record (size_t size)
+{
+	__atomic_fetch_add (&fu_benchmark_allocs, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add (&fu_benchmark_alloc_bytes, size, __ATOMIC_RELAXED);
+}
+
+void *
+malloc (size_t size)
+{
+	fu_benchmark_alloc_record (size);
+	return __libc_malloc (size);
+}
+
+void *
+calloc (size_t nmemb, size_t size)
+{
+	fu_benchmark_alloc_record (nmemb * size);
+	return __libc_calloc (nmemb, size);
+}
+
+void *
+realloc (void *ptr, size_t size)
+{
+	fu_benchmark_alloc_record (size);
+	return __libc_realloc (ptr, size);
+}
+#endif
+
+typedef struct {
+	gchar			*id;
+	guint64			 iterations;
+	guint64			 bytes;		/* per iteration, or 0 */
+	gdouble			 elapsed;	/* s */
+	guint64			 allocs;
+	guint64			 alloc_bytes;
+} FuBenchmarkResult;
+
+typedef struct {
+	guint			 scale;
+	gchar			**filters;
+	gchar			*tmpdir;
+	GPtrArray		*results;	/* of FuBenchmarkResult */
+	GTimer			*timer;
+	guint64			 allocs_start;
+	guint64			 alloc_bytes_start;
+} FuBenchmarkPrivate;
+
+typedef gboolean (*FuBenchmarkFunc)		(FuBenchmarkPrivate	*priv,
+						 GError			**error);
+
+static void
+fu_benchmark_result_free (FuBenchmarkResult *result)
+{
+	g_free (result->id);
+	g_free (result);
+}
+
+static void
+fu_benchmark_private_free (FuBenchmarkPrivate *priv)
+{
+	if (priv->tmpdir != NULL) {
+		g_autoptr(GError) error_local = NULL;
+		if (!fu_common_rmtree (priv->tmpdir, &error_local))
+			g_warning ("failed to remove %s: %s", priv->tmpdir, error_local->message);
+	}
+	g_strfreev (priv->filters);
+	g_free (priv->tmpdir);
+	g_ptr_array_unref (priv->results);
+	g_timer_destroy (priv->timer);
+	g_free (priv);
+}
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-function"
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(FuBenchmarkPrivate, fu_benchmark_private_free)
+#pragma clang diagnostic pop
+
+static void
+fu_benchmark_start (FuBenchmarkPrivate *priv)
+{
+#ifdef FU_BENCHMARK_COUNT_ALLOCS
+	priv->allocs_start = __atomic_load_n (&fu_benchmark_allocs, __ATOMIC_RELAXED);
+	priv->alloc_bytes_start = __atomic_load_n (&fu_benchmark_alloc_bytes, __ATOMIC_RELAXED);
+#endif
+	g_timer_start (priv->timer);
+}
+
+static void
+fu_benchmark_stop (FuBenchmarkPrivate *priv,
+		   const gchar *id,
+		   guint64 iterations,
+		   guint64 bytes)
+{
+	FuBenchmarkResult *result = g_new0 (FuBenchmarkResult, 1);
+	g_autoptr(GString) str = g_string_new (NULL);
+
+	result->elapsed = g_timer_elapsed (priv->timer, NULL);
+#ifdef FU_BENCHMARK_COUNT_ALLOCS
+	result->allocs = __atomic_load_n (&fu_benchmark_allocs, __ATOMIC_RELAXED) - priv->allocs_start;
+	result->alloc_bytes = __atomic_load_n (&fu_benchmark_alloc_bytes, __ATOMIC_RELAXED) - priv->alloc_bytes_start;
+#endif
+	result->id = g_strdup (id);
+	result->iterations = MAX (iterations, 1);
+	result->bytes = bytes;
+	g_ptr_array_add (priv->results, result);
+
+	/* print as we go */
+	g_string_append_printf (str, "%-24s %8" G_GUINT64_FORMAT " iter %12.1f op/s",
+				result->id, result->iterations,
+				(gdouble) result->iterations / MAX (result->elapsed, 1e-9));
+	if (result->bytes > 0) {
+		gdouble mbs = (gdouble) (result->bytes * result->iterations) /
+			      (MAX (result->elapsed, 1e-9) * 1024.f * 1024.f);
+		g_string_append_printf (str, " %9.1f MB/s", mbs);
+	} else {
+		g_string_append_printf (str, " %9s     ", "");
+	}
+#ifdef FU_BENCHMARK_COUNT_ALLOCS
+	g_string_append_printf (str, " %10.1f allocs/op %12.1f B/op",
+				(gdouble) result->allocs / result->iterations,
+				(gdouble) result->alloc_bytes / result->iterations);
+#endif
+	g_print ("%s\n", str->str);
+}
+
+static GBytes *
+fu_benchmark_build_payload (gsize sz)
+{
+	guint8 *buf = g_malloc (sz);
+	guint32 seed = 0x12345678;
+
+	/* deterministic, but not very compressible */
+	for (gsize i = 0; i < sz; i++) {
+		seed = seed * 1103515245 + 12345;
+		buf[i] = (guint8) (seed >> 16);
+	}
+	return g_bytes_new_take (buf, sz);
+}
+
+static gboolean
+fu_benchmark_firmware_parse (FuBenchmarkPrivate *priv,
+			     const gchar *id,
+			     GType gtype,
+			     GBytes *blob,
+			     GError **error)
+{
+	guint iterations = 20 * priv->scale;
+
+	fu_benchmark_start (priv);
+	for (guint i = 0; i < iterations; i++) {
+		g_autoptr(FuFirmware) firmware = g_object_new (gtype, NULL);
+		if (!fu_firmware_parse (firmware, blob, FWUPD_INSTALL_FLAG_NONE, error))
+			return FALSE;
+	}
+	fu_benchmark_stop (priv, id, iterations, g_bytes_get_size (blob));
+	return TRUE;
+}
+
+static gboolean
+fu_benchmark_firmware_ihex (FuBenchmarkPrivate *priv, GError **error)
+{
+	g_autoptr(FuFirmware) firmware = fu_ihex_firmware_new ();
+	g_autoptr(FuFirmwareImage) img = NULL;
+	g_autoptr(GBytes) payload = fu_benchmark_build_payload (0x10000 * priv->scale);
+	g_autoptr(GBytes) blob = NULL;
+
+	img = fu_firmware_image_new (payload);
+	fu_firmware_add_image (firmware, img);
+	blob = fu_firmware_write (firmware, error);
+	if (blob == NULL)
+		return FALSE;
+	return fu_benchmark_firmware_parse (priv, "firmware-parse-ihex",
+					    FU_TYPE_IHEX_FIRMWARE, blob, error);
+}
+
+static gboolean
+fu_benchmark_firmware_srec (FuBenchmarkPrivate *priv, GError **error)
+{
+	const guint8 *buf;
+	gsize bufsz = 0;
+	g_autoptr(GBytes) payload = fu_benchmark_build_payload (0x10000 * priv->scale);
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GString) str = g_string_new ("S00600004844521B\n");
+
+	/* there is no srec writer, so use S3 records of 32 bytes */
+	buf = g_bytes_get_data (payload, &bufsz);
+	for (gsize i = 0; i < bufsz; i += 32) {
+		guint8 csum;
+		guint8 len = (guint8) MIN (bufsz - i, 32);
+		guint32 addr = (guint32) i;
+		csum = len + 5;
+		for (guint j = 0; j < 4; j++)
+			csum += (guint8) (addr >> (j * 8));
+		g_string_append_printf (str, "S3%02X%08X", (guint) len + 5, addr);
+		for (guint j = 0; j < len; j++) {
+			g_string_append_printf (str, "%02X", buf[i + j]);
+			csum += buf[i + j];
+		}
+		g_string_append_printf (str, "%02X\n", (guint) (csum ^ 0xff));
+	}
+	g_string_append (str, "S70500000000FA\n");
+	blob = g_bytes_new (str->str, str->len);
+	return fu_benchmark_firmware_parse (priv, "firmware-parse-srec",
+					    FU_TYPE_SREC_FIRMWARE, blob, error);
+}
+
+static gboolean
+fu_benchmark_firmware_dfu (FuBenchmarkPrivate *priv, GError **error)
+{
+	g_autoptr(FuFirmware) firmware = fu_dfu_firmware_new ();
+	g_autoptr(FuFirmwareImage) img = NULL;
+	g_autoptr(GBytes) payload = fu_benchmark_build_payload (0x40000 * priv->scale);
+	g_autoptr(GBytes) blob = NULL;
+
+	img = fu_firmware_image_new (payload);
+	fu_firmware_add_image (firmware, img);
+	blob = fu_firmware_write (firmware, error);
+	if (blob == NULL)
+		return FALSE;
+	return fu_benchmark_firmware_parse (priv, "firmware-parse-dfu",
+					    FU_TYPE_DFU_FIRMWARE, blob, error);
+}
+
+static gboolean
+fu_benchmark_chunk_array (FuBenchmarkPrivate *priv, GError **error)
+{
+	const guint8 *buf;
+	gsize bufsz = 0;
+	guint iterations = 50 * priv->scale;
+	g_autoptr(GBytes) payload = fu_benchmark_build_payload (0x100000);
+
+	buf = g_bytes_get_data (payload, &bufsz);
+	fu_benchmark_start (priv);
+	for (guint i = 0; i < iterations; i++) {
+		g_autoptr(GPtrArray) chunks = fu_chunk_array_new (buf, bufsz, 0x0, 0x400, 64);
+		if (chunks->len == 0) {
+			g_set_error_literal (error,
+					     FWUPD_ERROR,
+					     FWUPD_ERROR_INTERNAL,
+					     "no chunks");
+			return FALSE;
+		}
+	}
+	fu_benchmark_stop (priv, "chunk-array-new", iterations, bufsz);
+	return TRUE;
+}
+
+static gboolean
+fu_benchmark_quirks (FuBenchmarkPrivate *priv, GError **error)
+{
+	guint cnt = 1000 * priv->scale;
+	guint iterations = 10000 * priv->scale;
+	g_autofree gchar *fn = NULL;
+	g_autoptr(FuQuirks) quirks = NULL;
+	g_autoptr(GString) str = g_string_new (NULL);
+
+	/* generate a large quirk file */
+	for (guint i = 0; i < cnt; i++) {
+		g_string_append_printf (str,
+					"[DeviceInstanceId=USB\\VID_273F&PID_%04X]\n"
+					"Plugin = bench\n"
+					"Name = Benchmark Device %u\n"
+					"Flags = updatable,internal\n\n",
+					i, i);
+	}
+	fn = g_build_filename (priv->tmpdir, "quirks.d", "bench.quirk", NULL);
+	if (!fu_common_mkdir_parent (fn, error))
+		return FALSE;
+	if (!g_file_set_contents (fn, str->str, str->len, error))
+		return FALSE;
+
+	/* build the silo, which is cached for the next load */
+	fu_benchmark_start (priv);
+	quirks = fu_quirks_new ();
+	if (!fu_quirks_load (quirks, FU_QUIRKS_LOAD_FLAG_NONE, error))
+		return FALSE;
+	fu_benchmark_stop (priv, "quirks-load", 1, str->len);
+
+	/* lookup */
+	fu_benchmark_start (priv);
+	for (guint i = 0; i < iterations; i++) {
+		g_autofree gchar *group = NULL;
+		group = g_strdup_printf ("DeviceInstanceId=USB\\VID_273F&PID_%04X", i % cnt);
+		if (fu_quirks_lookup_by_id (quirks, group, "Name") == NULL) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_NOT_FOUND,
+				     "no quirk for %s",
+				     group);
+			return FALSE;
+		}
+	}
+	fu_benchmark_stop (priv, "quirks-lookup", iterations, 0);
+	return TRUE;
+}
+
+static gboolean
+fu_benchmark_vercmp (FuBenchmarkPrivate *priv, GError **error)
+{
+	guint iterations = 100000 * priv->scale;
+	gint rc = 0;
+	struct {
+		const gchar *a;
+		const gchar *b;
+		FwupdVersionFormat fmt;
+	} data[] = {
+		{ "1.2.3",		"1.2.4",		FWUPD_VERSION_FORMAT_TRIPLET },
+		{ "1.2.3",		"1.2.3",		FWUPD_VERSION_FORMAT_TRIPLET },
+		{ "0x00010203",		"1.2.4",		FWUPD_VERSION_FORMAT_UNKNOWN },
+		{ "1.2.3.4",		"1.2.3.5",		FWUPD_VERSION_FORMAT_QUAD },
+		{ "001.002.003",	"1.2.3",		FWUPD_VERSION_FORMAT_UNKNOWN },
+		{ "1.2.3~rc1",		"1.2.3",		FWUPD_VERSION_FORMAT_UNKNOWN },
+		{ "1.2.3a",		"1.2.3b",		FWUPD_VERSION_FORMAT_UNKNOWN },
+		{ "10.0.19041.1",	"10.0.18363.900",	FWUPD_VERSION_FORMAT_UNKNOWN },
+	};
+
+	fu_benchmark_start (priv);
+	for (guint i = 0; i < iterations; i++) {
+		guint idx = i % G_N_ELEMENTS (data);
+		rc += fu_common_vercmp_full (data[idx].a, data[idx].b, data[idx].fmt);
+	}
+	fu_benchmark_stop (priv, "vercmp", iterations, 0);
+	g_debug ("vercmp checksum: %i", rc);
+	return TRUE;
+}
+
+/* the same comparisons as above, but using keys built from the strings */
+static gboolean
+fu_benchmark_version_key (FuBenchmarkPrivate *priv, GError **error)
+{
+	guint iterations = 100000 * priv->scale;
+	gint rc = 0;
+	struct {
+		const gchar *a;
+		const gchar *b;
+		FwupdVersionFormat fmt;
+	} data[] = {
+		{ "1.2.3",		"1.2.4",		FWUPD_VERSION_FORMAT_TRIPLET },
+		{ "1.2.3",		"1.2.3",		FWUPD_VERSION_FORMAT_TRIPLET },
+		{ "1.2.3.4",		"1.2.3.5",		FWUPD_VERSION_FORMAT_QUAD },
+		{ "001.002.003",	"1.2.3",		FWUPD_VERSION_FORMAT_UNKNOWN },
+		{ "10.0.19041.1",	"10.0.18363.900",	FWUPD_VERSION_FORMAT_UNKNOWN },
+	};
+
+	fu_benchmark_start (priv);
+	for (guint i = 0; i < iterations; i++) {
+		guint idx = i % G_N_ELEMENTS (data);
+		guint64 key_a = fu_common_version_to_key (data[idx].a, data[idx].fmt);
+		guint64 key_b = fu_common_version_to_key (data[idx].b, data[idx].fmt);
+		rc += (key_a > key_b) - (key_a < key_b);
+	}
+	fu_benchmark_stop (priv, "version-key", iterations, 0);
+	g_debug ("version-key checksum: %i", rc);
+	return TRUE;
+}
+
+static GBytes *
+fu_benchmark_build_cabinet (guint cnt, gsize payloadsz, GError **error)
+{
+	g_autoptr(GBytes) payload = fu_benchmark_build_payload (payloadsz);
+	g_autoptr(GCabCabinet) cabinet = gcab_cabinet_new ();
+	g_autoptr(GCabFolder) cabfolder = gcab_folder_new (GCAB_COMPRESSION_NONE);
+	g_autoptr(GOutputStream) op = NULL;
+
+	if (!gcab_cabinet_add_folder (cabinet, cabfolder, error))
+		return NULL;
+	for (guint i = 0; i < cnt; i++) {
+		g_autofree gchar *fn_bin = g_strdup_printf ("firmware%04u.bin", i);
+		g_autofree gchar *fn_xml = g_strdup_printf ("firmware%04u.metainfo.xml", i);
+		g_autofree gchar *guid = NULL;
+		g_autofree gchar *xml = NULL;
+		g_autofree gchar *tmp = g_strdup_printf ("bench-%u", i);
+		g_autoptr(GBytes) blob_xml = NULL;
+		g_autoptr(GCabFile) cabfile_bin = NULL;
+		g_autoptr(GCabFile) cabfile_xml = NULL;
+
+		guid = fwupd_guid_hash_string (tmp);
+		xml = g_strdup_printf ("<component type=\"firmware\">\n"
+				       "  <id>org.fwupd.benchmark.device%04u.firmware</id>\n"
+				       "  <name>Benchmark</name>\n"
+				       "  <provides>\n"
+				       "    <firmware type=\"flashed\">%s</firmware>\n"
+				       "  </provides>\n"
+				       "  <releases>\n"
+				       "    <release version=\"1.2.3\" date=\"2020-01-01\">\n"
+				       "      <checksum filename=\"%s\" target=\"content\"/>\n"
+				       "      <description><p>Fixed things</p></description>\n"
+				       "    </release>\n"
+				       "  </releases>\n"
+				       "</component>\n",
+				       i, guid, fn_bin);
+		blob_xml = g_bytes_new (xml, strlen (xml));
+		cabfile_xml = gcab_file_new_with_bytes (fn_xml, blob_xml);
+		if (!gcab_folder_add_file (cabfolder, cabfile_xml, FALSE, NULL, error))
+			return NULL;
+		cabfile_bin = gcab_file_new_with_bytes (fn_bin, payload);
+		if (!gcab_folder_add_file (cabfolder, cabfile_bin, FALSE, NULL, error))
+			return NULL;
+	}
+	op = g_memory_output_stream_new_resizable ();
+	if (!gcab_cabinet_write_simple (cabinet, op, NULL, NULL, NULL, error))
+		return NULL;
+	if (!g_output_stream_close (op, NULL, error))
+		return NULL;
+	return g_memory_output_stream_steal_as_bytes (G_MEMORY_OUTPUT_STREAM (op));
+}
+
+static gboolean
+fu_benchmark_cabinet (FuBenchmarkPrivate *priv, GError **error)
+{
+	guint iterations = 10;
+	g_autoptr(GBytes) blob = NULL;
+
+	blob = fu_benchmark_build_cabinet (20 * priv->scale, 0x10000, error);
+	if (blob == NULL)
+		return FALSE;
+	fu_benchmark_start (priv);
+	for (guint i = 0; i < iterations; i++) {
+		g_autoptr(FuCabinet) cabinet = fu_cabinet_new ();
+		fu_cabinet_set_size_max (cabinet, G_MAXUINT32);
+		if (!fu_cabinet_parse (cabinet, blob, FU_CABINET_PARSE_FLAG_NONE, error))
+			return FALSE;
+	}
+	fu_benchmark_stop (priv, "cabinet-parse", iterations, g_bytes_get_size (blob));
+	return TRUE;
+}
+
+static gboolean
+fu_benchmark_metadata (FuBenchmarkPrivate *priv, GError **error)
+{
+	guint cnt = 2000 * priv->scale;
+	guint iterations = 5;
+	g_autofree gchar *guid_last = NULL;
+	g_autoptr(GString) str = g_string_new ("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+					       "<components origin=\"lvfs\" version=\"0.9\">\n");
+
+	/* generate a large AppStream file */
+	for (guint i = 0; i < cnt; i++) {
+		g_autofree gchar *tmp = g_strdup_printf ("bench-%u", i);
+		g_free (guid_last);
+		guid_last = fwupd_guid_hash_string (tmp);
+		g_string_append_printf (str,
+					"  <component type=\"firmware\">\n"
+					"    <id>org.fwupd.benchmark.device%05u.firmware</id>\n"
+					"    <name>Benchmark Device %u</name>\n"
+					"    <summary>Firmware for the benchmark device</summary>\n"
+					"    <provides>\n"
+					"      <firmware type=\"flashed\">%s</firmware>\n"
+					"    </provides>\n"
+					"    <releases>\n"
+					"      <release version=\"1.2.%u\" timestamp=\"1577836800\" urgency=\"medium\">\n"
+					"        <location>https://fwupd.org/downloads/%05u.cab</location>\n"
+					"        <checksum type=\"sha1\" target=\"container\">%040u</checksum>\n"
+					"        <description><p>This release fixes things.</p></description>\n"
+					"        <size type=\"installed\">65536</size>\n"
+					"      </release>\n"
+					"    </releases>\n"
+					"    <custom>\n"
+					"      <value key=\"LVFS::VersionFormat\">triplet</value>\n"
+					"    </custom>\n"
+					"  </component>\n",
+					i, i, guid_last, i, i, i);
+	}
+	g_string_append (str, "</components>\n");
+
+	fu_benchmark_start (priv);
+	for (guint i = 0; i < iterations; i++) {
+		g_autofree gchar *xpath = NULL;
+		g_autoptr(XbBuilder) builder = xb_builder_new ();
+		g_autoptr(XbBuilderSource) source = xb_builder_source_new ();
+		g_autoptr(XbNode) component = NULL;
+		g_autoptr(XbSilo) silo = NULL;
+
+		if (!xb_builder_source_load_xml (source, str->str,
+						 XB_BUILDER_SOURCE_FLAG_NONE,
+						 error))
+			return FALSE;
+		xb_builder_import_source (builder, source);
+		silo = xb_builder_compile (builder, XB_BUILDER_COMPILE_FLAG_NONE, NULL, error);
+		if (silo == NULL)
+			return FALSE;
+		xpath = g_strdup_printf ("components/component/provides/"
+					 "firmware[@type='flashed'][text()='%s']/../..",
+					 guid_last);
+		component = xb_silo_query_first (silo, xpath, error);
+		if (component == NULL)
+			return FALSE;
+	}
+	fu_benchmark_stop (priv, "metadata-load", iterations, str->len);
+	return TRUE;
+}
+
+static gboolean
+fu_benchmark_device_list (FuBenchmarkPrivate *priv, GError **error)
+{
+	guint cnt = 500 * priv->scale;
+	g_autoptr(FuDeviceList) device_list = fu_device_list_new ();
+	g_autoptr(GPtrArray) devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+
+	for (guint i = 0; i < cnt; i++) {
+		g_autofree gchar *id = g_strdup_printf ("bench-%u", i);
+		g_autofree gchar *guid = fwupd_guid_hash_string (id);
+		FuDevice *device = fu_device_new ();
+		fu_device_set_id (device, id);
+		fu_device_set_name (device, "Benchmark Device");
+		fu_device_add_guid (device, guid);
+		g_ptr_array_add (devices, device);
+	}
+
+	/* add */
+	fu_benchmark_start (priv);
+	for (guint i = 0; i < devices->len; i++)
+		fu_device_list_add (device_list, g_ptr_array_index (devices, i));
+	fu_benchmark_stop (priv, "device-list-add", devices->len, 0);
+
+	/* find by ID and by GUID */
+	fu_benchmark_start (priv);
+	for (guint i = 0; i < devices->len; i++) {
+		FuDevice *device = g_ptr_array_index (devices, i);
+		g_autoptr(FuDevice) device1 = NULL;
+		g_autoptr(FuDevice) device2 = NULL;
+		device1 = fu_device_list_get_by_id (device_list, fu_device_get_id (device), error);
+		if (device1 == NULL)
+			return FALSE;
+		device2 = fu_device_list_get_by_guid (device_list, fu_device_get_guid_default (device), error);
+		if (device2 == NULL)
+			return FALSE;
+	}
+	fu_benchmark_stop (priv, "device-list-find", devices->len, 0);
+	return TRUE;
+}
+
+static gboolean
+fu_benchmark_device_variant (FuBenchmarkPrivate *priv, GError **error)
+{
+	guint iterations = 10000 * priv->scale;
+	g_autoptr(FwupdDevice) device = fwupd_device_new ();
+
+	fwupd_device_set_id (device, "da39a3ee5e6b4b0d3255bfef95601890afd80709");
+	fwupd_device_set_name (device, "Benchmark Device");
+	fwupd_device_set_vendor (device, "ACME");
+	fwupd_device_set_vendor_id (device, "USB:0x273F");
+	fwupd_device_set_version (device, "1.2.3");
+	fwupd_device_set_version_lowest (device, "1.0.0");
+	fwupd_device_set_version_bootloader (device, "0.1.2");
+	fwupd_device_set_plugin (device, "bench");
+	fwupd_device_set_summary (device, "A device for benchmarking");
+	fwupd_device_add_flag (device, FWUPD_DEVICE_FLAG_UPDATABLE);
+	fwupd_device_add_flag (device, FWUPD_DEVICE_FLAG_INTERNAL);
+	fwupd_device_add_icon (device, "computer");
+	for (guint i = 0; i < 8; i++) {
+		g_autofree gchar *tmp = g_strdup_printf ("bench-%u", i);
+		g_autofree gchar *guid = fwupd_guid_hash_string (tmp);
+		fwupd_device_add_guid (device, guid);
+	}
+
+	fu_benchmark_start (priv);
+	for (guint i = 0; i < iterations; i++) {
+		g_autoptr(GVariant) val = g_variant_ref_sink (fwupd_device_to_variant (device));
+		g_autoptr(FwupdDevice) device2 = fwupd_device_from_variant (val);
+		if (device2 == NULL) {
+			g_set_error_literal (error,
+					     FWUPD_ERROR,
+					     FWUPD_ERROR_INTERNAL,
+					     "failed to deserialize device");
+			return FALSE;
+		}
+	}
+	fu_benchmark_stop (priv, "device-variant-roundtrip", iterations, 0);
+	return TRUE;
+}
+
+static gboolean
+fu_benchmark_save_json (FuBenchmarkPrivate *priv, const gchar *filename, GError **error)
+{
+	g_autofree gchar *data = NULL;
+	g_autoptr(JsonBuilder) builder = json_builder_new ();
+	g_autoptr(JsonGenerator) json_generator = NULL;
+	g_autoptr(JsonNode) json_root = NULL;
+
+	json_builder_begin_object (builder);
+	json_builder_set_member_name (builder, "Scale");
+	json_builder_add_int_value (builder, priv->scale);
+	json_builder_set_member_name (builder, "Benchmarks");
+	json_builder_begin_array (builder);
+	for (guint i = 0; i < priv->results->len; i++) {
+		FuBenchmarkResult *result = g_ptr_array_index (priv->results, i);
+		json_builder_begin_object (builder);
+		json_builder_set_member_name (builder, "Id");
+		json_builder_add_string_value (builder, result->id);
+		json_builder_set_member_name (builder, "Iterations");
+		json_builder_add_int_value (builder, result->iterations);
+		json_builder_set_member_name (builder, "Elapsed");
+		json_builder_add_double_value (builder, result->elapsed);
+		json_builder_set_member_name (builder, "Bytes");
+		json_builder_add_int_value (builder, result->bytes);
+#ifdef FU_BENCHMARK_COUNT_ALLOCS
+		json_builder_set_member_name (builder, "Allocs");
+		json_builder_add_int_value (builder, result->allocs);
+		json_builder_set_member_name (builder, "AllocBytes");
+		json_builder_add_int_value (builder, result->alloc_bytes);
+#endif
+		json_builder_end_object (builder);
+	}
+	json_builder_end_array (builder);
+	json_builder_end_object (builder);
+
+	json_root = json_builder_get_root (builder);
+	json_generator = json_generator_new ();
+	json_generator_set_pretty (json_generator, TRUE);
+	json_generator_set_root (json_generator, json_root);
+	data = json_generator_to_data (json_generator, NULL);
+	return g_file_set_contents (filename, data, -1, error);
+}
+
+static gboolean
+fu_benchmark_match (FuBenchmarkPrivate *priv, const gchar *id)
+{
+	if (priv->filters == NULL)
+		return TRUE;
+	for (guint i = 0; priv->filters[i] != NULL; i++) {
+		if (g_strstr_len (id, -1, priv->filters[i]) != NULL)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+int
+main (int argc, char *argv[])
+{
+	gint scale = 1;
+	g_autofree gchar *json_filename = NULL;
+	g_autoptr(FuBenchmarkPrivate) priv = g_new0 (FuBenchmarkPrivate, 1);
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GOptionContext) context = NULL;
+	struct {
+		const gchar *id;
+		FuBenchmarkFunc func;
+	} benchmarks[] = {
+		{ "firmware-parse-ihex",	fu_benchmark_firmware_ihex },
+		{ "firmware-parse-srec",	fu_benchmark_firmware_srec },
+		{ "firmware-parse-dfu",		fu_benchmark_firmware_dfu },
+		{ "chunk-array",		fu_benchmark_chunk_array },
+		{ "quirks",			fu_benchmark_quirks },
+		{ "vercmp",			fu_benchmark_vercmp },
+		{ "version-key",		fu_benchmark_version_key },
+		{ "cabinet-parse",		fu_benchmark_cabinet },
+		{ "metadata-load",		fu_benchmark_metadata },
+		{ "device-list",		fu_benchmark_device_list },
+		{ "device-variant",		fu_benchmark_device_variant },
+		{ NULL,				NULL }
+	};
+	const GOptionEntry options[] = {
+		{ "scale", '\0', 0, G_OPTION_ARG_INT, &scale,
+			"Multiply the size of the generated data", "N" },
+		{ "json", '\0', 0, G_OPTION_ARG_FILENAME, &json_filename,
+			"Save the results as JSON", "FILE" },
+		{ G_OPTION_REMAINING, '\0', 0, G_OPTION_ARG_STRING_ARRAY, &priv->filters,
+			"Only run benchmarks matching", "ID" },
+		{ NULL}
+	};
+
+	priv->results = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_benchmark_result_free);
+	priv->timer = g_timer_new ();
+	context = g_option_context_new (NULL);
+	g_option_context_set_summary (context, "Benchmark the firmware update hot paths");
+	g_option_context_add_main_entries (context, options, NULL);
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("Failed to parse arguments: %s\n", error->message);
+		return EXIT_FAILURE;
+	}
+	priv->scale = (guint) MAX (scale, 1);
+
+	/* do not use the system quirks or caches */
+	priv->tmpdir = g_dir_make_tmp ("fwupd-benchmark-XXXXXX", &error);
+	if (priv->tmpdir == NULL) {
+		g_printerr ("Failed to create temp dir: %s\n", error->message);
+		return EXIT_FAILURE;
+	}
+	g_setenv ("FWUPD_DATADIR", priv->tmpdir, TRUE);
+	g_setenv ("FWUPD_LOCALSTATEDIR", priv->tmpdir, TRUE);
+	g_setenv ("CACHE_DIRECTORY", priv->tmpdir, TRUE);
+
+	/* run each benchmark */
+	for (guint i = 0; benchmarks[i].id != NULL; i++) {
+		if (!fu_benchmark_match (priv, benchmarks[i].id))
+			continue;
+		if (!benchmarks[i].func (priv, &error)) {
+			g_printerr ("Failed to run %s: %s\n", benchmarks[i].id, error->message);
+			return EXIT_FAILURE;
+		}
+	}
+#ifndef FU_BENCHMARK_COUNT_ALLOCS
+	g_print ("NOTE: allocations are not counted on this platform\n");
+#endif
+
+	/* save for comparison */
+	if (json_filename != NULL) {
+		if (!fu_benchmark_save_json (priv, json_filename, &error)) {
+			g_printerr ("Failed to save results: %s\n", error->message);
+			return EXIT_FAILURE;
+		}
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,317 @@
+/*
+ * Copyright (C) 2020 The fwupd authors
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#define G_LOG_DOMAIN				"FuChangeStream"
+
+#include "config.h"
+
+#include "fwupd-device-private.h"
+
+#include "fu-change-stream.h"
+
+/**
+ * SECTION:fu-change-stream
+ * @short_description: sequence-numbered device changes
+ *
+ * This object records which device properties changed, so that clients that
+ * already have a copy of the device list can fetch just the differences
+ * rather than calling GetDevices again.
+ *
+ * Each change is given a sequence number, and the most recent changes are
+ * kept in a fixed-size ring. A client asking for changes older than the
+ * ring is told to resynchronize.
+ *
+ * Devices are always serialized as for an untrusted client, so the stream
+ * never includes serial numbers or instance IDs.
+ */
+
+#define FU_CHANGE_STREAM_MAX_ENTRIES_DEFAULT	256
+
+struct _FuChangeStream
+{
+	GObject			 parent_instance;
+	GPtrArray		*entries;		/* of FuChangeStreamEntry */
+	GHashTable		*devices;		/* device-id:GVariant */
+	guint			 max_entries;
+	guint64			 sequence;		/* of the newest entry */
+	guint64			 sequence_dropped;	/* of the newest entry no longer in the ring */
+};
+
+typedef struct {
+	guint64			 sequence;
+	GVariant		*value;
+} FuChangeStreamEntry;
+
+G_DEFINE_TYPE (FuChangeStream, fu_change_stream, G_TYPE_OBJECT)
+
+static void
+fu_change_stream_entry_free (FuChangeStreamEntry *entry)
+{
+	g_variant_unref (entry->value);
+	g_free (entry);
+}
+
+static void
+fu_change_stream_add_entry (FuChangeStream *self,
+			    const gchar *kind,
+			    const gchar *device_id,
+			    GVariant *changed,
+			    GPtrArray *removed)
+{
+	FuChangeStreamEntry *entry = g_new0 (FuChangeStreamEntry, 1);
+	GVariantBuilder builder;
+
+	entry->sequence = ++self->sequence;
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+	g_variant_builder_add (&builder, "{sv}", "Sequence",
+			       g_variant_new_uint64 (entry->sequence));
+	g_variant_builder_add (&builder, "{sv}", "Kind",
+			       g_variant_new_string (kind));
+	g_variant_builder_add (&builder, "{sv}", FWUPD_RESULT_KEY_DEVICE_ID,
+			       g_variant_new_string (device_id));
+	if (changed != NULL)
+		g_variant_builder_add (&builder, "{sv}", "Changed", changed);
+	if (removed != NULL && removed->len > 0) {
+		const gchar * const *tmp = (const gchar * const *) removed->pdata;
+		g_variant_builder_add (&builder, "{sv}", "Removed",
+				       g_variant_new_strv (tmp, removed->len));
+	}
+	entry->value = g_variant_ref_sink (g_variant_builder_end (&builder));
+	g_ptr_array_add (self->entries, entry);
+
+	/* forget the oldest change */
+	if (self->entries->len > self->max_entries) {
+		FuChangeStreamEntry *entry_old = g_ptr_array_index (self->entries, 0);
+		self->sequence_dropped = entry_old->sequence;
+		g_ptr_array_remove_index (self->entries, 0);
+	}
+}
+
+/* only the keys that are new or different in @value_new */
+static GVariant *
+fu_change_stream_build_delta (GVariant *value_old, GVariant *value_new, GPtrArray *removed)
+{
+	GVariantBuilder builder;
+	GVariantIter iter;
+	GVariant *value;
+	const gchar *key;
+	gboolean has_changes = FALSE;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+	g_variant_iter_init (&iter, value_new);
+	while (g_variant_iter_next (&iter, "{&sv}", &key, &value)) {
+		g_autoptr(GVariant) value_tmp = g_variant_lookup_value (value_old, key, NULL);
+		if (value_tmp == NULL || !g_variant_equal (value, value_tmp)) {
+			g_variant_builder_add (&builder, "{sv}", key, value);
+			has_changes = TRUE;
+		}
+		g_variant_unref (value);
+	}
+	g_variant_iter_init (&iter, value_old);
+	while (g_variant_iter_next (&iter, "{&sv}", &key, &value)) {
+		g_autoptr(GVariant) value_tmp = g_variant_lookup_value (value_new, key, NULL);
+		if (value_tmp == NULL)
+			g_ptr_array_add (removed, g_strdup (key));
+		g_variant_unref (value);
+	}
+	if (!has_changes) {
+		g_variant_builder_clear (&builder);
+		return NULL;
+	}
+	return g_variant_ref_sink (g_variant_builder_end (&builder));
+}
+
+/**
+ * fu_change_stream_set_max_entries:
+ * @self: A #FuChangeStream
+ * @max_entries: the number of changes to keep
+ *
+ * Sets how many changes are kept before clients have to resynchronize.
+ **/
+void
+fu_change_stream_set_max_entries (FuChangeStream *self, guint max_entries)
+{
+	g_return_if_fail (FU_IS_CHANGE_STREAM (self));
+	g_return_if_fail (max_entries > 0);
+	self->max_entries = max_entries;
+}
+
+/**
+ * fu_change_stream_device_added:
+ * @self: A #FuChangeStream
+ * @device: A #FwupdDevice
+ *
+ * Records a new device, with all of its properties.
+ **/
+void
+fu_change_stream_device_added (FuChangeStream *self, FwupdDevice *device)
+{
+	const gchar *device_id = fwupd_device_get_id (device);
+	g_autoptr(GVariant) value = NULL;
+
+	g_return_if_fail (FU_IS_CHANGE_STREAM (self));
+	g_return_if_fail (FWUPD_IS_DEVICE (device));
+
+	if (device_id == NULL)
+		return;
+	value = fwupd_device_to_variant_cached (device, FWUPD_DEVICE_FLAG_NONE);
+	fu_change_stream_add_entry (self, "added", device_id, value, NULL);
+	g_hash_table_insert (self->devices,
+			     g_strdup (device_id),
+			     g_steal_pointer (&value));
+}
+
+/**
+ * fu_change_stream_device_removed:
+ * @self: A #FuChangeStream
+ * @device: A #FwupdDevice
+ *
+ * Records that a device has gone away.
+ **/
+void
+fu_change_stream_device_removed (FuChangeStream *self, FwupdDevice *device)
+{
+	const gchar *device_id = fwupd_device_get_id (device);
+
+	g_return_if_fail (FU_IS_CHANGE_STREAM (self));
+	g_return_if_fail (FWUPD_IS_DEVICE (device));
+
+	if (device_id == NULL)
+		return;
+	fu_change_stream_add_entry (self, "removed", device_id, NULL, NULL);
+	g_hash_table_remove (self->devices, device_id);
+}
+
+/**
+ * fu_change_stream_device_changed:
+ * @self: A #FuChangeStream
+ * @device: A #FwupdDevice
+ *
+ * Records the properties that changed since the device was last added or
+ * changed. Nothing is recorded if only unserialized properties such as the
+ * progress changed.
+ **/
+void
+fu_change_stream_device_changed (FuChangeStream *self, FwupdDevice *device)
+{
+	const gchar *device_id = fwupd_device_get_id (device);
+	GVariant *value_old;
+	g_autoptr(GPtrArray) removed = g_ptr_array_new_with_free_func (g_free);
+	g_autoptr(GVariant) delta = NULL;
+	g_autoptr(GVariant) value = NULL;
+
+	g_return_if_fail (FU_IS_CHANGE_STREAM (self));
+	g_return_if_fail (FWUPD_IS_DEVICE (device));
+
+	if (device_id == NULL)
+		return;
+	value_old = g_hash_table_lookup (self->devices, device_id);
+	if (value_old == NULL) {
+		fu_change_stream_device_added (self, device);
+		return;
+	}
+	value = fwupd_device_to_variant_cached (device, FWUPD_DEVICE_FLAG_NONE);
+	if (value == value_old)
+		return;
+	delta = fu_change_stream_build_delta (value_old, value, removed);
+	if (delta == NULL && removed->len == 0)
+		return;
+	fu_change_stream_add_entry (self, "changed", device_id, delta, removed);
+	g_hash_table_insert (self->devices,
+			     g_strdup (device_id),
+			     g_steal_pointer (&value));
+}
+
+/**
+ * fu_change_stream_get_sequence:
+ * @self: A #FuChangeStream
+ *
+ * Gets the sequence number of the newest change.
+ *
+ * Returns: integer
+ **/
+guint64
+fu_change_stream_get_sequence (FuChangeStream *self)
+{
+	g_return_val_if_fail (FU_IS_CHANGE_STREAM (self), 0);
+	return self->sequence;
+}
+
+/**
+ * fu_change_stream_get_changes:
+ * @self: A #FuChangeStream
+ * @since: the last sequence number the client has seen, or 0
+ *
+ * Gets all the changes newer than @since.
+ *
+ * If @since is older than the oldest change in the ring, or was returned by
+ * a different daemon instance, the client is asked to resynchronize and no
+ * changes are returned.
+ *
+ * Returns: a #GVariant of type `(tbaa{sv})`
+ **/
+GVariant *
+fu_change_stream_get_changes (FuChangeStream *self, guint64 since)
+{
+	GVariantBuilder builder;
+	gboolean resync;
+
+	g_return_val_if_fail (FU_IS_CHANGE_STREAM (self), NULL);
+
+	resync = since < self->sequence_dropped || since > self->sequence;
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("aa{sv}"));
+	if (!resync) {
+		for (guint i = 0; i < self->entries->len; i++) {
+			FuChangeStreamEntry *entry = g_ptr_array_index (self->entries, i);
+			if (entry->sequence <= since)
+				continue;
+			g_variant_builder_add_value (&builder, entry->value);
+		}
+	}
+	return g_variant_new ("(tbaa{sv})", self->sequence, resync, &builder);
+}
+
+static void
+fu_change_stream_init (FuChangeStream *self)
+{
+	self->max_entries = FU_CHANGE_STREAM_MAX_ENTRIES_DEFAULT;
+	self->entries = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_change_stream_entry_free);
+	self->devices = g_hash_table_new_full (g_str_hash, g_str_equal,
+					       g_free, (GDestroyNotify) g_variant_unref);
+
+	/* a sequence number from a previous daemon instance is always older */
+	self->sequence = g_get_real_time ();
+	self->sequence_dropped = self->sequence;
+}
+
+static void
+fu_change_stream_finalize (GObject *obj)
+{
+	FuChangeStream *self = FU_CHANGE_STREAM (obj);
+	g_ptr_array_unref (self->entries);
+	g_hash_table_unref (self->devices);
+	G_OBJECT_CLASS (fu_change_stream_parent_class)->finalize (obj);
+}
+
+static void
+fu_change_stream_class_init (FuChangeStreamClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = fu_change_stream_finalize;
+}
+
+/**
+ * fu_change_stream_new:
+ *
+ * Creates a new #FuChangeStream.
+ *
+ * Returns: a #FuChangeStream
+ **/
+FuChangeStream *
+fu_change_stream_new (void)
+{
+	return FU_CHANGE_STREAM (g_object_new (FU_TYPE_CHANGE_STREAM, NULL));
+}
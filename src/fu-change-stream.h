@@ -0,0 +1,25 @@
+/*
+ * Copyright (C) 2020 The fwupd authors
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#pragma once
+
+#include <fwupd.h>
+
+#define FU_TYPE_CHANGE_STREAM (fu_change_stream_get_type ())
+G_DECLARE_FINAL_TYPE (FuChangeStream, fu_change_stream, FU, CHANGE_STREAM, GObject)
+
+FuChangeStream	*fu_change_stream_new			(void);
+void		 fu_change_stream_set_max_entries	(FuChangeStream	*self,
+							 guint		 max_entries);
+void		 fu_change_stream_device_added		(FuChangeStream	*self,
+							 FwupdDevice	*device);
+void		 fu_change_stream_device_removed	(FuChangeStream	*self,
+							 FwupdDevice	*device);
+void		 fu_change_stream_device_changed	(FuChangeStream	*self,
+							 FwupdDevice	*device);
+guint64		 fu_change_stream_get_sequence		(FuChangeStream	*self);
+GVariant	*fu_change_stream_get_changes		(FuChangeStream	*self,
+							 guint64	 since);
@@ -32,9 +32,14 @@ struct _FuConfig
 	GPtrArray		*approved_firmware;	/* (element-type utf-8) */
 	guint64			 archive_size_max;
 	guint			 idle_timeout;
+	guint			 history_max_age;	/* days */
+	guint			 history_max_entries;
+	guint			 progress_interval;	/* ms */
+	guint			 progress_delta;	/* percent */
 	gchar			*config_file;
 	gboolean		 update_motd;
 	gboolean		 enumerate_all_devices;
+	gboolean		 enumeration_cache;
 };
 
 G_DEFINE_TYPE (FuConfig, fu_config, G_TYPE_OBJECT)
@@ -122,6 +127,26 @@ fu_config_reload (FuConfig *self, GError **error)
 	if (idle_timeout > 0)
 		self->idle_timeout = idle_timeout;
 
+	/* get history retention, where zero is keep forever */
+	self->history_max_age = g_key_file_get_uint64 (keyfile,
+						       "fwupd",
+						       "HistoryMaxAge",
+						       NULL);
+	self->history_max_entries = g_key_file_get_uint64 (keyfile,
+							   "fwupd",
+							   "HistoryMaxEntries",
+							   NULL);
+
+	/* get how often to send device progress to clients */
+	self->progress_interval = g_key_file_get_uint64 (keyfile,
+							 "fwupd",
+							 "ProgressInterval",
+							 NULL);
+	self->progress_delta = g_key_file_get_uint64 (keyfile,
+						      "fwupd",
+						      "ProgressDelta",
+						      NULL);
+
 	/* get the domains to run in verbose */
 	domains = g_key_file_get_string (keyfile,
 					 "fwupd",
@@ -151,6 +176,12 @@ fu_config_reload (FuConfig *self, GError **error)
 		self->enumerate_all_devices = TRUE;
 	}
 
+	/* whether to restore devices from the last daemon instance */
+	self->enumeration_cache = g_key_file_get_boolean (keyfile,
+							  "fwupd",
+							  "EnumerationCache",
+							  NULL);
+
 	return TRUE;
 }
 
@@ -220,6 +251,34 @@ fu_config_get_idle_timeout (FuConfig *self)
 	return self->idle_timeout;
 }
 
+guint
+fu_config_get_history_max_age (FuConfig *self)
+{
+	g_return_val_if_fail (FU_IS_CONFIG (self), 0);
+	return self->history_max_age;
+}
+
+guint
+fu_config_get_history_max_entries (FuConfig *self)
+{
+	g_return_val_if_fail (FU_IS_CONFIG (self), 0);
+	return self->history_max_entries;
+}
+
+guint
+fu_config_get_progress_interval (FuConfig *self)
+{
+	g_return_val_if_fail (FU_IS_CONFIG (self), 0);
+	return self->progress_interval;
+}
+
+guint
+fu_config_get_progress_delta (FuConfig *self)
+{
+	g_return_val_if_fail (FU_IS_CONFIG (self), 0);
+	return self->progress_delta;
+}
+
 GPtrArray *
 fu_config_get_blacklist_devices (FuConfig *self)
 {
@@ -262,6 +321,13 @@ fu_config_get_enumerate_all_devices (FuConfig *self)
 	return self->enumerate_all_devices;
 }
 
+gboolean
+fu_config_get_enumeration_cache (FuConfig *self)
+{
+	g_return_val_if_fail (FU_IS_CONFIG (self), FALSE);
+	return self->enumeration_cache;
+}
+
 static void
 fu_config_class_init (FuConfigClass *klass)
 {
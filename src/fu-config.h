@@ -23,8 +23,13 @@ gboolean	 fu_config_set_key_value		(FuConfig	*self,
 
 guint64		 fu_config_get_archive_size_max		(FuConfig	*self);
 guint		 fu_config_get_idle_timeout		(FuConfig	*self);
+guint		 fu_config_get_history_max_age		(FuConfig	*self);
+guint		 fu_config_get_history_max_entries	(FuConfig	*self);
+guint		 fu_config_get_progress_interval	(FuConfig	*self);
+guint		 fu_config_get_progress_delta		(FuConfig	*self);
 GPtrArray	*fu_config_get_blacklist_devices	(FuConfig	*self);
 GPtrArray	*fu_config_get_blacklist_plugins	(FuConfig	*self);
 GPtrArray	*fu_config_get_approved_firmware	(FuConfig	*self);
 gboolean	 fu_config_get_update_motd		(FuConfig	*self);
 gboolean	 fu_config_get_enumerate_all_devices	(FuConfig	*self);
+gboolean	 fu_config_get_enumeration_cache	(FuConfig	*self);
@@ -28,6 +28,11 @@
  * has been changed. If the #FuDevice has changed during a device replug then
  * the ::changed signal will be emitted instead of ::added and then ::removed.
  *
+ * The arrays returned by fu_device_list_get_all(), fu_device_list_get_active()
+ * and fu_device_list_get_active_sorted() are shared snapshots that are only
+ * rebuilt when devices are added, removed or replaced, and so must not be
+ * modified by the caller.
+ *
  * See also: #FuDevice
  */
 
@@ -37,6 +42,10 @@ struct _FuDeviceList
 {
 	GObject			 parent_instance;
 	GPtrArray		*devices;	/* of FuDeviceItem */
+	GPtrArray		*snapshot_all;	/* (nullable) of FuDevice */
+	GPtrArray		*snapshot_active; /* (nullable) of FuDevice */
+	GPtrArray		*snapshot_sorted; /* (nullable) of FuDevice */
+	GCompareFunc		 sort_func;
 	GRWLock			 devices_mutex;
 	GMainLoop		*replug_loop;	/* block waiting for replug */
 	guint			 replug_id;	/* timeout the loop */
@@ -81,6 +90,99 @@ fu_device_list_emit_device_changed (FuDeviceList *self, FuDevice *device)
 	g_signal_emit (self, signals[SIGNAL_CHANGED], 0, device);
 }
 
+/* must be called with the writer lock held in the same critical section as the
+ * change to the list, so no reader can get a snapshot older than the list; the
+ * arrays are moved to @stale to be unreffed outside the lock, as this may
+ * finalize removed devices */
+static void
+fu_device_list_invalidate_locked (FuDeviceList *self, GPtrArray *stale)
+{
+	GPtrArray **snapshots[] = { &self->snapshot_all,
+				    &self->snapshot_active,
+				    &self->snapshot_sorted,
+				    NULL };
+	for (guint i = 0; snapshots[i] != NULL; i++) {
+		if (*snapshots[i] != NULL)
+			g_ptr_array_add (stale, g_steal_pointer (snapshots[i]));
+	}
+}
+
+static GPtrArray *
+fu_device_list_stale_new (void)
+{
+	return g_ptr_array_new_with_free_func ((GDestroyNotify) g_ptr_array_unref);
+}
+
+static void
+fu_device_list_item_add (FuDeviceList *self, FuDeviceItem *item)
+{
+	g_autoptr(GPtrArray) stale = fu_device_list_stale_new ();
+	g_rw_lock_writer_lock (&self->devices_mutex);
+	g_ptr_array_add (self->devices, item);
+	fu_device_list_invalidate_locked (self, stale);
+	g_rw_lock_writer_unlock (&self->devices_mutex);
+}
+
+static void
+fu_device_list_item_remove (FuDeviceList *self, FuDeviceItem *item)
+{
+	g_autoptr(GPtrArray) stale = fu_device_list_stale_new ();
+	g_rw_lock_writer_lock (&self->devices_mutex);
+	g_ptr_array_remove (self->devices, item);
+	fu_device_list_invalidate_locked (self, stale);
+	g_rw_lock_writer_unlock (&self->devices_mutex);
+}
+
+/* must be called with the writer lock held */
+static GPtrArray *
+fu_device_list_snapshot_new (FuDeviceList *self, gboolean include_old, GCompareFunc sort_func)
+{
+	GPtrArray *devices;
+	devices = g_ptr_array_new_full (self->devices->len,
+					(GDestroyNotify) g_object_unref);
+	for (guint i = 0; i < self->devices->len; i++) {
+		FuDeviceItem *item = g_ptr_array_index (self->devices, i);
+		g_ptr_array_add (devices, g_object_ref (item->device));
+	}
+	if (sort_func != NULL)
+		g_ptr_array_sort (devices, sort_func);
+	if (!include_old)
+		return devices;
+	for (guint i = 0; i < self->devices->len; i++) {
+		FuDeviceItem *item = g_ptr_array_index (self->devices, i);
+		if (item->device_old == NULL)
+			continue;
+		g_ptr_array_add (devices, g_object_ref (item->device_old));
+	}
+	return devices;
+}
+
+static GPtrArray *
+fu_device_list_snapshot_get (FuDeviceList *self,
+			     GPtrArray **snapshot,
+			     gboolean include_old,
+			     GCompareFunc sort_func)
+{
+	GPtrArray *devices;
+
+	/* fast path: the snapshot is still current */
+	g_rw_lock_reader_lock (&self->devices_mutex);
+	if (*snapshot != NULL) {
+		devices = g_ptr_array_ref (*snapshot);
+		g_rw_lock_reader_unlock (&self->devices_mutex);
+		return devices;
+	}
+	g_rw_lock_reader_unlock (&self->devices_mutex);
+
+	/* another thread may have rebuilt it since */
+	g_rw_lock_writer_lock (&self->devices_mutex);
+	if (*snapshot == NULL)
+		*snapshot = fu_device_list_snapshot_new (self, include_old, sort_func);
+	devices = g_ptr_array_ref (*snapshot);
+	g_rw_lock_writer_unlock (&self->devices_mutex);
+	return devices;
+}
+
 /**
  * fu_device_list_get_all:
  * @self: A #FuDeviceList
@@ -89,30 +191,16 @@ fu_device_list_emit_device_changed (FuDeviceList *self, FuDevice *device)
  * This includes devices that are no longer active, for instance where a
  * different plugin has taken over responsibility of the #FuDevice.
  *
- * Returns: (transfer container) (element-type FuDevice): the devices
+ * Returns: (transfer full) (element-type FuDevice): a new reference to a
+ * shared array of devices, which must not be modified
  *
  * Since: 1.0.2
  **/
 GPtrArray *
 fu_device_list_get_all (FuDeviceList *self)
 {
-	GPtrArray *devices;
 	g_return_val_if_fail (FU_IS_DEVICE_LIST (self), NULL);
-	devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
-
-	g_rw_lock_reader_lock (&self->devices_mutex);
-	for (guint i = 0; i < self->devices->len; i++) {
-		FuDeviceItem *item = g_ptr_array_index (self->devices, i);
-		g_ptr_array_add (devices, g_object_ref (item->device));
-	}
-	for (guint i = 0; i < self->devices->len; i++) {
-		FuDeviceItem *item = g_ptr_array_index (self->devices, i);
-		if (item->device_old == NULL)
-			continue;
-		g_ptr_array_add (devices, g_object_ref (item->device_old));
-	}
-	g_rw_lock_reader_unlock (&self->devices_mutex);
-	return devices;
+	return fu_device_list_snapshot_get (self, &self->snapshot_all, TRUE, NULL);
 }
 
 /**
@@ -123,23 +211,75 @@ fu_device_list_get_all (FuDeviceList *self)
  * An active device is defined as a device that is currently connected and has
  * is owned by a plugin.
  *
- * Returns: (transfer container) (element-type FuDevice): the devices
+ * Returns: (transfer full) (element-type FuDevice): a new reference to a
+ * shared array of devices, which must not be modified
  *
  * Since: 1.0.2
  **/
 GPtrArray *
 fu_device_list_get_active (FuDeviceList *self)
 {
-	GPtrArray *devices;
 	g_return_val_if_fail (FU_IS_DEVICE_LIST (self), NULL);
-	devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
-	g_rw_lock_reader_lock (&self->devices_mutex);
-	for (guint i = 0; i < self->devices->len; i++) {
-		FuDeviceItem *item = g_ptr_array_index (self->devices, i);
-		g_ptr_array_add (devices, g_object_ref (item->device));
-	}
-	g_rw_lock_reader_unlock (&self->devices_mutex);
-	return devices;
+	return fu_device_list_snapshot_get (self, &self->snapshot_active, FALSE, NULL);
+}
+
+/**
+ * fu_device_list_get_active_sorted:
+ * @self: A #FuDeviceList
+ *
+ * Returns all the active devices, ordered using the function set with
+ * fu_device_list_set_sort_func().
+ *
+ * Returns: (transfer full) (element-type FuDevice): a new reference to a
+ * shared array of devices, which must not be modified
+ *
+ * Since: 1.4.2
+ **/
+GPtrArray *
+fu_device_list_get_active_sorted (FuDeviceList *self)
+{
+	g_return_val_if_fail (FU_IS_DEVICE_LIST (self), NULL);
+	return fu_device_list_snapshot_get (self, &self->snapshot_sorted, FALSE,
+					    self->sort_func);
+}
+
+/**
+ * fu_device_list_set_sort_func:
+ * @self: A #FuDeviceList
+ * @sort_func: (nullable): A #GCompareFunc for an array of #FuDevice
+ *
+ * Sets the order used by fu_device_list_get_active_sorted().
+ *
+ * Since: 1.4.2
+ **/
+void
+fu_device_list_set_sort_func (FuDeviceList *self, GCompareFunc sort_func)
+{
+	g_autoptr(GPtrArray) stale = fu_device_list_stale_new ();
+	g_return_if_fail (FU_IS_DEVICE_LIST (self));
+	g_rw_lock_writer_lock (&self->devices_mutex);
+	self->sort_func = sort_func;
+	fu_device_list_invalidate_locked (self, stale);
+	g_rw_lock_writer_unlock (&self->devices_mutex);
+}
+
+/**
+ * fu_device_list_invalidate_sorted:
+ * @self: A #FuDeviceList
+ *
+ * Drops the sorted snapshot, which should be done when a property used by the
+ * sort function has changed, for instance the device name.
+ *
+ * Since: 1.4.2
+ **/
+void
+fu_device_list_invalidate_sorted (FuDeviceList *self)
+{
+	g_autoptr(GPtrArray) snapshot = NULL;
+	g_return_if_fail (FU_IS_DEVICE_LIST (self));
+	g_rw_lock_writer_lock (&self->devices_mutex);
+	snapshot = g_steal_pointer (&self->snapshot_sorted);
+	g_rw_lock_writer_unlock (&self->devices_mutex);
 }
 
 static FuDeviceItem *
@@ -365,17 +505,13 @@ fu_device_list_device_delayed_remove_cb (gpointer user_data)
 			continue;
 		}
 		fu_device_list_emit_device_removed (self, child);
-		g_rw_lock_writer_lock (&self->devices_mutex);
-		g_ptr_array_remove (self->devices, child_item);
-		g_rw_lock_writer_unlock (&self->devices_mutex);
+		fu_device_list_item_remove (self, child_item);
 	}
 
 	/* just remove now */
 	g_debug ("doing delayed removal");
 	fu_device_list_emit_device_removed (self, item->device);
-	g_rw_lock_writer_lock (&self->devices_mutex);
-	g_ptr_array_remove (self->devices, item);
-	g_rw_lock_writer_unlock (&self->devices_mutex);
+	fu_device_list_item_remove (self, item);
 	return G_SOURCE_REMOVE;
 }
 
@@ -451,16 +587,12 @@ fu_device_list_remove (FuDeviceList *self, FuDevice *device)
 			continue;
 		}
 		fu_device_list_emit_device_removed (self, child);
-		g_rw_lock_writer_lock (&self->devices_mutex);
-		g_ptr_array_remove (self->devices, child_item);
-		g_rw_lock_writer_unlock (&self->devices_mutex);
+		fu_device_list_item_remove (self, child_item);
 	}
 
 	/* remove right now */
 	fu_device_list_emit_device_removed (self, item->device);
-	g_rw_lock_writer_lock (&self->devices_mutex);
-	g_ptr_array_remove (self->devices, item);
-	g_rw_lock_writer_unlock (&self->devices_mutex);
+	fu_device_list_item_remove (self, item);
 }
 
 static void
@@ -491,9 +623,7 @@ fu_device_list_item_finalized_cb (gpointer data, GObject *where_the_object_was)
 	g_critical ("FuDevice %p was finalized without being removed from "
 		    "FuDeviceList, removing item!",
 		    where_the_object_was);
-	g_rw_lock_writer_lock (&self->devices_mutex);
-	g_ptr_array_remove (self->devices, item);
-	g_rw_lock_writer_unlock (&self->devices_mutex);
+	fu_device_list_item_remove (self, item);
 }
 
 /* this should never be required, and yet here we are */
@@ -516,13 +646,16 @@ fu_device_list_item_set_device (FuDeviceItem *item, FuDevice *device)
 static void
 fu_device_list_replace (FuDeviceList *self, FuDeviceItem *item, FuDevice *device)
 {
+	g_autoptr(GPtrArray) stale = fu_device_list_stale_new ();
+
 	/* clear timeout if scheduled */
 	if (item->remove_id != 0) {
 		g_source_remove (item->remove_id);
 		item->remove_id = 0;
 	}
 
-	/* copy over any GUIDs that used to exist */
+	/* copy over any GUIDs that used to exist, notifying each property once */
+	fu_device_batch_begin (device);
 	fu_device_list_add_missing_guids (device, item->device);
 
 	/* enforce the vendor ID if specified */
@@ -572,10 +705,14 @@ fu_device_list_replace (FuDeviceList *self, FuDeviceItem *item, FuDevice *device
 		g_debug ("copying parent %s to new device", fu_device_get_id (parent));
 		fu_device_set_parent (device, parent);
 	}
+	fu_device_batch_commit (device);
 
 	/* assign the new device */
+	g_rw_lock_writer_lock (&self->devices_mutex);
 	g_set_object (&item->device_old, item->device);
 	fu_device_list_item_set_device (item, device);
+	fu_device_list_invalidate_locked (self, stale);
+	g_rw_lock_writer_unlock (&self->devices_mutex);
 	fu_device_list_emit_device_changed (self, device);
 
 	/* we were waiting for this... */
@@ -665,11 +802,10 @@ fu_device_list_add (FuDeviceList *self, FuDevice *device)
 		}
 	}
 
-	/* added the same device, supporting same protocol */
+	/* added the same device, supporting same protocol -- both are interned */
 	item = fu_device_list_get_by_guids (self, fu_device_get_guids (device));
 	if (item != NULL &&
-	    g_strcmp0 (fu_device_get_protocol (item->device),
-		       fu_device_get_protocol (device)) == 0) {
+	    fu_device_get_protocol (item->device) == fu_device_get_protocol (device)) {
 		if (!fu_device_has_flag (device, FWUPD_DEVICE_FLAG_NO_GUID_MATCHING)) {
 			if (fu_device_get_priority (device) < fu_device_get_priority (item->device)) {
 				g_debug ("ignoring device %s [%s] as better device %s [%s] already exists",
@@ -704,9 +840,7 @@ fu_device_list_add (FuDeviceList *self, FuDevice *device)
 	item = g_new0 (FuDeviceItem, 1);
 	item->self = self; /* no ref */
 	fu_device_list_item_set_device (item, device);
-	g_rw_lock_writer_lock (&self->devices_mutex);
-	g_ptr_array_add (self->devices, item);
-	g_rw_lock_writer_unlock (&self->devices_mutex);
+	fu_device_list_item_add (self, item);
 	fu_device_list_emit_device_added (self, device);
 }
 
@@ -949,6 +1083,12 @@ fu_device_list_finalize (GObject *obj)
 
 	if (self->replug_id != 0)
 		g_source_remove (self->replug_id);
+	if (self->snapshot_all != NULL)
+		g_ptr_array_unref (self->snapshot_all);
+	if (self->snapshot_active != NULL)
+		g_ptr_array_unref (self->snapshot_active);
+	if (self->snapshot_sorted != NULL)
+		g_ptr_array_unref (self->snapshot_sorted);
 	g_ptr_array_unref (self->devices);
 	g_main_loop_unref (self->replug_loop);
 	g_rw_lock_clear (&self->devices_mutex);
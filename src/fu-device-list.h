@@ -20,6 +20,10 @@ void		 fu_device_list_remove			(FuDeviceList	*self,
 							 FuDevice	*device);
 GPtrArray	*fu_device_list_get_all			(FuDeviceList	*self);
 GPtrArray	*fu_device_list_get_active		(FuDeviceList	*self);
+GPtrArray	*fu_device_list_get_active_sorted	(FuDeviceList	*self);
+void		 fu_device_list_set_sort_func		(FuDeviceList	*self,
+							 GCompareFunc	 sort_func);
+void		 fu_device_list_invalidate_sorted	(FuDeviceList	*self);
 FuDevice	*fu_device_list_get_old			(FuDeviceList	*self,
 							 FuDevice	*device);
 FuDevice	*fu_device_list_get_by_id		(FuDeviceList	*self,
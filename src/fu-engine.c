@@ -6,6 +6,15 @@
 
 #define G_LOG_DOMAIN				"FuEngine"
 
+/* how long uevents are collected before being processed */
+#define FU_ENGINE_UDEV_EVENTS_DELAY		50 /* ms */
+
+/* how many Guid quirks are followed when looking for a Plugin quirk */
+#define FU_ENGINE_PLUGIN_ROUTES_DEPTH_MAX	4
+
+/* how long hotplug events are collected before the device cache is saved */
+#define FU_ENGINE_DEVICE_CACHE_SAVE_DELAY	5 /* s */
+
 #include "config.h"
 
 #include <gio/gio.h>
@@ -34,11 +43,12 @@
 #include "fu-common.h"
 #include "fu-config.h"
 #include "fu-debug.h"
+#include "fu-device-cache.h"
 #include "fu-device-list.h"
 #include "fu-device-private.h"
 #include "fu-engine.h"
 #include "fu-engine-helper.h"
-#include "fu-hwids.h"
+#include "fu-hwids-private.h"
 #include "fu-idle.h"
 #include "fu-keyring-utils.h"
 #include "fu-hash.h"
@@ -50,6 +60,7 @@
 #include "fu-quirks.h"
 #include "fu-remote-list.h"
 #include "fu-smbios-private.h"
+#include "fu-udev-batch.h"
 #include "fu-udev-device-private.h"
 #include "fu-usb-device-private.h"
 
@@ -77,6 +88,9 @@ struct _FuEngine
 	FwupdStatus		 status;
 	gboolean		 tainted;
 	guint			 percentage;
+	FuDevice		*progress_device;	/* pending, not yet emitted */
+	gint64			 progress_emitted;	/* monotonic time, us */
+	guint			 progress_id;
 	FuHistory		*history;
 	FuIdle			*idle;
 	XbSilo			*silo;
@@ -86,18 +100,29 @@ struct _FuEngine
 	FuPluginList		*plugin_list;
 	GPtrArray		*plugin_filter;
 	GPtrArray		*udev_subsystems;
+	GHashTable		*plugins_on_demand;	/* name:filename */
+	GHashTable		*firmware_gtype_plugins; /* id:plugin name */
+	GHashTable		*plugin_routes;		/* guid:GPtrArray of plugin names */
+	GHashTable		*plugin_route_links;	/* guid:GPtrArray of GUIDs */
+	gboolean		 plugin_routes_valid;
 #ifdef HAVE_GUDEV
 	GHashTable		*udev_changed_ids;	/* sysfs:FuEngineUdevChangedHelper */
+	FuUdevBatch		*udev_batch;
+	guint			 udev_events_id;
 #endif
 	FuSmbios		*smbios;
 	FuHwids			*hwids;
 	FuQuirks		*quirks;
+	FuDeviceCache		*device_cache;		/* nullable */
+	guint			 device_cache_save_id;
 	GHashTable		*runtime_versions;
 	GHashTable		*compile_versions;
 	GHashTable		*approved_firmware;
 	GHashTable		*firmware_gtypes;
 	gchar			*host_machine_id;
 	JcatContext		*jcat_context;
+	FuTrace			*trace;
+	FuAllocStats		*alloc_stats;
 	gboolean		 loaded;
 };
 
@@ -133,14 +158,158 @@ fu_engine_emit_changed (FuEngine *self)
 static void
 fu_engine_emit_device_changed (FuEngine *self, FuDevice *device)
 {
+	/* emitted once from ::batch-changed when the batch is committed */
+	if (fu_device_batch_defer_changed (device))
+		return;
+
+	/* the name or priority might have changed */
+	fu_device_list_invalidate_sorted (self->device_list);
 	g_signal_emit (self, signals[SIGNAL_DEVICE_CHANGED], 0, device);
 }
 
+/* the manifest has to set up everything from fu_plugin_init() that is
+ * needed before the module is opened, so warn if the two get out of sync */
+static void
+fu_engine_plugin_check_manifest (FuEngine *self,
+				 FuPlugin *plugin,
+				 const guint *rules_len,
+				 guint udev_subsystems_len,
+				 guint firmware_gtypes_len)
+{
+	const gchar *name = fu_plugin_get_name (plugin);
+	guint firmware_gtypes_listed = 0;
+	GHashTableIter iter;
+	gpointer key, value;
+
+	for (guint i = FU_PLUGIN_RULE_CONFLICTS; i <= FU_PLUGIN_RULE_BETTER_THAN; i++) {
+		if (fu_plugin_get_rules (plugin, i)->len != rules_len[i]) {
+			g_warning ("%s manifest is missing rules set in fu_plugin_init()", name);
+			break;
+		}
+	}
+	if (self->udev_subsystems->len != udev_subsystems_len)
+		g_warning ("%s manifest is missing udev subsystems", name);
+	g_hash_table_iter_init (&iter, self->firmware_gtype_plugins);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		if (g_strcmp0 (value, name) != 0)
+			continue;
+		if (!g_hash_table_contains (self->firmware_gtypes, key)) {
+			g_warning ("%s manifest lists firmware type %s which was not added",
+				   name, (const gchar *) key);
+			continue;
+		}
+		firmware_gtypes_listed++;
+	}
+	if (g_hash_table_size (self->firmware_gtypes) > firmware_gtypes_len + firmware_gtypes_listed)
+		g_warning ("%s manifest is missing firmware types", name);
+}
+
+/* plugin does not match built version */
+static void
+fu_engine_plugin_check_build_hash (FuEngine *self, FuPlugin *plugin)
+{
+	const gchar *name = fu_plugin_get_name (plugin);
+	if (fu_plugin_get_build_hash (plugin) == NULL) {
+		g_warning ("%s should call fu_plugin_set_build_hash()", name);
+		self->tainted = TRUE;
+	} else if (g_strcmp0 (fu_plugin_get_build_hash (plugin),
+			      FU_BUILD_HASH) != 0) {
+		g_warning ("%s has incorrect built version %s",
+			   name, fu_plugin_get_build_hash (plugin));
+		self->tainted = TRUE;
+	}
+}
+
+/* returns TRUE if the plugin was opened, rather than already being open */
+static gboolean
+fu_engine_plugin_ensure_open (FuEngine *self, FuPlugin *plugin)
+{
+	const gchar *name = fu_plugin_get_name (plugin);
+	guint rules_len[FU_PLUGIN_RULE_LAST] = { 0 };
+	guint udev_subsystems_len = self->udev_subsystems->len;
+	guint firmware_gtypes_len = g_hash_table_size (self->firmware_gtypes);
+	g_autofree gchar *key = NULL;
+	g_autofree gchar *filename = NULL;
+	g_autoptr(GError) error = NULL;
+
+	/* already open, or never deferred */
+	if (!g_hash_table_lookup_extended (self->plugins_on_demand, name,
+					   (gpointer *) &key, (gpointer *) &filename))
+		return FALSE;
+	g_hash_table_steal (self->plugins_on_demand, name);
+	for (guint i = 0; i < FU_PLUGIN_RULE_LAST; i++)
+		rules_len[i] = fu_plugin_get_rules (plugin, i)->len;
+
+	/* do the same as fu_engine_load() would have done at startup */
+	g_debug ("loading %s on demand", filename);
+	fu_trace_begin (self->trace, "plugin-load", name);
+	if (!fu_plugin_open (plugin, filename, &error)) {
+		g_warning ("%s", error->message);
+		fu_plugin_set_enabled (plugin, FALSE);
+		fu_trace_end (self->trace);
+		return TRUE;
+	}
+	fu_engine_plugin_check_build_hash (self, plugin);
+	fu_engine_plugin_check_manifest (self, plugin, rules_len,
+					 udev_subsystems_len,
+					 firmware_gtypes_len);
+	if (!fu_plugin_runner_startup (plugin, &error)) {
+		fu_plugin_set_enabled (plugin, FALSE);
+		g_message ("disabling plugin because: %s", error->message);
+	} else if (!fu_plugin_runner_coldplug (plugin, &error)) {
+		fu_plugin_set_enabled (plugin, FALSE);
+		g_message ("disabling plugin because: %s", error->message);
+	}
+	fu_trace_end (self->trace);
+	return TRUE;
+}
+
+/* returns TRUE if any of the named plugins had to be opened */
+static gboolean
+fu_engine_plugins_ensure_open (FuEngine *self, GPtrArray *plugin_names)
+{
+	gboolean opened = FALSE;
+	for (guint i = 0; i < plugin_names->len; i++) {
+		const gchar *plugin_name = g_ptr_array_index (plugin_names, i);
+		FuPlugin *plugin = fu_plugin_list_find_by_name (self->plugin_list,
+								plugin_name, NULL);
+		if (plugin == NULL)
+			continue;
+		if (fu_engine_plugin_ensure_open (self, plugin))
+			opened = TRUE;
+	}
+	return opened;
+}
+
+/* quirks may reference types registered by plugins not yet open, so this
+ * returns TRUE if the device has to be probed again */
+gboolean
+fu_engine_open_plugins_for_device (FuEngine *self, FuDevice *device)
+{
+	g_autoptr(GPtrArray) possible_plugins = NULL;
+	g_return_val_if_fail (FU_IS_ENGINE (self), FALSE);
+	g_return_val_if_fail (FU_IS_DEVICE (device), FALSE);
+	possible_plugins = fu_device_get_possible_plugins (device);
+	return fu_engine_plugins_ensure_open (self, possible_plugins);
+}
+
 GPtrArray *
 fu_engine_get_firmware_gtype_ids (FuEngine *self)
 {
 	GPtrArray *firmware_gtypes = g_ptr_array_new_with_free_func (g_free);
-	g_autoptr(GList) keys = g_hash_table_get_keys (self->firmware_gtypes);
+	g_autoptr(GHashTable) ids = g_hash_table_new (g_str_hash, g_str_equal);
+	g_autoptr(GList) keys = NULL;
+
+	/* plugins that are not open yet list their types in the manifest */
+	keys = g_hash_table_get_keys (self->firmware_gtypes);
+	for (GList *l = keys; l != NULL; l = l->next)
+		g_hash_table_add (ids, l->data);
+	g_list_free (keys);
+	keys = g_hash_table_get_keys (self->firmware_gtype_plugins);
+	for (GList *l = keys; l != NULL; l = l->next)
+		g_hash_table_add (ids, l->data);
+	g_list_free (keys);
+	keys = g_hash_table_get_keys (ids);
 	for (GList *l = keys; l != NULL; l = l->next) {
 		const gchar *id = l->data;
 		g_ptr_array_add (firmware_gtypes, g_strdup (id));
@@ -151,6 +320,16 @@ fu_engine_get_firmware_gtype_ids (FuEngine *self)
 GType
 fu_engine_get_firmware_gtype_by_id (FuEngine *self, const gchar *id)
 {
+	const gchar *plugin_name;
+
+	/* only open the plugin that registers this type */
+	plugin_name = g_hash_table_lookup (self->firmware_gtype_plugins, id);
+	if (plugin_name != NULL) {
+		FuPlugin *plugin = fu_plugin_list_find_by_name (self->plugin_list,
+								plugin_name, NULL);
+		if (plugin != NULL)
+			fu_engine_plugin_ensure_open (self, plugin);
+	}
 	return GPOINTER_TO_SIZE (g_hash_table_lookup (self->firmware_gtypes, id));
 }
 
@@ -199,22 +378,85 @@ fu_engine_set_percentage (FuEngine *self, guint percentage)
 	g_signal_emit (self, signals[SIGNAL_PERCENTAGE_CHANGED], 0, percentage);
 }
 
+static void
+fu_engine_progress_emit (FuEngine *self, FuDevice *device)
+{
+	self->progress_emitted = g_get_monotonic_time ();
+	fu_engine_set_percentage (self, fu_device_get_progress (device));
+	fu_engine_emit_device_changed (self, device);
+}
+
+/* send any progress that was held back */
+static void
+fu_engine_progress_flush (FuEngine *self)
+{
+	g_autoptr(FuDevice) device = g_steal_pointer (&self->progress_device);
+	if (self->progress_id != 0) {
+		g_source_remove (self->progress_id);
+		self->progress_id = 0;
+	}
+	if (device != NULL)
+		fu_engine_progress_emit (self, device);
+}
+
+static gboolean
+fu_engine_progress_flush_cb (gpointer user_data)
+{
+	FuEngine *self = FU_ENGINE (user_data);
+	self->progress_id = 0;
+	fu_engine_progress_flush (self);
+	return G_SOURCE_REMOVE;
+}
+
 static void
 fu_engine_progress_notify_cb (FuDevice *device, GParamSpec *pspec, FuEngine *self)
 {
+	guint interval = fu_config_get_progress_interval (self->config);
+	guint delta = fu_config_get_progress_delta (self->config);
+	guint progress = fu_device_get_progress (device);
+	gint64 elapsed = (g_get_monotonic_time () - self->progress_emitted) / 1000;
+
 	if (fu_device_get_status (device) == FWUPD_STATUS_UNKNOWN)
 		return;
-	fu_engine_set_percentage (self, fu_device_get_progress (device));
-	fu_engine_emit_device_changed (self, device);
+
+	/* a different device is now making progress */
+	if (self->progress_device != NULL && self->progress_device != device)
+		fu_engine_progress_flush (self);
+
+	/* always send the start and the end, otherwise only send updates that
+	 * are far enough apart in both time and value */
+	if (progress == 0 || progress == 100 ||
+	    (elapsed >= (gint64) interval &&
+	     (guint) ABS ((gint) progress - (gint) self->percentage) >= delta)) {
+		g_clear_object (&self->progress_device);
+		fu_engine_progress_emit (self, device);
+		return;
+	}
+
+	/* send the latest value once the progress has stopped changing, which
+	 * might not be until the plugin has finished writing */
+	g_set_object (&self->progress_device, device);
+	if (self->progress_id != 0)
+		g_source_remove (self->progress_id);
+	self->progress_id = g_timeout_add (MAX (interval, 1),
+					   fu_engine_progress_flush_cb,
+					   self);
 }
 
 static void
 fu_engine_status_notify_cb (FuDevice *device, GParamSpec *pspec, FuEngine *self)
 {
+	fu_engine_progress_flush (self);
 	fu_engine_set_status (self, fu_device_get_status (device));
 	fu_engine_emit_device_changed (self, device);
 }
 
+static void
+fu_engine_batch_changed_cb (FuDevice *device, FuEngine *self)
+{
+	fu_engine_emit_device_changed (self, device);
+}
+
 static void
 fu_engine_watch_device (FuEngine *self, FuDevice *device)
 {
@@ -226,17 +468,60 @@ fu_engine_watch_device (FuEngine *self, FuDevice *device)
 		g_signal_handlers_disconnect_by_func (device_old,
 						      fu_engine_status_notify_cb,
 						      self);
+		g_signal_handlers_disconnect_by_func (device_old,
+						      fu_engine_batch_changed_cb,
+						      self);
 	}
 	g_signal_connect (device, "notify::progress",
 			  G_CALLBACK (fu_engine_progress_notify_cb), self);
 	g_signal_connect (device, "notify::status",
 			  G_CALLBACK (fu_engine_status_notify_cb), self);
+	g_signal_connect (device, "batch-changed",
+			  G_CALLBACK (fu_engine_batch_changed_cb), self);
+}
+
+static void
+fu_engine_save_device_cache (FuEngine *self)
+{
+	g_autoptr(GError) error = NULL;
+	if (self->device_cache_save_id != 0) {
+		g_source_remove (self->device_cache_save_id);
+		self->device_cache_save_id = 0;
+	}
+	if (self->device_cache == NULL)
+		return;
+	if (!fu_device_cache_save (self->device_cache, &error))
+		g_warning ("Failed to save device cache: %s", error->message);
+}
+
+static gboolean
+fu_engine_save_device_cache_cb (gpointer user_data)
+{
+	FuEngine *self = FU_ENGINE (user_data);
+	self->device_cache_save_id = 0;
+	fu_engine_save_device_cache (self);
+	return FALSE;
+}
+
+/* devices hotplugged after startup are only set up once, so record them
+ * without writing the cache for every device in a burst of events */
+static void
+fu_engine_save_device_cache_delayed (FuEngine *self)
+{
+	if (self->device_cache == NULL)
+		return;
+	if (self->device_cache_save_id != 0)
+		g_source_remove (self->device_cache_save_id);
+	self->device_cache_save_id = g_timeout_add_seconds (FU_ENGINE_DEVICE_CACHE_SAVE_DELAY,
+							    fu_engine_save_device_cache_cb,
+							    self);
 }
 
 static void
 fu_engine_device_added_cb (FuDeviceList *device_list, FuDevice *device, FuEngine *self)
 {
 	fu_engine_watch_device (self, device);
+	fu_engine_save_device_cache_delayed (self);
 	g_signal_emit (self, signals[SIGNAL_DEVICE_ADDED], 0, device);
 }
 
@@ -255,6 +540,7 @@ fu_engine_device_removed_cb (FuDeviceList *device_list, FuDevice *device, FuEngi
 {
 	fu_engine_device_runner_device_removed (self, device);
 	g_signal_handlers_disconnect_by_data (device, self);
+	fu_engine_save_device_cache_delayed (self);
 	g_signal_emit (self, signals[SIGNAL_DEVICE_REMOVED], 0, device);
 }
 
@@ -617,16 +903,68 @@ fu_engine_modify_device (FuEngine *self,
 	return FALSE;
 }
 
-static const gchar *
-fu_engine_checksum_type_to_string (GChecksumType checksum_type)
+/* import the per-device XML file written by older versions, then delete it;
+ * checksums already in the database are never replaced */
+static gboolean
+fu_engine_verify_migrate (FuEngine *self, const gchar *device_id, GError **error)
 {
-	if (checksum_type == G_CHECKSUM_SHA1)
-		return "sha1";
-	if (checksum_type == G_CHECKSUM_SHA256)
-		return "sha256";
-	if (checksum_type == G_CHECKSUM_SHA512)
-		return "sha512";
-	return "sha1";
+	g_autofree gchar *fn = NULL;
+	g_autofree gchar *localstatedir = NULL;
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GFile) file = NULL;
+	g_autoptr(GPtrArray) releases = NULL;
+	g_autoptr(XbBuilder) builder = xb_builder_new ();
+	g_autoptr(XbBuilderSource) source = xb_builder_source_new ();
+	g_autoptr(XbSilo) silo = NULL;
+
+	/* nothing to do */
+	localstatedir = fu_common_get_path (FU_PATH_KIND_LOCALSTATEDIR_PKG);
+	fn = g_strdup_printf ("%s/verify/%s.xml", localstatedir, device_id);
+	file = g_file_new_for_path (fn);
+	if (!g_file_query_exists (file, NULL))
+		return TRUE;
+
+	/* load legacy silo */
+	if (!xb_builder_source_load_file (source, file,
+					  XB_BUILDER_SOURCE_FLAG_NONE,
+					  NULL, error))
+		return FALSE;
+	xb_builder_import_source (builder, source);
+	silo = xb_builder_compile (builder,
+				   XB_BUILDER_COMPILE_FLAG_NONE,
+				   NULL, error);
+	if (silo == NULL)
+		return FALSE;
+	releases = xb_silo_query (silo, "component/releases/release", 0, &error_local);
+	if (releases == NULL) {
+		if (!g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND)) {
+			g_propagate_error (error, g_steal_pointer (&error_local));
+			return FALSE;
+		}
+	} else {
+		for (guint i = 0; i < releases->len; i++) {
+			XbNode *release = g_ptr_array_index (releases, i);
+			g_autoptr(GPtrArray) checksums = g_ptr_array_new ();
+			g_autoptr(GPtrArray) csums = NULL;
+			csums = xb_node_query (release, "checksum", 0, NULL);
+			if (csums == NULL)
+				continue;
+			for (guint j = 0; j < csums->len; j++) {
+				XbNode *csum = g_ptr_array_index (csums, j);
+				g_ptr_array_add (checksums, (gpointer) xb_node_get_text (csum));
+			}
+			if (!fu_history_import_verify_checksums (self->history,
+								 device_id,
+								 xb_node_get_attr (release, "version"),
+								 checksums,
+								 error))
+				return FALSE;
+		}
+	}
+
+	/* never load this again */
+	g_debug ("migrated %s to history database", fn);
+	return g_file_delete (file, NULL, error);
 }
 
 /**
@@ -635,7 +973,7 @@ fu_engine_checksum_type_to_string (GChecksumType checksum_type)
  * @device_id: A device ID
  * @error: A #GError, or %NULL
  *
- * Updates the verification silo entry for a specific device.
+ * Updates the stored verification checksums for a specific device.
  *
  * Returns: %TRUE for success
  **/
@@ -644,17 +982,7 @@ fu_engine_verify_update (FuEngine *self, const gchar *device_id, GError **error)
 {
 	FuPlugin *plugin;
 	GPtrArray *checksums;
-	GPtrArray *guids;
-	g_autofree gchar *fn = NULL;
-	g_autofree gchar *localstatedir = NULL;
 	g_autoptr(FuDevice) device = NULL;
-	g_autoptr(GFile) file = NULL;
-	g_autoptr(XbBuilder) builder = xb_builder_new ();
-	g_autoptr(XbBuilderNode) component = NULL;
-	g_autoptr(XbBuilderNode) provides = NULL;
-	g_autoptr(XbBuilderNode) release = NULL;
-	g_autoptr(XbBuilderNode) releases = NULL;
-	g_autoptr(XbSilo) silo = NULL;
 
 	g_return_val_if_fail (FU_IS_ENGINE (self), FALSE);
 	g_return_val_if_fail (device_id != NULL, FALSE);
@@ -691,52 +1019,64 @@ fu_engine_verify_update (FuEngine *self, const gchar *device_id, GError **error)
 		return FALSE;
 	}
 
-	/* build XML */
-	component = xb_builder_node_insert (NULL, "component",
-					    "type", "firmware",
-					    NULL);
-	provides = xb_builder_node_insert (component, "provides", NULL);
-	guids = fu_device_get_guids (device);
-	for (guint i = 0; i < guids->len; i++) {
-		const gchar *guid = g_ptr_array_index (guids, i);
-		g_autoptr(XbBuilderNode) provide = NULL;
-		provide = xb_builder_node_insert (provides, "firmware",
-						  "type", "flashed",
-						  NULL);
-		xb_builder_node_set_text (provide, guid, -1);
-	}
-	releases = xb_builder_node_insert (component, "releases", NULL);
-	release = xb_builder_node_insert (releases, "release",
-					  "version", fu_device_get_version (device),
-					  NULL);
-	for (guint i = 0; i < checksums->len; i++) {
-		const gchar *checksum = g_ptr_array_index (checksums, i);
-		GChecksumType kind = fwupd_checksum_guess_kind (checksum);
-		g_autoptr(XbBuilderNode) csum = NULL;
-		csum = xb_builder_node_insert (release, "checksum",
-					       "type", fu_engine_checksum_type_to_string (kind),
-					       "target", "content",
-					       NULL);
-		xb_builder_node_set_text (csum, checksum, -1);
-	}
-	xb_builder_import_node (builder, component);
-
-	/* save silo */
-	localstatedir = fu_common_get_path (FU_PATH_KIND_LOCALSTATEDIR_PKG);
-	fn = g_strdup_printf ("%s/verify/%s.xml", localstatedir, device_id);
-	if (!fu_common_mkdir_parent (fn, error))
-		return FALSE;
-	file = g_file_new_for_path (fn);
-	silo = xb_builder_compile (builder, XB_BUILDER_COMPILE_FLAG_NONE, NULL, error);
-	if (silo == NULL)
+	/* the legacy file must never be imported over these checksums */
+	if (!fu_engine_verify_migrate (self, device_id, error))
 		return FALSE;
-	if (!xb_silo_export_file (silo, file,
-				  XB_NODE_EXPORT_FLAG_FORMAT_MULTILINE,
-				  NULL, error))
+
+	/* save to the database */
+	return fu_history_set_verify_checksums (self->history,
+						device_id,
+						fu_device_get_version (device),
+						checksums,
+						error);
+}
+
+/* the stored checksums are from fu_engine_verify_update() */
+static gboolean
+fu_engine_verify_stored (FuEngine *self,
+			 FuDevice *device,
+			 GPtrArray *checksums_stored,
+			 GError **error)
+{
+	GPtrArray *checksums = fu_device_get_checksums (device);
+	const gchar *version = fu_device_get_version (device);
+	g_autoptr(GString) checksums_device = g_string_new (NULL);
+	g_autoptr(GString) checksums_metadata = g_string_new (NULL);
+
+	if (checksums->len == 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_FOUND,
+			     "No device checksums for %s", version);
 		return FALSE;
+	}
+	for (guint i = 0; i < checksums->len; i++) {
+		const gchar *hash_tmp = g_ptr_array_index (checksums, i);
+		for (guint j = 0; j < checksums_stored->len; j++) {
+			const gchar *hash_stored = g_ptr_array_index (checksums_stored, j);
+			if (g_strcmp0 (hash_tmp, hash_stored) == 0)
+				return TRUE;
+		}
+	}
 
-	/* success */
-	return TRUE;
+	/* show all checksums in the error */
+	for (guint i = 0; i < checksums_stored->len; i++) {
+		const gchar *hash_tmp = g_ptr_array_index (checksums_stored, i);
+		xb_string_append_union (checksums_metadata, "%s", hash_tmp);
+	}
+	for (guint i = 0; i < checksums->len; i++) {
+		const gchar *hash_tmp = g_ptr_array_index (checksums, i);
+		xb_string_append_union (checksums_device, "%s", hash_tmp);
+	}
+	g_set_error (error,
+		     FWUPD_ERROR,
+		     FWUPD_ERROR_NOT_FOUND,
+		     "For %s %s expected %s, got %s",
+		     fu_device_get_name (device),
+		     version,
+		     checksums_metadata->str,
+		     checksums_device->str);
+	return FALSE;
 }
 
 XbNode *
@@ -758,13 +1098,73 @@ fu_engine_get_component_by_guids (FuEngine *self, FuDevice *device)
 	return NULL;
 }
 
+/* compares two versions using the packed integer keys where both versions
+ * could be represented, falling back to parsing the version strings */
+static gint
+fu_engine_vercmp_key (guint64 key_a, const gchar *version_a,
+		      guint64 key_b, const gchar *version_b,
+		      FwupdVersionFormat fmt)
+{
+	if (key_a != 0 && key_b != 0) {
+		if (key_a < key_b)
+			return -1;
+		if (key_a > key_b)
+			return 1;
+		return 0;
+	}
+	return fu_common_vercmp_full (version_a, version_b, fmt);
+}
+
+typedef struct {
+	gpointer		 obj;		/* no ref */
+	gchar			*version;
+	guint64			 key;
+	FwupdVersionFormat	 fmt;
+} FuEngineSortItem;
+
+static void
+fu_engine_sort_item_clear (gpointer data)
+{
+	FuEngineSortItem *item = (FuEngineSortItem *) data;
+	g_free (item->version);
+}
+
+static gint
+fu_engine_sort_item_cmp (gconstpointer a, gconstpointer b)
+{
+	const FuEngineSortItem *item_a = (const FuEngineSortItem *) a;
+	const FuEngineSortItem *item_b = (const FuEngineSortItem *) b;
+	return fu_engine_vercmp_key (item_a->key, item_a->version,
+				     item_b->key, item_b->version,
+				     item_a->fmt);
+}
+
+static gint
+fu_engine_sort_item_reverse_cmp (gconstpointer a, gconstpointer b)
+{
+	return fu_engine_sort_item_cmp (b, a);
+}
+
+/* sorts using the version parsed once for each object, rather than once for
+ * each comparison; the array is reordered in place without changing refs */
+static void
+fu_engine_sort_items_apply (GPtrArray *array, GArray *items, GCompareFunc func)
+{
+	g_array_sort (items, func);
+	for (guint i = 0; i < items->len; i++) {
+		FuEngineSortItem *item = &g_array_index (items, FuEngineSortItem, i);
+		array->pdata[i] = item->obj;
+	}
+}
+
 /**
  * fu_engine_verify:
  * @self: A #FuEngine
  * @device_id: A device ID
  * @error: A #GError, or %NULL
  *
- * Verifies a device firmware checksum using the verification silo entry.
+ * Verifies a device firmware checksum using the stored verification checksums,
+ * falling back to the checksums in the system metadata.
  *
  * Returns: %TRUE for success
  **/
@@ -772,16 +1172,15 @@ gboolean
 fu_engine_verify (FuEngine *self, const gchar *device_id, GError **error)
 {
 	FuPlugin *plugin;
+	FwupdVersionFormat fmt;
 	GPtrArray *checksums;
+	GPtrArray *guids;
 	const gchar *version;
-	g_autofree gchar *fn = NULL;
-	g_autofree gchar *localstatedir = NULL;
 	g_autoptr(FuDevice) device = NULL;
-	g_autoptr(GFile) file = NULL;
+	g_autoptr(GPtrArray) checksums_stored = NULL;
 	g_autoptr(GString) xpath_csum = g_string_new (NULL);
 	g_autoptr(XbNode) csum = NULL;
 	g_autoptr(XbNode) release = NULL;
-	g_autoptr(XbSilo) silo = xb_silo_new ();
 
 	g_return_val_if_fail (FU_IS_ENGINE (self), FALSE);
 	g_return_val_if_fail (device_id != NULL, FALSE);
@@ -806,56 +1205,46 @@ fu_engine_verify (FuEngine *self, const gchar *device_id, GError **error)
 			return FALSE;
 	}
 
-	/* find component in metadata */
+	/* use checksums saved with fu_engine_verify_update() */
+	if (!fu_engine_verify_migrate (self, device_id, error))
+		return FALSE;
 	version = fu_device_get_version (device);
-	localstatedir = fu_common_get_path (FU_PATH_KIND_LOCALSTATEDIR_PKG);
-	fn = g_strdup_printf ("%s/verify/%s.xml", localstatedir, device_id);
-	file = g_file_new_for_path (fn);
-	if (g_file_query_exists (file, NULL)) {
-		g_autofree gchar *xpath = NULL;
-		g_autoptr(XbBuilder) builder = xb_builder_new ();
-		g_autoptr(XbBuilderSource) source = xb_builder_source_new ();
-		if (!xb_builder_source_load_file (source, file,
-						  XB_BUILDER_SOURCE_FLAG_NONE,
-						  NULL, error))
-			return FALSE;
-		xb_builder_import_source (builder, source);
-		silo = xb_builder_compile (builder,
-					   XB_BUILDER_COMPILE_FLAG_NONE,
-					   NULL, error);
-		if (silo == NULL)
-			return FALSE;
-		xpath = g_strdup_printf ("component/releases/release[@version='%s']", version);
-		release = xb_silo_query_first (silo, xpath, NULL);
-	}
+	checksums_stored = fu_history_get_verify_checksums (self->history,
+							    device_id,
+							    version,
+							    error);
+	if (checksums_stored == NULL)
+		return FALSE;
+	if (checksums_stored->len > 0)
+		return fu_engine_verify_stored (self, device, checksums_stored, error);
 
-	/* try again with the system metadata */
-	if (release == NULL) {
-		GPtrArray *guids = fu_device_get_guids (device);
-		FwupdVersionFormat fmt = fu_device_get_version_format (device);
-		for (guint i = 0; i < guids->len; i++) {
-			const gchar *guid = g_ptr_array_index (guids, i);
-			g_autofree gchar *xpath2 = NULL;
-			g_autoptr(GPtrArray) releases = NULL;
-			xpath2 = g_strdup_printf ("components/component/"
-						  "provides/firmware[@type='flashed'][text()='%s']/"
-						  "../../releases/release",
-						  guid);
-			releases = xb_silo_query (self->silo, xpath2, 0, error);
-			if (releases == NULL)
-				return FALSE;
-			for (guint j = 0; j < releases->len; j++) {
-				XbNode *rel = g_ptr_array_index (releases, j);
-				const gchar *rel_ver = xb_node_get_attr (rel, "version");
-				g_autofree gchar *tmp_ver = fu_common_version_parse_from_format (rel_ver, fmt);
-				if (fu_common_vercmp_full (tmp_ver, version, fmt) == 0) {
-					release = g_object_ref (rel);
-					break;
-				}
-			}
-			if (release != NULL)
+	/* find component in metadata */
+	guids = fu_device_get_guids (device);
+	fmt = fu_device_get_version_format (device);
+	for (guint i = 0; i < guids->len; i++) {
+		const gchar *guid = g_ptr_array_index (guids, i);
+		g_autofree gchar *xpath2 = NULL;
+		g_autoptr(GPtrArray) releases = NULL;
+		xpath2 = g_strdup_printf ("components/component/"
+					  "provides/firmware[@type='flashed'][text()='%s']/"
+					  "../../releases/release",
+					  guid);
+		releases = xb_silo_query (self->silo, xpath2, 0, error);
+		if (releases == NULL)
+			return FALSE;
+		for (guint j = 0; j < releases->len; j++) {
+			XbNode *rel = g_ptr_array_index (releases, j);
+			const gchar *rel_ver = xb_node_get_attr (rel, "version");
+			g_autofree gchar *tmp_ver = fu_common_version_parse_from_format (rel_ver, fmt);
+			if (fu_engine_vercmp_key (fu_common_version_to_key (tmp_ver, fmt), tmp_ver,
+						  fu_device_get_version_key (device), version,
+						  fmt) == 0) {
+				release = g_object_ref (rel);
 				break;
+			}
 		}
+		if (release != NULL)
+			break;
 	}
 	if (release == NULL) {
 		g_set_error (error,
@@ -1279,8 +1668,8 @@ fu_engine_check_requirements (FuEngine *self, FuInstallTask *task,
 			      FwupdInstallFlags flags, GError **error)
 {
 	FuDevice *device = fu_install_task_get_device (task);
+	GPtrArray *reqs;
 	g_autoptr(GError) error_local = NULL;
-	g_autoptr(GPtrArray) reqs = NULL;
 
 	/* all install task checks require a device */
 	if (device != NULL) {
@@ -1289,8 +1678,8 @@ fu_engine_check_requirements (FuEngine *self, FuInstallTask *task,
 	}
 
 	/* do engine checks */
-	reqs = xb_node_query (fu_install_task_get_component (task),
-			      "requires/*", 0, &error_local);
+	reqs = fu_requirements_get_requires (fu_install_task_get_requirements (task),
+					     &error_local);
 	if (reqs == NULL) {
 		if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
 			return TRUE;
@@ -1888,51 +2277,32 @@ fu_engine_install_release (FuEngine *self,
 	return TRUE;
 }
 
-typedef struct {
-	gboolean	 ret;
-	GError		**error;
-	FuEngine	*self;
-	FuDevice	*device;
-} FuEngineSortHelper;
-
-static gint
-fu_engine_sort_release_versions_cb (gconstpointer a, gconstpointer b, gpointer user_data)
-{
-	FuEngineSortHelper *helper = (FuEngineSortHelper *) user_data;
-	XbNode *na = *((XbNode **) a);
-	XbNode *nb = *((XbNode **) b);
-	g_autofree gchar *va = NULL;
-	g_autofree gchar *vb = NULL;
-
-	/* already failed */
-	if (!helper->ret)
-		return 0;
-
-	/* get the semver from the release */
-	va = fu_engine_get_release_version (helper->self, helper->device, na, helper->error);
-	if (va == NULL) {
-		g_prefix_error (helper->error, "failed to get release version: ");
-		return 0;
-	}
-	vb = fu_engine_get_release_version (helper->self, helper->device, nb, helper->error);
-	if (vb == NULL) {
-		g_prefix_error (helper->error, "failed to get release version: ");
-		return 0;
-	}
-	return fu_common_vercmp_full (va, vb, fu_device_get_version_format (helper->device));
-}
-
 static gboolean
 fu_engine_sort_releases (FuEngine *self, FuDevice *device, GPtrArray *rels, GError **error)
 {
-	FuEngineSortHelper helper = {
-		.ret = TRUE,
-		.self = self,
-		.device = device,
-		.error = error,
-	};
-	g_ptr_array_sort_with_data (rels, fu_engine_sort_release_versions_cb, &helper);
-	return helper.ret;
+	FwupdVersionFormat fmt = fu_device_get_version_format (device);
+	g_autoptr(GArray) items = NULL;
+
+	items = g_array_sized_new (FALSE, FALSE, sizeof(FuEngineSortItem), rels->len);
+	g_array_set_clear_func (items, fu_engine_sort_item_clear);
+	for (guint i = 0; i < rels->len; i++) {
+		XbNode *rel = g_ptr_array_index (rels, i);
+		FuEngineSortItem item = {
+			.obj = rel,
+			.fmt = fmt,
+		};
+
+		/* get the semver from the release */
+		item.version = fu_engine_get_release_version (self, device, rel, error);
+		if (item.version == NULL) {
+			g_prefix_error (error, "failed to get release version: ");
+			return FALSE;
+		}
+		item.key = fu_common_version_to_key (item.version, fmt);
+		g_array_append_val (items, item);
+	}
+	fu_engine_sort_items_apply (rels, items, fu_engine_sort_item_cmp);
+	return TRUE;
 }
 
 /**
@@ -2851,10 +3221,12 @@ fu_engine_md_refresh_devices (FuEngine *self)
 		g_autoptr(XbNode) component = fu_engine_get_component_by_guids (self, device);
 
 		/* set or clear the SUPPORTED flag */
+		fu_device_batch_begin (device);
 		fu_engine_ensure_device_supported (self, device);
 
 		/* fixup the name and format as needed */
 		fu_engine_md_refresh_device_from_component (self, device, component);
+		fu_device_batch_commit (device);
 	}
 }
 
@@ -2978,10 +3350,21 @@ fu_engine_load_metadata_store (FuEngine *self, FuEngineLoadFlags flags, GError *
 	return TRUE;
 }
 
+static void
+fu_engine_history_prune (FuEngine *self)
+{
+	guint64 max_age = (guint64) fu_config_get_history_max_age (self->config) * 24 * 60 * 60;
+	guint max_entries = fu_config_get_history_max_entries (self->config);
+	g_autoptr(GError) error_local = NULL;
+	if (!fu_history_prune (self->history, max_age, max_entries, &error_local))
+		g_warning ("failed to prune history: %s", error_local->message);
+}
+
 static void
 fu_engine_config_changed_cb (FuConfig *config, FuEngine *self)
 {
 	fu_idle_set_timeout (self->idle, fu_config_get_idle_timeout (config));
+	fu_engine_history_prune (self);
 }
 
 static void
@@ -3489,9 +3872,10 @@ fu_engine_sort_devices_by_priority_name (gconstpointer a, gconstpointer b)
  * @self: A #FuEngine
  * @error: A #GError, or %NULL
  *
- * Gets the list of devices.
+ * Gets the list of devices, sorted by priority and then name.
  *
- * Returns: (transfer container) (element-type FwupdDevice): results
+ * Returns: (transfer full) (element-type FwupdDevice): a new reference to a
+ * shared array of devices, which must not be modified
  **/
 GPtrArray *
 fu_engine_get_devices (FuEngine *self, GError **error)
@@ -3501,7 +3885,7 @@ fu_engine_get_devices (FuEngine *self, GError **error)
 	g_return_val_if_fail (FU_IS_ENGINE (self), NULL);
 	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
-	devices = fu_device_list_get_active (self->device_list);
+	devices = fu_device_list_get_active_sorted (self->device_list);
 	if (devices->len == 0) {
 		g_set_error_literal (error,
 				     FWUPD_ERROR,
@@ -3509,7 +3893,6 @@ fu_engine_get_devices (FuEngine *self, GError **error)
 				     "No detected devices");
 		return NULL;
 	}
-	g_ptr_array_sort (devices, fu_engine_sort_devices_by_priority_name);
 	return g_steal_pointer (&devices);
 }
 
@@ -3584,14 +3967,44 @@ fu_engine_get_devices_by_guid (FuEngine *self, const gchar *guid, GError **error
 GPtrArray *
 fu_engine_get_history (FuEngine *self, GError **error)
 {
-	g_autoptr(GPtrArray) devices = NULL;
-
-	g_return_val_if_fail (FU_IS_ENGINE (self), NULL);
-	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+	return fu_engine_get_history_full (self, NULL,
+					   FWUPD_UPDATE_STATE_UNKNOWN,
+					   0, 0, 0, error);
+}
 
-	devices = fu_history_get_devices (self->history, error);
-	if (devices == NULL)
-		return NULL;
+/**
+ * fu_engine_get_history_full:
+ * @self: A #FuEngine
+ * @device_id: (nullable): A device ID, or %NULL for all devices
+ * @update_state: A #FwupdUpdateState, or %FWUPD_UPDATE_STATE_UNKNOWN for all states
+ * @since: Only return devices modified at or after this UNIX time, or 0
+ * @offset: Number of matching devices to skip
+ * @limit: Maximum number of devices to return, or 0 for no limit
+ * @error: A #GError, or %NULL
+ *
+ * Gets a filtered page of the history.
+ *
+ * Returns: (transfer container) (element-type FwupdDevice): results
+ **/
+GPtrArray *
+fu_engine_get_history_full (FuEngine *self,
+			    const gchar *device_id,
+			    FwupdUpdateState update_state,
+			    guint64 since,
+			    guint offset,
+			    guint limit,
+			    GError **error)
+{
+	g_autoptr(GPtrArray) devices = NULL;
+
+	g_return_val_if_fail (FU_IS_ENGINE (self), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	devices = fu_history_get_devices_full (self->history, device_id,
+					       update_state, since,
+					       offset, limit, error);
+	if (devices == NULL)
+		return NULL;
 	if (devices->len == 0) {
 		g_set_error_literal (error,
 				     FWUPD_ERROR,
@@ -3627,6 +4040,40 @@ fu_engine_get_history (FuEngine *self, GError **error)
 	return g_steal_pointer (&devices);
 }
 
+/**
+ * fu_engine_get_trace:
+ * @self: A #FuEngine
+ *
+ * Gets the recorder used for the startup timing. Recording is enabled by
+ * setting `FWUPD_TRACE` in the environment, or by enabling it before
+ * fu_engine_load() is called, and is disabled when the engine has loaded.
+ *
+ * Returns: (transfer none): a #FuTrace
+ **/
+FuTrace *
+fu_engine_get_trace (FuEngine *self)
+{
+	g_return_val_if_fail (FU_IS_ENGINE (self), NULL);
+	return self->trace;
+}
+
+/**
+ * fu_engine_get_alloc_stats:
+ * @self: A #FuEngine
+ *
+ * Gets the memory accounting for engine phases. Recording is enabled by
+ * setting `FWUPD_ALLOC_STATS` in the environment, or by enabling it before
+ * fu_engine_load() is called.
+ *
+ * Returns: (transfer none): a #FuAllocStats
+ **/
+FuAllocStats *
+fu_engine_get_alloc_stats (FuEngine *self)
+{
+	g_return_val_if_fail (FU_IS_ENGINE (self), NULL);
+	return self->alloc_stats;
+}
+
 /**
  * fu_engine_get_remotes:
  * @self: A #FuEngine
@@ -3687,15 +4134,26 @@ fu_engine_get_remote_by_id (FuEngine *self, const gchar *remote_id, GError **err
 }
 
 
-static gint
-fu_engine_sort_releases_cb (gconstpointer a, gconstpointer b, gpointer user_data)
+/* newest release first */
+static void
+fu_engine_sort_releases_for_device (FuDevice *device, GPtrArray *releases)
 {
-	FuDevice *device = FU_DEVICE (user_data);
-	FwupdRelease *rel_a = FWUPD_RELEASE (*((FwupdRelease **) a));
-	FwupdRelease *rel_b = FWUPD_RELEASE (*((FwupdRelease **) b));
-	return fu_common_vercmp_full (fwupd_release_get_version (rel_b),
-				      fwupd_release_get_version (rel_a),
-				      fu_device_get_version_format (device));
+	FwupdVersionFormat fmt = fu_device_get_version_format (device);
+	g_autoptr(GArray) items = NULL;
+
+	items = g_array_sized_new (FALSE, FALSE, sizeof(FuEngineSortItem), releases->len);
+	g_array_set_clear_func (items, fu_engine_sort_item_clear);
+	for (guint i = 0; i < releases->len; i++) {
+		FwupdRelease *rel = g_ptr_array_index (releases, i);
+		FuEngineSortItem item = {
+			.obj = rel,
+			.version = g_strdup (fwupd_release_get_version (rel)),
+			.fmt = fmt,
+		};
+		item.key = fu_common_version_to_key (item.version, fmt);
+		g_array_append_val (items, item);
+	}
+	fu_engine_sort_items_apply (releases, items, fu_engine_sort_item_reverse_cmp);
 }
 
 static gboolean
@@ -3773,9 +4231,11 @@ fu_engine_add_releases_for_device_component (FuEngine *self,
 			continue;
 
 		/* test for upgrade or downgrade */
-		vercmp = fu_common_vercmp_full (fwupd_release_get_version (rel),
-						fu_device_get_version (device),
-						fmt);
+		vercmp = fu_engine_vercmp_key (fu_common_version_to_key (fwupd_release_get_version (rel), fmt),
+					       fwupd_release_get_version (rel),
+					       fu_device_get_version_key (device),
+					       fu_device_get_version (device),
+					       fmt);
 		if (vercmp > 0)
 			fwupd_release_add_flag (rel, FWUPD_RELEASE_FLAG_IS_UPGRADE);
 		else if (vercmp < 0)
@@ -3814,8 +4274,8 @@ fu_engine_add_releases_for_device_component (FuEngine *self,
 	return TRUE;
 }
 
-GPtrArray *
-fu_engine_get_releases_for_device (FuEngine *self, FuDevice *device, GError **error)
+static GPtrArray *
+fu_engine_get_releases_for_device_internal (FuEngine *self, FuDevice *device, GError **error)
 {
 	GPtrArray *device_guids;
 	GPtrArray *releases;
@@ -3903,6 +4363,16 @@ fu_engine_get_releases_for_device (FuEngine *self, FuDevice *device, GError **er
 	return releases;
 }
 
+GPtrArray *
+fu_engine_get_releases_for_device (FuEngine *self, FuDevice *device, GError **error)
+{
+	GPtrArray *releases;
+	fu_alloc_stats_begin (self->alloc_stats, "engine", "get-releases-for-device");
+	releases = fu_engine_get_releases_for_device_internal (self, device, error);
+	fu_alloc_stats_end (self->alloc_stats);
+	return releases;
+}
+
 /**
  * fu_engine_get_releases:
  * @self: A #FuEngine
@@ -3939,7 +4409,7 @@ fu_engine_get_releases (FuEngine *self, const gchar *device_id, GError **error)
 				     "No releases for device");
 		return NULL;
 	}
-	g_ptr_array_sort_with_data (releases, fu_engine_sort_releases_cb, device);
+	fu_engine_sort_releases_for_device (device, releases);
 	return g_steal_pointer (&releases);
 }
 
@@ -4029,7 +4499,7 @@ fu_engine_get_downgrades (FuEngine *self, const gchar *device_id, GError **error
 		}
 		return NULL;
 	}
-	g_ptr_array_sort_with_data (releases, fu_engine_sort_releases_cb, device);
+	fu_engine_sort_releases_for_device (device, releases);
 	return g_steal_pointer (&releases);
 }
 
@@ -4176,7 +4646,7 @@ fu_engine_get_upgrades (FuEngine *self, const gchar *device_id, GError **error)
 		}
 		return NULL;
 	}
-	g_ptr_array_sort_with_data (releases, fu_engine_sort_releases_cb, device);
+	fu_engine_sort_releases_for_device (device, releases);
 	return g_steal_pointer (&releases);
 }
 
@@ -4274,10 +4744,12 @@ fu_engine_plugins_setup (FuEngine *self)
 	for (guint i = 0; i < plugins->len; i++) {
 		g_autoptr(GError) error = NULL;
 		FuPlugin *plugin = g_ptr_array_index (plugins, i);
+		fu_trace_begin (self->trace, "plugin", fu_plugin_get_name (plugin));
 		if (!fu_plugin_runner_startup (plugin, &error)) {
 			fu_plugin_set_enabled (plugin, FALSE);
 			g_message ("disabling plugin because: %s", error->message);
 		}
+		fu_trace_end (self->trace);
 	}
 }
 
@@ -4292,12 +4764,16 @@ fu_engine_plugins_coldplug (FuEngine *self, gboolean is_recoldplug)
 
 	/* prepare */
 	plugins = fu_plugin_list_get_all (self->plugin_list);
+	fu_trace_begin (self->trace, "phase", "coldplug-prepare");
 	for (guint i = 0; i < plugins->len; i++) {
 		g_autoptr(GError) error = NULL;
 		FuPlugin *plugin = g_ptr_array_index (plugins, i);
+		fu_trace_begin (self->trace, "plugin", fu_plugin_get_name (plugin));
 		if (!fu_plugin_runner_coldplug_prepare (plugin, &error))
 			g_warning ("failed to prepare coldplug: %s", error->message);
+		fu_trace_end (self->trace);
 	}
+	fu_trace_end (self->trace);
 
 	/* do this in one place */
 	if (self->coldplug_delay > 0) {
@@ -4306,9 +4782,12 @@ fu_engine_plugins_coldplug (FuEngine *self, gboolean is_recoldplug)
 	}
 
 	/* exec */
+	fu_trace_begin (self->trace, "phase", is_recoldplug ? "recoldplug" : "coldplug");
+	fu_alloc_stats_begin (self->alloc_stats, "phase", is_recoldplug ? "recoldplug" : "coldplug");
 	for (guint i = 0; i < plugins->len; i++) {
 		g_autoptr(GError) error = NULL;
 		FuPlugin *plugin = g_ptr_array_index (plugins, i);
+		fu_trace_begin (self->trace, "plugin", fu_plugin_get_name (plugin));
 		if (is_recoldplug) {
 			if (!fu_plugin_runner_recoldplug (plugin, &error))
 				g_message ("failed recoldplug: %s", error->message);
@@ -4319,15 +4798,22 @@ fu_engine_plugins_coldplug (FuEngine *self, gboolean is_recoldplug)
 					   error->message);
 			}
 		}
+		fu_trace_end (self->trace);
 	}
+	fu_alloc_stats_end (self->alloc_stats);
+	fu_trace_end (self->trace);
 
 	/* cleanup */
+	fu_trace_begin (self->trace, "phase", "coldplug-cleanup");
 	for (guint i = 0; i < plugins->len; i++) {
 		g_autoptr(GError) error = NULL;
 		FuPlugin *plugin = g_ptr_array_index (plugins, i);
+		fu_trace_begin (self->trace, "plugin", fu_plugin_get_name (plugin));
 		if (!fu_plugin_runner_coldplug_cleanup (plugin, &error))
 			g_warning ("failed to cleanup coldplug: %s", error->message);
+		fu_trace_end (self->trace);
 	}
+	fu_trace_end (self->trace);
 
 	/* print what we do have */
 	for (guint i = 0; i < plugins->len; i++) {
@@ -4387,7 +4873,9 @@ fu_engine_plugin_device_added_cb (FuPlugin *plugin,
 		fu_device_set_priority (device, fu_plugin_get_priority (plugin));
 	}
 
+	fu_trace_begin (self->trace, "device", fu_device_get_id (device));
 	fu_engine_add_device (self, device);
+	fu_trace_end (self->trace);
 }
 
 static void
@@ -4463,9 +4951,9 @@ fu_engine_set_proxy_device (FuEngine *self, FuDevice *device)
 
 	/* are we the parent of an existing device */
 	guids = fu_device_get_guids (device);
+	devices = fu_device_list_get_active (self->device_list);
 	for (guint j = 0; j < guids->len; j++) {
 		const gchar *guid = g_ptr_array_index (guids, j);
-		devices = fu_device_list_get_active (self->device_list);
 		for (guint i = 0; i < devices->len; i++) {
 			FuDevice *device_tmp = g_ptr_array_index (devices, i);
 			if (g_strcmp0 (fu_device_get_proxy_guid (device_tmp), guid) == 0) {
@@ -4708,12 +5196,184 @@ fu_engine_recoldplug_delay_cb (gpointer user_data)
 	return FALSE;
 }
 
-#ifdef HAVE_GUDEV
 static void
-fu_engine_udev_device_add (FuEngine *self, GUdevDevice *udev_device)
+fu_engine_plugin_routes_add_cb (FuQuirks *quirks,
+				const gchar *guid,
+				const gchar *value,
+				gpointer user_data)
+{
+	GHashTable *routes = (GHashTable *) user_data;
+	GPtrArray *values;
+
+	if (guid == NULL || value == NULL)
+		return;
+	values = g_hash_table_lookup (routes, guid);
+	if (values == NULL) {
+		values = g_ptr_array_new_with_free_func (g_free);
+		g_hash_table_insert (routes, g_strdup (guid), values);
+	}
+	g_ptr_array_add (values, g_strdup (value));
+}
+
+/* build a table of which plugins can handle each quirk group so that
+ * devices nothing can handle are never probed */
+static void
+fu_engine_load_plugin_routes (FuEngine *self)
+{
+	g_hash_table_remove_all (self->plugin_routes);
+	g_hash_table_remove_all (self->plugin_route_links);
+	fu_quirks_lookup_by_key_iter (self->quirks, FU_QUIRKS_PLUGIN,
+				      fu_engine_plugin_routes_add_cb,
+				      self->plugin_routes);
+	fu_quirks_lookup_by_key_iter (self->quirks, FU_QUIRKS_GUID,
+				      fu_engine_plugin_routes_add_cb,
+				      self->plugin_route_links);
+	self->plugin_routes_valid = TRUE;
+	g_debug ("%u quirk groups set a plugin",
+		 g_hash_table_size (self->plugin_routes));
+}
+
+static void
+fu_engine_quirks_changed_cb (FuQuirks *quirks, FuEngine *self)
+{
+	self->plugin_routes_valid = FALSE;
+}
+
+static void
+fu_engine_plugin_routes_lookup (FuEngine *self,
+				const gchar *guid,
+				GHashTable *plugin_names,
+				guint depth)
+{
+	GPtrArray *values;
+
+	/* the Guid quirk adds another GUID, which may have more quirks */
+	if (depth > FU_ENGINE_PLUGIN_ROUTES_DEPTH_MAX)
+		return;
+	values = g_hash_table_lookup (self->plugin_routes, guid);
+	if (values != NULL) {
+		for (guint i = 0; i < values->len; i++) {
+			const gchar *plugin_name = g_ptr_array_index (values, i);
+			g_hash_table_add (plugin_names, (gpointer) plugin_name);
+		}
+	}
+	values = g_hash_table_lookup (self->plugin_route_links, guid);
+	if (values != NULL) {
+		for (guint i = 0; i < values->len; i++) {
+			const gchar *tmp = g_ptr_array_index (values, i);
+			g_autofree gchar *guid_tmp = NULL;
+			if (fwupd_guid_is_valid (tmp)) {
+				fu_engine_plugin_routes_lookup (self, tmp, plugin_names, depth + 1);
+				continue;
+			}
+			guid_tmp = fwupd_guid_hash_string (tmp);
+			fu_engine_plugin_routes_lookup (self, guid_tmp, plugin_names, depth + 1);
+		}
+	}
+}
+
+/* returns the enabled plugins that any of the instance IDs are routed to */
+GPtrArray *
+fu_engine_get_routed_plugins (FuEngine *self, GPtrArray *instance_ids)
+{
+	GPtrArray *plugins;
+	GPtrArray *routed;
+	g_autoptr(GHashTable) plugin_names = g_hash_table_new (g_str_hash, g_str_equal);
+
+	g_return_val_if_fail (FU_IS_ENGINE (self), NULL);
+	g_return_val_if_fail (instance_ids != NULL, NULL);
+
+	/* the quirks are loaded again when first used after a file changes */
+	if (!self->plugin_routes_valid || !fu_quirks_is_valid (self->quirks))
+		fu_engine_load_plugin_routes (self);
+
+	plugins = fu_plugin_list_get_all (self->plugin_list);
+	routed = g_ptr_array_new ();
+	for (guint i = 0; i < instance_ids->len; i++) {
+		const gchar *instance_id = g_ptr_array_index (instance_ids, i);
+		g_autofree gchar *guid = fwupd_guid_hash_string (instance_id);
+		fu_engine_plugin_routes_lookup (self, guid, plugin_names, 0);
+	}
+	if (g_hash_table_size (plugin_names) == 0)
+		return routed;
+	for (guint i = 0; i < plugins->len; i++) {
+		FuPlugin *plugin = g_ptr_array_index (plugins, i);
+		if (!fu_plugin_get_enabled (plugin))
+			continue;
+		if (g_hash_table_contains (plugin_names, fu_plugin_get_name (plugin)))
+			g_ptr_array_add (routed, plugin);
+	}
+	return routed;
+}
+
+#ifdef HAVE_GUDEV
+/* this has to match the instance IDs added in fu_udev_device_probe() */
+static GPtrArray *
+fu_engine_udev_device_get_instance_ids (GUdevDevice *udev_device)
+{
+	GPtrArray *instance_ids = g_ptr_array_new_with_free_func (g_free);
+	guint64 vendor;
+	guint64 model;
+	guint64 revision;
+	g_autofree gchar *subsystem = NULL;
+
+	subsystem = g_ascii_strup (g_udev_device_get_subsystem (udev_device), -1);
+	if (subsystem == NULL)
+		return instance_ids;
+	g_ptr_array_add (instance_ids, g_strdup (subsystem));
+
+	/* hidraw gets the IDs from the parent, so always probe */
+	vendor = fu_common_strtoull (g_udev_device_get_sysfs_attr (udev_device, "vendor"));
+	model = fu_common_strtoull (g_udev_device_get_sysfs_attr (udev_device, "device"));
+	revision = fu_common_strtoull (g_udev_device_get_sysfs_attr (udev_device, "revision"));
+	if (vendor == 0x0 && model == 0x0 && revision == 0x0 &&
+	    g_strcmp0 (subsystem, "HIDRAW") == 0) {
+		g_ptr_array_unref (instance_ids);
+		return NULL;
+	}
+	if (vendor > G_MAXUINT32 || model > G_MAXUINT32 || revision > G_MAXUINT8) {
+		g_ptr_array_unref (instance_ids);
+		return NULL;
+	}
+	if (vendor != 0x0000 && model != 0x0000) {
+		g_ptr_array_add (instance_ids,
+				 g_strdup_printf ("%s\\VEN_%04X&DEV_%04X&REV_%02X",
+						  subsystem, (guint) vendor,
+						  (guint) model, (guint) revision));
+		g_ptr_array_add (instance_ids,
+				 g_strdup_printf ("%s\\VEN_%04X&DEV_%04X",
+						  subsystem, (guint) vendor,
+						  (guint) model));
+	}
+	if (vendor != 0x0000) {
+		g_ptr_array_add (instance_ids,
+				 g_strdup_printf ("%s\\VEN_%04X",
+						  subsystem, (guint) vendor));
+	}
+	return instance_ids;
+}
+
+static FuUdevDevice *
+fu_engine_udev_device_probe (FuEngine *self, GUdevDevice *udev_device)
 {
 	g_autoptr(FuUdevDevice) device = fu_udev_device_new (udev_device);
 	g_autoptr(GError) error_local = NULL;
+
+	fu_device_set_quirks (FU_DEVICE (device), self->quirks);
+	if (!fu_device_probe (FU_DEVICE (device), &error_local)) {
+		g_warning ("failed to probe device %s: %s",
+			   g_udev_device_get_sysfs_path (udev_device),
+			   error_local->message);
+		return NULL;
+	}
+	return g_steal_pointer (&device);
+}
+
+static void
+fu_engine_udev_device_add (FuEngine *self, GUdevDevice *udev_device)
+{
+	g_autoptr(FuUdevDevice) device = NULL;
+	g_autoptr(GPtrArray) instance_ids = NULL;
 	g_autoptr(GPtrArray) possible_plugins = NULL;
 
 	/* debug */
@@ -4722,13 +5382,30 @@ fu_engine_udev_device_add (FuEngine *self, GUdevDevice *udev_device)
 			 g_udev_device_get_sysfs_path (udev_device));
 	}
 
+	/* no plugin can handle this device */
+	instance_ids = fu_engine_udev_device_get_instance_ids (udev_device);
+	if (instance_ids != NULL) {
+		g_autoptr(GPtrArray) routed = fu_engine_get_routed_plugins (self, instance_ids);
+		if (routed->len == 0) {
+			if (g_getenv ("FWUPD_PROBE_VERBOSE") != NULL) {
+				g_debug ("UDEV %s has no plugin, ignoring",
+					 g_udev_device_get_sysfs_path (udev_device));
+			}
+			return;
+		}
+	}
+
 	/* add any extra quirks */
-	fu_device_set_quirks (FU_DEVICE (device), self->quirks);
-	if (!fu_device_probe (FU_DEVICE (device), &error_local)) {
-		g_warning ("failed to probe device %s: %s",
-			   g_udev_device_get_sysfs_path (udev_device),
-			   error_local->message);
+	device = fu_engine_udev_device_probe (self, udev_device);
+	if (device == NULL)
 		return;
+
+	/* quirks may reference types registered by plugins not yet open */
+	if (fu_engine_open_plugins_for_device (self, FU_DEVICE (device))) {
+		g_object_unref (device);
+		device = fu_engine_udev_device_probe (self, udev_device);
+		if (device == NULL)
+			return;
 	}
 
 	/* can be specified using a quirk */
@@ -4736,6 +5413,7 @@ fu_engine_udev_device_add (FuEngine *self, GUdevDevice *udev_device)
 	for (guint i = 0; i < possible_plugins->len; i++) {
 		FuPlugin *plugin;
 		const gchar *plugin_name = g_ptr_array_index (possible_plugins, i);
+		gboolean ret;
 		g_autoptr(GError) error = NULL;
 
 		plugin = fu_plugin_list_find_by_name (self->plugin_list,
@@ -4745,7 +5423,10 @@ fu_engine_udev_device_add (FuEngine *self, GUdevDevice *udev_device)
 				 plugin_name, error->message);
 			continue;
 		}
-		if (!fu_plugin_runner_udev_device_added (plugin, device, &error)) {
+		fu_trace_begin (self->trace, "plugin", plugin_name);
+		ret = fu_plugin_runner_udev_device_added (plugin, device, &error);
+		fu_trace_end (self->trace);
+		if (!ret) {
 			if (g_error_matches (error, FWUPD_ERROR, FWUPD_ERROR_NOT_SUPPORTED)) {
 				if (g_getenv ("FWUPD_PROBE_VERBOSE") != NULL) {
 					g_debug ("%s ignoring: %s",
@@ -4763,24 +5444,28 @@ fu_engine_udev_device_add (FuEngine *self, GUdevDevice *udev_device)
 }
 
 static void
-fu_engine_udev_device_remove (FuEngine *self, GUdevDevice *udev_device)
+fu_engine_udev_devices_remove (FuEngine *self, GHashTable *sysfs_paths)
 {
 	g_autoptr(GPtrArray) devices = NULL;
 
 	/* debug */
 	if (g_getenv ("FWUPD_PROBE_VERBOSE") != NULL) {
-		g_debug ("UDEV %s removed",
-			 g_udev_device_get_sysfs_path (udev_device));
+		GHashTableIter iter;
+		gpointer key;
+		g_hash_table_iter_init (&iter, sysfs_paths);
+		while (g_hash_table_iter_next (&iter, &key, NULL))
+			g_debug ("UDEV %s removed", (const gchar *) key);
 	}
 
-	/* go through each device and remove any that match */
+	/* go through each device once and remove any that match */
 	devices = fu_device_list_get_all (self->device_list);
 	for (guint i = 0; i < devices->len; i++) {
 		FuDevice *device = g_ptr_array_index (devices, i);
+		const gchar *sysfs_path;
 		if (!FU_IS_UDEV_DEVICE (device))
 			continue;
-		if (g_strcmp0 (fu_udev_device_get_sysfs_path (FU_UDEV_DEVICE (device)),
-			       g_udev_device_get_sysfs_path (udev_device)) == 0) {
+		sysfs_path = fu_udev_device_get_sysfs_path (FU_UDEV_DEVICE (device));
+		if (sysfs_path != NULL && g_hash_table_contains (sysfs_paths, sysfs_path)) {
 			g_debug ("auto-removing GUdevDevice");
 			fu_device_list_remove (self->device_list, device);
 		}
@@ -4818,11 +5503,27 @@ fu_engine_udev_changed_cb (gpointer user_data)
 	FuEngineUdevChangedHelper *helper = (FuEngineUdevChangedHelper *) user_data;
 	GPtrArray *plugins = fu_plugin_list_get_all (helper->self->plugin_list);
 	g_autoptr(FuUdevDevice) device = fu_udev_device_new (helper->udev_device);
+	g_autoptr(GPtrArray) instance_ids = NULL;
+	g_autoptr(GPtrArray) routed = NULL;
 
-	/* run all plugins */
+	/* the generic fallback only makes sense for plugins handling the device */
+	instance_ids = fu_engine_udev_device_get_instance_ids (helper->udev_device);
+	if (instance_ids != NULL)
+		routed = fu_engine_get_routed_plugins (helper->self, instance_ids);
+
+	/* run all plugins that implement the vfunc or can handle the device */
 	for (guint j = 0; j < plugins->len; j++) {
 		FuPlugin *plugin_tmp = g_ptr_array_index (plugins, j);
+		gboolean is_routed = routed == NULL;
 		g_autoptr(GError) error = NULL;
+		for (guint i = 0; routed != NULL && i < routed->len; i++) {
+			if (g_ptr_array_index (routed, i) == plugin_tmp) {
+				is_routed = TRUE;
+				break;
+			}
+		}
+		if (!is_routed && !fu_plugin_has_vfunc (plugin_tmp, "udev_device_changed"))
+			continue;
 		if (!fu_plugin_runner_udev_device_changed (plugin_tmp, device, &error)) {
 			if (g_error_matches (error, FWUPD_ERROR, FWUPD_ERROR_NOT_SUPPORTED)) {
 				g_debug ("%s ignoring: %s",
@@ -4874,6 +5575,70 @@ fu_engine_udev_device_changed (FuEngine *self, GUdevDevice *udev_device)
 	g_hash_table_insert (self->udev_changed_ids, g_strdup (sysfs_path), helper);
 }
 
+/* a parent sysfs path is always a prefix of the child, so sorting by path
+ * means parents are always added before children */
+static void
+fu_engine_udev_events_flush (FuEngine *self)
+{
+	g_autoptr(GHashTable) removed = g_hash_table_new (g_str_hash, g_str_equal);
+	g_autoptr(GPtrArray) events = NULL;
+
+	/* new events may arrive while the plugins are running */
+	events = fu_udev_batch_steal (self->udev_batch);
+	g_debug ("processing %u batched uevents", events->len);
+
+	/* remove everything in one pass of the device list */
+	for (guint i = 0; i < events->len; i++) {
+		FuUdevBatchEvent *event = g_ptr_array_index (events, i);
+		if (event->actions & FU_UDEV_BATCH_ACTION_REMOVE)
+			g_hash_table_add (removed, event->sysfs_path);
+	}
+	if (g_hash_table_size (removed) > 0)
+		fu_engine_udev_devices_remove (self, removed);
+
+	/* parents first */
+	for (guint i = 0; i < events->len; i++) {
+		FuUdevBatchEvent *event = g_ptr_array_index (events, i);
+		if (event->actions & FU_UDEV_BATCH_ACTION_ADD)
+			fu_engine_udev_device_add (self, G_UDEV_DEVICE (event->device));
+	}
+	for (guint i = 0; i < events->len; i++) {
+		FuUdevBatchEvent *event = g_ptr_array_index (events, i);
+		if (event->actions == FU_UDEV_BATCH_ACTION_CHANGE)
+			fu_engine_udev_device_changed (self, G_UDEV_DEVICE (event->device));
+	}
+}
+
+static gboolean
+fu_engine_udev_events_cb (gpointer user_data)
+{
+	FuEngine *self = FU_ENGINE (user_data);
+	self->udev_events_id = 0;
+	fu_engine_udev_events_flush (self);
+	return G_SOURCE_REMOVE;
+}
+
+static void
+fu_engine_udev_events_add (FuEngine *self, GUdevDevice *udev_device, FuUdevBatchAction action)
+{
+	/* merge with any event for the same path in this window */
+	fu_udev_batch_add (self->udev_batch,
+			   g_udev_device_get_sysfs_path (udev_device),
+			   G_OBJECT (udev_device),
+			   action);
+
+	/* process now, or at the end of the window */
+	if (self->app_flags & FU_APP_FLAGS_NO_IDLE_SOURCES) {
+		fu_engine_udev_events_flush (self);
+		return;
+	}
+	if (self->udev_events_id == 0) {
+		self->udev_events_id = g_timeout_add (FU_ENGINE_UDEV_EVENTS_DELAY,
+						      fu_engine_udev_events_cb,
+						      self);
+	}
+}
+
 static void
 fu_engine_enumerate_udev (FuEngine *self)
 {
@@ -4886,7 +5651,10 @@ fu_engine_enumerate_udev (FuEngine *self)
 			 g_list_length (devices), subsystem);
 		for (GList *l = devices; l != NULL; l = l->next) {
 			GUdevDevice *udev_device = l->data;
+			fu_trace_begin (self->trace, "device",
+					g_udev_device_get_sysfs_path (udev_device));
 			fu_engine_udev_device_add (self, udev_device);
+			fu_trace_end (self->trace);
 		}
 		g_list_foreach (devices, (GFunc) g_object_unref, NULL);
 		g_list_free (devices);
@@ -4923,26 +5691,12 @@ fu_engine_plugin_set_coldplug_delay_cb (FuPlugin *plugin, guint duration, FuEngi
 		 duration, self->coldplug_delay);
 }
 
-/* this is called by the self tests as well */
+/* this is called by the self tests, which open the plugin themselves */
 void
 fu_engine_add_plugin (FuEngine *self, FuPlugin *plugin)
 {
-	if (fu_plugin_is_open (plugin)) {
-		/* plugin does not match built version */
-		if (fu_plugin_get_build_hash (plugin) == NULL) {
-			const gchar *name = fu_plugin_get_name (plugin);
-			g_warning ("%s should call fu_plugin_set_build_hash()",
-				   name);
-			self->tainted = TRUE;
-		} else if (g_strcmp0 (fu_plugin_get_build_hash (plugin),
-				      FU_BUILD_HASH) != 0) {
-			const gchar *name = fu_plugin_get_name (plugin);
-			g_warning ("%s has incorrect built version %s",
-				   name, fu_plugin_get_build_hash (plugin));
-			self->tainted = TRUE;
-		}
-	}
-
+	if (fu_plugin_is_open (plugin))
+		fu_engine_plugin_check_build_hash (self, plugin);
 	fu_plugin_list_add (self->plugin_list, plugin);
 }
 
@@ -5017,6 +5771,62 @@ fu_engine_get_host_machine_id (FuEngine *self)
 	return self->host_machine_id;
 }
 
+static void
+fu_engine_plugin_load_manifest_rules (FuPlugin *plugin,
+				      GKeyFile *kf,
+				      const gchar *key,
+				      FuPluginRule rule)
+{
+	g_auto(GStrv) names = g_key_file_get_string_list (kf, "fwupd Plugin", key, NULL, NULL);
+	for (guint i = 0; names != NULL && names[i] != NULL; i++)
+		fu_plugin_add_rule (plugin, rule, names[i]);
+}
+
+/* returns TRUE if the plugin should only be opened when a device needs it */
+static gboolean
+fu_engine_plugin_load_manifest (FuEngine *self, FuPlugin *plugin, const gchar *filename)
+{
+	g_autofree gchar *basename = NULL;
+	g_autofree gchar *manifest = NULL;
+	g_auto(GStrv) firmware_gtypes = NULL;
+	g_auto(GStrv) subsystems = NULL;
+	g_autoptr(GKeyFile) kf = g_key_file_new ();
+	g_autoptr(GError) error_local = NULL;
+
+	/* the manifest is installed next to the module */
+	if (!g_str_has_suffix (filename, "." G_MODULE_SUFFIX))
+		return FALSE;
+	basename = g_strndup (filename, strlen (filename) - strlen ("." G_MODULE_SUFFIX));
+	manifest = g_strdup_printf ("%s.manifest", basename);
+	if (!g_file_test (manifest, G_FILE_TEST_EXISTS))
+		return FALSE;
+	if (!g_key_file_load_from_file (kf, manifest, G_KEY_FILE_NONE, &error_local)) {
+		g_warning ("failed to load %s: %s", manifest, error_local->message);
+		return FALSE;
+	}
+	if (!g_key_file_get_boolean (kf, "fwupd Plugin", "LoadOnDemand", NULL))
+		return FALSE;
+
+	/* set up everything fu_plugin_init() would have done that is needed
+	 * before the module is opened */
+	subsystems = g_key_file_get_string_list (kf, "fwupd Plugin", "UdevSubsystems", NULL, NULL);
+	for (guint i = 0; subsystems != NULL && subsystems[i] != NULL; i++)
+		fu_plugin_add_udev_subsystem (plugin, subsystems[i]);
+	fu_engine_plugin_load_manifest_rules (plugin, kf, "Conflicts", FU_PLUGIN_RULE_CONFLICTS);
+	fu_engine_plugin_load_manifest_rules (plugin, kf, "RunAfter", FU_PLUGIN_RULE_RUN_AFTER);
+	fu_engine_plugin_load_manifest_rules (plugin, kf, "RunBefore", FU_PLUGIN_RULE_RUN_BEFORE);
+	fu_engine_plugin_load_manifest_rules (plugin, kf, "BetterThan", FU_PLUGIN_RULE_BETTER_THAN);
+
+	/* so the plugin can be opened only when one of its types is used */
+	firmware_gtypes = g_key_file_get_string_list (kf, "fwupd Plugin", "FirmwareGTypes", NULL, NULL);
+	for (guint i = 0; firmware_gtypes != NULL && firmware_gtypes[i] != NULL; i++) {
+		g_hash_table_insert (self->firmware_gtype_plugins,
+				     g_strdup (firmware_gtypes[i]),
+				     g_strdup (fu_plugin_get_name (plugin)));
+	}
+	return TRUE;
+}
+
 gboolean
 fu_engine_load_plugins (FuEngine *self, GError **error)
 {
@@ -5062,6 +5872,7 @@ fu_engine_load_plugins (FuEngine *self, GError **error)
 		fu_plugin_set_smbios (plugin, self->smbios);
 		fu_plugin_set_udev_subsystems (plugin, self->udev_subsystems);
 		fu_plugin_set_quirks (plugin, self->quirks);
+		fu_plugin_set_device_cache (plugin, self->device_cache);
 		fu_plugin_set_runtime_versions (plugin, self->runtime_versions);
 		fu_plugin_set_compile_versions (plugin, self->compile_versions);
 		g_signal_connect (plugin, "add-firmware-gtype",
@@ -5069,11 +5880,20 @@ fu_engine_load_plugins (FuEngine *self, GError **error)
 				  self);
 		g_debug ("adding plugin %s", filename);
 
-		/* if loaded from fu_engine_load() open the plugin */
+		/* if loaded from fu_engine_load() open the plugin, unless the
+		 * manifest says it is only required for specific devices */
 		if (self->usb_ctx != NULL) {
-			if (!fu_plugin_open (plugin, filename, &error_local)) {
-				g_warning ("%s", error_local->message);
-				continue;
+			if (fu_engine_plugin_load_manifest (self, plugin, filename)) {
+				g_debug ("deferring load of %s", name);
+				g_hash_table_insert (self->plugins_on_demand,
+						     g_strdup (name),
+						     g_strdup (filename));
+			} else {
+				if (!fu_plugin_open (plugin, filename, &error_local)) {
+					g_warning ("%s", error_local->message);
+					continue;
+				}
+				fu_engine_plugin_check_build_hash (self, plugin);
 			}
 		}
 
@@ -5108,7 +5928,7 @@ fu_engine_load_plugins (FuEngine *self, GError **error)
 				  self);
 
 		/* add */
-		fu_engine_add_plugin (self, plugin);
+		fu_plugin_list_add (self->plugin_list, plugin);
 	}
 
 	/* depsolve into the correct order */
@@ -5170,13 +5990,79 @@ fu_engine_usb_device_removed_cb (GUsbContext *ctx,
 	}
 }
 
-static void
-fu_engine_usb_device_added_cb (GUsbContext *ctx,
-			       GUsbDevice *usb_device,
-			       FuEngine *self)
+/* this has to match the instance IDs added in fu_usb_device_probe() */
+static gboolean
+fu_engine_usb_device_is_routed (FuEngine *self, GUsbDevice *usb_device)
+{
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GPtrArray) instance_ids = g_ptr_array_new_with_free_func (g_free);
+	g_autoptr(GPtrArray) intfs = NULL;
+	g_autoptr(GPtrArray) routed = NULL;
+	g_autoptr(GPtrArray) routed_intfs = NULL;
+
+	g_ptr_array_add (instance_ids,
+			 g_strdup_printf ("USB\\VID_%04X&PID_%04X&REV_%04X",
+					  g_usb_device_get_vid (usb_device),
+					  g_usb_device_get_pid (usb_device),
+					  g_usb_device_get_release (usb_device)));
+	g_ptr_array_add (instance_ids,
+			 g_strdup_printf ("USB\\VID_%04X&PID_%04X",
+					  g_usb_device_get_vid (usb_device),
+					  g_usb_device_get_pid (usb_device)));
+	g_ptr_array_add (instance_ids,
+			 g_strdup_printf ("USB\\VID_%04X",
+					  g_usb_device_get_vid (usb_device)));
+	routed = fu_engine_get_routed_plugins (self, instance_ids);
+	if (routed->len > 0)
+		return TRUE;
+
+	/* only read the descriptors when the VID and PID did not match */
+	intfs = g_usb_device_get_interfaces (usb_device, &error_local);
+	if (intfs == NULL) {
+		g_debug ("failed to get interfaces, probing anyway: %s",
+			 error_local->message);
+		return TRUE;
+	}
+	g_ptr_array_set_size (instance_ids, 0);
+	for (guint i = 0; i < intfs->len; i++) {
+		GUsbInterface *intf = g_ptr_array_index (intfs, i);
+		g_ptr_array_add (instance_ids,
+				 g_strdup_printf ("USB\\CLASS_%02X&SUBCLASS_%02X&PROT_%02X",
+						  g_usb_interface_get_class (intf),
+						  g_usb_interface_get_subclass (intf),
+						  g_usb_interface_get_protocol (intf)));
+		g_ptr_array_add (instance_ids,
+				 g_strdup_printf ("USB\\CLASS_%02X&SUBCLASS_%02X",
+						  g_usb_interface_get_class (intf),
+						  g_usb_interface_get_subclass (intf)));
+		g_ptr_array_add (instance_ids,
+				 g_strdup_printf ("USB\\CLASS_%02X",
+						  g_usb_interface_get_class (intf)));
+	}
+	routed_intfs = fu_engine_get_routed_plugins (self, instance_ids);
+	return routed_intfs->len > 0;
+}
+
+static FuUsbDevice *
+fu_engine_usb_device_probe (FuEngine *self, GUsbDevice *usb_device)
 {
 	g_autoptr(FuUsbDevice) device = fu_usb_device_new (usb_device);
 	g_autoptr(GError) error_local = NULL;
+
+	fu_device_set_quirks (FU_DEVICE (device), self->quirks);
+	if (!fu_device_probe (FU_DEVICE (device), &error_local)) {
+		g_warning ("failed to probe device %s: %s",
+			   fu_device_get_physical_id (FU_DEVICE (device)),
+			   error_local->message);
+		return NULL;
+	}
+	return g_steal_pointer (&device);
+}
+
+static void
+fu_engine_usb_device_add (FuEngine *self, GUsbDevice *usb_device)
+{
+	g_autoptr(FuUsbDevice) device = NULL;
 	g_autoptr(GPtrArray) possible_plugins = NULL;
 
 	/* debug */
@@ -5186,13 +6072,27 @@ fu_engine_usb_device_added_cb (GUsbContext *ctx,
 			 g_usb_device_get_pid (usb_device));
 	}
 
+	/* no plugin can handle this device */
+	if (!fu_engine_usb_device_is_routed (self, usb_device)) {
+		if (g_getenv ("FWUPD_PROBE_VERBOSE") != NULL) {
+			g_debug ("USB %04x:%04x has no plugin, ignoring",
+				 g_usb_device_get_vid (usb_device),
+				 g_usb_device_get_pid (usb_device));
+		}
+		return;
+	}
+
 	/* add any extra quirks */
-	fu_device_set_quirks (FU_DEVICE (device), self->quirks);
-	if (!fu_device_probe (FU_DEVICE (device), &error_local)) {
-		g_warning ("failed to probe device %s: %s",
-			   fu_device_get_physical_id (FU_DEVICE (device)),
-			   error_local->message);
+	device = fu_engine_usb_device_probe (self, usb_device);
+	if (device == NULL)
 		return;
+
+	/* quirks may reference types registered by plugins not yet open */
+	if (fu_engine_open_plugins_for_device (self, FU_DEVICE (device))) {
+		g_object_unref (device);
+		device = fu_engine_usb_device_probe (self, usb_device);
+		if (device == NULL)
+			return;
 	}
 
 	/* can be specified using a quirk */
@@ -5200,6 +6100,7 @@ fu_engine_usb_device_added_cb (GUsbContext *ctx,
 	for (guint i = 0; i < possible_plugins->len; i++) {
 		FuPlugin *plugin;
 		const gchar *plugin_name = g_ptr_array_index (possible_plugins, i);
+		gboolean ret;
 		g_autoptr(GError) error = NULL;
 
 		plugin = fu_plugin_list_find_by_name (self->plugin_list,
@@ -5209,7 +6110,10 @@ fu_engine_usb_device_added_cb (GUsbContext *ctx,
 				 plugin_name, error->message);
 			continue;
 		}
-		if (!fu_plugin_runner_usb_device_added (plugin, device, &error)) {
+		fu_trace_begin (self->trace, "plugin", plugin_name);
+		ret = fu_plugin_runner_usb_device_added (plugin, device, &error);
+		fu_trace_end (self->trace);
+		if (!ret) {
 			if (g_error_matches (error, FWUPD_ERROR, FWUPD_ERROR_NOT_SUPPORTED)) {
 				if (g_getenv ("FWUPD_PROBE_VERBOSE") != NULL) {
 					g_debug ("%s ignoring: %s",
@@ -5227,12 +6131,39 @@ fu_engine_usb_device_added_cb (GUsbContext *ctx,
 	}
 }
 
+static void
+fu_engine_usb_device_added_cb (GUsbContext *ctx,
+			       GUsbDevice *usb_device,
+			       FuEngine *self)
+{
+	fu_trace_begin (self->trace, "device", g_usb_device_get_platform_id (usb_device));
+	fu_engine_usb_device_add (self, usb_device);
+	fu_trace_end (self->trace);
+}
+
 static void
 fu_engine_load_quirks (FuEngine *self, FuQuirksLoadFlags quirks_flags)
 {
 	g_autoptr(GError) error = NULL;
-	if (!fu_quirks_load (self->quirks, quirks_flags, &error))
+	if (!fu_quirks_load (self->quirks, quirks_flags, &error)) {
 		g_warning ("Failed to load quirks: %s", error->message);
+		return;
+	}
+	fu_engine_load_plugin_routes (self);
+}
+
+static void
+fu_engine_load_device_cache (FuEngine *self)
+{
+	g_autofree gchar *cachedirpkg = fu_common_get_path (FU_PATH_KIND_CACHEDIR_PKG);
+	g_autofree gchar *filename = g_build_filename (cachedirpkg, "devices.cache", NULL);
+	g_autoptr(FuDeviceCache) device_cache = fu_device_cache_new ();
+	g_autoptr(GError) error = NULL;
+	if (!fu_device_cache_load (device_cache, filename, &error)) {
+		g_warning ("Failed to load device cache: %s", error->message);
+		return;
+	}
+	self->device_cache = g_steal_pointer (&device_cache);
 }
 
 static void
@@ -5246,8 +6177,10 @@ fu_engine_load_smbios (FuEngine *self)
 static void
 fu_engine_load_hwids (FuEngine *self)
 {
+	g_autofree gchar *cachedirpkg = fu_common_get_path (FU_PATH_KIND_CACHEDIR_PKG);
+	g_autofree gchar *filename = g_build_filename (cachedirpkg, "hwids.cache", NULL);
 	g_autoptr(GError) error = NULL;
-	if (!fu_hwids_setup (self->hwids, self->smbios, &error))
+	if (!fu_hwids_setup_with_cache (self->hwids, self->smbios, filename, &error))
 		g_warning ("Failed to load HWIDs: %s", error->message);
 }
 
@@ -5361,15 +6294,15 @@ fu_engine_udev_uevent_cb (GUdevClient *gudev_client,
 			  FuEngine *self)
 {
 	if (g_strcmp0 (action, "add") == 0) {
-		fu_engine_udev_device_add (self, udev_device);
+		fu_engine_udev_events_add (self, udev_device, FU_UDEV_BATCH_ACTION_ADD);
 		return;
 	}
 	if (g_strcmp0 (action, "remove") == 0) {
-		fu_engine_udev_device_remove (self, udev_device);
+		fu_engine_udev_events_add (self, udev_device, FU_UDEV_BATCH_ACTION_REMOVE);
 		return;
 	}
 	if (g_strcmp0 (action, "change") == 0) {
-		fu_engine_udev_device_changed (self, udev_device);
+		fu_engine_udev_events_add (self, udev_device, FU_UDEV_BATCH_ACTION_CHANGE);
 		return;
 	}
 }
@@ -5399,18 +6332,9 @@ fu_engine_ensure_client_certificate (FuEngine *self)
 	g_debug ("client certificate exists and working");
 }
 
-/**
- * fu_engine_load:
- * @self: A #FuEngine
- * @flags: #FuEngineLoadFlags, e.g. %FU_ENGINE_LOAD_FLAG_READONLY_FS
- * @error: A #GError, or %NULL
- *
- * Load the firmware update engine so it is ready for use.
- *
- * Returns: %TRUE for success
- **/
-gboolean
-fu_engine_load (FuEngine *self, FuEngineLoadFlags flags, GError **error)
+/* each phase ends its own span on error, and the caller ends the "load" span */
+static gboolean
+fu_engine_load_phases (FuEngine *self, FuEngineLoadFlags flags, GError **error)
 {
 	FuRemoteListLoadFlags remote_list_flags = FU_REMOTE_LIST_LOAD_FLAG_NONE;
 	FuQuirksLoadFlags quirks_flags = FU_QUIRKS_LOAD_FLAG_NONE;
@@ -5419,13 +6343,6 @@ fu_engine_load (FuEngine *self, FuEngineLoadFlags flags, GError **error)
 	g_autoptr(GError) error_local = NULL;
 #endif
 
-	g_return_val_if_fail (FU_IS_ENGINE (self), FALSE);
-	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
-
-	/* avoid re-loading a second time if fu-tool or fu-util request to */
-	if (self->loaded)
-		return TRUE;
-
 /* TODO: Read registry key [HKEY_LOCAL_MACHINE\SOFTWARE\Microsoft\Cryptography] "MachineGuid" */
 #ifndef _WIN32
 	/* cache machine ID so we can use it from a sandboxed app */
@@ -5434,23 +6351,32 @@ fu_engine_load (FuEngine *self, FuEngineLoadFlags flags, GError **error)
 		g_debug ("%s", error_local->message);
 #endif
 	/* read config file */
+	fu_trace_begin (self->trace, "phase", "config");
 	if (!fu_config_load (self->config, error)) {
 		g_prefix_error (error, "Failed to load config: ");
+		fu_trace_end (self->trace);
 		return FALSE;
 	}
+	fu_trace_end (self->trace);
 
 	/* read remotes */
+	fu_trace_begin (self->trace, "phase", "remotes");
 	if (flags & FU_ENGINE_LOAD_FLAG_READONLY_FS)
 		remote_list_flags |= FU_REMOTE_LIST_LOAD_FLAG_READONLY_FS;
 	if (!fu_remote_list_load (self->remote_list, remote_list_flags, error)) {
 		g_prefix_error (error, "Failed to load remotes: ");
+		fu_trace_end (self->trace);
 		return FALSE;
 	}
+	fu_trace_end (self->trace);
 
 	/* create client certificate */
+	fu_trace_begin (self->trace, "phase", "client-certificate");
 	fu_engine_ensure_client_certificate (self);
+	fu_trace_end (self->trace);
 
 	/* get hardcoded approved firmware */
+	fu_trace_begin (self->trace, "phase", "approved-firmware");
 	checksums = fu_config_get_approved_firmware (self->config);
 	for (guint i = 0; i < checksums->len; i++) {
 		const gchar *csum = g_ptr_array_index (checksums, i);
@@ -5459,30 +6385,54 @@ fu_engine_load (FuEngine *self, FuEngineLoadFlags flags, GError **error)
 
 	/* get extra firmware saved to the database */
 	checksums = fu_history_get_approved_firmware (self->history, error);
-	if (checksums == NULL)
+	if (checksums == NULL) {
+		fu_trace_end (self->trace);
 		return FALSE;
+	}
 	for (guint i = 0; i < checksums->len; i++) {
 		const gchar *csum = g_ptr_array_index (checksums, i);
 		fu_engine_add_approved_firmware (self, csum);
 	}
 
+	fu_trace_end (self->trace);
+
+	/* apply the history retention policy */
+	fu_trace_begin (self->trace, "phase", "history-prune");
+	if ((flags & FU_ENGINE_LOAD_FLAG_READONLY_FS) == 0)
+		fu_engine_history_prune (self);
+	fu_trace_end (self->trace);
+
 	/* set up idle exit */
 	if ((self->app_flags & FU_APP_FLAGS_NO_IDLE_SOURCES) == 0)
 		fu_idle_set_timeout (self->idle, fu_config_get_idle_timeout (self->config));
 
 	/* load quirks, SMBIOS and the hwids */
+	fu_trace_begin (self->trace, "phase", "smbios");
 	fu_engine_load_smbios (self);
+	fu_trace_end (self->trace);
+	fu_trace_begin (self->trace, "phase", "hwids");
 	fu_engine_load_hwids (self);
+	fu_trace_end (self->trace);
 	/* on a read-only filesystem don't care about the cache GUID */
 	if (flags & FU_ENGINE_LOAD_FLAG_READONLY_FS)
 		quirks_flags |= FU_QUIRKS_LOAD_FLAG_READONLY_FS;
+	fu_trace_begin (self->trace, "phase", "quirks");
+	fu_alloc_stats_begin (self->alloc_stats, "phase", "quirks");
 	fu_engine_load_quirks (self, quirks_flags);
+	fu_alloc_stats_end (self->alloc_stats);
+	fu_trace_end (self->trace);
 
 	/* load AppStream metadata */
+	fu_trace_begin (self->trace, "phase", "metadata");
+	fu_alloc_stats_begin (self->alloc_stats, "phase", "metadata");
 	if (!fu_engine_load_metadata_store (self, flags, error)) {
 		g_prefix_error (error, "Failed to load AppStream data: ");
+		fu_alloc_stats_end (self->alloc_stats);
+		fu_trace_end (self->trace);
 		return FALSE;
 	}
+	fu_alloc_stats_end (self->alloc_stats);
+	fu_trace_end (self->trace);
 
 	/* add the "built-in" firmware types */
 	fu_engine_add_firmware_gtype (self, "raw", FU_TYPE_FIRMWARE);
@@ -5503,11 +6453,21 @@ fu_engine_load (FuEngine *self, FuEngineLoadFlags flags, GError **error)
 		return FALSE;
 	}
 
+	/* restore devices from the last daemon instance */
+	if (fu_config_get_enumeration_cache (self->config))
+		fu_engine_load_device_cache (self);
+
 	/* load plugin */
+	fu_trace_begin (self->trace, "phase", "plugins-load");
+	fu_alloc_stats_begin (self->alloc_stats, "phase", "plugins-load");
 	if (!fu_engine_load_plugins (self, error)) {
 		g_prefix_error (error, "Failed to load plugins: ");
+		fu_alloc_stats_end (self->alloc_stats);
+		fu_trace_end (self->trace);
 		return FALSE;
 	}
+	fu_alloc_stats_end (self->alloc_stats);
+	fu_trace_end (self->trace);
 
 	/* watch the device list for updates and proxy */
 	g_signal_connect (self->device_list, "added",
@@ -5537,7 +6497,9 @@ fu_engine_load (FuEngine *self, FuEngineLoadFlags flags, GError **error)
 	fu_engine_set_status (self, FWUPD_STATUS_LOADING);
 
 	/* add devices */
+	fu_trace_begin (self->trace, "phase", "startup");
 	fu_engine_plugins_setup (self);
+	fu_trace_end (self->trace);
 	if ((flags & FU_ENGINE_LOAD_FLAG_NO_ENUMERATE) == 0)
 		fu_engine_plugins_coldplug (self, FALSE);
 
@@ -5548,24 +6510,77 @@ fu_engine_load (FuEngine *self, FuEngineLoadFlags flags, GError **error)
 	g_signal_connect (self->usb_ctx, "device-removed",
 			  G_CALLBACK (fu_engine_usb_device_removed_cb),
 			  self);
-	if ((flags & FU_ENGINE_LOAD_FLAG_NO_ENUMERATE) == 0)
+	if ((flags & FU_ENGINE_LOAD_FLAG_NO_ENUMERATE) == 0) {
+		fu_trace_begin (self->trace, "phase", "usb-enumerate");
 		g_usb_context_enumerate (self->usb_ctx);
+		fu_trace_end (self->trace);
+	}
 
 #ifdef HAVE_GUDEV
 	/* coldplug udev devices */
-	if ((flags & FU_ENGINE_LOAD_FLAG_NO_ENUMERATE) == 0)
+	if ((flags & FU_ENGINE_LOAD_FLAG_NO_ENUMERATE) == 0) {
+		fu_trace_begin (self->trace, "phase", "udev-enumerate");
 		fu_engine_enumerate_udev (self);
+		fu_trace_end (self->trace);
+	}
 #endif
 
+	/* save the devices that were set up, and forget ones that went away */
+	if ((flags & FU_ENGINE_LOAD_FLAG_NO_ENUMERATE) == 0)
+		fu_engine_save_device_cache (self);
+
 	/* set device properties from the metadata */
+	fu_trace_begin (self->trace, "phase", "md-refresh");
+	fu_alloc_stats_begin (self->alloc_stats, "phase", "md-refresh");
 	fu_engine_md_refresh_devices (self);
+	fu_alloc_stats_end (self->alloc_stats);
+	fu_trace_end (self->trace);
 
 	/* update the db for devices that were updated during the reboot */
-	if (!fu_engine_update_history_database (self, error))
+	fu_trace_begin (self->trace, "phase", "history-update");
+	if (!fu_engine_update_history_database (self, error)) {
+		fu_trace_end (self->trace);
 		return FALSE;
+	}
+	fu_trace_end (self->trace);
 
 	fu_engine_set_status (self, FWUPD_STATUS_IDLE);
 	self->loaded = TRUE;
+	return TRUE;
+}
+
+/**
+ * fu_engine_load:
+ * @self: A #FuEngine
+ * @flags: #FuEngineLoadFlags, e.g. %FU_ENGINE_LOAD_FLAG_READONLY_FS
+ * @error: A #GError, or %NULL
+ *
+ * Load the firmware update engine so it is ready for use.
+ *
+ * Returns: %TRUE for success
+ **/
+gboolean
+fu_engine_load (FuEngine *self, FuEngineLoadFlags flags, GError **error)
+{
+	gboolean ret;
+
+	g_return_val_if_fail (FU_IS_ENGINE (self), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	/* avoid re-loading a second time if fu-tool or fu-util request to */
+	if (self->loaded)
+		return TRUE;
+
+	fu_trace_begin (self->trace, "phase", "load");
+	fu_alloc_stats_begin (self->alloc_stats, "phase", "load");
+	ret = fu_engine_load_phases (self, flags, error);
+	fu_alloc_stats_end (self->alloc_stats);
+	fu_trace_end (self->trace);
+
+	/* only the startup is recorded, so the trace does not grow forever */
+	fu_trace_set_enabled (self->trace, FALSE);
+	if (!ret)
+		return FALSE;
 
 	/* let clients know engine finished starting up */
 	fu_engine_emit_changed (self);
@@ -5652,17 +6667,32 @@ fu_engine_init (FuEngine *self)
 	self->config = fu_config_new ();
 	self->remote_list = fu_remote_list_new ();
 	self->device_list = fu_device_list_new ();
+	fu_device_list_set_sort_func (self->device_list,
+				      fu_engine_sort_devices_by_priority_name);
 	self->smbios = fu_smbios_new ();
 	self->hwids = fu_hwids_new ();
 	self->idle = fu_idle_new ();
 	self->quirks = fu_quirks_new ();
 	self->history = fu_history_new ();
+	self->trace = fu_trace_new ();
+	if (g_getenv ("FWUPD_TRACE") != NULL)
+		fu_trace_set_enabled (self->trace, TRUE);
+	self->alloc_stats = fu_alloc_stats_new ();
+	if (g_getenv ("FWUPD_ALLOC_STATS") != NULL)
+		fu_alloc_stats_set_enabled (self->alloc_stats, TRUE);
 	self->plugin_list = fu_plugin_list_new ();
 	self->plugin_filter = g_ptr_array_new_with_free_func (g_free);
 	self->udev_subsystems = g_ptr_array_new_with_free_func (g_free);
+	self->plugins_on_demand = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	self->firmware_gtype_plugins = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	self->plugin_routes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+						     (GDestroyNotify) g_ptr_array_unref);
+	self->plugin_route_links = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+							  (GDestroyNotify) g_ptr_array_unref);
 #ifdef HAVE_GUDEV
 	self->udev_changed_ids = g_hash_table_new_full (g_str_hash, g_str_equal,
 							g_free, (GDestroyNotify) fu_engine_udev_changed_helper_free);
+	self->udev_batch = fu_udev_batch_new ();
 #endif
 	self->runtime_versions = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
 	self->compile_versions = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
@@ -5675,6 +6705,9 @@ fu_engine_init (FuEngine *self)
 	g_signal_connect (self->remote_list, "changed",
 			  G_CALLBACK (fu_engine_remote_list_changed_cb),
 			  self);
+	g_signal_connect (self->quirks, "changed",
+			  G_CALLBACK (fu_engine_quirks_changed_cb),
+			  self);
 
 	g_signal_connect (self->idle, "notify::status",
 			  G_CALLBACK (fu_engine_idle_status_notify_cb), self);
@@ -5731,9 +6764,18 @@ fu_engine_finalize (GObject *obj)
 #ifdef HAVE_GUDEV
 	if (self->gudev_client != NULL)
 		g_object_unref (self->gudev_client);
+	if (self->udev_events_id != 0)
+		g_source_remove (self->udev_events_id);
 #endif
 	if (self->coldplug_id != 0)
 		g_source_remove (self->coldplug_id);
+	if (self->progress_id != 0)
+		g_source_remove (self->progress_id);
+	g_clear_object (&self->progress_device);
+
+	/* record any devices added since the cache was last saved */
+	if (self->device_cache_save_id != 0)
+		fu_engine_save_device_cache (self);
 
 	g_free (self->host_machine_id);
 	g_object_unref (self->idle);
@@ -5741,14 +6783,23 @@ fu_engine_finalize (GObject *obj)
 	g_object_unref (self->remote_list);
 	g_object_unref (self->smbios);
 	g_object_unref (self->quirks);
+	if (self->device_cache != NULL)
+		g_object_unref (self->device_cache);
 	g_object_unref (self->hwids);
 	g_object_unref (self->history);
+	g_object_unref (self->trace);
+	g_object_unref (self->alloc_stats);
 	g_object_unref (self->device_list);
 	g_object_unref (self->jcat_context);
 	g_ptr_array_unref (self->plugin_filter);
 	g_ptr_array_unref (self->udev_subsystems);
+	g_hash_table_unref (self->plugins_on_demand);
+	g_hash_table_unref (self->firmware_gtype_plugins);
+	g_hash_table_unref (self->plugin_routes);
+	g_hash_table_unref (self->plugin_route_links);
 #ifdef HAVE_GUDEV
 	g_hash_table_unref (self->udev_changed_ids);
+	g_object_unref (self->udev_batch);
 #endif
 	g_hash_table_unref (self->runtime_versions);
 	g_hash_table_unref (self->compile_versions);
@@ -13,9 +13,11 @@
 #include "fwupd-device.h"
 #include "fwupd-enums.h"
 
+#include "fu-alloc-stats.h"
 #include "fu-common.h"
 #include "fu-install-task.h"
 #include "fu-plugin.h"
+#include "fu-trace.h"
 
 #define FU_TYPE_ENGINE (fu_engine_get_type ())
 G_DECLARE_FINAL_TYPE (FuEngine, fu_engine, FU, ENGINE, GObject)
@@ -65,6 +67,15 @@ GPtrArray	*fu_engine_get_devices_by_guid		(FuEngine	*self,
 							 GError		**error);
 GPtrArray	*fu_engine_get_history			(FuEngine	*self,
 							 GError		**error);
+FuTrace		*fu_engine_get_trace			(FuEngine	*self);
+FuAllocStats	*fu_engine_get_alloc_stats		(FuEngine	*self);
+GPtrArray	*fu_engine_get_history_full		(FuEngine	*self,
+							 const gchar	*device_id,
+							 FwupdUpdateState update_state,
+							 guint64	 since,
+							 guint		 offset,
+							 guint		 limit,
+							 GError		**error);
 FwupdRemote 	*fu_engine_get_remote_by_id		(FuEngine	*self,
 							 const gchar	*remote_id,
 							 GError		**error);
@@ -171,6 +182,10 @@ void		 fu_engine_add_device			(FuEngine	*self,
 							 FuDevice	*device);
 void		 fu_engine_add_plugin			(FuEngine	*self,
 							 FuPlugin	*plugin);
+gboolean	 fu_engine_open_plugins_for_device	(FuEngine	*self,
+							 FuDevice	*device);
+GPtrArray	*fu_engine_get_routed_plugins		(FuEngine	*self,
+							 GPtrArray	*instance_ids);
 void		 fu_engine_add_runtime_version		(FuEngine	*self,
 							 const gchar	*component_id,
 							 const gchar	*version);
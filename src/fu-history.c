@@ -20,7 +20,26 @@
 #include "fu-history.h"
 #include "fu-mutex.h"
 
-#define FU_HISTORY_CURRENT_SCHEMA_VERSION	5
+#define FU_HISTORY_CURRENT_SCHEMA_VERSION	7
+#define FU_HISTORY_BUSY_TIMEOUT			5000	/* ms */
+
+/* in the order expected by fu_history_device_from_stmt() */
+#define FU_HISTORY_DEVICE_COLUMNS		"device_id, "		\
+						"checksum, "		\
+						"plugin, "		\
+						"device_created, "	\
+						"device_modified, "	\
+						"display_name, "	\
+						"filename, "		\
+						"flags, "		\
+						"metadata, "		\
+						"guid_default, "	\
+						"update_state, "	\
+						"update_error, "	\
+						"version_new, "		\
+						"version_old, "		\
+						"checksum_device, "	\
+						"protocol"
 
 static void fu_history_finalize			 (GObject *object);
 
@@ -29,6 +48,10 @@ struct _FuHistory
 	GObject			 parent_instance;
 	sqlite3			*db;
 	GRWLock			 db_mutex;
+	GHashTable		*stmts;		/* SQL:sqlite3_stmt */
+	sqlite3			*db_reader;
+	GMutex			 db_reader_mutex;
+	GHashTable		*stmts_reader;	/* SQL:sqlite3_stmt */
 };
 
 G_DEFINE_TYPE (FuHistory, fu_history, G_TYPE_OBJECT)
@@ -146,12 +169,77 @@ fu_history_stmt_exec (FuHistory *self, sqlite3_stmt *stmt,
 	if (rc != SQLITE_DONE) {
 		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_WRITE,
 			     "failed to execute prepared statement: %s",
+			     sqlite3_errmsg (sqlite3_db_handle (stmt)));
+		sqlite3_reset (stmt);
+		return FALSE;
+	}
+
+	/* do not hold the read transaction open until the next use */
+	sqlite3_reset (stmt);
+	return TRUE;
+}
+
+/* the returned statement is owned by @stmts, and must only be used while the
+ * lock for @db is held */
+static sqlite3_stmt *
+fu_history_stmt_get (sqlite3 *db, GHashTable *stmts, const gchar *sql, GError **error)
+{
+	gint rc;
+	sqlite3_stmt *stmt = g_hash_table_lookup (stmts, sql);
+
+	/* reuse */
+	if (stmt != NULL) {
+		sqlite3_reset (stmt);
+		sqlite3_clear_bindings (stmt);
+		return stmt;
+	}
+
+	/* compile and cache */
+	rc = sqlite3_prepare_v2 (db, sql, -1, &stmt, NULL);
+	if (rc != SQLITE_OK) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INTERNAL,
+				     sqlite3_errmsg (db));
+		return NULL;
+	}
+	g_hash_table_insert (stmts, g_strdup (sql), stmt);
+	return stmt;
+}
+
+static gboolean
+fu_history_transaction_begin (FuHistory *self, GError **error)
+{
+	gint rc = sqlite3_exec (self->db, "BEGIN TRANSACTION;", NULL, NULL, NULL);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
+			     "Failed to begin transaction: %s",
+			     sqlite3_errmsg (self->db));
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static gboolean
+fu_history_transaction_commit (FuHistory *self, GError **error)
+{
+	gint rc = sqlite3_exec (self->db, "COMMIT;", NULL, NULL, NULL);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_WRITE,
+			     "Failed to commit transaction: %s",
 			     sqlite3_errmsg (self->db));
+		sqlite3_exec (self->db, "ROLLBACK;", NULL, NULL, NULL);
 		return FALSE;
 	}
 	return TRUE;
 }
 
+static void
+fu_history_transaction_rollback (FuHistory *self)
+{
+	sqlite3_exec (self->db, "ROLLBACK;", NULL, NULL, NULL);
+}
+
 static gboolean
 fu_history_create_database (FuHistory *self, GError **error)
 {
@@ -181,6 +269,18 @@ fu_history_create_database (FuHistory *self, GError **error)
 			 "protocol TEXT DEFAULT NULL);"
 			 "CREATE TABLE IF NOT EXISTS approved_firmware ("
 			 "checksum TEXT);"
+			 "CREATE TABLE IF NOT EXISTS verify ("
+			 "device_id TEXT,"
+			 "version TEXT,"
+			 "checksum TEXT);"
+			 "CREATE INDEX IF NOT EXISTS verify_device_version "
+			 "ON verify (device_id, version);"
+			 "CREATE INDEX IF NOT EXISTS history_device_id "
+			 "ON history (device_id);"
+			 "CREATE INDEX IF NOT EXISTS history_update_state "
+			 "ON history (update_state);"
+			 "CREATE INDEX IF NOT EXISTS history_device_modified "
+			 "ON history (device_modified);"
 			 "COMMIT;", NULL, NULL, NULL);
 	if (rc != SQLITE_OK) {
 		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
@@ -269,6 +369,48 @@ fu_history_migrate_database_v4 (FuHistory *self, GError **error)
 	return TRUE;
 }
 
+static gboolean
+fu_history_migrate_database_v5 (FuHistory *self, GError **error)
+{
+	gint rc;
+	rc = sqlite3_exec (self->db,
+			   "CREATE TABLE IF NOT EXISTS verify ("
+			   "device_id TEXT,"
+			   "version TEXT,"
+			   "checksum TEXT);"
+			   "CREATE INDEX IF NOT EXISTS verify_device_version "
+			   "ON verify (device_id, version);",
+			   NULL, NULL, NULL);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
+			     "Failed to create table: %s",
+			     sqlite3_errmsg (self->db));
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static gboolean
+fu_history_migrate_database_v6 (FuHistory *self, GError **error)
+{
+	gint rc;
+	rc = sqlite3_exec (self->db,
+			   "CREATE INDEX IF NOT EXISTS history_device_id "
+			   "ON history (device_id);"
+			   "CREATE INDEX IF NOT EXISTS history_update_state "
+			   "ON history (update_state);"
+			   "CREATE INDEX IF NOT EXISTS history_device_modified "
+			   "ON history (device_modified);",
+			   NULL, NULL, NULL);
+	if (rc != SQLITE_OK) {
+		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
+			     "Failed to create index: %s",
+			     sqlite3_errmsg (self->db));
+		return FALSE;
+	}
+	return TRUE;
+}
+
 /* returns 0 if database is not initialised */
 static guint
 fu_history_get_schema_version (FuHistory *self)
@@ -315,16 +457,38 @@ fu_history_create_or_migrate (FuHistory *self, guint schema_ver, GError **error)
 			return FALSE;
 		if (!fu_history_migrate_database_v4 (self, error))
 			return FALSE;
+		if (!fu_history_migrate_database_v5 (self, error))
+			return FALSE;
+		if (!fu_history_migrate_database_v6 (self, error))
+			return FALSE;
 	} else if (schema_ver == 3) {
 		g_debug ("migrating v%u database by altering", schema_ver);
 		if (!fu_history_migrate_database_v3 (self, error))
 			return FALSE;
 		if (!fu_history_migrate_database_v4 (self, error))
 			return FALSE;
+		if (!fu_history_migrate_database_v5 (self, error))
+			return FALSE;
+		if (!fu_history_migrate_database_v6 (self, error))
+			return FALSE;
 	} else if (schema_ver == 4) {
 		g_debug ("migrating v%u database by altering", schema_ver);
 		if (!fu_history_migrate_database_v4 (self, error))
 			return FALSE;
+		if (!fu_history_migrate_database_v5 (self, error))
+			return FALSE;
+		if (!fu_history_migrate_database_v6 (self, error))
+			return FALSE;
+	} else if (schema_ver == 5) {
+		g_debug ("migrating v%u database by altering", schema_ver);
+		if (!fu_history_migrate_database_v5 (self, error))
+			return FALSE;
+		if (!fu_history_migrate_database_v6 (self, error))
+			return FALSE;
+	} else if (schema_ver == 6) {
+		g_debug ("migrating v%u database by altering", schema_ver);
+		if (!fu_history_migrate_database_v6 (self, error))
+			return FALSE;
 	} else {
 		/* this is probably okay, but return an error if we ever delete
 		 * or rename columns */
@@ -351,7 +515,9 @@ fu_history_open (FuHistory *self, const gchar *filename, GError **error)
 {
 	gint rc;
 	g_debug ("trying to open database '%s'", filename);
-	rc = sqlite3_open (filename, &self->db);
+	rc = sqlite3_open_v2 (filename, &self->db,
+			      SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE,
+			      NULL);
 	if (rc != SQLITE_OK) {
 		g_set_error (error,
 			     FWUPD_ERROR,
@@ -360,9 +526,53 @@ fu_history_open (FuHistory *self, const gchar *filename, GError **error)
 			     filename, sqlite3_errmsg (self->db));
 		return FALSE;
 	}
+	sqlite3_busy_timeout (self->db, FU_HISTORY_BUSY_TIMEOUT);
+
+	/* allow readers to run at the same time as the writer; the history
+	 * is written before the device is flashed so sync each commit */
+	rc = sqlite3_exec (self->db,
+			   "PRAGMA journal_mode=WAL;"
+			   "PRAGMA synchronous=FULL;",
+			   NULL, NULL, NULL);
+	if (rc != SQLITE_OK)
+		g_debug ("ignoring journal mode error: %s", sqlite3_errmsg (self->db));
 	return TRUE;
 }
 
+static gboolean
+fu_history_open_reader (FuHistory *self, const gchar *filename, GError **error)
+{
+	gint rc;
+	rc = sqlite3_open_v2 (filename, &self->db_reader, SQLITE_OPEN_READWRITE, NULL);
+	if (rc != SQLITE_OK) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_READ,
+			     "Can't open %s for reading: %s",
+			     filename, sqlite3_errmsg (self->db_reader));
+		sqlite3_close (self->db_reader);
+		self->db_reader = NULL;
+		return FALSE;
+	}
+	sqlite3_busy_timeout (self->db_reader, FU_HISTORY_BUSY_TIMEOUT);
+	return TRUE;
+}
+
+static void
+fu_history_close (FuHistory *self)
+{
+	g_hash_table_remove_all (self->stmts);
+	g_hash_table_remove_all (self->stmts_reader);
+	if (self->db_reader != NULL) {
+		sqlite3_close (self->db_reader);
+		self->db_reader = NULL;
+	}
+	if (self->db != NULL) {
+		sqlite3_close (self->db);
+		self->db = NULL;
+	}
+}
+
 static gboolean
 fu_history_load (FuHistory *self, GError **error)
 {
@@ -374,13 +584,15 @@ fu_history_load (FuHistory *self, GError **error)
 	g_autoptr(GRWLockWriterLocker) locker = g_rw_lock_writer_locker_new (&self->db_mutex);
 
 	/* already done */
-	if (self->db != NULL)
+	if (self->db_reader != NULL)
 		return TRUE;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
-	g_return_val_if_fail (self->db == NULL, FALSE);
 	g_return_val_if_fail (locker != NULL, FALSE);
 
+	/* a previous attempt failed */
+	fu_history_close (self);
+
 	/* create directory */
 	dirname = fu_common_get_path (FU_PATH_KIND_LOCALSTATEDIR_PKG);
 	file = g_file_new_for_path (dirname);
@@ -414,7 +626,7 @@ fu_history_load (FuHistory *self, GError **error)
 			 * and try again with something empty */
 			g_warning ("failed to migrate %s database: %s",
 				   filename, error_migrate->message);
-			sqlite3_close (self->db);
+			fu_history_close (self);
 			if (g_unlink (filename) != 0) {
 				g_set_error (error,
 					     FWUPD_ERROR,
@@ -424,12 +636,13 @@ fu_history_load (FuHistory *self, GError **error)
 			}
 			if (!fu_history_open (self, filename, error))
 				return FALSE;
-			return fu_history_create_database (self, error);
+			if (!fu_history_create_database (self, error))
+				return FALSE;
 		}
 	}
 
-	/* success */
-	return TRUE;
+	/* separate connection so that readers do not wait for the writer */
+	return fu_history_open_reader (self, filename, error);
 }
 
 static gchar *
@@ -472,8 +685,7 @@ fu_history_get_device_flags_filtered (FuDevice *device)
 gboolean
 fu_history_modify_device (FuHistory *self, FuDevice *device, GError **error)
 {
-	gint rc;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
+	sqlite3_stmt *stmt;
 	g_autoptr(GRWLockWriterLocker) locker = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
@@ -489,19 +701,17 @@ fu_history_modify_device (FuHistory *self, FuDevice *device, GError **error)
 	g_debug ("modifying device %s [%s]",
 		 fu_device_get_name (device),
 		 fu_device_get_id (device));
-	rc = sqlite3_prepare_v2 (self->db,
-				 "UPDATE history SET "
-				 "update_state = ?1, "
-				 "update_error = ?2, "
-				 "checksum_device = ?6, "
-				 "device_modified = ?7, "
-				 "flags = ?3 "
-				 "WHERE device_id = ?4;",
-				 -1, &stmt, NULL);
-	if (rc != SQLITE_OK) {
-		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
-			     "Failed to prepare SQL to update history: %s",
-			     sqlite3_errmsg (self->db));
+	stmt = fu_history_stmt_get (self->db, self->stmts,
+				    "UPDATE history SET "
+				    "update_state = ?1, "
+				    "update_error = ?2, "
+				    "checksum_device = ?6, "
+				    "device_modified = ?7, "
+				    "flags = ?3 "
+				    "WHERE device_id = ?4;",
+				    error);
+	if (stmt == NULL) {
+		g_prefix_error (error, "Failed to prepare SQL to update history: ");
 		return FALSE;
 	}
 
@@ -524,7 +734,8 @@ fu_history_modify_device (FuHistory *self, FuDevice *device, GError **error)
  * @release: A #FuRelease
  * @error: A #GError or NULL
  *
- * Adds a device to the history database
+ * Adds a device to the history database, replacing any old device with the
+ * same ID in the same transaction.
  *
  * Returns: @TRUE if successful, @FALSE for failure
  *
@@ -535,9 +746,9 @@ fu_history_add_device (FuHistory *self, FuDevice *device, FwupdRelease *release,
 {
 	const gchar *checksum_device;
 	const gchar *checksum = NULL;
-	gint rc;
+	sqlite3_stmt *stmt_delete;
+	sqlite3_stmt *stmt_insert;
 	g_autofree gchar *metadata = NULL;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
 	g_autoptr(GRWLockWriterLocker) locker = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
@@ -548,9 +759,6 @@ fu_history_add_device (FuHistory *self, FuDevice *device, FwupdRelease *release,
 	if (!fu_history_load (self, error))
 		return FALSE;
 
-	/* ensure all old device(s) with this ID are removed */
-	if (!fu_history_remove_device (self, device, error))
-		return FALSE;
 	g_debug ("add device %s [%s]",
 		 fu_device_get_name (device),
 		 fu_device_get_id (device));
@@ -567,48 +775,64 @@ fu_history_add_device (FuHistory *self, FuDevice *device, FwupdRelease *release,
 	/* add */
 	locker = g_rw_lock_writer_locker_new (&self->db_mutex);
 	g_return_val_if_fail (locker != NULL, FALSE);
-	rc = sqlite3_prepare_v2 (self->db,
-				 "INSERT INTO history (device_id,"
-						      "update_state,"
-						      "update_error,"
-						      "flags,"
-						      "filename,"
-						      "checksum,"
-						      "display_name,"
-						      "plugin,"
-						      "guid_default,"
-						      "metadata,"
-						      "device_created,"
-						      "device_modified,"
-						      "version_old,"
-						      "version_new,"
-						      "checksum_device,"
-						      "protocol) "
-				 "VALUES (?1,?2,?3,?4,?5,?6,?7,?8,?9,?10,"
-					 "?11,?12,?13,?14,?15,?16)", -1, &stmt, NULL);
-	if (rc != SQLITE_OK) {
-		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
-			     "Failed to prepare SQL to insert history: %s",
-			     sqlite3_errmsg (self->db));
+	stmt_delete = fu_history_stmt_get (self->db, self->stmts,
+					   "DELETE FROM history WHERE device_id = ?1;",
+					   error);
+	if (stmt_delete == NULL) {
+		g_prefix_error (error, "Failed to prepare SQL to delete history: ");
 		return FALSE;
 	}
-	sqlite3_bind_text (stmt, 1, fu_device_get_id (device), -1, SQLITE_STATIC);
-	sqlite3_bind_int (stmt, 2, fu_device_get_update_state (device));
-	sqlite3_bind_text (stmt, 3, fu_device_get_update_error (device), -1, SQLITE_STATIC);
-	sqlite3_bind_int64 (stmt, 4, fu_history_get_device_flags_filtered (device));
-	sqlite3_bind_text (stmt, 5, fwupd_release_get_filename (release), -1, SQLITE_STATIC);
-	sqlite3_bind_text (stmt, 6, checksum, -1, SQLITE_STATIC);
-	sqlite3_bind_text (stmt, 7, fu_device_get_name (device), -1, SQLITE_STATIC);
-	sqlite3_bind_text (stmt, 8, fu_device_get_plugin (device), -1, SQLITE_STATIC);
-	sqlite3_bind_text (stmt, 9, fu_device_get_guid_default (device), -1, SQLITE_STATIC);
-	sqlite3_bind_text (stmt, 10, metadata, -1, SQLITE_STATIC);
-	sqlite3_bind_int64 (stmt, 11, fu_device_get_created (device));
-	sqlite3_bind_int64 (stmt, 12, fu_device_get_modified (device));
-	sqlite3_bind_text (stmt, 13, fu_device_get_version (device), -1, SQLITE_STATIC);
-	sqlite3_bind_text (stmt, 14, fwupd_release_get_version (release), -1, SQLITE_STATIC);
-	sqlite3_bind_text (stmt, 15, checksum_device, -1, SQLITE_STATIC);
-	sqlite3_bind_text (stmt, 16, fwupd_release_get_protocol (release), -1, SQLITE_STATIC);
-	return fu_history_stmt_exec (self, stmt, NULL, error);
+	stmt_insert = fu_history_stmt_get (self->db, self->stmts,
+					   "INSERT INTO history (device_id,"
+								"update_state,"
+								"update_error,"
+								"flags,"
+								"filename,"
+								"checksum,"
+								"display_name,"
+								"plugin,"
+								"guid_default,"
+								"metadata,"
+								"device_created,"
+								"device_modified,"
+								"version_old,"
+								"version_new,"
+								"checksum_device,"
+								"protocol) "
+					   "VALUES (?1,?2,?3,?4,?5,?6,?7,?8,?9,?10,"
+						   "?11,?12,?13,?14,?15,?16)",
+					   error);
+	if (stmt_insert == NULL) {
+		g_prefix_error (error, "Failed to prepare SQL to insert history: ");
+		return FALSE;
+	}
+	sqlite3_bind_text (stmt_delete, 1, fu_device_get_id (device), -1, SQLITE_STATIC);
+	sqlite3_bind_text (stmt_insert, 1, fu_device_get_id (device), -1, SQLITE_STATIC);
+	sqlite3_bind_int (stmt_insert, 2, fu_device_get_update_state (device));
+	sqlite3_bind_text (stmt_insert, 3, fu_device_get_update_error (device), -1, SQLITE_STATIC);
+	sqlite3_bind_int64 (stmt_insert, 4, fu_history_get_device_flags_filtered (device));
+	sqlite3_bind_text (stmt_insert, 5, fwupd_release_get_filename (release), -1, SQLITE_STATIC);
+	sqlite3_bind_text (stmt_insert, 6, checksum, -1, SQLITE_STATIC);
+	sqlite3_bind_text (stmt_insert, 7, fu_device_get_name (device), -1, SQLITE_STATIC);
+	sqlite3_bind_text (stmt_insert, 8, fu_device_get_plugin (device), -1, SQLITE_STATIC);
+	sqlite3_bind_text (stmt_insert, 9, fu_device_get_guid_default (device), -1, SQLITE_STATIC);
+	sqlite3_bind_text (stmt_insert, 10, metadata, -1, SQLITE_STATIC);
+	sqlite3_bind_int64 (stmt_insert, 11, fu_device_get_created (device));
+	sqlite3_bind_int64 (stmt_insert, 12, fu_device_get_modified (device));
+	sqlite3_bind_text (stmt_insert, 13, fu_device_get_version (device), -1, SQLITE_STATIC);
+	sqlite3_bind_text (stmt_insert, 14, fwupd_release_get_version (release), -1, SQLITE_STATIC);
+	sqlite3_bind_text (stmt_insert, 15, checksum_device, -1, SQLITE_STATIC);
+	sqlite3_bind_text (stmt_insert, 16, fwupd_release_get_protocol (release), -1, SQLITE_STATIC);
+
+	/* ensure all old device(s) with this ID are removed */
+	if (!fu_history_transaction_begin (self, error))
+		return FALSE;
+	if (!fu_history_stmt_exec (self, stmt_delete, NULL, error) ||
+	    !fu_history_stmt_exec (self, stmt_insert, NULL, error)) {
+		fu_history_transaction_rollback (self);
+		return FALSE;
+	}
+	return fu_history_transaction_commit (self, error);
 }
 
 /**
@@ -629,8 +853,7 @@ fu_history_remove_all_with_state (FuHistory *self,
 				  FwupdUpdateState update_state,
 				  GError **error)
 {
-	gint rc;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
+	sqlite3_stmt *stmt;
 	g_autoptr(GRWLockWriterLocker) locker = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
@@ -644,13 +867,11 @@ fu_history_remove_all_with_state (FuHistory *self,
 	g_return_val_if_fail (locker != NULL, FALSE);
 	g_debug ("removing all devices with update_state %s",
 		 fwupd_update_state_to_string (update_state));
-	rc = sqlite3_prepare_v2 (self->db,
-				 "DELETE FROM history WHERE update_state = ?1",
-				 -1, &stmt, NULL);
-	if (rc != SQLITE_OK) {
-		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
-			     "Failed to prepare SQL to delete history: %s",
-			     sqlite3_errmsg (self->db));
+	stmt = fu_history_stmt_get (self->db, self->stmts,
+				    "DELETE FROM history WHERE update_state = ?1",
+				    error);
+	if (stmt == NULL) {
+		g_prefix_error (error, "Failed to prepare SQL to delete history: ");
 		return FALSE;
 	}
 	sqlite3_bind_int (stmt, 1, update_state);
@@ -671,8 +892,7 @@ fu_history_remove_all_with_state (FuHistory *self,
 gboolean
 fu_history_remove_all (FuHistory *self, GError **error)
 {
-	gint rc;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
+	sqlite3_stmt *stmt;
 	g_autoptr(GRWLockWriterLocker) locker = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
@@ -685,11 +905,9 @@ fu_history_remove_all (FuHistory *self, GError **error)
 	locker = g_rw_lock_writer_locker_new (&self->db_mutex);
 	g_return_val_if_fail (locker != NULL, FALSE);
 	g_debug ("removing all devices");
-	rc = sqlite3_prepare_v2 (self->db, "DELETE FROM history;", -1, &stmt, NULL);
-	if (rc != SQLITE_OK) {
-		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
-			     "Failed to prepare SQL to delete history: %s",
-			     sqlite3_errmsg (self->db));
+	stmt = fu_history_stmt_get (self->db, self->stmts, "DELETE FROM history;", error);
+	if (stmt == NULL) {
+		g_prefix_error (error, "Failed to prepare SQL to delete history: ");
 		return FALSE;
 	}
 	return fu_history_stmt_exec (self, stmt, NULL, error);
@@ -710,8 +928,7 @@ fu_history_remove_all (FuHistory *self, GError **error)
 gboolean
 fu_history_remove_device (FuHistory *self,  FuDevice *device, GError **error)
 {
-	gint rc;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
+	sqlite3_stmt *stmt;
 	g_autoptr(GRWLockWriterLocker) locker = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
@@ -726,13 +943,11 @@ fu_history_remove_device (FuHistory *self,  FuDevice *device, GError **error)
 	g_debug ("remove device %s [%s]",
 		 fu_device_get_name (device),
 		 fu_device_get_id (device));
-	rc = sqlite3_prepare_v2 (self->db,
-				 "DELETE FROM history WHERE device_id = ?1;",
-				 -1, &stmt, NULL);
-	if (rc != SQLITE_OK) {
-		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
-			     "Failed to prepare SQL to delete history: %s",
-			     sqlite3_errmsg (self->db));
+	stmt = fu_history_stmt_get (self->db, self->stmts,
+				    "DELETE FROM history WHERE device_id = ?1;",
+				    error);
+	if (stmt == NULL) {
+		g_prefix_error (error, "Failed to prepare SQL to delete history: ");
 		return FALSE;
 	}
 	sqlite3_bind_text (stmt, 1, fu_device_get_id (device), -1, SQLITE_STATIC);
@@ -755,10 +970,9 @@ fu_history_remove_device (FuHistory *self,  FuDevice *device, GError **error)
 FuDevice *
 fu_history_get_device_by_id (FuHistory *self, const gchar *device_id, GError **error)
 {
-	gint rc;
+	sqlite3_stmt *stmt;
 	g_autoptr(GPtrArray) array_tmp = NULL;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
-	g_autoptr(GRWLockReaderLocker) locker = NULL;
+	g_autoptr(GMutexLocker) locker = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), NULL);
 	g_return_val_if_fail (device_id != NULL, NULL);
@@ -768,32 +982,16 @@ fu_history_get_device_by_id (FuHistory *self, const gchar *device_id, GError **e
 		return NULL;
 
 	/* get all the devices */
-	locker = g_rw_lock_reader_locker_new (&self->db_mutex);
+	locker = g_mutex_locker_new (&self->db_reader_mutex);
 	g_return_val_if_fail (locker != NULL, NULL);
 	g_debug ("get device");
-	rc = sqlite3_prepare_v2 (self->db,
-				 "SELECT device_id, "
-					"checksum, "
-					"plugin, "
-					"device_created, "
-					"device_modified, "
-					"display_name, "
-					"filename, "
-					"flags, "
-					"metadata, "
-					"guid_default, "
-					"update_state, "
-					"update_error, "
-					"version_new, "
-					"version_old, "
-					"checksum_device, "
-					"protocol FROM history WHERE "
-				 "device_id = ?1 ORDER BY device_created DESC "
-				 "LIMIT 1", -1, &stmt, NULL);
-	if (rc != SQLITE_OK) {
-		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
-			     "Failed to prepare SQL to get history: %s",
-			     sqlite3_errmsg (self->db));
+	stmt = fu_history_stmt_get (self->db_reader, self->stmts_reader,
+				    "SELECT " FU_HISTORY_DEVICE_COLUMNS " "
+				    "FROM history WHERE "
+				    "device_id = ?1 ORDER BY device_created DESC "
+				    "LIMIT 1", error);
+	if (stmt == NULL) {
+		g_prefix_error (error, "Failed to prepare SQL to get history: ");
 		return NULL;
 	}
 	sqlite3_bind_text (stmt, 1, device_id, -1, SQLITE_STATIC);
@@ -814,7 +1012,8 @@ fu_history_get_device_by_id (FuHistory *self, const gchar *device_id, GError **e
  * @self: A #FuHistory
  * @error: A #GError or NULL
  *
- * Gets the devices in the history database.
+ * Gets the devices in the history database. This does not wait for any
+ * writes that are in progress.
  *
  * Returns: (element-type #FuDevice) (transfer container): devices
  *
@@ -823,53 +1022,167 @@ fu_history_get_device_by_id (FuHistory *self, const gchar *device_id, GError **e
 GPtrArray *
 fu_history_get_devices (FuHistory *self, GError **error)
 {
-	GPtrArray *array = NULL;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
-	gint rc;
+	return fu_history_get_devices_full (self, NULL,
+					    FWUPD_UPDATE_STATE_UNKNOWN,
+					    0, 0, 0, error);
+}
+
+/**
+ * fu_history_get_devices_full:
+ * @self: A #FuHistory
+ * @device_id: (nullable): A device ID, or %NULL for all devices
+ * @update_state: A #FwupdUpdateState, or %FWUPD_UPDATE_STATE_UNKNOWN for all states
+ * @since: Only return devices modified at or after this UNIX time, or 0
+ * @offset: Number of matching devices to skip
+ * @limit: Maximum number of devices to return, or 0 for no limit
+ * @error: A #GError or NULL
+ *
+ * Gets a page of the devices in the history database, oldest first. The
+ * filters use the table indexes so only the matching rows are read.
+ *
+ * Returns: (element-type #FuDevice) (transfer container): devices
+ *
+ * Since: 1.4.2
+ **/
+GPtrArray *
+fu_history_get_devices_full (FuHistory *self,
+			     const gchar *device_id,
+			     FwupdUpdateState update_state,
+			     guint64 since,
+			     guint offset,
+			     guint limit,
+			     GError **error)
+{
+	sqlite3_stmt *stmt;
 	g_autoptr(GPtrArray) array_tmp = NULL;
-	g_autoptr(GRWLockReaderLocker) locker = NULL;
+	g_autoptr(GPtrArray) where = g_ptr_array_new ();
+	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GString) sql = g_string_new ("SELECT " FU_HISTORY_DEVICE_COLUMNS " FROM history");
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), NULL);
 
 	/* lazy load */
-	if (self->db == NULL) {
+	if (self->db_reader == NULL) {
 		if (!fu_history_load (self, error))
 			return NULL;
 	}
 
+	/* only include the filters that are set so the index is used */
+	if (device_id != NULL)
+		g_ptr_array_add (where, (gpointer) "device_id = ?1");
+	if (update_state != FWUPD_UPDATE_STATE_UNKNOWN)
+		g_ptr_array_add (where, (gpointer) "update_state = ?2");
+	if (since != 0)
+		g_ptr_array_add (where, (gpointer) "device_modified >= ?3");
+	for (guint i = 0; i < where->len; i++) {
+		g_string_append (sql, i == 0 ? " WHERE " : " AND ");
+		g_string_append (sql, g_ptr_array_index (where, i));
+	}
+	g_string_append (sql, " ORDER BY device_modified ASC LIMIT ?4 OFFSET ?5;");
+
 	/* get all the devices */
-	locker = g_rw_lock_reader_locker_new (&self->db_mutex);
+	locker = g_mutex_locker_new (&self->db_reader_mutex);
 	g_return_val_if_fail (locker != NULL, NULL);
-	rc = sqlite3_prepare_v2 (self->db,
-				 "SELECT device_id, "
-					"checksum, "
-					"plugin, "
-					"device_created, "
-					"device_modified, "
-					"display_name, "
-					"filename, "
-					"flags, "
-					"metadata, "
-					"guid_default, "
-					"update_state, "
-					"update_error, "
-					"version_new, "
-					"version_old, "
-					"checksum_device, "
-					"protocol FROM history "
-					"ORDER BY device_modified ASC;",
-					-1, &stmt, NULL);
-	if (rc != SQLITE_OK) {
-		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
-			     "Failed to prepare SQL to get history: %s",
-			     sqlite3_errmsg (self->db));
+	stmt = fu_history_stmt_get (self->db_reader, self->stmts_reader, sql->str, error);
+	if (stmt == NULL) {
+		g_prefix_error (error, "Failed to prepare SQL to get history: ");
 		return NULL;
 	}
+	if (device_id != NULL)
+		sqlite3_bind_text (stmt, 1, device_id, -1, SQLITE_STATIC);
+	if (update_state != FWUPD_UPDATE_STATE_UNKNOWN)
+		sqlite3_bind_int (stmt, 2, update_state);
+	if (since != 0)
+		sqlite3_bind_int64 (stmt, 3, since);
+	sqlite3_bind_int64 (stmt, 4, limit > 0 ? (gint64) limit : -1);
+	sqlite3_bind_int64 (stmt, 5, offset);
 	array_tmp = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 	if (!fu_history_stmt_exec (self, stmt, array_tmp, error))
 		return NULL;
-	array = g_ptr_array_ref (array_tmp);
-	return array;
+	return g_steal_pointer (&array_tmp);
+}
+
+/**
+ * fu_history_prune:
+ * @self: A #FuHistory
+ * @max_age: Maximum age of a device in seconds, or 0 for no limit
+ * @max_entries: Maximum number of devices to keep, or 0 for no limit
+ * @error: A #GError or NULL
+ *
+ * Removes the oldest devices from the history database. Devices with an
+ * update that is pending or waiting for a reboot are never removed.
+ *
+ * Returns: @TRUE if successful, @FALSE for failure
+ *
+ * Since: 1.4.2
+ **/
+gboolean
+fu_history_prune (FuHistory *self, guint64 max_age, guint max_entries, GError **error)
+{
+	sqlite3_stmt *stmt_age;
+	sqlite3_stmt *stmt_entries;
+	gint changes = 0;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
+
+	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
+
+	/* nothing to do */
+	if (max_age == 0 && max_entries == 0)
+		return TRUE;
+
+	/* lazy load */
+	if (!fu_history_load (self, error))
+		return FALSE;
+
+	locker = g_rw_lock_writer_locker_new (&self->db_mutex);
+	g_return_val_if_fail (locker != NULL, FALSE);
+	stmt_age = fu_history_stmt_get (self->db, self->stmts,
+					"DELETE FROM history "
+					"WHERE update_state NOT IN (?1,?2) "
+					"AND device_modified < ?3;",
+					error);
+	if (stmt_age == NULL) {
+		g_prefix_error (error, "Failed to prepare SQL to prune history: ");
+		return FALSE;
+	}
+	stmt_entries = fu_history_stmt_get (self->db, self->stmts,
+					    "DELETE FROM history WHERE rowid IN "
+					    "(SELECT rowid FROM history "
+					    "WHERE update_state NOT IN (?1,?2) "
+					    "ORDER BY device_modified DESC "
+					    "LIMIT -1 OFFSET ?3);",
+					    error);
+	if (stmt_entries == NULL) {
+		g_prefix_error (error, "Failed to prepare SQL to prune history: ");
+		return FALSE;
+	}
+	if (!fu_history_transaction_begin (self, error))
+		return FALSE;
+	if (max_age > 0) {
+		gint64 now = g_get_real_time () / G_USEC_PER_SEC;
+		sqlite3_bind_int (stmt_age, 1, FWUPD_UPDATE_STATE_PENDING);
+		sqlite3_bind_int (stmt_age, 2, FWUPD_UPDATE_STATE_NEEDS_REBOOT);
+		sqlite3_bind_int64 (stmt_age, 3, now - (gint64) max_age);
+		if (!fu_history_stmt_exec (self, stmt_age, NULL, error)) {
+			fu_history_transaction_rollback (self);
+			return FALSE;
+		}
+		changes += sqlite3_changes (self->db);
+	}
+	if (max_entries > 0) {
+		sqlite3_bind_int (stmt_entries, 1, FWUPD_UPDATE_STATE_PENDING);
+		sqlite3_bind_int (stmt_entries, 2, FWUPD_UPDATE_STATE_NEEDS_REBOOT);
+		sqlite3_bind_int64 (stmt_entries, 3, max_entries);
+		if (!fu_history_stmt_exec (self, stmt_entries, NULL, error)) {
+			fu_history_transaction_rollback (self);
+			return FALSE;
+		}
+		changes += sqlite3_changes (self->db);
+	}
+	if (!fu_history_transaction_commit (self, error))
+		return FALSE;
+	g_debug ("pruned %i devices from history", changes);
+	return TRUE;
 }
 
 /**
@@ -887,28 +1200,26 @@ GPtrArray *
 fu_history_get_approved_firmware (FuHistory *self, GError **error)
 {
 	gint rc;
-	g_autoptr(GRWLockReaderLocker) locker = NULL;
+	sqlite3_stmt *stmt;
+	g_autoptr(GMutexLocker) locker = NULL;
 	g_autoptr(GPtrArray) array = NULL;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), NULL);
 
 	/* lazy load */
-	if (self->db == NULL) {
+	if (self->db_reader == NULL) {
 		if (!fu_history_load (self, error))
 			return NULL;
 	}
 
 	/* get all the approved firmware */
-	locker = g_rw_lock_reader_locker_new (&self->db_mutex);
+	locker = g_mutex_locker_new (&self->db_reader_mutex);
 	g_return_val_if_fail (locker != NULL, NULL);
-	rc = sqlite3_prepare_v2 (self->db,
-				 "SELECT checksum FROM approved_firmware;",
-				 -1, &stmt, NULL);
-	if (rc != SQLITE_OK) {
-		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
-			     "Failed to prepare SQL to get checksum: %s",
-			     sqlite3_errmsg (self->db));
+	stmt = fu_history_stmt_get (self->db_reader, self->stmts_reader,
+				    "SELECT checksum FROM approved_firmware;",
+				    error);
+	if (stmt == NULL) {
+		g_prefix_error (error, "Failed to prepare SQL to get checksum: ");
 		return NULL;
 	}
 	array = g_ptr_array_new_with_free_func (g_free);
@@ -919,9 +1230,11 @@ fu_history_get_approved_firmware (FuHistory *self, GError **error)
 	if (rc != SQLITE_DONE) {
 		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_WRITE,
 			     "failed to execute prepared statement: %s",
-			     sqlite3_errmsg (self->db));
+			     sqlite3_errmsg (self->db_reader));
+		sqlite3_reset (stmt);
 		return NULL;
 	}
+	sqlite3_reset (stmt);
 	return g_steal_pointer (&array);
 }
 
@@ -939,8 +1252,7 @@ fu_history_get_approved_firmware (FuHistory *self, GError **error)
 gboolean
 fu_history_clear_approved_firmware (FuHistory *self, GError **error)
 {
-	gint rc;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
+	sqlite3_stmt *stmt;
 	g_autoptr(GRWLockWriterLocker) locker = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
@@ -952,13 +1264,11 @@ fu_history_clear_approved_firmware (FuHistory *self, GError **error)
 	/* remove entries */
 	locker = g_rw_lock_writer_locker_new (&self->db_mutex);
 	g_return_val_if_fail (locker != NULL, FALSE);
-	rc = sqlite3_prepare_v2 (self->db,
-				 "DELETE FROM approved_firmware;",
-				 -1, &stmt, NULL);
-	if (rc != SQLITE_OK) {
-		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
-			     "Failed to prepare SQL to delete approved firmware: %s",
-			     sqlite3_errmsg (self->db));
+	stmt = fu_history_stmt_get (self->db, self->stmts,
+				    "DELETE FROM approved_firmware;",
+				    error);
+	if (stmt == NULL) {
+		g_prefix_error (error, "Failed to prepare SQL to delete approved firmware: ");
 		return FALSE;
 	}
 	return fu_history_stmt_exec (self, stmt, NULL, error);
@@ -981,8 +1291,7 @@ fu_history_add_approved_firmware (FuHistory *self,
 				  const gchar *checksum,
 				  GError **error)
 {
-	gint rc;
-	g_autoptr(sqlite3_stmt) stmt = NULL;
+	sqlite3_stmt *stmt;
 	g_autoptr(GRWLockWriterLocker) locker = NULL;
 
 	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
@@ -995,19 +1304,221 @@ fu_history_add_approved_firmware (FuHistory *self,
 	/* add */
 	locker = g_rw_lock_writer_locker_new (&self->db_mutex);
 	g_return_val_if_fail (locker != NULL, FALSE);
-	rc = sqlite3_prepare_v2 (self->db,
-				 "INSERT INTO approved_firmware (checksum) "
-				 "VALUES (?1)", -1, &stmt, NULL);
-	if (rc != SQLITE_OK) {
-		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
-			     "Failed to prepare SQL to insert checksum: %s",
-			     sqlite3_errmsg (self->db));
+	stmt = fu_history_stmt_get (self->db, self->stmts,
+				    "INSERT INTO approved_firmware (checksum) "
+				    "VALUES (?1)", error);
+	if (stmt == NULL) {
+		g_prefix_error (error, "Failed to prepare SQL to insert checksum: ");
 		return FALSE;
 	}
 	sqlite3_bind_text (stmt, 1, checksum, -1, SQLITE_STATIC);
 	return fu_history_stmt_exec (self, stmt, NULL, error);
 }
 
+/* if @replace is %FALSE then nothing is written when the device already has
+ * any stored checksums */
+static gboolean
+fu_history_write_verify_checksums (FuHistory *self,
+				   const gchar *device_id,
+				   const gchar *version,
+				   GPtrArray *checksums,
+				   gboolean replace,
+				   GError **error)
+{
+	gint rc;
+	sqlite3_stmt *stmt_delete;
+	sqlite3_stmt *stmt_exists;
+	sqlite3_stmt *stmt_insert;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
+
+	/* lazy load */
+	if (!fu_history_load (self, error))
+		return FALSE;
+
+	/* check or replace the entries for this device atomically */
+	locker = g_rw_lock_writer_locker_new (&self->db_mutex);
+	g_return_val_if_fail (locker != NULL, FALSE);
+	stmt_delete = fu_history_stmt_get (self->db, self->stmts,
+					   "DELETE FROM verify WHERE device_id = ?1;",
+					   error);
+	if (stmt_delete == NULL) {
+		g_prefix_error (error, "Failed to prepare SQL to delete verify: ");
+		return FALSE;
+	}
+	stmt_exists = fu_history_stmt_get (self->db, self->stmts,
+					   "SELECT 1 FROM verify WHERE device_id = ?1 LIMIT 1;",
+					   error);
+	if (stmt_exists == NULL) {
+		g_prefix_error (error, "Failed to prepare SQL to find verify: ");
+		return FALSE;
+	}
+	stmt_insert = fu_history_stmt_get (self->db, self->stmts,
+					   "INSERT INTO verify (device_id,"
+							       "version,"
+							       "checksum) "
+					   "VALUES (?1,?2,?3)", error);
+	if (stmt_insert == NULL) {
+		g_prefix_error (error, "Failed to prepare SQL to insert verify: ");
+		return FALSE;
+	}
+	if (!fu_history_transaction_begin (self, error))
+		return FALSE;
+	if (replace) {
+		sqlite3_bind_text (stmt_delete, 1, device_id, -1, SQLITE_STATIC);
+		if (!fu_history_stmt_exec (self, stmt_delete, NULL, error)) {
+			fu_history_transaction_rollback (self);
+			return FALSE;
+		}
+	} else {
+		sqlite3_bind_text (stmt_exists, 1, device_id, -1, SQLITE_STATIC);
+		rc = sqlite3_step (stmt_exists);
+		sqlite3_reset (stmt_exists);
+		if (rc == SQLITE_ROW) {
+			g_debug ("not importing checksums for %s as already set", device_id);
+			return fu_history_transaction_commit (self, error);
+		}
+		if (rc != SQLITE_DONE) {
+			g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_READ,
+				     "failed to execute prepared statement: %s",
+				     sqlite3_errmsg (self->db));
+			fu_history_transaction_rollback (self);
+			return FALSE;
+		}
+	}
+	for (guint i = 0; i < checksums->len; i++) {
+		const gchar *checksum = g_ptr_array_index (checksums, i);
+		sqlite3_reset (stmt_insert);
+		sqlite3_bind_text (stmt_insert, 1, device_id, -1, SQLITE_STATIC);
+		sqlite3_bind_text (stmt_insert, 2, version, -1, SQLITE_STATIC);
+		sqlite3_bind_text (stmt_insert, 3, checksum, -1, SQLITE_STATIC);
+		if (!fu_history_stmt_exec (self, stmt_insert, NULL, error)) {
+			fu_history_transaction_rollback (self);
+			return FALSE;
+		}
+	}
+	return fu_history_transaction_commit (self, error);
+}
+
+/**
+ * fu_history_set_verify_checksums:
+ * @self: A #FuHistory
+ * @device_id: A device ID
+ * @version: A device version
+ * @checksums: (element-type utf8): checksums of the device firmware
+ * @error: A #GError or NULL
+ *
+ * Replaces all the stored verification checksums for the device with the
+ * checksums of the specified version.
+ *
+ * Returns: #TRUE for success, #FALSE for failure
+ *
+ * Since: 1.4.2
+ **/
+gboolean
+fu_history_set_verify_checksums (FuHistory *self,
+				 const gchar *device_id,
+				 const gchar *version,
+				 GPtrArray *checksums,
+				 GError **error)
+{
+	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
+	g_return_val_if_fail (device_id != NULL, FALSE);
+	g_return_val_if_fail (checksums != NULL, FALSE);
+	return fu_history_write_verify_checksums (self, device_id, version,
+						  checksums, TRUE, error);
+}
+
+/**
+ * fu_history_import_verify_checksums:
+ * @self: A #FuHistory
+ * @device_id: A device ID
+ * @version: A device version
+ * @checksums: (element-type utf8): checksums of the device firmware
+ * @error: A #GError or NULL
+ *
+ * Adds verification checksums for the device, for instance from a legacy
+ * file, but only if no checksums have been stored for the device already.
+ *
+ * Returns: #TRUE for success, #FALSE for failure
+ *
+ * Since: 1.4.2
+ **/
+gboolean
+fu_history_import_verify_checksums (FuHistory *self,
+				    const gchar *device_id,
+				    const gchar *version,
+				    GPtrArray *checksums,
+				    GError **error)
+{
+	g_return_val_if_fail (FU_IS_HISTORY (self), FALSE);
+	g_return_val_if_fail (device_id != NULL, FALSE);
+	g_return_val_if_fail (checksums != NULL, FALSE);
+	return fu_history_write_verify_checksums (self, device_id, version,
+						  checksums, FALSE, error);
+}
+
+/**
+ * fu_history_get_verify_checksums:
+ * @self: A #FuHistory
+ * @device_id: A device ID
+ * @version: A device version
+ * @error: A #GError or NULL
+ *
+ * Gets the stored verification checksums for a specific device version.
+ *
+ * Returns: (transfer full) (element-type utf8): checksums, which may be empty
+ *
+ * Since: 1.4.2
+ **/
+GPtrArray *
+fu_history_get_verify_checksums (FuHistory *self,
+				 const gchar *device_id,
+				 const gchar *version,
+				 GError **error)
+{
+	gint rc;
+	sqlite3_stmt *stmt;
+	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GPtrArray) array = NULL;
+
+	g_return_val_if_fail (FU_IS_HISTORY (self), NULL);
+	g_return_val_if_fail (device_id != NULL, NULL);
+
+	/* lazy load */
+	if (self->db_reader == NULL) {
+		if (!fu_history_load (self, error))
+			return NULL;
+	}
+
+	/* uses the verify_device_version index */
+	locker = g_mutex_locker_new (&self->db_reader_mutex);
+	g_return_val_if_fail (locker != NULL, NULL);
+	stmt = fu_history_stmt_get (self->db_reader, self->stmts_reader,
+				    "SELECT checksum FROM verify "
+				    "WHERE device_id = ?1 AND version = ?2;",
+				    error);
+	if (stmt == NULL) {
+		g_prefix_error (error, "Failed to prepare SQL to get verify: ");
+		return NULL;
+	}
+	sqlite3_bind_text (stmt, 1, device_id, -1, SQLITE_STATIC);
+	sqlite3_bind_text (stmt, 2, version, -1, SQLITE_STATIC);
+	array = g_ptr_array_new_with_free_func (g_free);
+	while ((rc = sqlite3_step (stmt)) == SQLITE_ROW) {
+		const gchar *tmp = (const gchar *) sqlite3_column_text (stmt, 0);
+		g_ptr_array_add (array, g_strdup (tmp));
+	}
+	if (rc != SQLITE_DONE) {
+		g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_READ,
+			     "failed to execute prepared statement: %s",
+			     sqlite3_errmsg (self->db_reader));
+		sqlite3_reset (stmt);
+		return NULL;
+	}
+	sqlite3_reset (stmt);
+	return g_steal_pointer (&array);
+}
+
 static void
 fu_history_class_init (FuHistoryClass *klass)
 {
@@ -1019,6 +1530,11 @@ static void
 fu_history_init (FuHistory *self)
 {
 	g_rw_lock_init (&self->db_mutex);
+	g_mutex_init (&self->db_reader_mutex);
+	self->stmts = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+					     (GDestroyNotify) sqlite3_finalize);
+	self->stmts_reader = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+						    (GDestroyNotify) sqlite3_finalize);
 }
 
 static void
@@ -1026,9 +1542,11 @@ fu_history_finalize (GObject *object)
 {
 	FuHistory *self = FU_HISTORY (object);
 
-	if (self->db != NULL)
-		sqlite3_close (self->db);
+	fu_history_close (self);
+	g_hash_table_unref (self->stmts);
+	g_hash_table_unref (self->stmts_reader);
 	g_rw_lock_clear (&self->db_mutex);
+	g_mutex_clear (&self->db_reader_mutex);
 
 	G_OBJECT_CLASS (fu_history_parent_class)->finalize (object);
 }
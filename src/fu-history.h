@@ -35,6 +35,17 @@ FuDevice	*fu_history_get_device_by_id		(FuHistory	*self,
 							 GError		**error);
 GPtrArray	*fu_history_get_devices			(FuHistory	*self,
 							 GError		**error);
+GPtrArray	*fu_history_get_devices_full		(FuHistory	*self,
+							 const gchar	*device_id,
+							 FwupdUpdateState update_state,
+							 guint64	 since,
+							 guint		 offset,
+							 guint		 limit,
+							 GError		**error);
+gboolean	 fu_history_prune			(FuHistory	*self,
+							 guint64	 max_age,
+							 guint		 max_entries,
+							 GError		**error);
 
 gboolean	 fu_history_clear_approved_firmware	(FuHistory	*self,
 							 GError		**error);
@@ -43,3 +54,18 @@ gboolean	 fu_history_add_approved_firmware	(FuHistory	*self,
 							 GError		**error);
 GPtrArray	*fu_history_get_approved_firmware	(FuHistory	*self,
 							 GError		**error);
+
+gboolean	 fu_history_set_verify_checksums	(FuHistory	*self,
+							 const gchar	*device_id,
+							 const gchar	*version,
+							 GPtrArray	*checksums,
+							 GError		**error);
+gboolean	 fu_history_import_verify_checksums	(FuHistory	*self,
+							 const gchar	*device_id,
+							 const gchar	*version,
+							 GPtrArray	*checksums,
+							 GError		**error);
+GPtrArray	*fu_history_get_verify_checksums	(FuHistory	*self,
+							 const gchar	*device_id,
+							 const gchar	*version,
+							 GError		**error);
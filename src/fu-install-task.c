@@ -19,7 +19,7 @@ struct _FuInstallTask
 {
 	GObject			 parent_instance;
 	FuDevice		*device;
-	XbNode			*component;
+	FuRequirements		*requirements;
 	FwupdReleaseFlags		 trust_flags;
 	gboolean		 is_downgrade;
 };
@@ -53,7 +53,24 @@ XbNode *
 fu_install_task_get_component (FuInstallTask *self)
 {
 	g_return_val_if_fail (FU_IS_INSTALL_TASK (self), NULL);
-	return self->component;
+	if (self->requirements == NULL)
+		return NULL;
+	return fu_requirements_get_component (self->requirements);
+}
+
+/**
+ * fu_install_task_get_requirements:
+ * @self: A #FuInstallTask
+ *
+ * Gets the compiled requirements of the component for this task.
+ *
+ * Returns: (transfer none): the #FuRequirements
+ **/
+FuRequirements *
+fu_install_task_get_requirements (FuInstallTask *self)
+{
+	g_return_val_if_fail (FU_IS_INSTALL_TASK (self), NULL);
+	return self->requirements;
 }
 
 /**
@@ -152,35 +169,6 @@ fu_install_task_check_verfmt (FuInstallTask *self,
 	return TRUE;
 }
 
-static gboolean
-fu_install_task_check_requirements_version_check (FuInstallTask *self, GError **error)
-{
-	g_autoptr(GError) error_local = NULL;
-	g_autoptr(GPtrArray) reqs = NULL;
-
-	reqs = xb_node_query (fu_install_task_get_component (self),
-			      "requires/*", 0, &error_local);
-	if (reqs == NULL) {
-		g_set_error_literal (error,
-				     FWUPD_ERROR,
-				     FWUPD_ERROR_NOT_SUPPORTED,
-				     error_local->message);
-		return FALSE;
-	}
-	for (guint i = 0; i < reqs->len; i++) {
-		XbNode *req = g_ptr_array_index (reqs, i);
-		if (g_strcmp0 (xb_node_get_element (req), "firmware") == 0 &&
-		    xb_node_get_text (req) == NULL) {
-			return TRUE;
-		}
-	}
-	g_set_error_literal (error,
-			     FWUPD_ERROR,
-			     FWUPD_ERROR_NOT_SUPPORTED,
-			     "no firmware requirement");
-	return FALSE;
-}
-
 /**
  * fu_install_task_check_requirements:
  * @self: A #FuInstallTask
@@ -200,58 +188,31 @@ fu_install_task_check_requirements (FuInstallTask *self,
 {
 	const gchar *protocol;
 	const gchar *version;
+	const gchar *version_release = NULL;
 	const gchar *version_release_raw;
 	const gchar *version_lowest;
-	gboolean matches_guid = FALSE;
+	GPtrArray *verfmts;
+	XbNode *release;
 	gint vercmp;
-	g_autofree gchar *version_release = NULL;
 	g_autoptr(GError) error_local = NULL;
-	g_autoptr(GPtrArray) provides = NULL;
-	g_autoptr(GPtrArray) verfmts = NULL;
-	g_autoptr(XbNode) release = NULL;
 
 	g_return_val_if_fail (FU_IS_INSTALL_TASK (self), FALSE);
 	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
 
 	/* does this component provide a GUID the device has */
-	provides = xb_node_query (self->component,
-				  "provides/firmware[@type='flashed']",
-				  0, &error_local);
-	if (provides == NULL) {
-		g_set_error (error,
-			     FWUPD_ERROR,
-			     FWUPD_ERROR_NOT_FOUND,
-			     "No supported devices found: %s",
-			     error_local->message);
-		return FALSE;
-	}
-	for (guint i = 0; i < provides->len; i++) {
-		XbNode *provide = g_ptr_array_index (provides, i);
-		if (fu_device_has_guid (self->device, xb_node_get_text (provide))) {
-			matches_guid = TRUE;
-			break;
-		}
-	}
-	if (!matches_guid) {
-		g_set_error_literal (error,
-				     FWUPD_ERROR,
-				     FWUPD_ERROR_NOT_FOUND,
-				     "No supported devices found");
+	if (!fu_requirements_has_device_guid (self->requirements, self->device, error))
 		return FALSE;
-	}
 
 	/* device requires a version check */
 	if (fu_device_has_flag (self->device, FWUPD_DEVICE_FLAG_VERSION_CHECK_REQUIRED)) {
-		if (!fu_install_task_check_requirements_version_check (self, error)) {
+		if (!fu_requirements_has_version_check (self->requirements, error)) {
 			g_prefix_error (error, "device requires firmware with a version check: ");
 			return FALSE;
 		}
 	}
 
 	/* does the protocol match */
-	protocol = xb_node_query_text (self->component,
-				       "custom/value[@key='LVFS::UpdateProtocol']",
-				       NULL);
+	protocol = fu_requirements_get_protocol (self->requirements);
 	if (fu_device_get_protocol (self->device) != NULL && protocol != NULL &&
 	    g_strcmp0 (fu_device_get_protocol (self->device), protocol) != 0 &&
 	    (flags & FWUPD_INSTALL_FLAG_FORCE) == 0) {
@@ -313,7 +274,7 @@ fu_install_task_check_requirements (FuInstallTask *self,
 	}
 
 	/* get latest release */
-	release = xb_node_query_first (self->component, "releases/release", NULL);
+	release = fu_requirements_get_release (self->requirements);
 	if (release == NULL) {
 		g_set_error (error,
 			     FWUPD_ERROR,
@@ -336,9 +297,7 @@ fu_install_task_check_requirements (FuInstallTask *self,
 
 	/* check the version formats match if set in the release */
 	if ((flags & FWUPD_INSTALL_FLAG_FORCE) == 0) {
-		verfmts = xb_node_query (self->component,
-					"custom/value[@key='LVFS::VersionFormat']",
-					0, NULL);
+		verfmts = fu_requirements_get_verfmts (self->requirements);
 		if (verfmts != NULL) {
 			if (!fu_install_task_check_verfmt (self, verfmts, flags, error))
 				return FALSE;
@@ -360,14 +319,10 @@ fu_install_task_check_requirements (FuInstallTask *self,
 	}
 
 	/* check semver */
-	if (fu_device_get_version_format (self->device) == FWUPD_VERSION_FORMAT_PLAIN) {
-		version_release = g_strdup (version_release_raw);
-	} else {
-		version_release = fu_common_version_parse_from_format (version_release_raw,
-								       fu_device_get_version_format (self->device));
-	}
-	vercmp = fu_common_vercmp_full (version, version_release,
-					fu_device_get_version_format (self->device));
+	vercmp = fu_requirements_vercmp_release (self->requirements,
+						 version,
+						 fu_device_get_version_format (self->device),
+						 &version_release);
 	if (vercmp == 0 && (flags & FWUPD_INSTALL_FLAG_ALLOW_REINSTALL) == 0) {
 		g_set_error (error,
 			     FWUPD_ERROR,
@@ -439,8 +394,8 @@ fu_install_task_finalize (GObject *object)
 {
 	FuInstallTask *self = FU_INSTALL_TASK (object);
 
-	if (self->component != NULL)
-		g_object_unref (self->component);
+	if (self->requirements != NULL)
+		g_object_unref (self->requirements);
 	if (self->device != NULL)
 		g_object_unref (self->device);
 
@@ -486,11 +441,30 @@ fu_install_task_compare (FuInstallTask *task1, FuInstallTask *task2)
  **/
 FuInstallTask *
 fu_install_task_new (FuDevice *device, XbNode *component)
+{
+	g_autoptr(FuRequirements) requirements = NULL;
+	if (component != NULL)
+		requirements = fu_requirements_new (component);
+	return fu_install_task_new_full (device, requirements);
+}
+
+/**
+ * fu_install_task_new_full:
+ * @device: A #FuDevice
+ * @requirements: a #FuRequirements
+ *
+ * Creates a new install task that may or may not be valid, sharing the
+ * compiled requirements of a component with other tasks.
+ *
+ * Returns: (transfer full): the #FuInstallTask
+ **/
+FuInstallTask *
+fu_install_task_new_full (FuDevice *device, FuRequirements *requirements)
 {
 	FuInstallTask *self;
 	self = g_object_new (FU_TYPE_TASK, NULL);
-	if (component != NULL)
-		self->component = g_object_ref (component);
+	if (requirements != NULL)
+		self->requirements = g_object_ref (requirements);
 	if (device != NULL)
 		self->device = g_object_ref (device);
 	return FU_INSTALL_TASK (self);
@@ -10,14 +10,18 @@
 #include <xmlb.h>
 
 #include "fu-device.h"
+#include "fu-requirements.h"
 
 #define FU_TYPE_TASK (fu_install_task_get_type ())
 G_DECLARE_FINAL_TYPE (FuInstallTask, fu_install_task, FU, INSTALL_TASK, GObject)
 
 FuInstallTask	*fu_install_task_new			(FuDevice	*device,
 							 XbNode		*component);
+FuInstallTask	*fu_install_task_new_full		(FuDevice	*device,
+							 FuRequirements	*requirements);
 FuDevice	*fu_install_task_get_device		(FuInstallTask	*self);
 XbNode		*fu_install_task_get_component		(FuInstallTask	*self);
+FuRequirements	*fu_install_task_get_requirements	(FuInstallTask	*self);
 FwupdReleaseFlags fu_install_task_get_trust_flags	(FuInstallTask	*self);
 gboolean	 fu_install_task_get_is_downgrade	(FuInstallTask	*self);
 gboolean	 fu_install_task_check_requirements	(FuInstallTask	*self,
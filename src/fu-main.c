@@ -24,11 +24,13 @@
 #include "fwupd-remote-private.h"
 #include "fwupd-resources.h"
 
+#include "fu-change-stream.h"
 #include "fu-common.h"
 #include "fu-debug.h"
 #include "fu-device-private.h"
 #include "fu-engine.h"
 #include "fu-install-task.h"
+#include "fu-plugin-private.h"
 
 #ifndef HAVE_POLKIT_0_114
 #pragma clang diagnostic push
@@ -50,6 +52,7 @@ typedef struct {
 	PolkitAuthority		*authority;
 	guint			 owner_id;
 	FuEngine		*engine;
+	FuChangeStream		*change_stream;
 	gboolean		 update_in_progress;
 	gboolean		 pending_sigterm;
 } FuMainPrivate;
@@ -88,6 +91,8 @@ fu_main_engine_device_added_cb (FuEngine *engine,
 {
 	GVariant *val;
 
+	fu_change_stream_device_added (priv->change_stream, FWUPD_DEVICE (device));
+
 	/* not yet connected */
 	if (priv->connection == NULL)
 		return;
@@ -107,6 +112,8 @@ fu_main_engine_device_removed_cb (FuEngine *engine,
 {
 	GVariant *val;
 
+	fu_change_stream_device_removed (priv->change_stream, FWUPD_DEVICE (device));
+
 	/* not yet connected */
 	if (priv->connection == NULL)
 		return;
@@ -126,6 +133,8 @@ fu_main_engine_device_changed_cb (FuEngine *engine,
 {
 	GVariant *val;
 
+	fu_change_stream_device_changed (priv->change_stream, FWUPD_DEVICE (device));
+
 	/* not yet connected */
 	if (priv->connection == NULL)
 		return;
@@ -247,8 +256,8 @@ fu_main_device_array_to_variant (FuMainPrivate *priv, const gchar *sender,
 
 	for (guint i = 0; i < devices->len; i++) {
 		FuDevice *device = g_ptr_array_index (devices, i);
-		GVariant *tmp = fwupd_device_to_variant_full (FWUPD_DEVICE (device),
-							      flags);
+		g_autoptr(GVariant) tmp = NULL;
+		tmp = fwupd_device_to_variant_cached (FWUPD_DEVICE (device), flags);
 		g_variant_builder_add_value (&builder, tmp);
 	}
 	return g_variant_new ("(aa{sv})", &builder);
@@ -718,6 +727,7 @@ fu_main_install_with_helper (FuMainAuthHelper *helper_ref, GError **error)
 	errors = g_ptr_array_new_with_free_func ((GDestroyNotify) g_error_free);
 	for (guint i = 0; i < components->len; i++) {
 		XbNode *component = g_ptr_array_index (components, i);
+		g_autoptr(FuRequirements) requirements = fu_requirements_new (component);
 
 		/* do any devices pass the requirements */
 		for (guint j = 0; j < devices_possible->len; j++) {
@@ -726,8 +736,14 @@ fu_main_install_with_helper (FuMainAuthHelper *helper_ref, GError **error)
 			g_autoptr(FuInstallTask) task = NULL;
 			g_autoptr(GError) error_local = NULL;
 
+			/* skip quickly if the component cannot be flashed onto the device */
+			if (!fu_requirements_has_device_guid (requirements, device, &error_local)) {
+				g_ptr_array_add (errors, g_steal_pointer (&error_local));
+				continue;
+			}
+
 			/* is this component valid for the device */
-			task = fu_install_task_new (device, component);
+			task = fu_install_task_new_full (device, requirements);
 			if (!fu_engine_check_requirements (priv->engine,
 							   task,
 							   helper->flags | FWUPD_INSTALL_FLAG_FORCE,
@@ -797,10 +813,10 @@ fu_main_device_id_valid (const gchar *device_id, GError **error)
 }
 
 static void
-fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
-			    const gchar *object_path, const gchar *interface_name,
-			    const gchar *method_name, GVariant *parameters,
-			    GDBusMethodInvocation *invocation, gpointer user_data)
+fu_main_daemon_method_call_internal (GDBusConnection *connection, const gchar *sender,
+				     const gchar *object_path, const gchar *interface_name,
+				     const gchar *method_name, GVariant *parameters,
+				     GDBusMethodInvocation *invocation, gpointer user_data)
 {
 	FuMainPrivate *priv = (FuMainPrivate *) user_data;
 	GVariant *val = NULL;
@@ -825,6 +841,14 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 		g_dbus_method_invocation_return_value (invocation, val);
 		return;
 	}
+	if (g_strcmp0 (method_name, "GetChanges") == 0) {
+		guint64 since = 0;
+		g_variant_get (parameters, "(t)", &since);
+		g_debug ("Called %s(%" G_GUINT64_FORMAT ")", method_name, since);
+		val = fu_change_stream_get_changes (priv->change_stream, since);
+		g_dbus_method_invocation_return_value (invocation, val);
+		return;
+	}
 	if (g_strcmp0 (method_name, "GetReleases") == 0) {
 		const gchar *device_id;
 		g_autoptr(GPtrArray) releases = NULL;
@@ -987,6 +1011,124 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 		g_dbus_method_invocation_return_value (invocation, val);
 		return;
 	}
+	if (g_strcmp0 (method_name, "GetStartupTrace") == 0) {
+		FuTrace *trace = fu_engine_get_trace (priv->engine);
+		g_autofree gchar *json = NULL;
+		g_debug ("Called %s()", method_name);
+		if (fu_trace_get_size (trace) == 0) {
+			g_set_error_literal (&error,
+					     FWUPD_ERROR,
+					     FWUPD_ERROR_NOT_SUPPORTED,
+					     "No startup trace, set FWUPD_TRACE "
+					     "in the daemon environment");
+			g_dbus_method_invocation_return_gerror (invocation, error);
+			return;
+		}
+		json = fu_trace_to_json (trace, &error);
+		if (json == NULL) {
+			g_dbus_method_invocation_return_gerror (invocation, error);
+			return;
+		}
+		val = g_variant_new ("(s)", json);
+		g_dbus_method_invocation_return_value (invocation, val);
+		return;
+	}
+	if (g_strcmp0 (method_name, "GetAllocStats") == 0) {
+		FuAllocStats *alloc_stats = fu_engine_get_alloc_stats (priv->engine);
+		g_autofree gchar *json = NULL;
+		g_debug ("Called %s()", method_name);
+		if (!fu_alloc_stats_get_enabled (alloc_stats)) {
+			g_set_error_literal (&error,
+					     FWUPD_ERROR,
+					     FWUPD_ERROR_NOT_SUPPORTED,
+					     "Allocation stats not enabled, set "
+					     "FWUPD_ALLOC_STATS in the daemon "
+					     "environment or use --profile-allocs");
+			g_dbus_method_invocation_return_gerror (invocation, error);
+			return;
+		}
+		json = fu_alloc_stats_to_json (alloc_stats, &error);
+		if (json == NULL) {
+			g_dbus_method_invocation_return_gerror (invocation, error);
+			return;
+		}
+		val = g_variant_new ("(s)", json);
+		g_dbus_method_invocation_return_value (invocation, val);
+		return;
+	}
+	if (g_strcmp0 (method_name, "GetPluginStats") == 0) {
+		GPtrArray *plugins = fu_engine_get_plugins (priv->engine);
+		GVariantBuilder builder;
+		g_debug ("Called %s()", method_name);
+		g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+		for (guint i = 0; i < plugins->len; i++) {
+			FuPlugin *plugin = g_ptr_array_index (plugins, i);
+			if (!fu_plugin_get_enabled (plugin))
+				continue;
+			g_variant_builder_add (&builder, "{sv}",
+					       fu_plugin_get_name (plugin),
+					       fu_plugin_stats_to_variant (plugin));
+		}
+		val = g_variant_new ("(a{sv})", &builder);
+		g_dbus_method_invocation_return_value (invocation, val);
+		return;
+	}
+	if (g_strcmp0 (method_name, "GetHistoryFiltered") == 0) {
+		GVariant *prop_value;
+		const gchar *prop_key;
+		FwupdUpdateState update_state = FWUPD_UPDATE_STATE_UNKNOWN;
+		guint64 since = 0;
+		guint offset = 0;
+		guint limit = 0;
+		g_autofree gchar *device_id = NULL;
+		g_autoptr(GPtrArray) devices = NULL;
+		g_autoptr(GVariantIter) iter = NULL;
+
+		g_variant_get (parameters, "(a{sv})", &iter);
+		while (g_variant_iter_next (iter, "{&sv}", &prop_key, &prop_value)) {
+			g_debug ("got option %s", prop_key);
+			if (g_strcmp0 (prop_key, "device-id") == 0 &&
+			    g_variant_is_of_type (prop_value, G_VARIANT_TYPE_STRING)) {
+				g_free (device_id);
+				device_id = g_variant_dup_string (prop_value, NULL);
+			}
+			if (g_strcmp0 (prop_key, "update-state") == 0 &&
+			    g_variant_is_of_type (prop_value, G_VARIANT_TYPE_UINT32))
+				update_state = g_variant_get_uint32 (prop_value);
+			if (g_strcmp0 (prop_key, "since") == 0 &&
+			    g_variant_is_of_type (prop_value, G_VARIANT_TYPE_UINT64))
+				since = g_variant_get_uint64 (prop_value);
+			if (g_strcmp0 (prop_key, "offset") == 0 &&
+			    g_variant_is_of_type (prop_value, G_VARIANT_TYPE_UINT32))
+				offset = g_variant_get_uint32 (prop_value);
+			if (g_strcmp0 (prop_key, "limit") == 0 &&
+			    g_variant_is_of_type (prop_value, G_VARIANT_TYPE_UINT32))
+				limit = g_variant_get_uint32 (prop_value);
+			g_variant_unref (prop_value);
+		}
+		g_debug ("Called %s(%s,%s,%" G_GUINT64_FORMAT ",%u,%u)",
+			 method_name, device_id,
+			 fwupd_update_state_to_string (update_state),
+			 since, offset, limit);
+		if (device_id != NULL && !fu_main_device_id_valid (device_id, &error)) {
+			g_dbus_method_invocation_return_gerror (invocation, error);
+			return;
+		}
+		devices = fu_engine_get_history_full (priv->engine, device_id,
+						      update_state, since,
+						      offset, limit, &error);
+		if (devices == NULL) {
+			g_dbus_method_invocation_return_gerror (invocation, error);
+			return;
+		}
+		val = fu_main_device_array_to_variant (priv, sender, devices, &error);
+		if (val == NULL) {
+			g_dbus_method_invocation_return_gerror (invocation, error);
+			return;
+		}
+		g_dbus_method_invocation_return_value (invocation, val);
+		return;
+	}
 	if (g_strcmp0 (method_name, "ClearResults") == 0) {
 		const gchar *device_id;
 		g_variant_get (parameters, "(&s)", &device_id);
@@ -1362,6 +1504,24 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 	g_dbus_method_invocation_return_gerror (invocation, error);
 }
 
+static void
+fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
+			    const gchar *object_path, const gchar *interface_name,
+			    const gchar *method_name, GVariant *parameters,
+			    GDBusMethodInvocation *invocation, gpointer user_data)
+{
+	FuMainPrivate *priv = (FuMainPrivate *) user_data;
+	FuAllocStats *alloc_stats = fu_engine_get_alloc_stats (priv->engine);
+
+	/* methods that need authentication finish in a callback, which is not counted */
+	fu_alloc_stats_begin (alloc_stats, "dbus", method_name);
+	fu_main_daemon_method_call_internal (connection, sender,
+					     object_path, interface_name,
+					     method_name, parameters,
+					     invocation, user_data);
+	fu_alloc_stats_end (alloc_stats);
+}
+
 static GVariant *
 fu_main_daemon_get_property (GDBusConnection *connection_, const gchar *sender,
 			     const gchar *object_path, const gchar *interface_name,
@@ -1529,6 +1689,8 @@ fu_main_private_free (FuMainPrivate *priv)
 		g_object_unref (priv->proxy_uid);
 	if (priv->engine != NULL)
 		g_object_unref (priv->engine);
+	if (priv->change_stream != NULL)
+		g_object_unref (priv->change_stream);
 	if (priv->connection != NULL)
 		g_object_unref (priv->connection);
 	if (priv->authority != NULL)
@@ -1553,6 +1715,7 @@ int
 main (int argc, char *argv[])
 {
 	gboolean immediate_exit = FALSE;
+	gboolean profile_allocs = FALSE;
 	gboolean timed_exit = FALSE;
 	const GOptionEntry options[] = {
 		{ "timed-exit", '\0', 0, G_OPTION_ARG_NONE, &timed_exit,
@@ -1561,6 +1724,9 @@ main (int argc, char *argv[])
 		{ "immediate-exit", '\0', 0, G_OPTION_ARG_NONE, &immediate_exit,
 		  /* TRANSLATORS: exit straight away, used for automatic profiling */
 		  _("Exit after the engine has loaded"), NULL },
+		{ "profile-allocs", '\0', 0, G_OPTION_ARG_NONE, &profile_allocs,
+		  /* TRANSLATORS: record memory usage, used for debugging leaks */
+		  _("Record memory usage for each method and phase"), NULL },
 		{ NULL}
 	};
 	g_autoptr(FuMainPrivate) priv = NULL;
@@ -1592,6 +1758,9 @@ main (int argc, char *argv[])
 
 	/* load engine */
 	priv->engine = fu_engine_new (FU_APP_FLAGS_NONE);
+	priv->change_stream = fu_change_stream_new ();
+	if (profile_allocs)
+		fu_alloc_stats_set_enabled (fu_engine_get_alloc_stats (priv->engine), TRUE);
 	g_signal_connect (priv->engine, "changed",
 			  G_CALLBACK (fu_main_engine_changed_cb),
 			  priv);
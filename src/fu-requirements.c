@@ -0,0 +1,382 @@
+/*
+ * Copyright (C) 2020 The fwupd authors
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#define G_LOG_DOMAIN				"FuRequirements"
+
+#include "config.h"
+
+#include <fwupd.h>
+
+#include "fu-common-version.h"
+#include "fu-requirements.h"
+
+/**
+ * SECTION:fu-requirements
+ * @short_description: the compiled requirements of a component
+ *
+ * Checking if a component can be installed on a device involves running
+ * several XPath queries on the component and parsing the release version
+ * using the device version format. When one firmware archive is checked
+ * against many devices this work is repeated for every device.
+ *
+ * This object runs the queries once for each component, and memoises the
+ * parsed release versions and version comparisons so that each device check
+ * is a cheap lookup.
+ *
+ * See also: #FuInstallTask
+ */
+
+struct _FuRequirements
+{
+	GObject			 parent_instance;
+	XbNode			*component;
+	gboolean		 compiled;
+	GHashTable		*provides;		/* GUID:1 */
+	GError			*provides_error;
+	GPtrArray		*requires;		/* of XbNode */
+	GError			*requires_error;
+	gboolean		 has_version_check;
+	gchar			*protocol;
+	XbNode			*release;
+	GPtrArray		*verfmts;		/* of XbNode */
+	GHashTable		*versions_release;	/* fmt:version */
+	GHashTable		*vercmps;		/* "fmt:version":rc */
+};
+
+G_DEFINE_TYPE (FuRequirements, fu_requirements, G_TYPE_OBJECT)
+
+static void
+fu_requirements_ensure_compiled (FuRequirements *self)
+{
+	g_autoptr(GPtrArray) provides = NULL;
+
+	if (self->compiled)
+		return;
+	self->compiled = TRUE;
+
+	/* GUIDs the component can be flashed onto */
+	provides = xb_node_query (self->component,
+				  "provides/firmware[@type='flashed']",
+				  0, &self->provides_error);
+	if (provides != NULL) {
+		for (guint i = 0; i < provides->len; i++) {
+			XbNode *provide = g_ptr_array_index (provides, i);
+			const gchar *guid = xb_node_get_text (provide);
+			if (guid == NULL)
+				continue;
+
+			/* an instance ID, as fu_device_has_guid() would hash it */
+			if (!fwupd_guid_is_valid (guid)) {
+				g_hash_table_add (self->provides,
+						  fwupd_guid_hash_string (guid));
+				continue;
+			}
+			g_hash_table_add (self->provides, g_strdup (guid));
+		}
+	}
+
+	/* all requirements, and if there is an old firmware version check */
+	self->requires = xb_node_query (self->component, "requires/*",
+					0, &self->requires_error);
+	if (self->requires != NULL) {
+		for (guint i = 0; i < self->requires->len; i++) {
+			XbNode *req = g_ptr_array_index (self->requires, i);
+			if (g_strcmp0 (xb_node_get_element (req), "firmware") == 0 &&
+			    xb_node_get_text (req) == NULL) {
+				self->has_version_check = TRUE;
+				break;
+			}
+		}
+	}
+
+	/* these are all optional */
+	self->protocol = g_strdup (xb_node_query_text (self->component,
+						       "custom/value[@key='LVFS::UpdateProtocol']",
+						       NULL));
+	self->release = xb_node_query_first (self->component, "releases/release", NULL);
+	self->verfmts = xb_node_query (self->component,
+				       "custom/value[@key='LVFS::VersionFormat']",
+				       0, NULL);
+}
+
+/**
+ * fu_requirements_get_component:
+ * @self: A #FuRequirements
+ *
+ * Gets the component these requirements were compiled from.
+ *
+ * Returns: (transfer none): the component
+ **/
+XbNode *
+fu_requirements_get_component (FuRequirements *self)
+{
+	g_return_val_if_fail (FU_IS_REQUIREMENTS (self), NULL);
+	return self->component;
+}
+
+/**
+ * fu_requirements_has_device_guid:
+ * @self: A #FuRequirements
+ * @device: A #FuDevice
+ * @error: A #GError, or %NULL
+ *
+ * Checks if the component provides any of the GUIDs the device has.
+ *
+ * Returns: %TRUE if a GUID matched
+ **/
+gboolean
+fu_requirements_has_device_guid (FuRequirements *self, FuDevice *device, GError **error)
+{
+	GPtrArray *guids;
+
+	g_return_val_if_fail (FU_IS_REQUIREMENTS (self), FALSE);
+	g_return_val_if_fail (FU_IS_DEVICE (device), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	fu_requirements_ensure_compiled (self);
+	if (self->provides_error != NULL) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_FOUND,
+			     "No supported devices found: %s",
+			     self->provides_error->message);
+		return FALSE;
+	}
+	guids = fu_device_get_guids (device);
+	for (guint i = 0; i < guids->len; i++) {
+		const gchar *guid = g_ptr_array_index (guids, i);
+		if (g_hash_table_contains (self->provides, guid))
+			return TRUE;
+	}
+	g_set_error_literal (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_FOUND,
+			     "No supported devices found");
+	return FALSE;
+}
+
+/**
+ * fu_requirements_get_requires:
+ * @self: A #FuRequirements
+ * @error: A #GError, or %NULL
+ *
+ * Gets all the requirements of the component.
+ *
+ * Returns: (transfer none) (element-type XbNode): requirements, or %NULL
+ **/
+GPtrArray *
+fu_requirements_get_requires (FuRequirements *self, GError **error)
+{
+	g_return_val_if_fail (FU_IS_REQUIREMENTS (self), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	fu_requirements_ensure_compiled (self);
+	if (self->requires == NULL) {
+		g_propagate_error (error, g_error_copy (self->requires_error));
+		return NULL;
+	}
+	return self->requires;
+}
+
+/**
+ * fu_requirements_has_version_check:
+ * @self: A #FuRequirements
+ * @error: A #GError, or %NULL
+ *
+ * Checks if the component requires a specific firmware version to be
+ * already installed.
+ *
+ * Returns: %TRUE if a firmware version requirement exists
+ **/
+gboolean
+fu_requirements_has_version_check (FuRequirements *self, GError **error)
+{
+	g_return_val_if_fail (FU_IS_REQUIREMENTS (self), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	fu_requirements_ensure_compiled (self);
+	if (self->requires == NULL) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_NOT_SUPPORTED,
+				     self->requires_error->message);
+		return FALSE;
+	}
+	if (!self->has_version_check) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_NOT_SUPPORTED,
+				     "no firmware requirement");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * fu_requirements_get_protocol:
+ * @self: A #FuRequirements
+ *
+ * Gets the update protocol required by the component.
+ *
+ * Returns: the protocol, e.g. `com.hughski.colorhug`, or %NULL
+ **/
+const gchar *
+fu_requirements_get_protocol (FuRequirements *self)
+{
+	g_return_val_if_fail (FU_IS_REQUIREMENTS (self), NULL);
+	fu_requirements_ensure_compiled (self);
+	return self->protocol;
+}
+
+/**
+ * fu_requirements_get_release:
+ * @self: A #FuRequirements
+ *
+ * Gets the latest release of the component.
+ *
+ * Returns: (transfer none): the release, or %NULL
+ **/
+XbNode *
+fu_requirements_get_release (FuRequirements *self)
+{
+	g_return_val_if_fail (FU_IS_REQUIREMENTS (self), NULL);
+	fu_requirements_ensure_compiled (self);
+	return self->release;
+}
+
+/**
+ * fu_requirements_get_verfmts:
+ * @self: A #FuRequirements
+ *
+ * Gets the version formats set by the component.
+ *
+ * Returns: (transfer none) (element-type XbNode): version formats, or %NULL
+ **/
+GPtrArray *
+fu_requirements_get_verfmts (FuRequirements *self)
+{
+	g_return_val_if_fail (FU_IS_REQUIREMENTS (self), NULL);
+	fu_requirements_ensure_compiled (self);
+	return self->verfmts;
+}
+
+/**
+ * fu_requirements_vercmp_release:
+ * @self: A #FuRequirements
+ * @version: A device version string
+ * @fmt: A #FwupdVersionFormat, e.g. %FWUPD_VERSION_FORMAT_TRIPLET
+ * @version_release: (out) (optional): the parsed release version
+ *
+ * Compares a device version to the latest release of the component.
+ * The release version is parsed only once for each version format, and the
+ * comparison result is remembered for each device version.
+ *
+ * NOTE: The component must have a release with a version attribute.
+ *
+ * Returns: -1 if @version is older, 0 if the same, and 1 if newer than the release
+ **/
+gint
+fu_requirements_vercmp_release (FuRequirements *self,
+				const gchar *version,
+				FwupdVersionFormat fmt,
+				const gchar **version_release)
+{
+	const gchar *version_tmp;
+	gpointer rc_tmp = NULL;
+	gint rc;
+	g_autofree gchar *key = NULL;
+
+	g_return_val_if_fail (FU_IS_REQUIREMENTS (self), 0);
+	g_return_val_if_fail (version != NULL, 0);
+
+	/* parse the release version using the device format */
+	fu_requirements_ensure_compiled (self);
+	version_tmp = g_hash_table_lookup (self->versions_release, GUINT_TO_POINTER (fmt));
+	if (version_tmp == NULL) {
+		const gchar *version_raw = NULL;
+		gchar *version_new;
+		if (self->release != NULL)
+			version_raw = xb_node_get_attr (self->release, "version");
+		if (fmt == FWUPD_VERSION_FORMAT_PLAIN)
+			version_new = g_strdup (version_raw);
+		else
+			version_new = fu_common_version_parse_from_format (version_raw, fmt);
+		if (version_new == NULL)
+			version_new = g_strdup ("");
+		g_hash_table_insert (self->versions_release,
+				     GUINT_TO_POINTER (fmt),
+				     version_new);
+		version_tmp = version_new;
+	}
+	if (version_release != NULL)
+		*version_release = version_tmp;
+
+	/* compare with the device version */
+	key = g_strdup_printf ("%u:%s", (guint) fmt, version);
+	if (g_hash_table_lookup_extended (self->vercmps, key, NULL, &rc_tmp))
+		return GPOINTER_TO_INT (rc_tmp);
+	rc = fu_common_vercmp_full (version, version_tmp, fmt);
+	g_hash_table_insert (self->vercmps, g_steal_pointer (&key), GINT_TO_POINTER (rc));
+	return rc;
+}
+
+static void
+fu_requirements_init (FuRequirements *self)
+{
+	self->provides = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	self->versions_release = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+	self->vercmps = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+}
+
+static void
+fu_requirements_finalize (GObject *object)
+{
+	FuRequirements *self = FU_REQUIREMENTS (object);
+
+	if (self->provides_error != NULL)
+		g_error_free (self->provides_error);
+	if (self->requires_error != NULL)
+		g_error_free (self->requires_error);
+	if (self->requires != NULL)
+		g_ptr_array_unref (self->requires);
+	if (self->release != NULL)
+		g_object_unref (self->release);
+	if (self->verfmts != NULL)
+		g_ptr_array_unref (self->verfmts);
+	g_hash_table_unref (self->provides);
+	g_hash_table_unref (self->versions_release);
+	g_hash_table_unref (self->vercmps);
+	g_free (self->protocol);
+	g_object_unref (self->component);
+
+	G_OBJECT_CLASS (fu_requirements_parent_class)->finalize (object);
+}
+
+static void
+fu_requirements_class_init (FuRequirementsClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = fu_requirements_finalize;
+}
+
+/**
+ * fu_requirements_new:
+ * @component: a #XbNode
+ *
+ * Creates a new set of requirements for a component. The component is only
+ * queried when the requirements are first used.
+ *
+ * Returns: (transfer full): the #FuRequirements
+ **/
+FuRequirements *
+fu_requirements_new (XbNode *component)
+{
+	FuRequirements *self;
+	g_return_val_if_fail (XB_IS_NODE (component), NULL);
+	self = g_object_new (FU_TYPE_REQUIREMENTS, NULL);
+	self->component = g_object_ref (component);
+	return FU_REQUIREMENTS (self);
+}
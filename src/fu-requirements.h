@@ -0,0 +1,32 @@
+/*
+ * Copyright (C) 2020 The fwupd authors
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#pragma once
+
+#include <glib-object.h>
+#include <xmlb.h>
+
+#include "fu-device.h"
+
+#define FU_TYPE_REQUIREMENTS (fu_requirements_get_type ())
+G_DECLARE_FINAL_TYPE (FuRequirements, fu_requirements, FU, REQUIREMENTS, GObject)
+
+FuRequirements	*fu_requirements_new			(XbNode		*component);
+XbNode		*fu_requirements_get_component		(FuRequirements	*self);
+gboolean	 fu_requirements_has_device_guid	(FuRequirements	*self,
+							 FuDevice	*device,
+							 GError		**error);
+GPtrArray	*fu_requirements_get_requires		(FuRequirements	*self,
+							 GError		**error);
+gboolean	 fu_requirements_has_version_check	(FuRequirements	*self,
+							 GError		**error);
+const gchar	*fu_requirements_get_protocol		(FuRequirements	*self);
+XbNode		*fu_requirements_get_release		(FuRequirements	*self);
+GPtrArray	*fu_requirements_get_verfmts		(FuRequirements	*self);
+gint		 fu_requirements_vercmp_release		(FuRequirements	*self,
+							 const gchar	*version,
+							 FwupdVersionFormat fmt,
+							 const gchar	**version_release);
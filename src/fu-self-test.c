@@ -15,6 +15,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "fu-alloc-stats.h"
+#include "fu-change-stream.h"
 #include "fu-config.h"
 #include "fu-device-list.h"
 #include "fu-device-private.h"
@@ -26,6 +28,8 @@
 #include "fu-progressbar.h"
 #include "fu-hash.h"
 #include "fu-smbios-private.h"
+#include "fu-trace.h"
+#include "fu-udev-batch.h"
 
 typedef struct {
 	FuPlugin	*plugin;
@@ -66,6 +70,93 @@ fu_test_loop_quit (void)
 	}
 }
 
+/* the test plugins are blacklisted in the config, so install with another name */
+static void
+fu_test_plugin_link_full (const gchar *plugindir, const gchar *name, const gchar *target)
+{
+	gboolean ret;
+	g_autofree gchar *basename = NULL;
+	g_autofree gchar *basename_target = NULL;
+	g_autofree gchar *fn_module = NULL;
+	g_autofree gchar *fn_target = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GFile) file_module = NULL;
+
+	g_assert_cmpint (g_mkdir_with_parents (plugindir, 0755), ==, 0);
+	basename = g_strdup_printf ("libfu_plugin_%s." G_MODULE_SUFFIX, name);
+	fn_module = g_build_filename (plugindir, basename, NULL);
+	if (g_file_test (fn_module, G_FILE_TEST_EXISTS))
+		return;
+	basename_target = g_strdup_printf ("libfu_plugin_%s." G_MODULE_SUFFIX, target);
+	fn_target = g_build_filename (PLUGINBUILDDIR, basename_target, NULL);
+	file_module = g_file_new_for_path (fn_module);
+	ret = g_file_make_symbolic_link (file_module, fn_target, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+}
+
+static void
+fu_test_plugin_link (const gchar *plugindir, const gchar *name)
+{
+	fu_test_plugin_link_full (plugindir, name, "test");
+}
+
+static FuPlugin *
+fu_test_engine_get_plugin (FuEngine *engine, const gchar *name)
+{
+	GPtrArray *plugins = fu_engine_get_plugins (engine);
+	for (guint i = 0; i < plugins->len; i++) {
+		FuPlugin *plugin = g_ptr_array_index (plugins, i);
+		if (g_strcmp0 (fu_plugin_get_name (plugin), name) == 0)
+			return plugin;
+	}
+	return NULL;
+}
+
+/* sets the cache token in ->probe() and is expensive to set up, like NVMe */
+#define FU_TYPE_TEST_CACHE_DEVICE (fu_test_cache_device_get_type ())
+G_DECLARE_FINAL_TYPE (FuTestCacheDevice, fu_test_cache_device, FU, TEST_CACHE_DEVICE, FuUdevDevice)
+
+struct _FuTestCacheDevice {
+	FuUdevDevice		 parent_instance;
+};
+
+G_DEFINE_TYPE (FuTestCacheDevice, fu_test_cache_device, FU_TYPE_UDEV_DEVICE)
+
+static guint _test_cache_device_setup_cnt = 0;
+
+static gboolean
+fu_test_cache_device_probe (FuDevice *device, GError **error)
+{
+	fu_device_set_physical_id (device, "PCI_SLOT_NAME=0000:00:1d.0");
+	fu_device_set_cache_token (device, "THNSN5512GPU7|Z58S101XTLPT|57DA4103");
+	return TRUE;
+}
+
+static gboolean
+fu_test_cache_device_setup (FuDevice *device, GError **error)
+{
+	_test_cache_device_setup_cnt++;
+	fu_device_set_name (device, "THNSN5512GPU7 TOSHIBA");
+	fu_device_set_version_format (device, FWUPD_VERSION_FORMAT_PLAIN);
+	fu_device_set_version (device, "57DA4103");
+	fu_device_add_guid (device, "e1409b09-50cf-5aef-8ad8-760b9022f88d");
+	return TRUE;
+}
+
+static void
+fu_test_cache_device_init (FuTestCacheDevice *self)
+{
+}
+
+static void
+fu_test_cache_device_class_init (FuTestCacheDeviceClass *klass)
+{
+	FuDeviceClass *klass_device = FU_DEVICE_CLASS (klass);
+	klass_device->probe = fu_test_cache_device_probe;
+	klass_device->setup = fu_test_cache_device_setup;
+}
+
 static void
 fu_self_test_mkroot (void)
 {
@@ -449,6 +540,130 @@ fu_engine_requirements_func (gconstpointer user_data)
 	g_assert (ret);
 }
 
+static void
+fu_engine_requirements_instance_id_func (gconstpointer user_data)
+{
+	gboolean ret;
+	g_autoptr(FuDevice) device = fu_device_new ();
+	g_autoptr(FuEngine) engine = fu_engine_new (FU_APP_FLAGS_NONE);
+	g_autoptr(FuInstallTask) task = NULL;
+	g_autoptr(FuRequirements) requirements = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(XbNode) component = NULL;
+	g_autoptr(XbSilo) silo = NULL;
+	const gchar *xml =
+		"<component>"
+		"  <provides>"
+		"    <firmware type=\"flashed\">USB\\VID_FFFF&amp;PID_1234</firmware>"
+		"  </provides>"
+		"  <releases>"
+		"    <release version=\"1.2.3\"/>"
+		"  </releases>"
+		"</component>";
+
+	/* set up a dummy device that only has the instance ID */
+	fu_device_set_version_format (device, FWUPD_VERSION_FORMAT_TRIPLET);
+	fu_device_set_version (device, "1.2.2");
+	fu_device_add_flag (device, FWUPD_DEVICE_FLAG_UPDATABLE);
+	fu_device_add_instance_id (device, "USB\\VID_FFFF&PID_1234");
+	fu_device_convert_instance_ids (device);
+
+	/* the provide is hashed when compiled, like a device GUID */
+	silo = xb_silo_new_from_xml (xml, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (silo);
+	component = xb_silo_query_first (silo, "component", &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (component);
+	requirements = fu_requirements_new (component);
+	ret = fu_requirements_has_device_guid (requirements, device, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	/* check this passes */
+	task = fu_install_task_new_full (device, requirements);
+	ret = fu_engine_check_requirements (engine, task,
+					    FWUPD_INSTALL_FLAG_NONE,
+					    &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+}
+
+static void
+fu_engine_requirements_shared_func (gconstpointer user_data)
+{
+	gboolean ret;
+	const gchar *version_release = NULL;
+	g_autoptr(FuDevice) device1 = fu_device_new ();
+	g_autoptr(FuDevice) device2 = fu_device_new ();
+	g_autoptr(FuEngine) engine = fu_engine_new (FU_APP_FLAGS_NONE);
+	g_autoptr(FuInstallTask) task1 = NULL;
+	g_autoptr(FuInstallTask) task2 = NULL;
+	g_autoptr(FuRequirements) requirements = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(XbNode) component = NULL;
+	g_autoptr(XbSilo) silo = NULL;
+	const gchar *xml =
+		"<component>"
+		"  <provides>"
+		"    <firmware type=\"flashed\">12345678-1234-1234-1234-123456789012</firmware>"
+		"  </provides>"
+		"  <releases>"
+		"    <release version=\"65563\"/>"
+		"  </releases>"
+		"</component>";
+
+	/* set up a dummy device that can be updated */
+	fu_device_set_version_format (device1, FWUPD_VERSION_FORMAT_TRIPLET);
+	fu_device_set_version (device1, "0.1.2");
+	fu_device_add_flag (device1, FWUPD_DEVICE_FLAG_UPDATABLE);
+	fu_device_add_guid (device1, "12345678-1234-1234-1234-123456789012");
+
+	/* and another that does not have the GUID */
+	fu_device_set_version_format (device2, FWUPD_VERSION_FORMAT_TRIPLET);
+	fu_device_set_version (device2, "0.1.2");
+	fu_device_add_flag (device2, FWUPD_DEVICE_FLAG_UPDATABLE);
+	fu_device_add_guid (device2, "1ff60ab2-3905-06a1-b476-0371f00c9e9b");
+
+	/* compile the requirements once */
+	silo = xb_silo_new_from_xml (xml, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (silo);
+	component = xb_silo_query_first (silo, "component", &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (component);
+	requirements = fu_requirements_new (component);
+	g_assert (fu_requirements_get_component (requirements) == component);
+
+	/* parsed using the device version format */
+	g_assert_cmpint (fu_requirements_vercmp_release (requirements, "0.1.2",
+							 FWUPD_VERSION_FORMAT_TRIPLET,
+							 &version_release), <, 0);
+	g_assert_cmpstr (version_release, ==, "0.1.27");
+	g_assert_cmpint (fu_requirements_vercmp_release (requirements, "0.1.27",
+							 FWUPD_VERSION_FORMAT_TRIPLET,
+							 NULL), ==, 0);
+	g_assert_cmpint (fu_requirements_vercmp_release (requirements, "0.1.27",
+							 FWUPD_VERSION_FORMAT_TRIPLET,
+							 NULL), ==, 0);
+
+	/* check the first device passes */
+	task1 = fu_install_task_new_full (device1, requirements);
+	ret = fu_engine_check_requirements (engine, task1,
+					    FWUPD_INSTALL_FLAG_NONE,
+					    &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	/* check the second device fails with the same requirements */
+	task2 = fu_install_task_new_full (device2, requirements);
+	ret = fu_engine_check_requirements (engine, task2,
+					    FWUPD_INSTALL_FLAG_NONE,
+					    &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_NOT_FOUND);
+	g_assert (!ret);
+}
+
 static void
 fu_engine_requirements_device_func (gconstpointer user_data)
 {
@@ -1078,6 +1293,367 @@ fu_engine_device_unlock_func (gconstpointer user_data)
 	g_assert_nonnull (fwupd_device_get_release_default (FWUPD_DEVICE (device)));
 }
 
+static void
+_engine_device_changed_cb (FuEngine *engine, FuDevice *device, gpointer user_data)
+{
+	guint *cnt = (guint *) user_data;
+	(*cnt)++;
+}
+
+static void
+_engine_percentage_changed_cb (FuEngine *engine, guint percentage, gpointer user_data)
+{
+	guint *percentage_last = (guint *) user_data;
+	*percentage_last = percentage;
+}
+
+static void
+fu_engine_device_progress_func (gconstpointer user_data)
+{
+	gboolean ret;
+	guint changed_cnt = 0;
+	guint percentage = 0;
+	g_autoptr(FuDevice) device = fu_device_new ();
+	g_autoptr(FuEngine) engine = fu_engine_new (FU_APP_FLAGS_NONE);
+	g_autoptr(GError) error = NULL;
+	g_autoptr(XbSilo) silo_empty = xb_silo_new ();
+
+	/* the test config sends progress at most every 100ms */
+	g_setenv ("CONFIGURATION_DIRECTORY", TESTDATADIR_SRC, TRUE);
+	ret = fu_engine_load (engine, FU_ENGINE_LOAD_FLAG_NO_ENUMERATE, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	fu_engine_set_silo (engine, silo_empty);
+
+	/* add a dummy device */
+	fu_device_set_id (device, "progress-dev0");
+	fu_device_set_vendor_id (device, "USB:FFFF");
+	fu_device_set_protocol (device, "com.acme");
+	fu_device_add_guid (device, "2d47f29b-83a2-4f31-a2e8-63474f4d4c2e");
+	fu_engine_add_device (engine, device);
+	g_signal_connect (engine, "device-changed",
+			  G_CALLBACK (_engine_device_changed_cb),
+			  &changed_cnt);
+	g_signal_connect (engine, "percentage-changed",
+			  G_CALLBACK (_engine_percentage_changed_cb),
+			  &percentage);
+
+	/* a status change is always sent */
+	fu_device_set_status (device, FWUPD_STATUS_DEVICE_WRITE);
+	g_assert_cmpint (changed_cnt, ==, 1);
+
+	/* the first change is sent, and the rest held back */
+	for (guint i = 1; i <= 50; i++)
+		fu_device_set_progress (device, i);
+	g_assert_cmpint (changed_cnt, ==, 2);
+	g_assert_cmpint (percentage, ==, 1);
+
+	/* the latest value is sent once the progress stops changing */
+	fu_test_loop_run_with_timeout (250);
+	fu_test_loop_quit ();
+	g_assert_cmpint (changed_cnt, ==, 3);
+	g_assert_cmpint (percentage, ==, 50);
+
+	/* held back, then sent before the status changes */
+	fu_device_set_progress (device, 51);
+	fu_device_set_progress (device, 52);
+	changed_cnt = 0;
+	fu_device_set_progress (device, 53);
+	g_assert_cmpint (changed_cnt, ==, 0);
+	fu_device_set_status (device, FWUPD_STATUS_DEVICE_VERIFY);
+	g_assert_cmpint (changed_cnt, ==, 2);
+	g_assert_cmpint (percentage, ==, 53);
+
+	/* the end is always sent */
+	fu_device_set_progress (device, 100);
+	g_assert_cmpint (changed_cnt, ==, 3);
+	g_assert_cmpint (percentage, ==, 100);
+}
+
+static void
+fu_engine_device_batch_func (gconstpointer user_data)
+{
+	gboolean ret;
+	guint changed_cnt = 0;
+	g_autoptr(FuDevice) device = fu_device_new ();
+	g_autoptr(FuEngine) engine = fu_engine_new (FU_APP_FLAGS_NONE);
+	g_autoptr(GError) error = NULL;
+	g_autoptr(XbSilo) silo_empty = xb_silo_new ();
+
+	g_setenv ("CONFIGURATION_DIRECTORY", TESTDATADIR_SRC, TRUE);
+	ret = fu_engine_load (engine, FU_ENGINE_LOAD_FLAG_NO_ENUMERATE, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	fu_engine_set_silo (engine, silo_empty);
+
+	/* add a dummy device */
+	fu_device_set_id (device, "batch-dev0");
+	fu_device_set_vendor_id (device, "USB:FFFF");
+	fu_device_set_protocol (device, "com.acme");
+	fu_device_add_guid (device, "2d47f29b-83a2-4f31-a2e8-63474f4d4c2e");
+	fu_engine_add_device (engine, device);
+	g_signal_connect (engine, "device-changed",
+			  G_CALLBACK (_engine_device_changed_cb),
+			  &changed_cnt);
+
+	/* the status change is held back until the batch is committed */
+	fu_device_batch_begin (device);
+	fu_device_set_status (device, FWUPD_STATUS_DEVICE_WRITE);
+	fu_device_add_flag (device, FWUPD_DEVICE_FLAG_UPDATABLE);
+	g_assert_cmpint (changed_cnt, ==, 0);
+	g_assert_true (fu_device_batch_commit (device));
+	g_assert_cmpint (changed_cnt, ==, 1);
+	g_assert_cmpint (fu_engine_get_status (engine), ==, FWUPD_STATUS_DEVICE_WRITE);
+}
+
+static void
+fu_engine_plugin_on_demand_func (gconstpointer user_data)
+{
+	FuPlugin *plugin;
+	GType gtype;
+	gboolean found = FALSE;
+	gboolean ret;
+	g_autofree gchar *fn_manifest = NULL;
+	g_autoptr(FuDevice) device1 = fu_device_new ();
+	g_autoptr(FuDevice) device2 = fu_device_new ();
+	g_autoptr(FuEngine) engine = fu_engine_new (FU_APP_FLAGS_NONE);
+	g_autoptr(FuQuirks) quirks = fu_quirks_new ();
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) firmware_gtypes = NULL;
+	g_autoptr(XbSilo) silo_empty = xb_silo_new ();
+	const gchar *plugindir = "/tmp/fwupd-self-test/plugins";
+
+	fu_test_plugin_link (plugindir, "ondemand");
+	fn_manifest = g_build_filename (plugindir, "libfu_plugin_ondemand.manifest", NULL);
+	ret = g_file_set_contents (fn_manifest,
+				   "[fwupd Plugin]\n"
+				   "LoadOnDemand=true\n"
+				   "FirmwareGTypes=test;\n",
+				   -1, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	/* the plugin is not opened at startup */
+	g_setenv ("FWUPD_PLUGINDIR", plugindir, TRUE);
+	g_setenv ("CONFIGURATION_DIRECTORY", TESTDATADIR_SRC, TRUE);
+	ret = fu_engine_load (engine, FU_ENGINE_LOAD_FLAG_NO_ENUMERATE, &error);
+	g_setenv ("FWUPD_PLUGINDIR", TESTDATADIR_SRC, TRUE);
+	g_assert_no_error (error);
+	g_assert (ret);
+	fu_engine_set_silo (engine, silo_empty);
+	plugin = fu_test_engine_get_plugin (engine, "ondemand");
+	g_assert_nonnull (plugin);
+	g_assert_false (fu_plugin_is_open (plugin));
+
+	/* listing the firmware types uses the manifest */
+	firmware_gtypes = fu_engine_get_firmware_gtype_ids (engine);
+	for (guint i = 0; i < firmware_gtypes->len; i++) {
+		const gchar *id = g_ptr_array_index (firmware_gtypes, i);
+		if (g_strcmp0 (id, "test") == 0)
+			found = TRUE;
+	}
+	g_assert_true (found);
+	g_assert_false (fu_plugin_is_open (plugin));
+
+	/* a device routed to another plugin does not open it */
+	ret = fu_quirks_load (quirks, FU_QUIRKS_LOAD_FLAG_NONE, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	fu_device_set_quirks (device1, quirks);
+	fu_device_add_instance_id (device1, "USB\\VID_FFFF&PID_FFFF");
+	fu_device_convert_instance_ids (device1);
+	g_assert_false (fu_engine_open_plugins_for_device (engine, device1));
+	g_assert_false (fu_plugin_is_open (plugin));
+
+	/* a device routed to the plugin does, but only once */
+	fu_device_set_quirks (device2, quirks);
+	fu_device_add_instance_id (device2, "USB\\VID_FFFF&PID_FFFE");
+	fu_device_convert_instance_ids (device2);
+	g_assert_true (fu_engine_open_plugins_for_device (engine, device2));
+	g_assert_true (fu_plugin_is_open (plugin));
+	g_assert_false (fu_engine_open_plugins_for_device (engine, device2));
+
+	/* the type is now registered by the plugin itself */
+	gtype = fu_engine_get_firmware_gtype_by_id (engine, "test");
+	g_assert_true (gtype == FU_TYPE_FIRMWARE);
+}
+
+static void
+fu_engine_plugin_routes_func (gconstpointer user_data)
+{
+	FuPlugin *plugin;
+	gboolean ret;
+	g_autoptr(FuEngine) engine = fu_engine_new (FU_APP_FLAGS_NONE);
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) instance_ids = g_ptr_array_new ();
+	g_autoptr(GPtrArray) routed = NULL;
+	g_autoptr(XbSilo) silo_empty = xb_silo_new ();
+	const gchar *plugindir = "/tmp/fwupd-self-test/plugins-routes";
+
+	/* two copies of the same plugin, only one named in a quirk */
+	fu_test_plugin_link (plugindir, "ondemand");
+	fu_test_plugin_link (plugindir, "other");
+	g_setenv ("FWUPD_PLUGINDIR", plugindir, TRUE);
+	g_setenv ("CONFIGURATION_DIRECTORY", TESTDATADIR_SRC, TRUE);
+	ret = fu_engine_load (engine, FU_ENGINE_LOAD_FLAG_NO_ENUMERATE, &error);
+	g_setenv ("FWUPD_PLUGINDIR", TESTDATADIR_SRC, TRUE);
+	g_assert_no_error (error);
+	g_assert (ret);
+	fu_engine_set_silo (engine, silo_empty);
+	g_assert_nonnull (fu_test_engine_get_plugin (engine, "other"));
+	plugin = fu_test_engine_get_plugin (engine, "ondemand");
+	g_assert_nonnull (plugin);
+
+	/* a device without a Plugin quirk is not routed anywhere */
+	g_ptr_array_add (instance_ids, "USB\\VID_1234&PID_5678");
+	routed = fu_engine_get_routed_plugins (engine, instance_ids);
+	g_assert_cmpint (routed->len, ==, 0);
+	g_clear_pointer (&routed, g_ptr_array_unref);
+
+	/* only the named plugin, and not the other copy */
+	g_ptr_array_add (instance_ids, "USB\\VID_FFFF&PID_FFFE");
+	routed = fu_engine_get_routed_plugins (engine, instance_ids);
+	g_assert_cmpint (routed->len, ==, 1);
+	g_assert_true (g_ptr_array_index (routed, 0) == (gpointer) plugin);
+	g_clear_pointer (&routed, g_ptr_array_unref);
+
+	/* followed through a Guid quirk */
+	g_ptr_array_set_size (instance_ids, 0);
+	g_ptr_array_add (instance_ids, "USB\\VID_FFFF&PID_FFFD");
+	routed = fu_engine_get_routed_plugins (engine, instance_ids);
+	g_assert_cmpint (routed->len, ==, 1);
+	g_assert_true (g_ptr_array_index (routed, 0) == (gpointer) plugin);
+	g_clear_pointer (&routed, g_ptr_array_unref);
+
+	/* the named plugin is not loaded */
+	g_ptr_array_set_size (instance_ids, 0);
+	g_ptr_array_add (instance_ids, "USB\\VID_FFFF&PID_FFFF");
+	routed = fu_engine_get_routed_plugins (engine, instance_ids);
+	g_assert_cmpint (routed->len, ==, 0);
+	g_clear_pointer (&routed, g_ptr_array_unref);
+
+	/* the named plugin is disabled */
+	g_ptr_array_set_size (instance_ids, 0);
+	g_ptr_array_add (instance_ids, "USB\\VID_FFFF&PID_FFFE");
+	fu_plugin_set_enabled (plugin, FALSE);
+	routed = fu_engine_get_routed_plugins (engine, instance_ids);
+	g_assert_cmpint (routed->len, ==, 0);
+}
+
+static void
+fu_engine_plugin_on_demand_tainted_func (gconstpointer user_data)
+{
+	FuPlugin *plugin;
+	gboolean ret;
+	g_autoptr(FuEngine) engine = fu_engine_new (FU_APP_FLAGS_NONE);
+	g_autoptr(GError) error = NULL;
+	g_autoptr(XbSilo) silo_empty = xb_silo_new ();
+	const gchar *plugindir = "/tmp/fwupd-self-test/plugins-tainted";
+
+	fu_test_plugin_link_full (plugindir, "tainted", "invalid");
+	ret = g_file_set_contents ("/tmp/fwupd-self-test/plugins-tainted/libfu_plugin_tainted.manifest",
+				   "[fwupd Plugin]\n"
+				   "LoadOnDemand=true\n"
+				   "FirmwareGTypes=tainted;\n",
+				   -1, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	/* not tainted until the plugin is actually opened */
+	g_setenv ("FWUPD_PLUGINDIR", plugindir, TRUE);
+	g_setenv ("CONFIGURATION_DIRECTORY", TESTDATADIR_SRC, TRUE);
+	ret = fu_engine_load (engine, FU_ENGINE_LOAD_FLAG_NO_ENUMERATE, &error);
+	g_setenv ("FWUPD_PLUGINDIR", TESTDATADIR_SRC, TRUE);
+	g_assert_no_error (error);
+	g_assert (ret);
+	fu_engine_set_silo (engine, silo_empty);
+	plugin = fu_test_engine_get_plugin (engine, "tainted");
+	g_assert_nonnull (plugin);
+	g_assert_false (fu_plugin_is_open (plugin));
+	g_assert_false (fu_engine_get_tainted (engine));
+
+	/* opened on demand with the wrong build hash */
+	g_test_expect_message ("FuEngine", G_LOG_LEVEL_WARNING, "* has incorrect built version*");
+	g_assert_true (fu_engine_get_firmware_gtype_by_id (engine, "tainted") == G_TYPE_INVALID);
+	g_test_assert_expected_messages ();
+	g_assert_true (fu_plugin_is_open (plugin));
+	g_assert_true (fu_engine_get_tainted (engine));
+}
+
+static void
+fu_engine_device_cache_func (gconstpointer user_data)
+{
+	FuDevice *device;
+	FuPlugin *plugin;
+	gboolean ret;
+	g_autoptr(FuEngine) engine1 = fu_engine_new (FU_APP_FLAGS_NONE);
+	g_autoptr(FuEngine) engine2 = fu_engine_new (FU_APP_FLAGS_NONE);
+	g_autoptr(FuUdevDevice) udev_device1 = fu_udev_device_new (NULL);
+	g_autoptr(FuUdevDevice) udev_device2 = fu_udev_device_new (NULL);
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) devices = NULL;
+	g_autoptr(XbSilo) silo_empty = xb_silo_new ();
+	const gchar *cachedir = "/tmp/fwupd-self-test/cache";
+	const gchar *configdir = "/tmp/fwupd-self-test/enumeration-cache";
+	const gchar *plugindir = "/tmp/fwupd-self-test/plugins-cache";
+
+	/* only the cache is enabled in the config */
+	fu_test_plugin_link (plugindir, "cache");
+	g_assert_cmpint (g_mkdir_with_parents (cachedir, 0755), ==, 0);
+	g_assert_cmpint (g_mkdir_with_parents (configdir, 0755), ==, 0);
+	ret = g_file_set_contents ("/tmp/fwupd-self-test/enumeration-cache/daemon.conf",
+				   "[fwupd]\n"
+				   "EnumerationCache=true\n",
+				   -1, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_setenv ("CONFIGURATION_DIRECTORY", configdir, TRUE);
+	g_setenv ("CACHE_DIRECTORY", cachedir, TRUE);
+	g_setenv ("FWUPD_PLUGINDIR", plugindir, TRUE);
+
+	/* the device is set up when first added, after the engine has loaded */
+	_test_cache_device_setup_cnt = 0;
+	ret = fu_engine_load (engine1, FU_ENGINE_LOAD_FLAG_NO_ENUMERATE, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	fu_engine_set_silo (engine1, silo_empty);
+	plugin = fu_test_engine_get_plugin (engine1, "cache");
+	g_assert_nonnull (plugin);
+	fu_plugin_set_device_gtype (plugin, FU_TYPE_TEST_CACHE_DEVICE);
+	ret = fu_plugin_runner_udev_device_added (plugin, udev_device1, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpint (_test_cache_device_setup_cnt, ==, 1);
+
+	/* the hotplugged device is saved when the daemon exits */
+	g_clear_object (&engine1);
+
+	/* the next start restores it without setting it up */
+	ret = fu_engine_load (engine2, FU_ENGINE_LOAD_FLAG_NO_ENUMERATE, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	fu_engine_set_silo (engine2, silo_empty);
+	plugin = fu_test_engine_get_plugin (engine2, "cache");
+	g_assert_nonnull (plugin);
+	fu_plugin_set_device_gtype (plugin, FU_TYPE_TEST_CACHE_DEVICE);
+	ret = fu_plugin_runner_udev_device_added (plugin, udev_device2, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpint (_test_cache_device_setup_cnt, ==, 1);
+	devices = fu_engine_get_devices (engine2, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (devices);
+	g_assert_cmpint (devices->len, ==, 1);
+	device = g_ptr_array_index (devices, 0);
+	g_assert_cmpstr (fu_device_get_name (device), ==, "THNSN5512GPU7 TOSHIBA");
+	g_assert_cmpstr (fu_device_get_version (device), ==, "57DA4103");
+	g_assert_true (fu_device_has_guid (device, "e1409b09-50cf-5aef-8ad8-760b9022f88d"));
+
+	g_setenv ("CONFIGURATION_DIRECTORY", TESTDATADIR_SRC, TRUE);
+	g_setenv ("FWUPD_PLUGINDIR", TESTDATADIR_SRC, TRUE);
+	g_unsetenv ("CACHE_DIRECTORY");
+}
+
 static void
 fu_engine_require_hwid_func (gconstpointer user_data)
 {
@@ -1371,6 +1947,101 @@ fu_engine_install_duration_func (gconstpointer user_data)
 	g_assert_cmpint (fwupd_release_get_install_duration (rel), ==, 120);
 }
 
+static void
+fu_engine_verify_migrate_func (gconstpointer user_data)
+{
+	FuTest *self = (FuTest *) user_data;
+	gboolean ret;
+	g_autofree gchar *fn = NULL;
+	g_autofree gchar *localstatedir = NULL;
+	g_autoptr(FuDevice) device = fu_device_new ();
+	g_autoptr(FuEngine) engine = fu_engine_new (FU_APP_FLAGS_NONE);
+	g_autoptr(FuHistory) history = fu_history_new ();
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) checksums = NULL;
+	g_autoptr(XbSilo) silo_empty = xb_silo_new ();
+	const gchar *xml =
+		"<component type=\"firmware\">"
+		"  <releases>"
+		"    <release version=\"1.2.3\">"
+		"      <checksum type=\"sha1\" target=\"content\">"
+		"2b8546ba805ad10bf8a2e5ad539d53f303812ba5</checksum>"
+		"    </release>"
+		"  </releases>"
+		"</component>";
+
+	/* ensure empty tree */
+	fu_self_test_mkroot ();
+
+	/* no metadata in daemon */
+	fu_engine_set_silo (engine, silo_empty);
+	fu_engine_add_plugin (engine, self->plugin);
+	g_setenv ("CONFIGURATION_DIRECTORY", TESTDATADIR_SRC, TRUE);
+	ret = fu_engine_load (engine, FU_ENGINE_LOAD_FLAG_NO_ENUMERATE, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	/* add a device with the firmware already read back */
+	fu_device_set_version_format (device, FWUPD_VERSION_FORMAT_TRIPLET);
+	fu_device_set_version (device, "1.2.3");
+	fu_device_set_id (device, "verify-migrate");
+	fu_device_set_plugin (device, "test");
+	fu_device_add_guid (device, "12345678-1234-1234-1234-123456789012");
+	fu_device_add_checksum (device, "7998cd212721e068b2411135e1f90d0ad436d730");
+	fu_engine_add_device (engine, device);
+
+	/* the legacy file is imported when verifying */
+	localstatedir = fu_common_get_path (FU_PATH_KIND_LOCALSTATEDIR_PKG);
+	fn = g_strdup_printf ("%s/verify/%s.xml", localstatedir, fu_device_get_id (device));
+	ret = fu_common_mkdir_parent (fn, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	ret = g_file_set_contents (fn, xml, -1, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	ret = fu_engine_verify (engine, fu_device_get_id (device), &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_NOT_FOUND);
+	g_assert (!ret);
+	g_clear_error (&error);
+	g_assert_false (g_file_test (fn, G_FILE_TEST_EXISTS));
+	checksums = fu_history_get_verify_checksums (history, fu_device_get_id (device),
+						     "1.2.3", &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (checksums);
+	g_assert_cmpint (checksums->len, ==, 1);
+	g_assert_cmpstr (g_ptr_array_index (checksums, 0), ==,
+			 "2b8546ba805ad10bf8a2e5ad539d53f303812ba5");
+	g_clear_pointer (&checksums, g_ptr_array_unref);
+
+	/* a stale legacy file is deleted before new checksums are saved */
+	ret = g_file_set_contents (fn, xml, -1, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	ret = fu_engine_verify_update (engine, fu_device_get_id (device), &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_false (g_file_test (fn, G_FILE_TEST_EXISTS));
+	ret = fu_engine_verify (engine, fu_device_get_id (device), &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	/* and is never imported over existing checksums */
+	ret = g_file_set_contents (fn, xml, -1, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	ret = fu_engine_verify (engine, fu_device_get_id (device), &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_false (g_file_test (fn, G_FILE_TEST_EXISTS));
+	checksums = fu_history_get_verify_checksums (history, fu_device_get_id (device),
+						     "1.2.3", &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (checksums);
+	g_assert_cmpint (checksums->len, ==, 1);
+	g_assert_cmpstr (g_ptr_array_index (checksums, 0), ==,
+			 "7998cd212721e068b2411135e1f90d0ad436d730");
+}
+
 static void
 fu_engine_history_func (gconstpointer user_data)
 {
@@ -2113,6 +2784,14 @@ fu_device_list_remove_chain_func (gconstpointer user_data)
 	g_assert_cmpint (changed_cnt, ==, 0);
 }
 
+static gint
+_device_list_sort_by_id_cb (gconstpointer a, gconstpointer b)
+{
+	FuDevice *dev_a = *((FuDevice **) a);
+	FuDevice *dev_b = *((FuDevice **) b);
+	return g_strcmp0 (fu_device_get_id (dev_a), fu_device_get_id (dev_b));
+}
+
 static void
 fu_device_list_func (gconstpointer user_data)
 {
@@ -2121,6 +2800,10 @@ fu_device_list_func (gconstpointer user_data)
 	g_autoptr(FuDevice) device2 = fu_device_new ();
 	g_autoptr(GPtrArray) devices = NULL;
 	g_autoptr(GPtrArray) devices2 = NULL;
+	g_autoptr(GPtrArray) devices3 = NULL;
+	g_autoptr(GPtrArray) devices_sorted = NULL;
+	g_autoptr(GPtrArray) devices_sorted2 = NULL;
+	g_autoptr(GPtrArray) devices_sorted3 = NULL;
 	g_autoptr(GError) error = NULL;
 	FuDevice *device;
 	guint added_cnt = 0;
@@ -2157,6 +2840,23 @@ fu_device_list_func (gconstpointer user_data)
 	g_assert_cmpstr (fu_device_get_id (device), ==,
 			 "99249eb1bd9ef0b6e192b271a8cb6a3090cfec7a");
 
+	/* nothing changed, so the same snapshot is returned */
+	devices3 = fu_device_list_get_all (device_list);
+	g_assert (devices3 == devices);
+
+	/* sorted, and also shared until invalidated */
+	fu_device_list_set_sort_func (device_list, _device_list_sort_by_id_cb);
+	devices_sorted = fu_device_list_get_active_sorted (device_list);
+	g_assert_cmpint (devices_sorted->len, ==, 2);
+	device = g_ptr_array_index (devices_sorted, 0);
+	g_assert_cmpstr (fu_device_get_id (device), ==,
+			 "1a8d0d9a96ad3e67ba76cf3033623625dc6d6882");
+	devices_sorted2 = fu_device_list_get_active_sorted (device_list);
+	g_assert (devices_sorted2 == devices_sorted);
+	fu_device_list_invalidate_sorted (device_list);
+	devices_sorted3 = fu_device_list_get_active_sorted (device_list);
+	g_assert (devices_sorted3 != devices_sorted);
+
 	/* find by ID */
 	device = fu_device_list_get_by_id (device_list,
 					   "99249eb1bd9ef0b6e192b271a8cb6a3090cfec7a",
@@ -2190,6 +2890,7 @@ fu_device_list_func (gconstpointer user_data)
 	g_assert_cmpint (changed_cnt, ==, 0);
 	devices2 = fu_device_list_get_all (device_list);
 	g_assert_cmpint (devices2->len, ==, 1);
+	g_assert_cmpint (devices->len, ==, 2);
 	device = g_ptr_array_index (devices2, 0);
 	g_assert_cmpstr (fu_device_get_id (device), ==,
 			 "1a8d0d9a96ad3e67ba76cf3033623625dc6d6882");
@@ -2326,6 +3027,86 @@ _plugin_device_register_cb (FuPlugin *plugin, FuDevice *device, gpointer user_da
 	fu_plugin_runner_device_register (plugin, device);
 }
 
+static void
+_plugin_device_added_array_cb (FuPlugin *plugin, FuDevice *device, gpointer user_data)
+{
+	GPtrArray *devices = (GPtrArray *) user_data;
+	g_ptr_array_add (devices, g_object_ref (device));
+}
+
+static void
+fu_plugin_module_scale_func (gconstpointer user_data)
+{
+	FuTest *self = (FuTest *) user_data;
+	FuDevice *device;
+	gboolean ret;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+
+	/* parent, child and proxied child for each */
+	g_setenv ("FWUPD_PLUGIN_TEST_SCALE", "5", TRUE);
+	g_signal_connect (self->plugin, "device-added",
+			  G_CALLBACK (_plugin_device_added_array_cb),
+			  devices);
+	ret = fu_plugin_runner_coldplug (self->plugin, &error);
+	g_signal_handlers_disconnect_by_data (self->plugin, devices);
+	g_unsetenv ("FWUPD_PLUGIN_TEST_SCALE");
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpint (devices->len, ==, 15);
+
+	/* matches contrib/generate-scale-metadata.py */
+	device = g_ptr_array_index (devices, 0);
+	g_assert_cmpstr (fu_device_get_guid_default (device), ==,
+			 "273f0000-0000-4000-8000-000000000000");
+	g_assert_cmpint (fu_device_get_guids (device)->len, ==, 4);
+	g_assert_cmpint (fu_device_get_children (device)->len, ==, 2);
+	device = g_ptr_array_index (devices, 2);
+	g_assert (fu_device_get_parent (device) == g_ptr_array_index (devices, 0));
+	g_assert (fu_device_get_proxy (device) == g_ptr_array_index (devices, 0));
+}
+
+static void
+fu_plugin_stats_func (gconstpointer user_data)
+{
+	FuTest *self = (FuTest *) user_data;
+	gboolean ret;
+	guint64 cnt;
+	g_autofree gchar *line = NULL;
+	g_autofree gchar *str = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) names = NULL;
+	g_autoptr(GVariant) val = NULL;
+	g_autoptr(GVariant) stats = NULL;
+	g_autoptr(GVariant) buckets = NULL;
+
+	/* each call is counted */
+	cnt = fu_plugin_get_stats_count (self->plugin, "startup");
+	ret = fu_plugin_runner_startup (self->plugin, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpint (fu_plugin_get_stats_count (self->plugin, "startup"), ==, cnt + 1);
+	g_assert_cmpint (fu_plugin_get_stats_count (self->plugin, "unknown"), ==, 0);
+	names = fu_plugin_get_stats_names (self->plugin);
+	g_assert_cmpint (names->len, >=, 1);
+
+	/* text summary */
+	str = fu_plugin_stats_to_string (self->plugin);
+	g_assert_nonnull (str);
+	line = g_strdup_printf ("  %-20s count:%" G_GUINT64_FORMAT " failed:0 mean:",
+				"startup", cnt + 1);
+	g_assert_nonnull (g_strstr_len (str, -1, line));
+	g_assert_nonnull (g_strstr_len (str, -1, "ms max:"));
+
+	/* serialized histogram */
+	val = g_variant_ref_sink (fu_plugin_stats_to_variant (self->plugin));
+	stats = g_variant_lookup_value (val, "startup", G_VARIANT_TYPE_VARDICT);
+	g_assert_nonnull (stats);
+	buckets = g_variant_lookup_value (stats, "Buckets", G_VARIANT_TYPE ("at"));
+	g_assert_nonnull (buckets);
+	g_assert_cmpint (g_variant_n_children (buckets), ==, 24);
+}
+
 static void
 fu_plugin_module_func (gconstpointer user_data)
 {
@@ -2467,12 +3248,16 @@ fu_history_func (gconstpointer user_data)
 {
 	GError *error = NULL;
 	GPtrArray *checksums;
+	GPtrArray *devices;
 	gboolean ret;
 	FuDevice *device;
 	FwupdRelease *release;
 	g_autoptr(FuDevice) device_found = NULL;
 	g_autoptr(FuHistory) history = NULL;
+	g_autoptr(FuHistory) history2 = NULL;
 	g_autoptr(GPtrArray) approved_firmware = NULL;
+	g_autoptr(GPtrArray) checksums_verify = NULL;
+	g_autoptr(GPtrArray) checksums_stored = NULL;
 	g_autofree gchar *dirname = NULL;
 	g_autofree gchar *filename = NULL;
 
@@ -2507,11 +3292,52 @@ fu_history_func (gconstpointer user_data)
 	ret = fu_history_add_device (history, device, release, &error);
 	g_assert_no_error (error);
 	g_assert (ret);
-	g_object_unref (release);
 
 	/* ensure database was created */
 	g_assert (g_file_test (filename, G_FILE_TEST_EXISTS));
 
+	/* adding again replaces the old entry */
+	ret = fu_history_add_device (history, device, release, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	devices = fu_history_get_devices (history, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (devices);
+	g_assert_cmpint (devices->len, ==, 1);
+	g_ptr_array_unref (devices);
+
+	/* filtered */
+	devices = fu_history_get_devices_full (history, NULL, FWUPD_UPDATE_STATE_FAILED,
+					       0, 0, 0, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (devices->len, ==, 1);
+	g_ptr_array_unref (devices);
+	devices = fu_history_get_devices_full (history, NULL, FWUPD_UPDATE_STATE_SUCCESS,
+					       0, 0, 0, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (devices->len, ==, 0);
+	g_ptr_array_unref (devices);
+	devices = fu_history_get_devices_full (history, "2ba16d10df45823dd4494ff10a0bfccfef512c9d",
+					       FWUPD_UPDATE_STATE_UNKNOWN,
+					       457, 0, 0, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (devices->len, ==, 0);
+	g_ptr_array_unref (devices);
+	devices = fu_history_get_devices_full (history, NULL, FWUPD_UPDATE_STATE_UNKNOWN,
+					       0, 1, 10, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (devices->len, ==, 0);
+	g_ptr_array_unref (devices);
+
+	/* visible to another connection */
+	history2 = fu_history_new ();
+	devices = fu_history_get_devices (history2, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (devices);
+	g_assert_cmpint (devices->len, ==, 1);
+	g_ptr_array_unref (devices);
+	g_object_unref (release);
+
 	g_object_unref (device);
 
 	/* get device */
@@ -2580,6 +3406,70 @@ fu_history_func (gconstpointer user_data)
 	g_assert_cmpint (approved_firmware->len, ==, 2);
 	g_assert_cmpstr (g_ptr_array_index (approved_firmware, 0), ==, "foo");
 	g_assert_cmpstr (g_ptr_array_index (approved_firmware, 1), ==, "bar");
+
+	/* verification checksums */
+	checksums_verify = g_ptr_array_new ();
+	g_ptr_array_add (checksums_verify, (gpointer) "7c211433f02071597741e6ff5a8ea34789abbf43");
+	ret = fu_history_set_verify_checksums (history, "self-test", "1.2.3", checksums_verify, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	ret = fu_history_set_verify_checksums (history, "self-test", "1.2.4", checksums_verify, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	checksums_stored = fu_history_get_verify_checksums (history, "self-test", "1.2.4", &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (checksums_stored);
+	g_assert_cmpint (checksums_stored->len, ==, 1);
+	g_assert_cmpstr (g_ptr_array_index (checksums_stored, 0), ==,
+			 "7c211433f02071597741e6ff5a8ea34789abbf43");
+	g_ptr_array_unref (checksums_stored);
+
+	/* the old version was replaced */
+	checksums_stored = fu_history_get_verify_checksums (history, "self-test", "1.2.3", &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (checksums_stored);
+	g_assert_cmpint (checksums_stored->len, ==, 0);
+
+	/* retention never removes pending updates */
+	release = fwupd_release_new ();
+	device = fu_device_new ();
+	fu_device_set_id (device, "self-test-pending");
+	fu_device_set_update_state (device, FWUPD_UPDATE_STATE_PENDING);
+	fu_device_set_modified (device, 1);
+	ret = fu_history_add_device (history, device, release, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_object_unref (device);
+	for (guint i = 0; i < 3; i++) {
+		g_autofree gchar *id = g_strdup_printf ("self-test-success%u", i);
+		device = fu_device_new ();
+		fu_device_set_id (device, id);
+		fu_device_set_update_state (device, FWUPD_UPDATE_STATE_SUCCESS);
+		fu_device_set_modified (device, 2 + i);
+		ret = fu_history_add_device (history, device, release, &error);
+		g_assert_no_error (error);
+		g_assert (ret);
+		g_object_unref (device);
+	}
+	g_object_unref (release);
+	ret = fu_history_prune (history, 0, 1, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	devices = fu_history_get_devices (history, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (devices->len, ==, 2);
+	device = g_ptr_array_index (devices, 1);
+	g_assert_cmpint (fu_device_get_modified (device), ==, 4);
+	g_ptr_array_unref (devices);
+	ret = fu_history_prune (history, 60, 0, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	devices = fu_history_get_devices (history, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (devices->len, ==, 1);
+	device = g_ptr_array_index (devices, 0);
+	g_assert_cmpint (fu_device_get_update_state (device), ==, FWUPD_UPDATE_STATE_PENDING);
+	g_ptr_array_unref (devices);
 }
 
 static GBytes *
@@ -2806,6 +3696,204 @@ fu_plugin_composite_func (gconstpointer user_data)
 }
 
 
+static void
+fu_trace_func (gconstpointer user_data)
+{
+	g_autoptr(FuTrace) trace = fu_trace_new ();
+	g_autoptr(GError) error = NULL;
+	g_autofree gchar *json = NULL;
+	g_autofree gchar *str = NULL;
+	g_auto(GStrv) lines = NULL;
+
+	/* disabled by default */
+	fu_trace_begin (trace, "phase", "ignored");
+	fu_trace_end (trace);
+	g_assert_cmpint (fu_trace_get_size (trace), ==, 0);
+
+	/* nested */
+	fu_trace_set_enabled (trace, TRUE);
+	fu_trace_begin (trace, "phase", "coldplug");
+	fu_trace_begin (trace, "plugin", "test");
+	fu_trace_begin (trace, "device", "self-test");
+	fu_trace_end (trace);
+	fu_trace_end (trace);
+	fu_trace_begin (trace, "plugin", "invalid");
+	fu_trace_end (trace);
+	fu_trace_end (trace);
+	g_assert_cmpint (fu_trace_get_size (trace), ==, 4);
+	str = fu_trace_to_string (trace);
+	lines = g_strsplit (str, "\n", -1);
+	g_assert_cmpint (g_strv_length (lines), ==, 5);
+	g_assert_true (g_str_has_suffix (lines[0], "ms phase:coldplug"));
+	g_assert_true (g_str_has_suffix (lines[1], "ms   plugin:test"));
+	g_assert_true (g_str_has_suffix (lines[2], "ms     device:self-test"));
+	g_assert_true (g_str_has_suffix (lines[3], "ms   plugin:invalid"));
+	g_assert_cmpstr (lines[4], ==, "");
+
+	/* chrome trace */
+	json = fu_trace_to_json (trace, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (json);
+	g_assert_nonnull (g_strstr_len (json, -1, "\"traceEvents\""));
+	g_assert_nonnull (g_strstr_len (json, -1, "\"self-test\""));
+}
+
+static void
+fu_alloc_stats_func (gconstpointer user_data)
+{
+	g_autoptr(FuAllocStats) alloc_stats = fu_alloc_stats_new ();
+	g_autoptr(GError) error = NULL;
+	g_autofree gchar *json = NULL;
+	g_autofree gchar *str = NULL;
+
+	/* disabled by default */
+	fu_alloc_stats_begin (alloc_stats, "phase", "ignored");
+	fu_alloc_stats_end (alloc_stats);
+	g_assert_cmpint (fu_alloc_stats_get_size (alloc_stats), ==, 0);
+
+	/* nested, and aggregated by name */
+	fu_alloc_stats_set_enabled (alloc_stats, TRUE);
+	for (guint i = 0; i < 2; i++) {
+		g_autofree gchar *buf = NULL;
+		fu_alloc_stats_begin (alloc_stats, "dbus", "GetDevices");
+		fu_alloc_stats_begin (alloc_stats, "engine", "get-releases-for-device");
+		buf = g_malloc0 (0x100000);
+		fu_alloc_stats_end (alloc_stats);
+		fu_alloc_stats_end (alloc_stats);
+	}
+	g_assert_cmpint (fu_alloc_stats_get_size (alloc_stats), ==, 2);
+	str = fu_alloc_stats_to_string (alloc_stats);
+	g_assert_nonnull (g_strstr_len (str, -1, "dbus     GetDevices"));
+	g_assert_nonnull (g_strstr_len (str, -1, "calls:2 "));
+
+	json = fu_alloc_stats_to_json (alloc_stats, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (json);
+	g_assert_nonnull (g_strstr_len (json, -1, "\"AllocStats\""));
+	g_assert_nonnull (g_strstr_len (json, -1, "\"get-releases-for-device\""));
+}
+
+static void
+fu_change_stream_func (gconstpointer user_data)
+{
+	gboolean resync = FALSE;
+	guint64 seq;
+	guint64 seq_tmp = 0;
+	const gchar *tmp = NULL;
+	g_autoptr(FuChangeStream) change_stream = fu_change_stream_new ();
+	g_autoptr(FwupdDevice) device = fwupd_device_new ();
+	g_autoptr(GVariant) change = NULL;
+	g_autoptr(GVariant) changed = NULL;
+	g_autoptr(GVariant) changes = NULL;
+	g_autoptr(GVariant) val = NULL;
+
+	/* a new client always has to resync */
+	val = fu_change_stream_get_changes (change_stream, 0);
+	g_variant_ref_sink (val);
+	g_variant_get (val, "(tb@aa{sv})", &seq_tmp, &resync, &changes);
+	g_assert_true (resync);
+	g_assert_cmpint (g_variant_n_children (changes), ==, 0);
+	g_clear_pointer (&changes, g_variant_unref);
+	g_clear_pointer (&val, g_variant_unref);
+
+	/* added */
+	seq = fu_change_stream_get_sequence (change_stream);
+	fwupd_device_set_id (device, "ab49c9fc9e5c6b8fbb1c6bc5d3b3f4a1b7d1e2f3");
+	fwupd_device_set_name (device, "ColorHug");
+	fwupd_device_set_version (device, "1.2.3");
+	fu_change_stream_device_added (change_stream, device);
+	g_assert_cmpint (fu_change_stream_get_sequence (change_stream), ==, seq + 1);
+
+	/* only the changed property is sent */
+	fwupd_device_set_version (device, "1.2.4");
+	fu_change_stream_device_changed (change_stream, device);
+	val = fu_change_stream_get_changes (change_stream, seq + 1);
+	g_variant_ref_sink (val);
+	g_variant_get (val, "(tb@aa{sv})", &seq_tmp, &resync, &changes);
+	g_assert_false (resync);
+	g_assert_cmpint (seq_tmp, ==, seq + 2);
+	g_assert_cmpint (g_variant_n_children (changes), ==, 1);
+	change = g_variant_get_child_value (changes, 0);
+	g_assert_true (g_variant_lookup (change, "Kind", "&s", &tmp));
+	g_assert_cmpstr (tmp, ==, "changed");
+	changed = g_variant_lookup_value (change, "Changed", G_VARIANT_TYPE_VARDICT);
+	g_assert_nonnull (changed);
+	g_assert_cmpint (g_variant_n_children (changed), ==, 1);
+	g_assert_true (g_variant_lookup (changed, FWUPD_RESULT_KEY_VERSION, "&s", &tmp));
+	g_assert_cmpstr (tmp, ==, "1.2.4");
+	g_clear_pointer (&changes, g_variant_unref);
+	g_clear_pointer (&val, g_variant_unref);
+
+	/* nothing serialized changed */
+	fu_change_stream_device_changed (change_stream, device);
+	g_assert_cmpint (fu_change_stream_get_sequence (change_stream), ==, seq + 2);
+
+	/* the ring overflowed */
+	fu_change_stream_set_max_entries (change_stream, 2);
+	fu_change_stream_device_removed (change_stream, device);
+	val = fu_change_stream_get_changes (change_stream, seq);
+	g_variant_ref_sink (val);
+	g_variant_get (val, "(tb@aa{sv})", &seq_tmp, &resync, &changes);
+	g_assert_true (resync);
+	g_assert_cmpint (seq_tmp, ==, seq + 3);
+}
+
+static void
+fu_udev_batch_func (gconstpointer user_data)
+{
+	FuUdevBatchEvent *event;
+	g_autoptr(FuUdevBatch) udev_batch = fu_udev_batch_new ();
+	g_autoptr(GObject) device1 = g_object_new (G_TYPE_OBJECT, NULL);
+	g_autoptr(GObject) device2 = g_object_new (G_TYPE_OBJECT, NULL);
+	g_autoptr(GPtrArray) events = NULL;
+
+	/* child switching modes: removed and added again */
+	fu_udev_batch_add (udev_batch, "/sys/devices/usb1/1-1/1-1.2", device1,
+			   FU_UDEV_BATCH_ACTION_ADD);
+	fu_udev_batch_add (udev_batch, "/sys/devices/usb1/1-1/1-1.2", device1,
+			   FU_UDEV_BATCH_ACTION_REMOVE);
+	fu_udev_batch_add (udev_batch, "/sys/devices/usb1/1-1/1-1.2", device2,
+			   FU_UDEV_BATCH_ACTION_ADD);
+
+	/* parent added after the child, then changed */
+	fu_udev_batch_add (udev_batch, "/sys/devices/usb1/1-1", device1,
+			   FU_UDEV_BATCH_ACTION_ADD);
+	fu_udev_batch_add (udev_batch, "/sys/devices/usb1/1-1", device1,
+			   FU_UDEV_BATCH_ACTION_CHANGE);
+
+	/* only changed */
+	fu_udev_batch_add (udev_batch, "/sys/devices/usb1/1-1/1-1.3", device1,
+			   FU_UDEV_BATCH_ACTION_CHANGE);
+
+	/* added then unplugged */
+	fu_udev_batch_add (udev_batch, "/sys/devices/usb1/1-1/1-1.4", device1,
+			   FU_UDEV_BATCH_ACTION_ADD);
+	fu_udev_batch_add (udev_batch, "/sys/devices/usb1/1-1/1-1.4", device1,
+			   FU_UDEV_BATCH_ACTION_REMOVE);
+	g_assert_cmpint (fu_udev_batch_get_size (udev_batch), ==, 4);
+
+	/* one event per path, parents first */
+	events = fu_udev_batch_steal (udev_batch);
+	g_assert_cmpint (events->len, ==, 4);
+	event = g_ptr_array_index (events, 0);
+	g_assert_cmpstr (event->sysfs_path, ==, "/sys/devices/usb1/1-1");
+	g_assert_cmpint (event->actions, ==, FU_UDEV_BATCH_ACTION_ADD);
+	event = g_ptr_array_index (events, 1);
+	g_assert_cmpstr (event->sysfs_path, ==, "/sys/devices/usb1/1-1/1-1.2");
+	g_assert_cmpint (event->actions, ==, FU_UDEV_BATCH_ACTION_REMOVE |
+					     FU_UDEV_BATCH_ACTION_ADD);
+	g_assert_true (event->device == device2);
+	event = g_ptr_array_index (events, 2);
+	g_assert_cmpstr (event->sysfs_path, ==, "/sys/devices/usb1/1-1/1-1.3");
+	g_assert_cmpint (event->actions, ==, FU_UDEV_BATCH_ACTION_CHANGE);
+	event = g_ptr_array_index (events, 3);
+	g_assert_cmpstr (event->sysfs_path, ==, "/sys/devices/usb1/1-1/1-1.4");
+	g_assert_cmpint (event->actions, ==, FU_UDEV_BATCH_ACTION_REMOVE);
+
+	/* the next window starts empty */
+	g_assert_cmpint (fu_udev_batch_get_size (udev_batch), ==, 0);
+}
+
 static void
 fu_memcpy_func (gconstpointer user_data)
 {
@@ -2982,10 +4070,22 @@ main (int argc, char **argv)
 	}
 	g_test_add_data_func ("/fwupd/plugin{build-hash}", self,
 			      fu_plugin_hash_func);
+	g_test_add_data_func ("/fwupd/plugin{module-scale}", self,
+			      fu_plugin_module_scale_func);
+	g_test_add_data_func ("/fwupd/plugin{stats}", self,
+			      fu_plugin_stats_func);
 	g_test_add_data_func ("/fwupd/plugin{module}", self,
 			      fu_plugin_module_func);
 	g_test_add_data_func ("/fwupd/memcpy", self,
 			      fu_memcpy_func);
+	g_test_add_data_func ("/fwupd/trace", self,
+			      fu_trace_func);
+	g_test_add_data_func ("/fwupd/alloc-stats", self,
+			      fu_alloc_stats_func);
+	g_test_add_data_func ("/fwupd/change-stream", self,
+			      fu_change_stream_func);
+	g_test_add_data_func ("/fwupd/udev-batch", self,
+			      fu_udev_batch_func);
 	g_test_add_data_func ("/fwupd/device-list", self,
 			      fu_device_list_func);
 	g_test_add_data_func ("/fwupd/device-list{delay}", self,
@@ -2998,10 +4098,24 @@ main (int argc, char **argv)
 			      fu_install_task_compare_func);
 	g_test_add_data_func ("/fwupd/engine{device-unlock}", self,
 			      fu_engine_device_unlock_func);
+	g_test_add_data_func ("/fwupd/engine{device-progress}", self,
+			      fu_engine_device_progress_func);
+	g_test_add_data_func ("/fwupd/engine{plugin-on-demand}", self,
+			      fu_engine_plugin_on_demand_func);
+	g_test_add_data_func ("/fwupd/engine{plugin-on-demand-tainted}", self,
+			      fu_engine_plugin_on_demand_tainted_func);
+	g_test_add_data_func ("/fwupd/engine{plugin-routes}", self,
+			      fu_engine_plugin_routes_func);
+	g_test_add_data_func ("/fwupd/engine{device-cache}", self,
+			      fu_engine_device_cache_func);
+	g_test_add_data_func ("/fwupd/engine{device-batch}", self,
+			      fu_engine_device_batch_func);
 	g_test_add_data_func ("/fwupd/engine{multiple-releases}", self,
 			      fu_engine_multiple_rels_func);
 	g_test_add_data_func ("/fwupd/engine{history-success}", self,
 			      fu_engine_history_func);
+	g_test_add_data_func ("/fwupd/engine{verify-migrate}", self,
+			      fu_engine_verify_migrate_func);
 	g_test_add_data_func ("/fwupd/engine{history-error}", self,
 			      fu_engine_history_error_func);
 	if (g_test_slow ()) {
@@ -3034,6 +4148,10 @@ main (int argc, char **argv)
 			      fu_engine_requirements_child_fail_func);
 	g_test_add_data_func ("/fwupd/engine{requirements-unsupported}", self,
 			      fu_engine_requirements_unsupported_func);
+	g_test_add_data_func ("/fwupd/engine{requirements-shared}", self,
+			      fu_engine_requirements_shared_func);
+	g_test_add_data_func ("/fwupd/engine{requirements-instance-id}", self,
+			      fu_engine_requirements_instance_id_func);
 	g_test_add_data_func ("/fwupd/engine{requirements-device}", self,
 			      fu_engine_requirements_device_func);
 	g_test_add_data_func ("/fwupd/engine{requirements-device-plain}", self,
@@ -176,6 +176,114 @@ fu_util_smbios_dump (FuUtilPrivate *priv, gchar **values, GError **error)
 	return TRUE;
 }
 
+static gboolean
+fu_util_startup_trace (FuUtilPrivate *priv, gchar **values, GError **error)
+{
+	FuTrace *trace = fu_engine_get_trace (priv->engine);
+	g_autofree gchar *str = NULL;
+
+	if (g_strv_length (values) > 1) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_ARGS,
+				     "Invalid arguments");
+		return FALSE;
+	}
+
+	/* record the engine startup */
+	fu_trace_set_enabled (trace, TRUE);
+	if (!fu_util_start_engine (priv, FU_ENGINE_LOAD_FLAG_NONE, error))
+		return FALSE;
+	str = fu_trace_to_string (trace);
+	g_print ("%s", str);
+
+	/* save for chrome://tracing */
+	if (g_strv_length (values) == 1) {
+		g_autofree gchar *json = fu_trace_to_json (trace, error);
+		if (json == NULL)
+			return FALSE;
+		if (!g_file_set_contents (values[0], json, -1, error))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static gboolean
+fu_util_get_alloc_stats (FuUtilPrivate *priv, gchar **values, GError **error)
+{
+	JsonArray *json_array;
+	JsonNode *json_root;
+	JsonObject *json_object;
+	const gchar *json = NULL;
+	g_autoptr(GDBusConnection) connection = NULL;
+	g_autoptr(GVariant) val = NULL;
+	g_autoptr(JsonParser) parser = json_parser_new ();
+
+	if (g_strv_length (values) > 1) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_ARGS,
+				     "Invalid arguments");
+		return FALSE;
+	}
+
+	/* the interesting numbers are from the long-running daemon */
+	connection = g_bus_get_sync (G_BUS_TYPE_SYSTEM, priv->cancellable, error);
+	if (connection == NULL)
+		return FALSE;
+	val = g_dbus_connection_call_sync (connection,
+					   FWUPD_DBUS_SERVICE,
+					   FWUPD_DBUS_PATH,
+					   FWUPD_DBUS_INTERFACE,
+					   "GetAllocStats",
+					   NULL,
+					   G_VARIANT_TYPE ("(s)"),
+					   G_DBUS_CALL_FLAGS_NONE,
+					   -1,
+					   priv->cancellable,
+					   error);
+	if (val == NULL)
+		return FALSE;
+	g_variant_get (val, "(&s)", &json);
+
+	/* save the raw data for later comparison */
+	if (g_strv_length (values) == 1) {
+		if (!g_file_set_contents (values[0], json, -1, error))
+			return FALSE;
+	}
+
+	/* show a table, the daemon has already sorted by heap growth */
+	if (!json_parser_load_from_data (parser, json, -1, error))
+		return FALSE;
+	json_root = json_parser_get_root (parser);
+	if (!JSON_NODE_HOLDS_OBJECT (json_root) ||
+	    !json_object_has_member (json_node_get_object (json_root), "AllocStats")) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "no AllocStats in daemon response");
+		return FALSE;
+	}
+	json_object = json_node_get_object (json_root);
+	json_array = json_object_get_array_member (json_object, "AllocStats");
+	g_print ("%-8s %-32s %8s %12s %12s %12s %12s\n",
+		 "Category", "Name", "Calls", "Heap", "HeapMax", "Rss", "RssPeak");
+	for (guint i = 0; i < json_array_get_length (json_array); i++) {
+		JsonObject *obj = json_array_get_object_element (json_array, i);
+		g_print ("%-8s %-32s %8" G_GINT64_FORMAT " %12" G_GINT64_FORMAT
+			 " %12" G_GINT64_FORMAT " %12" G_GINT64_FORMAT
+			 " %12" G_GINT64_FORMAT "\n",
+			 json_object_get_string_member (obj, "Category"),
+			 json_object_get_string_member (obj, "Name"),
+			 json_object_get_int_member (obj, "Calls"),
+			 json_object_get_int_member (obj, "Heap"),
+			 json_object_get_int_member (obj, "HeapMax"),
+			 json_object_get_int_member (obj, "Rss"),
+			 json_object_get_int_member (obj, "RssPeak"));
+	}
+	return TRUE;
+}
+
 #ifdef HAVE_GIO_UNIX
 static gboolean
 fu_util_sigint_cb (gpointer user_data)
@@ -265,11 +373,17 @@ static gboolean
 fu_util_get_plugins (FuUtilPrivate *priv, gchar **values, GError **error)
 {
 	GPtrArray *plugins;
+	gboolean verbose = g_getenv ("FWUPD_VERBOSE") != NULL;
 	guint cnt = 0;
 
-	/* load engine */
-	if (!fu_engine_load_plugins (priv->engine, error))
-		return FALSE;
+	/* load engine, fully if showing how long the vfuncs took */
+	if (verbose) {
+		if (!fu_util_start_engine (priv, FU_ENGINE_LOAD_FLAG_NONE, error))
+			return FALSE;
+	} else {
+		if (!fu_engine_load_plugins (priv->engine, error))
+			return FALSE;
+	}
 
 	/* print */
 	plugins = fu_engine_get_plugins (priv->engine);
@@ -279,6 +393,11 @@ fu_util_get_plugins (FuUtilPrivate *priv, gchar **values, GError **error)
 		if (!fu_plugin_get_enabled (plugin))
 			continue;
 		g_print ("%s\n", fu_plugin_get_name (plugin));
+		if (verbose) {
+			g_autofree gchar *stats = fu_plugin_stats_to_string (plugin);
+			if (stats != NULL)
+				g_print ("%s", stats);
+		}
 		cnt++;
 	}
 	if (cnt == 0) {
@@ -2031,6 +2150,18 @@ main (int argc, char *argv[])
 		     /* TRANSLATORS: command description */
 		     _("Dump SMBIOS data from a file"),
 		     fu_util_smbios_dump);
+	fu_util_cmd_array_add (cmd_array,
+		     "startup-trace",
+		     "[FILE]",
+		     /* TRANSLATORS: command description */
+		     _("Show the time taken to start the engine"),
+		     fu_util_startup_trace);
+	fu_util_cmd_array_add (cmd_array,
+		     "get-alloc-stats",
+		     "[FILE]",
+		     /* TRANSLATORS: command description */
+		     _("Show memory growth recorded by the daemon"),
+		     fu_util_get_alloc_stats);
 	fu_util_cmd_array_add (cmd_array,
 		     "get-plugins",
 		     NULL,
@@ -0,0 +1,299 @@
+/*
+ * Copyright (C) 2020 The fwupd authors
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#define G_LOG_DOMAIN				"FuTrace"
+
+#include "config.h"
+
+#include <fwupd.h>
+#include <json-glib/json-glib.h>
+
+#include "fu-trace.h"
+
+/**
+ * SECTION:fu-trace
+ * @short_description: a hierarchical timing recorder
+ *
+ * This object records nested spans of time, for instance the startup phases
+ * of the engine, the plugins run in each phase and the devices added by each
+ * plugin. When disabled, beginning and ending a span does nothing.
+ *
+ * The spans can be exported in the Chrome trace event format, which can be
+ * loaded into `chrome://tracing` or https://ui.perfetto.dev/
+ *
+ * Open spans are kept on a single stack, so every span has to be ended on the
+ * thread that began it; in the daemon that is always the main loop.
+ */
+
+struct _FuTrace
+{
+	GObject			 parent_instance;
+	gboolean		 enabled;
+	gint64			 epoch;		/* us */
+	GPtrArray		*events;	/* of FuTraceEvent */
+	GPtrArray		*stack;		/* of FuTraceEvent */
+};
+
+typedef struct {
+	gchar			*category;
+	gchar			*name;
+	gint64			 begin;		/* us since epoch */
+	gint64			 end;		/* us since epoch, or -1 */
+	guint			 depth;
+} FuTraceEvent;
+
+G_DEFINE_TYPE (FuTrace, fu_trace, G_TYPE_OBJECT)
+
+static void
+fu_trace_event_free (FuTraceEvent *event)
+{
+	g_free (event->category);
+	g_free (event->name);
+	g_free (event);
+}
+
+/* spans that were never ended, e.g. on error, finish now */
+static gint64
+fu_trace_event_get_end (FuTrace *self, FuTraceEvent *event)
+{
+	if (event->end >= 0)
+		return event->end;
+	return g_get_monotonic_time () - self->epoch;
+}
+
+/**
+ * fu_trace_set_enabled:
+ * @self: A #FuTrace
+ * @enabled: %TRUE to record spans
+ *
+ * Enables or disables recording. Any spans already recorded are kept.
+ **/
+void
+fu_trace_set_enabled (FuTrace *self, gboolean enabled)
+{
+	g_return_if_fail (FU_IS_TRACE (self));
+	self->enabled = enabled;
+}
+
+/**
+ * fu_trace_get_enabled:
+ * @self: A #FuTrace
+ *
+ * Gets if spans are being recorded.
+ *
+ * Returns: %TRUE if enabled
+ **/
+gboolean
+fu_trace_get_enabled (FuTrace *self)
+{
+	g_return_val_if_fail (FU_IS_TRACE (self), FALSE);
+	return self->enabled;
+}
+
+/**
+ * fu_trace_begin:
+ * @self: A #FuTrace
+ * @category: A category, e.g. `phase`, `plugin` or `device`
+ * @name: A name, e.g. `coldplug`
+ *
+ * Begins a span of time, which is nested in any span that has not yet ended.
+ **/
+void
+fu_trace_begin (FuTrace *self, const gchar *category, const gchar *name)
+{
+	FuTraceEvent *event;
+
+	/* fast path */
+	if (!self->enabled)
+		return;
+
+	event = g_new0 (FuTraceEvent, 1);
+	event->category = g_strdup (category);
+	event->name = g_strdup (name);
+	event->begin = g_get_monotonic_time () - self->epoch;
+	event->end = -1;
+	event->depth = self->stack->len;
+	g_ptr_array_add (self->events, event);
+	g_ptr_array_add (self->stack, event);
+}
+
+/**
+ * fu_trace_end:
+ * @self: A #FuTrace
+ *
+ * Ends the most recently begun span of time.
+ **/
+void
+fu_trace_end (FuTrace *self)
+{
+	FuTraceEvent *event;
+
+	/* fast path */
+	if (!self->enabled)
+		return;
+	if (self->stack->len == 0) {
+		g_warning ("no trace span to end");
+		return;
+	}
+	event = g_ptr_array_index (self->stack, self->stack->len - 1);
+	event->end = g_get_monotonic_time () - self->epoch;
+	g_ptr_array_remove_index (self->stack, self->stack->len - 1);
+}
+
+/**
+ * fu_trace_get_size:
+ * @self: A #FuTrace
+ *
+ * Gets the number of recorded spans.
+ *
+ * Returns: integer
+ **/
+guint
+fu_trace_get_size (FuTrace *self)
+{
+	g_return_val_if_fail (FU_IS_TRACE (self), 0);
+	return self->events->len;
+}
+
+/**
+ * fu_trace_to_string:
+ * @self: A #FuTrace
+ *
+ * Exports the recorded spans as an indented tree, in the order they began.
+ *
+ * Returns: (transfer full): a string
+ **/
+gchar *
+fu_trace_to_string (FuTrace *self)
+{
+	GString *str = g_string_new (NULL);
+
+	g_return_val_if_fail (FU_IS_TRACE (self), NULL);
+
+	for (guint i = 0; i < self->events->len; i++) {
+		FuTraceEvent *event = g_ptr_array_index (self->events, i);
+		gint64 duration = fu_trace_event_get_end (self, event) - event->begin;
+		g_string_append_printf (str, "%9.3fms ", (gdouble) duration / 1000.f);
+		for (guint j = 0; j < event->depth; j++)
+			g_string_append (str, "  ");
+		g_string_append_printf (str, "%s:%s\n", event->category, event->name);
+	}
+	return g_string_free (str, FALSE);
+}
+
+/**
+ * fu_trace_to_json:
+ * @self: A #FuTrace
+ * @error: A #GError, or %NULL
+ *
+ * Exports the recorded spans as complete events in the Chrome trace event
+ * format, with all times in microseconds.
+ *
+ * Returns: (transfer full): a JSON string, or %NULL for error
+ **/
+gchar *
+fu_trace_to_json (FuTrace *self, GError **error)
+{
+	g_autofree gchar *data = NULL;
+	g_autoptr(JsonBuilder) builder = json_builder_new ();
+	g_autoptr(JsonGenerator) json_generator = NULL;
+	g_autoptr(JsonNode) json_root = NULL;
+
+	g_return_val_if_fail (FU_IS_TRACE (self), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	json_builder_begin_object (builder);
+	json_builder_set_member_name (builder, "displayTimeUnit");
+	json_builder_add_string_value (builder, "ms");
+	json_builder_set_member_name (builder, "traceEvents");
+	json_builder_begin_array (builder);
+	for (guint i = 0; i < self->events->len; i++) {
+		FuTraceEvent *event = g_ptr_array_index (self->events, i);
+		json_builder_begin_object (builder);
+		json_builder_set_member_name (builder, "name");
+		json_builder_add_string_value (builder, event->name);
+		json_builder_set_member_name (builder, "cat");
+		json_builder_add_string_value (builder, event->category);
+		json_builder_set_member_name (builder, "ph");
+		json_builder_add_string_value (builder, "X");
+		json_builder_set_member_name (builder, "ts");
+		json_builder_add_int_value (builder, event->begin);
+		json_builder_set_member_name (builder, "dur");
+		json_builder_add_int_value (builder, fu_trace_event_get_end (self, event) - event->begin);
+		json_builder_set_member_name (builder, "pid");
+		json_builder_add_int_value (builder, 1);
+		json_builder_set_member_name (builder, "tid");
+		json_builder_add_int_value (builder, 1);
+		json_builder_set_member_name (builder, "args");
+		json_builder_begin_object (builder);
+		json_builder_set_member_name (builder, "depth");
+		json_builder_add_int_value (builder, event->depth);
+		if (event->end < 0) {
+			json_builder_set_member_name (builder, "incomplete");
+			json_builder_add_boolean_value (builder, TRUE);
+		}
+		json_builder_end_object (builder);
+		json_builder_end_object (builder);
+	}
+	json_builder_end_array (builder);
+	json_builder_end_object (builder);
+
+	/* export as a string */
+	json_root = json_builder_get_root (builder);
+	json_generator = json_generator_new ();
+	json_generator_set_pretty (json_generator, TRUE);
+	json_generator_set_root (json_generator, json_root);
+	data = json_generator_to_data (json_generator, NULL);
+	if (data == NULL) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INTERNAL,
+				     "Failed to convert trace to JSON");
+		return NULL;
+	}
+	return g_steal_pointer (&data);
+}
+
+static void
+fu_trace_init (FuTrace *self)
+{
+	self->epoch = g_get_monotonic_time ();
+	self->events = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_trace_event_free);
+	self->stack = g_ptr_array_new ();
+}
+
+static void
+fu_trace_finalize (GObject *object)
+{
+	FuTrace *self = FU_TRACE (object);
+
+	g_ptr_array_unref (self->events);
+	g_ptr_array_unref (self->stack);
+
+	G_OBJECT_CLASS (fu_trace_parent_class)->finalize (object);
+}
+
+static void
+fu_trace_class_init (FuTraceClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = fu_trace_finalize;
+}
+
+/**
+ * fu_trace_new:
+ *
+ * Creates a new timing recorder, which is disabled by default.
+ *
+ * Returns: (transfer full): the #FuTrace
+ **/
+FuTrace *
+fu_trace_new (void)
+{
+	FuTrace *self;
+	self = g_object_new (FU_TYPE_TRACE, NULL);
+	return FU_TRACE (self);
+}
@@ -0,0 +1,25 @@
+/*
+ * Copyright (C) 2020 The fwupd authors
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#pragma once
+
+#include <glib-object.h>
+
+#define FU_TYPE_TRACE (fu_trace_get_type ())
+G_DECLARE_FINAL_TYPE (FuTrace, fu_trace, FU, TRACE, GObject)
+
+FuTrace		*fu_trace_new			(void);
+void		 fu_trace_set_enabled		(FuTrace	*self,
+						 gboolean	 enabled);
+gboolean	 fu_trace_get_enabled		(FuTrace	*self);
+void		 fu_trace_begin			(FuTrace	*self,
+						 const gchar	*category,
+						 const gchar	*name);
+void		 fu_trace_end			(FuTrace	*self);
+guint		 fu_trace_get_size		(FuTrace	*self);
+gchar		*fu_trace_to_string		(FuTrace	*self);
+gchar		*fu_trace_to_json		(FuTrace	*self,
+						 GError		**error);
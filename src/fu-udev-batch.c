@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) 2020 The fwupd authors
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#define G_LOG_DOMAIN				"FuUdevBatch"
+
+#include "config.h"
+
+#include "fu-udev-batch.h"
+
+/**
+ * SECTION:fu-udev-batch
+ * @short_description: coalesced uevents
+ *
+ * This object merges the uevents for each sysfs path that arrive within a
+ * short window, so that a device that is removed and added again while
+ * switching modes is only probed once, and a change is dropped when the
+ * device is going to be probed anyway.
+ *
+ * The events are returned sorted by sysfs path, so that a parent is always
+ * processed before its children.
+ */
+
+struct _FuUdevBatch
+{
+	GObject			 parent_instance;
+	GHashTable		*events;	/* sysfs:FuUdevBatchEvent */
+};
+
+G_DEFINE_TYPE (FuUdevBatch, fu_udev_batch, G_TYPE_OBJECT)
+
+static void
+fu_udev_batch_event_free (FuUdevBatchEvent *event)
+{
+	g_free (event->sysfs_path);
+	if (event->device != NULL)
+		g_object_unref (event->device);
+	g_free (event);
+}
+
+static GHashTable *
+fu_udev_batch_events_new (void)
+{
+	return g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+				      (GDestroyNotify) fu_udev_batch_event_free);
+}
+
+/**
+ * fu_udev_batch_add:
+ * @self: A #FuUdevBatch
+ * @sysfs_path: The sysfs path of the device
+ * @device: (nullable): The object to return with the event, e.g. a #GUdevDevice
+ * @action: A #FuUdevBatchAction, e.g. %FU_UDEV_BATCH_ACTION_ADD
+ *
+ * Merges a uevent with any other pending event for the same path. The most
+ * recent @device is kept.
+ **/
+void
+fu_udev_batch_add (FuUdevBatch *self,
+		   const gchar *sysfs_path,
+		   GObject *device,
+		   FuUdevBatchAction action)
+{
+	FuUdevBatchEvent *event;
+
+	g_return_if_fail (FU_IS_UDEV_BATCH (self));
+	g_return_if_fail (sysfs_path != NULL);
+
+	event = g_hash_table_lookup (self->events, sysfs_path);
+	if (event == NULL) {
+		event = g_new0 (FuUdevBatchEvent, 1);
+		event->sysfs_path = g_strdup (sysfs_path);
+		g_hash_table_insert (self->events, event->sysfs_path, event);
+	}
+	g_set_object (&event->device, device);
+
+	/* add->remove->add is a single remove and add, and a change is
+	 * only needed when the device is not going to be probed again */
+	if (action == FU_UDEV_BATCH_ACTION_ADD) {
+		event->actions = (event->actions & FU_UDEV_BATCH_ACTION_REMOVE) |
+				 FU_UDEV_BATCH_ACTION_ADD;
+	} else if (action == FU_UDEV_BATCH_ACTION_REMOVE) {
+		event->actions = FU_UDEV_BATCH_ACTION_REMOVE;
+	} else if (action == FU_UDEV_BATCH_ACTION_CHANGE) {
+		if (event->actions == FU_UDEV_BATCH_ACTION_NONE)
+			event->actions = FU_UDEV_BATCH_ACTION_CHANGE;
+	}
+}
+
+/**
+ * fu_udev_batch_get_size:
+ * @self: A #FuUdevBatch
+ *
+ * Gets the number of sysfs paths with a pending event.
+ *
+ * Returns: integer
+ **/
+guint
+fu_udev_batch_get_size (FuUdevBatch *self)
+{
+	g_return_val_if_fail (FU_IS_UDEV_BATCH (self), 0);
+	return g_hash_table_size (self->events);
+}
+
+static gint
+fu_udev_batch_event_sort_cb (gconstpointer a, gconstpointer b)
+{
+	FuUdevBatchEvent *event1 = *((FuUdevBatchEvent **) a);
+	FuUdevBatchEvent *event2 = *((FuUdevBatchEvent **) b);
+	return g_strcmp0 (event1->sysfs_path, event2->sysfs_path);
+}
+
+/**
+ * fu_udev_batch_steal:
+ * @self: A #FuUdevBatch
+ *
+ * Gets all the pending events and empties the batch, so that new events can
+ * be added while the returned ones are being processed.
+ *
+ * Returns: (transfer container) (element-type FuUdevBatchEvent): events,
+ * sorted by sysfs path
+ **/
+GPtrArray *
+fu_udev_batch_steal (FuUdevBatch *self)
+{
+	GHashTableIter iter;
+	gpointer value;
+	GPtrArray *events;
+	g_autoptr(GHashTable) events_old = NULL;
+
+	g_return_val_if_fail (FU_IS_UDEV_BATCH (self), NULL);
+
+	events_old = self->events;
+	self->events = fu_udev_batch_events_new ();
+	events = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_udev_batch_event_free);
+	g_hash_table_iter_init (&iter, events_old);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		g_ptr_array_add (events, value);
+		g_hash_table_iter_steal (&iter);
+	}
+	g_ptr_array_sort (events, fu_udev_batch_event_sort_cb);
+	return events;
+}
+
+static void
+fu_udev_batch_finalize (GObject *object)
+{
+	FuUdevBatch *self = FU_UDEV_BATCH (object);
+	g_hash_table_unref (self->events);
+	G_OBJECT_CLASS (fu_udev_batch_parent_class)->finalize (object);
+}
+
+static void
+fu_udev_batch_class_init (FuUdevBatchClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = fu_udev_batch_finalize;
+}
+
+static void
+fu_udev_batch_init (FuUdevBatch *self)
+{
+	self->events = fu_udev_batch_events_new ();
+}
+
+/**
+ * fu_udev_batch_new:
+ *
+ * Creates a new batch of uevents.
+ *
+ * Returns: a #FuUdevBatch
+ **/
+FuUdevBatch *
+fu_udev_batch_new (void)
+{
+	FuUdevBatch *self;
+	self = g_object_new (FU_TYPE_UDEV_BATCH, NULL);
+	return FU_UDEV_BATCH (self);
+}
@@ -0,0 +1,33 @@
+/*
+ * Copyright (C) 2020 The fwupd authors
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#pragma once
+
+#include <glib-object.h>
+
+#define FU_TYPE_UDEV_BATCH (fu_udev_batch_get_type ())
+G_DECLARE_FINAL_TYPE (FuUdevBatch, fu_udev_batch, FU, UDEV_BATCH, GObject)
+
+typedef enum {
+	FU_UDEV_BATCH_ACTION_NONE		= 0,
+	FU_UDEV_BATCH_ACTION_REMOVE		= 1 << 0,
+	FU_UDEV_BATCH_ACTION_ADD		= 1 << 1,
+	FU_UDEV_BATCH_ACTION_CHANGE		= 1 << 2,
+} FuUdevBatchAction;
+
+typedef struct {
+	gchar			*sysfs_path;
+	GObject			*device;
+	FuUdevBatchAction	 actions;
+} FuUdevBatchEvent;
+
+FuUdevBatch	*fu_udev_batch_new		(void);
+void		 fu_udev_batch_add		(FuUdevBatch	*self,
+						 const gchar	*sysfs_path,
+						 GObject	*device,
+						 FuUdevBatchAction action);
+guint		 fu_udev_batch_get_size		(FuUdevBatch	*self);
+GPtrArray	*fu_udev_batch_steal		(FuUdevBatch	*self);